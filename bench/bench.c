@@ -0,0 +1,82 @@
+#include <stddef.h>
+#include "bench.h"
+#include "printf.h"
+
+static uint32_t bench_samples[BENCH_MAX_SAMPLES];
+static uint32_t bench_overhead;
+
+static void _bench_empty(void *ctx) {
+  (void)ctx;
+}
+
+static void _bench_sort(uint32_t *v, uint32_t n) {
+  uint32_t gap, i, j, tmp;
+
+  for (gap = n / 2; gap > 0; gap /= 2) {
+    for (i = gap; i < n; i++) {
+      tmp = v[i];
+      for (j = i; j >= gap && v[j - gap] > tmp; j -= gap) {
+        v[j] = v[j - gap];
+      }
+      v[j] = tmp;
+    }
+  }
+}
+
+void bench_init(void) {
+  bench_result_t res;
+
+  bench_overhead = 0;
+  bench_run("harness", "overhead", _bench_empty, NULL, NULL, BENCH_MAX_SAMPLES, &res);
+  bench_overhead = res.min;
+}
+
+void bench_run(const char *suite, const char *name, bench_fn_t fn, bench_fn_t prepare, void *ctx,
+               uint32_t n, bench_result_t *res) {
+  uint32_t i, start, elapsed;
+
+  if (n > BENCH_MAX_SAMPLES) n = BENCH_MAX_SAMPLES;
+
+  for (i = 0; i < n; i++) {
+    if (prepare != NULL) prepare(ctx);
+    start = bench_now();
+    fn(ctx);
+    elapsed = bench_now() - start;
+    bench_samples[i] = (elapsed > bench_overhead) ? (elapsed - bench_overhead) : 0;
+  }
+
+  bench_collect(suite, name, bench_samples, n, res);
+}
+
+void bench_collect(const char *suite, const char *name, uint32_t *samples, uint32_t n, bench_result_t *res) {
+  uint64_t sum = 0;
+  uint32_t i;
+
+  res->suite = suite;
+  res->name = name;
+  res->n = n;
+  if (n == 0) {
+    res->min = res->avg = res->max = res->p50 = res->p90 = res->p99 = 0;
+    return;
+  }
+
+  _bench_sort(samples, n);
+  for (i = 0; i < n; i++) {
+    sum += samples[i];
+  }
+
+  res->min = samples[0];
+  res->max = samples[n - 1];
+  res->avg = (uint32_t)(sum / n);
+  res->p50 = samples[(n * 50) / 100];
+  res->p90 = samples[(n * 90) / 100];
+  res->p99 = samples[(n * 99) / 100];
+}
+
+void bench_report(const bench_result_t *res) {
+  printf("{\"suite\":\"%s\",\"bench\":\"%s\",\"unit\":\"" BENCH_UNIT "\",\"n\":%u,"
+         "\"min\":%u,\"avg\":%u,\"max\":%u,\"p50\":%u,\"p90\":%u,\"p99\":%u}\r\n",
+         res->suite, res->name, (unsigned)res->n,
+         (unsigned)res->min, (unsigned)res->avg, (unsigned)res->max,
+         (unsigned)res->p50, (unsigned)res->p90, (unsigned)res->p99);
+}
@@ -0,0 +1,97 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Micro-benchmark harness.
+ * On target samples are core cycles from DWT->CYCCNT; the host build
+ * (BENCH_HOST, simulated peripherals) samples a monotonic clock in ns.
+ * Results are printed as one JSON object per line.
+ */
+
+#define BENCH_MAX_SAMPLES   512U
+
+#ifdef BENCH_HOST
+#define BENCH_UNIT          "ns"
+uint32_t bench_now(void);
+#else
+#include "stm32h563.h"
+#define BENCH_UNIT          "cycles"
+static inline uint32_t bench_now(void) {
+  return DWT->CYCCNT;
+}
+#endif
+
+typedef struct {
+  const char *suite;
+  const char *name;
+  uint32_t n;
+  uint32_t min;
+  uint32_t avg;
+  uint32_t max;
+  uint32_t p50;
+  uint32_t p90;
+  uint32_t p99;
+} bench_result_t;
+
+typedef void (*bench_fn_t)(void *ctx);
+
+/**
+ * @brief Start the sample clock and measure the harness overhead,
+ * which bench_run() subtracts from every sample.
+ */
+void bench_init(void);
+
+/**
+ * @brief Time 'n' calls of fn (at most BENCH_MAX_SAMPLES).
+ * @param prepare Untimed call before each sample (refill a FIFO, ...), may be NULL.
+ */
+void bench_run(const char *suite, const char *name, bench_fn_t fn, bench_fn_t prepare, void *ctx,
+               uint32_t n, bench_result_t *res);
+
+/**
+ * @brief Aggregate samples taken by the caller (e.g. inside an ISR).
+ * The array is sorted in place.
+ */
+void bench_collect(const char *suite, const char *name, uint32_t *samples, uint32_t n, bench_result_t *res);
+
+/**
+ * @brief Print one result as a JSON line.
+ */
+void bench_report(const bench_result_t *res);
+
+/* Benchmark suites */
+void bench_rcc(void);
+void bench_timebase(void);
+void bench_fdcan(void);
+void bench_fdcan_deadline(void);
+void bench_fdcan_stats(void);
+void bench_printf(void);
+void bench_printf_cpp(void);
+void bench_can_trace(void);
+void bench_slcan(void);
+void bench_can_mailbox(void);
+void bench_can_change(void);
+void bench_can_txq(void);
+void bench_can_busload(void);
+void bench_can_selftest(void);
+void bench_can_sniffer(void);
+void bench_can_autobaud(void);
+void bench_can_health(void);
+void bench_can_latency(void);
+void bench_can_replay(void);
+void bench_trace(void);
+void bench_fdcan_cpp(void);
+void bench_fdcan_mp(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
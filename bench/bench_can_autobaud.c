@@ -0,0 +1,206 @@
+#include <stddef.h>
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+#include "can/can_autobaud.h"
+
+#define BENCH_AUTOBAUD_ITERATIONS  256U
+#define BENCH_AUTOBAUD_SEEDS       16U
+#define BENCH_AUTOBAUD_POLL_NS     10000U   // simulated time between two polls
+#define BENCH_AUTOBAUD_CONFIG_NS   20000U   // fdcan_init() and PSR/IR clear per candidate
+
+/*
+ * Simulated bus behind the autobaud port, in simulated time, so the same
+ * runs on host and target. Frames follow each other with uniform random
+ * gaps for the requested load; half of the frames on an FD bus are 64-byte
+ * BRS frames. What the controller reports at a candidate rate:
+ *   - nothing until it saw 11 recessive bits (at its own rate) since it was
+ *     configured or since the previous frame: bus integration
+ *   - the right nominal rate: the frame, or a data phase error for a BRS
+ *     frame at the wrong data rate (or at no data rate)
+ *   - any other nominal rate: an arbitration phase error
+ * Evidence is reported at the end of the frame.
+ */
+typedef struct {
+  uint32_t nominal_bps;
+  uint32_t data_bps;          // 0: classic bus
+  uint32_t load_permille;
+  uint32_t seed;
+  uint64_t now_ns;
+  uint64_t start_ns;          // next frame
+  uint64_t end_ns;
+  uint64_t prev_end_ns;
+  bool     brs;
+  uint32_t cand_nominal;
+  uint32_t cand_data;
+  uint64_t configured_ns;
+} bench_ab_bus_t;
+
+static bench_ab_bus_t bench_ab_bus;
+
+static uint32_t _bench_ab_rand(bench_ab_bus_t *b) {
+  b->seed = b->seed * 1103515245U + 12345U;
+  return b->seed >> 8;
+}
+
+static void _bench_ab_next_frame(bench_ab_bus_t *b) {
+  uint64_t len_ns, gap_ns;
+
+  b->prev_end_ns = b->end_ns;
+  b->brs = (b->data_bps != 0) && (_bench_ab_rand(b) & 1);
+  if (b->brs) {
+    // ~30 arbitration + ~14 end bits nominal, ~580 data phase bits
+    len_ns = 44ULL * 1000000000ULL / b->nominal_bps + 580ULL * 1000000000ULL / b->data_bps;
+  } else {
+    // 8 byte classic frame with typical stuffing, 3 bit intermission
+    len_ns = 125ULL * 1000000000ULL / b->nominal_bps;
+  }
+  gap_ns = 3ULL * 1000000000ULL / b->nominal_bps;
+  gap_ns += (len_ns * (1000 - b->load_permille) / b->load_permille) * (_bench_ab_rand(b) % 2001) / 1000;
+
+  b->start_ns = b->end_ns + gap_ns;
+  b->end_ns = b->start_ns + len_ns;
+}
+
+static int _bench_ab_configure(void *ctx, uint32_t nominal_bps, uint32_t data_bps) {
+  bench_ab_bus_t *b = ctx;
+
+  b->now_ns += BENCH_AUTOBAUD_CONFIG_NS;
+  b->cand_nominal = nominal_bps;
+  b->cand_data = data_bps;
+  b->configured_ns = b->now_ns;
+  return 0;
+}
+
+static void _bench_ab_sample(void *ctx, can_autobaud_evidence_t *ev) {
+  bench_ab_bus_t *b = ctx;
+  uint64_t idle_from, integrate_ns;
+
+  memset(ev, 0, sizeof(*ev));
+  b->now_ns += BENCH_AUTOBAUD_POLL_NS;
+
+  while (b->end_ns <= b->now_ns) {
+    idle_from = (b->prev_end_ns > b->configured_ns) ? b->prev_end_ns : b->configured_ns;
+    integrate_ns = 11ULL * 1000000000ULL / b->cand_nominal;
+
+    if (b->start_ns >= idle_from + integrate_ns) {
+      if (b->cand_nominal != b->nominal_bps) {
+        ev->errors++;
+      } else if (!b->brs) {
+        ev->frames++;
+      } else if (b->cand_data == b->data_bps) {
+        ev->frames++;
+        ev->brs_frames++;
+      } else {
+        ev->data_errors++;
+      }
+    }
+    _bench_ab_next_frame(b);
+  }
+}
+
+static uint64_t _bench_ab_now_us(void *ctx) {
+  return ((bench_ab_bus_t *)ctx)->now_ns / 1000U;
+}
+
+static const can_autobaud_port_t bench_ab_port = {
+  .configure = _bench_ab_configure,
+  .sample = _bench_ab_sample,
+  .now_us = _bench_ab_now_us,
+};
+
+static const uint32_t bench_ab_loads[] = { 200, 500 };
+
+static void _bench_ab_run(uint32_t nominal_bps, uint32_t data_bps) {
+  can_autobaud_config_t cfg = { .fd = true };
+  can_autobaud_result_t res;
+  can_autobaud_t ab;
+  uint32_t l, s, runs = 0, wrong = 0, failed = 0, max_lock = 0, max_total = 0, max_candidates = 0;
+  uint64_t sum_lock = 0;
+
+  for (l = 0; l < sizeof(bench_ab_loads) / sizeof(bench_ab_loads[0]); l++) {
+    for (s = 0; s < BENCH_AUTOBAUD_SEEDS; s++) {
+      memset(&bench_ab_bus, 0, sizeof(bench_ab_bus));
+      bench_ab_bus.nominal_bps = nominal_bps;
+      bench_ab_bus.data_bps = data_bps;
+      bench_ab_bus.load_permille = bench_ab_loads[l];
+      bench_ab_bus.seed = 0xA070BA0DU + s * 7919U + l;
+      // join at a random point of the traffic
+      bench_ab_bus.now_ns = _bench_ab_rand(&bench_ab_bus) % 20000000U;
+      _bench_ab_next_frame(&bench_ab_bus);
+
+      can_autobaud_init(&ab, &cfg, &bench_ab_port, &bench_ab_bus);
+      while (can_autobaud_poll(&ab) == 0);
+      can_autobaud_get_result(&ab, &res);
+
+      runs++;
+      if (res.nominal_bps == 0) {
+        failed++;
+        continue;
+      }
+      if (res.nominal_bps != nominal_bps || res.data_bps != data_bps) wrong++;
+      sum_lock += res.lock_us;
+      if (res.lock_us > max_lock) max_lock = res.lock_us;
+      if (res.total_us > max_total) max_total = res.total_us;
+      if (res.candidates > max_candidates) max_candidates = res.candidates;
+    }
+  }
+
+  printf("{\"suite\":\"can_autobaud\",\"bench\":\"detect\",\"nominal_bps\":%u,\"data_bps\":%u,\"runs\":%u,"
+         "\"avg_lock_us\":%u,\"max_lock_us\":%u,\"max_total_us\":%u,\"max_candidates\":%u,\"wrong\":%u,"
+         "\"failed\":%u,\"errors\":%u}\r\n",
+         (unsigned)nominal_bps, (unsigned)data_bps, (unsigned)runs,
+         (unsigned)((runs > failed) ? sum_lock / (runs - failed) : 0), (unsigned)max_lock, (unsigned)max_total,
+         (unsigned)max_candidates, (unsigned)wrong, (unsigned)failed, (unsigned)(wrong + failed));
+}
+
+/* Quiet bus, nothing to report: the cost of one poll */
+static int _bench_ab_idle_configure(void *ctx, uint32_t nominal_bps, uint32_t data_bps) {
+  (void)ctx;
+  (void)nominal_bps;
+  (void)data_bps;
+  return 0;
+}
+
+static void _bench_ab_idle_sample(void *ctx, can_autobaud_evidence_t *ev) {
+  (void)ctx;
+  memset(ev, 0, sizeof(*ev));
+}
+
+static uint64_t _bench_ab_idle_now_us(void *ctx) {
+  (void)ctx;
+  return 0;
+}
+
+static const can_autobaud_port_t bench_ab_idle_port = {
+  .configure = _bench_ab_idle_configure,
+  .sample = _bench_ab_idle_sample,
+  .now_us = _bench_ab_idle_now_us,
+};
+
+static can_autobaud_t bench_ab_idle;
+
+static void _bench_ab_poll(void *ctx) {
+  (void)ctx;
+  (void)can_autobaud_poll(&bench_ab_idle);
+}
+
+void bench_can_autobaud(void) {
+  static const uint32_t classic[] = { 1000000, 800000, 500000, 250000, 125000, 100000, 50000 };
+  static const can_autobaud_config_t idle_cfg = { .fd = true };
+  bench_result_t res;
+  uint32_t i;
+
+  for (i = 0; i < sizeof(classic) / sizeof(classic[0]); i++) {
+    _bench_ab_run(classic[i], 0);
+  }
+  _bench_ab_run(500000, 2000000);
+  _bench_ab_run(500000, 4000000);
+  _bench_ab_run(1000000, 5000000);
+  _bench_ab_run(1000000, 8000000);
+  _bench_ab_run(250000, 1000000);
+
+  can_autobaud_init(&bench_ab_idle, &idle_cfg, &bench_ab_idle_port, NULL);
+  bench_run("can_autobaud", "poll_idle", _bench_ab_poll, NULL, NULL, BENCH_AUTOBAUD_ITERATIONS, &res);
+  bench_report(&res);
+}
@@ -0,0 +1,240 @@
+#include <stddef.h>
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+#include "can/can_busload.h"
+
+#define BENCH_BUSLOAD_ITERATIONS  256U
+#define BENCH_BUSLOAD_FRAMES      20000U
+
+static const uint8_t bench_bl_dlc_bytes[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+
+static can_busload_t bench_bl;
+static uint8_t bench_bl_data[64];
+static uint32_t bench_bl_id;
+static uint8_t bench_bl_flags;
+static uint8_t bench_bl_dlc;
+
+/*
+ * Bit-level reference: the frame is laid out field by field as on the wire,
+ * stuffed by appending a complement bit after every five equal bits, and
+ * counted per bitrate phase.
+ */
+typedef struct {
+  uint8_t bit[1024];
+  uint8_t data_phase[1024];
+  uint32_t n;
+} bench_bl_stream_t;
+
+static bench_bl_stream_t bench_bl_raw;
+static bench_bl_stream_t bench_bl_wire;
+
+static void _bench_bl_push(bench_bl_stream_t *s, uint64_t value, uint32_t nbits, bool data_phase) {
+  while (nbits-- > 0) {
+    s->bit[s->n] = (uint8_t)((value >> nbits) & 1);
+    s->data_phase[s->n] = data_phase;
+    s->n++;
+  }
+}
+
+static void _bench_bl_reference(uint32_t id, uint8_t flags, uint8_t dlc, const uint8_t *data,
+                                can_busload_bits_t *bits) {
+  bool fd = (flags & CAN_BUSLOAD_FDF) != 0, brs = fd && (flags & CAN_BUSLOAD_BRS) != 0;
+  bool xtd = (flags & CAN_BUSLOAD_XTD) != 0;
+  uint32_t len = fd ? bench_bl_dlc_bytes[dlc] : ((dlc > 8) ? 8 : dlc);
+  uint32_t i, j, run, crc = 0, nb, stuff = 0, fixed, crc_len, nom = 0, dat = 0;
+
+  bench_bl_raw.n = 0;
+  _bench_bl_push(&bench_bl_raw, 0, 1, false);                          // SOF
+  if (xtd) {
+    _bench_bl_push(&bench_bl_raw, (id >> 18) & 0x7FF, 11, false);
+    _bench_bl_push(&bench_bl_raw, 1, 1, false);                        // SRR
+    _bench_bl_push(&bench_bl_raw, 1, 1, false);                        // IDE
+    _bench_bl_push(&bench_bl_raw, id & 0x3FFFF, 18, false);
+  } else {
+    _bench_bl_push(&bench_bl_raw, id & 0x7FF, 11, false);
+  }
+  if (fd) {
+    _bench_bl_push(&bench_bl_raw, 0, 1, false);                        // RRS
+    if (!xtd) _bench_bl_push(&bench_bl_raw, 0, 1, false);              // IDE
+    _bench_bl_push(&bench_bl_raw, 1, 1, false);                        // FDF
+    _bench_bl_push(&bench_bl_raw, 0, 1, false);                        // res
+    _bench_bl_push(&bench_bl_raw, brs ? 1 : 0, 1, false);              // BRS
+    _bench_bl_push(&bench_bl_raw, (flags & CAN_BUSLOAD_ESI) ? 1 : 0, 1, brs);
+  } else {
+    _bench_bl_push(&bench_bl_raw, 0, 1, false);                        // RTR
+    _bench_bl_push(&bench_bl_raw, 0, 1, false);                        // IDE / r1
+    _bench_bl_push(&bench_bl_raw, 0, 1, false);                        // r0
+  }
+  _bench_bl_push(&bench_bl_raw, dlc, 4, brs);
+  for (i = 0; i < len; i++) {
+    _bench_bl_push(&bench_bl_raw, data[i], 8, brs);
+  }
+  if (!fd) {
+    for (i = 0; i < bench_bl_raw.n; i++) {
+      nb = bench_bl_raw.bit[i] ^ ((crc >> 14) & 1);
+      crc = (crc << 1) & 0x7FFF;
+      if (nb) crc ^= 0x4599;
+    }
+    _bench_bl_push(&bench_bl_raw, crc, 15, false);
+  }
+
+  // dynamic stuffing
+  bench_bl_wire.n = 0;
+  for (i = 0, run = 0; i < bench_bl_raw.n; i++) {
+    _bench_bl_push(&bench_bl_wire, bench_bl_raw.bit[i], 1, bench_bl_raw.data_phase[i]);
+    for (j = 1, run = 1; j < 5 && bench_bl_wire.n > j; j++) {
+      if (bench_bl_wire.bit[bench_bl_wire.n - 1 - j] != bench_bl_raw.bit[i]) break;
+      run++;
+    }
+    // CAN FD: the fixed stuff bit after the data field replaces a dynamic one
+    if (run == 5 && (!fd || i + 1 < bench_bl_raw.n)) {
+      _bench_bl_push(&bench_bl_wire, bench_bl_raw.bit[i] ^ 1, 1, bench_bl_raw.data_phase[i]);
+      stuff++;
+    }
+  }
+
+  if (fd) {
+    crc_len = (len <= 16) ? 17 : 21;
+    fixed = (4 + crc_len + 3) / 4;
+    _bench_bl_push(&bench_bl_wire, 0, 4 + crc_len + fixed, brs);      // stuff count, CRC, fixed stuff bits
+    stuff += fixed;
+  }
+  _bench_bl_push(&bench_bl_wire, 1, 1, brs);                           // CRC delimiter
+  _bench_bl_push(&bench_bl_wire, 0, 12, false);                        // ACK .. intermission
+
+  for (i = 0; i < bench_bl_wire.n; i++) {
+    if (bench_bl_wire.data_phase[i]) dat++; else nom++;
+  }
+  bits->nominal = (uint16_t)nom;
+  bits->data = (uint16_t)dat;
+  bits->stuff = (uint16_t)stuff;
+}
+
+static void _bench_bl_random(uint32_t *seed) {
+  uint32_t j, len, pattern;
+
+  *seed = *seed * 1103515245U + 12345U;
+  bench_bl_flags = 0;
+  switch ((*seed >> 8) & 3) {
+    case 1: bench_bl_flags = CAN_BUSLOAD_XTD; break;
+    case 2: bench_bl_flags = CAN_BUSLOAD_FDF | (((*seed >> 12) & 1) ? CAN_BUSLOAD_BRS : 0); break;
+    case 3: bench_bl_flags = CAN_BUSLOAD_XTD | CAN_BUSLOAD_FDF | CAN_BUSLOAD_BRS; break;
+    default: break;
+  }
+  if (((*seed >> 13) & 7) == 0) bench_bl_flags |= CAN_BUSLOAD_ESI;
+  bench_bl_id = (*seed >> 3) & ((bench_bl_flags & CAN_BUSLOAD_XTD) ? 0x1FFFFFFFU : 0x7FFU);
+  bench_bl_dlc = (uint8_t)((*seed >> 16) & 0xF);
+  len = bench_bl_dlc_bytes[bench_bl_dlc];
+
+  // long runs are what stuffing is about: mix constant, sparse and random payloads
+  pattern = (*seed >> 20) & 3;
+  for (j = 0; j < len; j++) {
+    *seed = *seed * 1103515245U + 12345U;
+    bench_bl_data[j] = (pattern == 0) ? 0x00 : (pattern == 1) ? 0xFF
+                     : (pattern == 2) ? (uint8_t)(((*seed >> 16) & 7) == 0 ? (*seed >> 24) : 0)
+                     : (uint8_t)(*seed >> 24);
+  }
+  if (((*seed >> 10) & 15) == 0) bench_bl_id = (bench_bl_flags & CAN_BUSLOAD_XTD) ? 0 : 0x7FF;
+}
+
+/* Table-driven counts against the reference on random frames of every format */
+static void _bench_bl_check(void) {
+  can_busload_config_t cfg = { 500000, 2000000, CAN_BUSLOAD_STUFF_ACTUAL };
+  can_busload_t worst;
+  can_busload_bits_t got, ref, bound;
+  uint32_t i, seed = 0xB0510ADU, errors = 0, over = 0, max_stuff = 0;
+
+  (void)can_busload_init(&bench_bl, &cfg);
+  cfg.stuffing = CAN_BUSLOAD_STUFF_WORST;
+  (void)can_busload_init(&worst, &cfg);
+
+  for (i = 0; i < BENCH_BUSLOAD_FRAMES; i++) {
+    _bench_bl_random(&seed);
+    can_busload_frame_bits(&bench_bl, bench_bl_id, bench_bl_flags, bench_bl_dlc, bench_bl_data, &got);
+    _bench_bl_reference(bench_bl_id, bench_bl_flags, bench_bl_dlc, bench_bl_data, &ref);
+    can_busload_frame_bits(&worst, bench_bl_id, bench_bl_flags, bench_bl_dlc, bench_bl_data, &bound);
+
+    if (got.nominal != ref.nominal || got.data != ref.data || got.stuff != ref.stuff) errors++;
+    if (bound.nominal < ref.nominal || bound.data < ref.data || bound.stuff < ref.stuff) over++;
+    if (ref.stuff > max_stuff) max_stuff = ref.stuff;
+  }
+
+  printf("{\"suite\":\"can_busload\",\"bench\":\"reference_check\",\"frames\":%u,\"errors\":%u,"
+         "\"worst_below_actual\":%u,\"max_stuff_bits\":%u}\r\n",
+         (unsigned)BENCH_BUSLOAD_FRAMES, (unsigned)errors, (unsigned)over, (unsigned)max_stuff);
+}
+
+/*
+ * 8 byte frames every 500 us at 500 kbit/s for 2 s: every window must read the same load.
+ * After an idle gap longer than the history the windows restart from empty.
+ */
+static void _bench_bl_windows(void) {
+  can_busload_config_t cfg = { 500000, 500000, CAN_BUSLOAD_STUFF_ACTUAL };
+  can_busload_stats_t st;
+  uint32_t expect, wire, errors = 0;
+  uint64_t t, end;
+
+  memset(bench_bl_data, 0x55, 8);
+  (void)can_busload_init(&bench_bl, &cfg);
+  wire = can_busload_wire_ns(&bench_bl, 0x123, 0, 8, bench_bl_data);
+  expect = wire / 500;   // ns per 500 us, in permille
+
+  for (t = 0; t < 2000000; t += 500) {
+    can_busload_record(&bench_bl, 0x123, 0, 8, bench_bl_data, t);
+  }
+  can_busload_get(&bench_bl, t, &st);
+
+  printf("{\"suite\":\"can_busload\",\"bench\":\"windows\",\"wire_ns\":%u,\"expected_permille\":%u,"
+         "\"load_10ms\":%u,\"load_100ms\":%u,\"load_1s\":%u,\"peak_10ms\":%u,\"frames\":%u}\r\n",
+         (unsigned)wire, (unsigned)expect, (unsigned)st.load_10ms_permille, (unsigned)st.load_100ms_permille,
+         (unsigned)st.load_1s_permille, (unsigned)st.peak_10ms_permille, (unsigned)st.frames);
+
+  // 5 s idle from the middle of a bucket: every window reads 0, then the same traffic reads the same load again
+  can_busload_record(&bench_bl, 0x123, 0, 8, bench_bl_data, t + 5000);
+  t += 5000000;
+  can_busload_get(&bench_bl, t, &st);
+  if (st.load_10ms_permille != 0 || st.load_100ms_permille != 0 || st.load_1s_permille != 0) errors++;
+  if (bench_bl.sum_100ms != 0 || bench_bl.sum_1s != 0) errors++;   // below one permille the windows still read 0
+  for (end = t + 1000000; t < end; t += 500) {
+    can_busload_record(&bench_bl, 0x123, 0, 8, bench_bl_data, t);
+  }
+  can_busload_get(&bench_bl, t, &st);
+  if (st.load_100ms_permille != expect || st.load_1s_permille != expect) errors++;
+
+  printf("{\"suite\":\"can_busload\",\"bench\":\"idle_gap\",\"gap_us\":5000000,\"load_100ms\":%u,"
+         "\"load_1s\":%u,\"errors\":%u}\r\n",
+         (unsigned)st.load_100ms_permille, (unsigned)st.load_1s_permille, (unsigned)errors);
+}
+
+static void _bench_bl_record(void *ctx) {
+  (void)ctx;
+  can_busload_record(&bench_bl, bench_bl_id, bench_bl_flags, bench_bl_dlc, bench_bl_data, 1000);
+}
+
+static void _bench_bl_time(const char *name, can_busload_stuffing_t stuffing, uint8_t flags, uint8_t dlc) {
+  can_busload_config_t cfg = { 500000, 2000000, stuffing };
+  bench_result_t res;
+  uint32_t j;
+
+  (void)can_busload_init(&bench_bl, &cfg);
+  bench_bl_id = 0x18FF1234U;
+  bench_bl_flags = flags;
+  bench_bl_dlc = dlc;
+  for (j = 0; j < 64; j++) {
+    bench_bl_data[j] = (uint8_t)(j * 37);
+  }
+
+  bench_run("can_busload", name, _bench_bl_record, NULL, NULL, BENCH_BUSLOAD_ITERATIONS, &res);
+  bench_report(&res);
+}
+
+void bench_can_busload(void) {
+  _bench_bl_check();
+  _bench_bl_windows();
+
+  _bench_bl_time("can_busload_record_worst_dlc8", CAN_BUSLOAD_STUFF_WORST, CAN_BUSLOAD_XTD, 8);
+  _bench_bl_time("can_busload_record_actual_dlc8", CAN_BUSLOAD_STUFF_ACTUAL, CAN_BUSLOAD_XTD, 8);
+  _bench_bl_time("can_busload_record_actual_fd64", CAN_BUSLOAD_STUFF_ACTUAL,
+                 CAN_BUSLOAD_XTD | CAN_BUSLOAD_FDF | CAN_BUSLOAD_BRS, 15);
+}
@@ -0,0 +1,165 @@
+#include <stddef.h>
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+#include "can/can_change.h"
+
+#define BENCH_CHANGE_ITERATIONS  256U
+#define BENCH_CHANGE_FRAMES      8192U
+#define BENCH_CHANGE_IDS         16U
+
+typedef struct {
+  uint32_t key;
+  uint8_t len;
+  uint8_t data[64];
+} bench_change_frame_t;
+
+static can_change_t bench_chg;
+static bench_change_frame_t bench_change_frames[BENCH_CHANGE_FRAMES];
+static uint32_t bench_change_last[CAN_CHANGE_WORDS];
+static uint32_t bench_change_mask[CAN_CHANGE_WORDS];
+static uint8_t bench_change_prev[64];
+static uint32_t bench_change_dispatched;
+static uint32_t bench_change_errors;
+static uint32_t bench_change_next;
+
+/*
+ * Capture modelled on a vehicle bus: every ID carries a rolling counter in
+ * byte 0 and a checksum in its last byte; a few fast IDs have a noisy and a
+ * slowly moving signal, the rest rarely change; one FD frame of 20 bytes.
+ */
+static void _bench_change_generate(void) {
+  uint32_t i, j, slot, seed = 0x2468ACEU;
+  bench_change_frame_t *f;
+  uint8_t sum;
+
+  for (i = 0; i < BENCH_CHANGE_FRAMES; i++) {
+    f = &bench_change_frames[i];
+    slot = i % BENCH_CHANGE_IDS;
+    seed = seed * 1103515245U + 12345U;
+
+    f->key = 0x100 + slot * 0x10;
+    f->len = (slot == 14) ? 20 : 8;
+    if (slot == 15) f->key = 0x18FF0000U | slot | CAN_CHANGE_EXT;
+
+    for (j = 0; j < f->len; j++) {
+      f->data[j] = (uint8_t)(slot * 7 + j);
+    }
+    f->data[0] = (uint8_t)(i / BENCH_CHANGE_IDS);           // rolling counter
+    f->data[4] = (uint8_t)(i / (BENCH_CHANGE_IDS * 256));   // status, changes rarely
+    if (slot < 4) {
+      f->data[2] = (uint8_t)((seed >> 8) & 0x03);           // noisy low bits
+      f->data[3] = (uint8_t)(i / (BENCH_CHANGE_IDS * 16));  // slow signal
+    }
+
+    for (j = 0, sum = 0; j + 1 < f->len; j++) {
+      sum = (uint8_t)(sum + f->data[j]);
+    }
+    f->data[f->len - 1] = (uint8_t)~sum;                    // checksum
+  }
+}
+
+static void _bench_change_handler(void *ctx, uint32_t key, const uint8_t *data, uint8_t len, uint64_t changed) {
+  (void)ctx; (void)key; (void)data; (void)len; (void)changed;
+  bench_change_dispatched++;
+}
+
+static void _bench_change_setup(bool masked) {
+  uint32_t i;
+  int index;
+
+  can_change_init(&bench_chg, NULL, NULL);
+  for (i = 0; i < BENCH_CHANGE_IDS; i++) {
+    index = can_change_add(&bench_chg, bench_change_frames[i].key, _bench_change_handler, NULL);
+    if (masked) {
+      (void)can_change_ignore(&bench_chg, index, 0, 8);                                   // counter
+      (void)can_change_ignore(&bench_chg, index, (bench_change_frames[i].len - 1) * 8U, 8); // checksum
+    }
+  }
+}
+
+/* Feed the capture through the stage and print the fraction of frames not dispatched */
+static void _bench_change_ratio(const char *name, bool masked) {
+  uint32_t i;
+
+  _bench_change_setup(masked);
+  bench_change_dispatched = 0;
+  for (i = 0; i < BENCH_CHANGE_FRAMES; i++) {
+    (void)can_change_process(&bench_chg, bench_change_frames[i].key, bench_change_frames[i].data,
+                             bench_change_frames[i].len);
+  }
+
+  printf("{\"suite\":\"can_change\",\"bench\":\"%s\",\"frames\":%u,\"dispatched\":%u,\"skipped\":%u,"
+         "\"skip_ratio_x1000\":%u}\r\n",
+         name, (unsigned)BENCH_CHANGE_FRAMES, (unsigned)bench_change_dispatched, (unsigned)bench_chg.skipped,
+         (unsigned)(bench_chg.skipped * 1000U / BENCH_CHANGE_FRAMES));
+}
+
+/* Changed-byte bitmaps against a byte-by-byte reference, every length and masked byte position */
+static void _bench_change_check(void) {
+  uint8_t data[64];
+  uint64_t got, want;
+  uint32_t len, j, k, seed = 0x13579BDU;
+
+  bench_change_errors = 0;
+  for (len = 0; len <= 64; len++) {
+    for (k = 0; k < 64; k++) {
+      memset(bench_change_mask, 0xFF, sizeof(bench_change_mask));
+      ((uint8_t *)bench_change_mask)[k] = 0;
+      memset(bench_change_last, 0, sizeof(bench_change_last));
+      memset(bench_change_prev, 0, sizeof(bench_change_prev));
+
+      for (j = 0; j < len; j++) {
+        seed = seed * 1103515245U + 12345U;
+        data[j] = ((seed >> 16) & 1) ? (uint8_t)(seed >> 24) : 0;
+      }
+      (void)can_change_diff(bench_change_last, bench_change_mask, bench_change_prev, len);
+      got = can_change_diff(bench_change_last, bench_change_mask, data, len);
+
+      for (j = 0, want = 0; j < len; j++) {
+        if (j != k && data[j] != 0) want |= 1ULL << j;
+      }
+      if (got != want) bench_change_errors++;
+    }
+  }
+
+  printf("{\"suite\":\"can_change\",\"bench\":\"diff_check\",\"cases\":%u,\"errors\":%u}\r\n",
+         65U * 64U, (unsigned)bench_change_errors);
+}
+
+static void _bench_change_process(void *ctx) {
+  const bench_change_frame_t *f = &bench_change_frames[bench_change_next];
+
+  (void)ctx;
+  (void)can_change_process(&bench_chg, f->key, f->data, f->len);
+}
+
+static void _bench_change_process_prepare(void *ctx) {
+  (void)ctx;
+  bench_change_next = (bench_change_next + 1) % BENCH_CHANGE_FRAMES;
+}
+
+static void _bench_change_diff64(void *ctx) {
+  (void)ctx;
+  (void)can_change_diff(bench_change_last, bench_change_mask, bench_change_frames[14].data, 64);
+}
+
+void bench_can_change(void) {
+  bench_result_t res;
+
+  _bench_change_generate();
+  _bench_change_check();
+  _bench_change_ratio("skip_raw", false);
+  _bench_change_ratio("skip_masked", true);
+
+  bench_change_next = 0;
+  bench_run("can_change", "can_change_process_masked", _bench_change_process, _bench_change_process_prepare, NULL,
+            BENCH_CHANGE_ITERATIONS, &res);
+  bench_report(&res);
+
+  memset(bench_change_mask, 0xFF, sizeof(bench_change_mask));
+  (void)can_change_diff(bench_change_last, bench_change_mask, bench_change_frames[14].data, 64);
+  bench_run("can_change", "can_change_diff_64_unchanged", _bench_change_diff64, NULL, NULL,
+            BENCH_CHANGE_ITERATIONS, &res);
+  bench_report(&res);
+}
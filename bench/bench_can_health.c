@@ -0,0 +1,232 @@
+#include <stddef.h>
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+#include "drivers/fdcan.h"
+#include "can/can_health.h"
+
+#define BENCH_HEALTH_ITERATIONS   256U
+#define BENCH_HEALTH_ERRORS       6000U
+#define BENCH_HEALTH_BUS_OFFS     12U
+#define BENCH_HEALTH_BACKOFF_US   10000U
+#define BENCH_HEALTH_BACKOFF_MAX  160000U
+#define BENCH_HEALTH_SEQUENCE_US  2816U      // 128 x 11 recessive bits at 500 kbit/s
+#define BENCH_HEALTH_FIRST_TX_US  300U
+#define BENCH_HEALTH_TICK_US      1000U
+#define BENCH_HEALTH_SOURCES      (FDCAN_IT_ERROR_PASSIVE | FDCAN_IT_ERROR_WARNING | FDCAN_IT_BUS_OFF | \
+                                   FDCAN_IT_ARB_PROTOCOL_ERROR | FDCAN_IT_DATA_PROTOCOL_ERROR)
+
+#define BENCH_HEALTH_GROUPS       (FDCAN_IT_GROUP_BIT_LINE_ERROR | FDCAN_IT_GROUP_PROTOCOL_ERROR)
+
+#define BENCH_PSR_EP              BIT(5)
+#define BENCH_PSR_EW              BIT(6)
+#define BENCH_PSR_BO              BIT(7)
+
+/*
+ * Controller behaviour replayed on the simulated FDCAN2 registers: the
+ * interrupt sources are set in IR, PSR and ECR hold what the controller
+ * would report, and CCCR.INIT is set on bus-off like the hardware does.
+ * Time is simulated, the back-off runs from 1 ms ticks.
+ */
+static FDCAN_Handle_t bench_h_can;
+static can_health_t bench_h;
+static uint64_t bench_h_now;
+static uint32_t bench_h_code;
+
+static void _bench_h_irq(uint32_t ir, uint32_t psr, uint32_t ecr) {
+  bench_h_can.Instance->IR = ir;
+  bench_h_can.Instance->PSR = psr;
+  bench_h_can.Instance->ECR = ecr;
+  can_health_isr(&bench_h, bench_h_now);
+}
+
+static uint32_t _bench_h_flags(uint32_t tec) {
+  return ((tec >= 96) ? BENCH_PSR_EW : 0) | ((tec >= 128) ? BENCH_PSR_EP : 0);
+}
+
+static void _bench_h_setup(void) {
+  static const can_health_config_t cfg = {
+    .backoff_us = BENCH_HEALTH_BACKOFF_US, .backoff_max_us = BENCH_HEALTH_BACKOFF_MAX,
+    .stable_us = 100000, .protocol_errors = true,
+  };
+
+  memset(&bench_h_can, 0, sizeof(bench_h_can));
+  bench_h_can.Instance = FDCAN2;
+#ifdef BENCH_HOST
+  bench_h_can.Instance->CCCR = 0;
+#else
+  bench_h_can.Init.NominalPrescaler = 1;
+  bench_h_can.Init.NominalTimeSeg1 = 63;
+  bench_h_can.Init.NominalTimeSeg2 = 16;
+  bench_h_can.Init.NominalSyncJumpWidth = 16;
+  bench_h_can.Init.Loopback = true;
+  fdcan_init(&bench_h_can);
+#endif
+  bench_h_can.Instance->IE = 0;
+  can_health_init(&bench_h, &bench_h_can, &cfg);
+  fdcan_irq_route(&bench_h_can, BENCH_HEALTH_GROUPS);
+  fdcan_irq_enable(&bench_h_can, BENCH_HEALTH_SOURCES);
+  bench_h_now = 1000;
+}
+
+#ifdef BENCH_HOST
+/* Protocol errors of every code, counters ramping up to error passive and back */
+static void _bench_h_errors(void) {
+  uint32_t i, code, tec = 0, expect[8] = { 0 }, expect_d[8] = { 0 }, errors = 0;
+  can_health_stats_t s;
+
+  _bench_h_setup();
+  for (i = 0; i < BENCH_HEALTH_ERRORS; i++) {
+    code = 1 + (i / 2) % 6;
+    tec = (i % 400 < 200) ? (i % 200) : 199 - (i % 200);   // 0 .. 199 .. 0
+    if (i & 1) {
+      _bench_h_irq(FDCAN_IT_ARB_PROTOCOL_ERROR, code | (7U << 8) | _bench_h_flags(tec), tec | (1U << 16));
+      expect[code]++;
+    } else {
+      _bench_h_irq(FDCAN_IT_DATA_PROTOCOL_ERROR, 7U | (code << 8) | _bench_h_flags(tec), tec | (1U << 16));
+      expect_d[code]++;
+    }
+    bench_h_now += 50;
+  }
+
+  can_health_get_stats(&bench_h, &s);
+  for (code = 0; code < 8; code++) {
+    if (s.lec[code] != expect[code] || s.dlec[code] != expect_d[code]) errors++;
+  }
+  // 15 ramps cross 96 and 128 on the way up
+  if (s.warning != 15 || s.passive != 15 || s.tec_peak != 199 || s.errors_logged != BENCH_HEALTH_ERRORS) errors++;
+  if (s.state != CAN_HEALTH_ERROR_ACTIVE) errors++;
+
+  printf("{\"suite\":\"can_health\",\"bench\":\"error_counting\",\"irqs\":%u,\"stuff\":%u,\"form\":%u,\"crc\":%u,"
+         "\"data_crc\":%u,\"warning\":%u,\"passive\":%u,\"tec_peak\":%u,\"errors\":%u}\r\n",
+         (unsigned)s.irqs, (unsigned)s.lec[1], (unsigned)s.lec[2], (unsigned)s.lec[6], (unsigned)s.dlec[6],
+         (unsigned)s.warning, (unsigned)s.passive, (unsigned)s.tec_peak, (unsigned)errors);
+}
+
+/*
+ * Bus-off, back-off from the tick, recovery sequence, first TX; returns the expected recovery time.
+ * A line 0 Tx complete user with 'txbtie' set (TC enabled if not 0) must find its setup unchanged,
+ * 'restore_errors' counts where it was not.
+ */
+static uint32_t _bench_h_bus_off(uint32_t *backoff_seen, uint32_t txbtie, uint32_t *restore_errors) {
+  uint64_t t0 = bench_h_now, next_tick;
+
+  bench_h_can.Instance->TXBTIE = txbtie;
+  if (txbtie != 0) bench_h_can.Instance->IE |= FDCAN_IT_TX_COMPLETE;
+  else bench_h_can.Instance->IE &= ~FDCAN_IT_TX_COMPLETE;
+
+  bench_h_can.Instance->CCCR |= BIT(0);
+  _bench_h_irq(FDCAN_IT_BUS_OFF, BENCH_PSR_BO | BENCH_PSR_EP | BENCH_PSR_EW | 7U, 248U | (8U << 16));
+
+  // ticks at a random phase until the back-off clears INIT
+  next_tick = t0 + 1 + (t0 * 7919U) % BENCH_HEALTH_TICK_US;
+  while (bench_h_can.Instance->CCCR & BIT(0)) {
+    bench_h_now = next_tick;
+    can_health_tick(&bench_h, bench_h_now);
+    next_tick += BENCH_HEALTH_TICK_US;
+    if (bench_h_now - t0 > 10U * BENCH_HEALTH_BACKOFF_MAX) return 0;
+  }
+  *backoff_seen = (uint32_t)(bench_h_now - t0);
+
+  bench_h_now += BENCH_HEALTH_SEQUENCE_US;
+  _bench_h_irq(FDCAN_IT_BUS_OFF, 7U, 0);
+  // waiting for the first TX: Tx complete on line 1, from every buffer
+  if (bench_h_can.Instance->ILS != (BENCH_HEALTH_GROUPS | FDCAN_IT_GROUP_SMSG) ||
+      bench_h_can.Instance->TXBTIE != (1U << FDCAN_TX_BUFFERS) - 1U ||
+      !(bench_h_can.Instance->IE & FDCAN_IT_TX_COMPLETE)) {
+    (*restore_errors)++;
+  }
+  bench_h_now += BENCH_HEALTH_FIRST_TX_US;
+  _bench_h_irq(FDCAN_IT_TX_COMPLETE, 7U, 0);
+  if (bench_h_can.Instance->ILS != BENCH_HEALTH_GROUPS || (bench_h_can.IrqLine1 & FDCAN_IT_TX_COMPLETE) ||
+      bench_h_can.Instance->TXBTIE != txbtie ||
+      ((bench_h_can.Instance->IE & FDCAN_IT_TX_COMPLETE) != 0) != (txbtie != 0)) {
+    (*restore_errors)++;
+  }
+
+  return (uint32_t)(bench_h_now - t0);
+}
+
+static void _bench_h_recovery(void) {
+  uint32_t i, errors = 0, expect, backoff, backoff_seen = 0, min = 0xFFFFFFFFU, max = 0, first = 0, last = 0;
+  uint32_t restore_errors = 0;
+  uint64_t sum = 0;
+  can_health_stats_t s;
+
+  _bench_h_setup();
+  for (i = 0; i < BENCH_HEALTH_BUS_OFFS; i++) {
+    // two bursts of bus-offs 200 us after each recovery, separated by a stable period
+    bench_h_now += (i == BENCH_HEALTH_BUS_OFFS / 2) ? 500000U : 200U;
+    backoff = BENCH_HEALTH_BACKOFF_US << ((i < BENCH_HEALTH_BUS_OFFS / 2) ? i : i - BENCH_HEALTH_BUS_OFFS / 2);
+    if (backoff > BENCH_HEALTH_BACKOFF_MAX) backoff = BENCH_HEALTH_BACKOFF_MAX;
+
+    // every other bus-off with a line 0 Tx complete user on buffer 1
+    expect = _bench_h_bus_off(&backoff_seen, (i & 1) ? BIT(1) : 0, &restore_errors);
+    can_health_get_stats(&bench_h, &s);
+    if (expect == 0 || s.recovery_last_us != expect || s.backoff_us != backoff) errors++;
+    if (backoff_seen < backoff || backoff_seen >= backoff + BENCH_HEALTH_TICK_US) errors++;
+    if (s.state != CAN_HEALTH_ERROR_ACTIVE) errors++;
+    if (i == 0) first = s.backoff_us;
+    last = s.backoff_us;
+    sum += expect;
+    if (expect < min) min = expect;
+    if (expect > max) max = expect;
+  }
+
+  can_health_get_stats(&bench_h, &s);
+  if (s.bus_off != BENCH_HEALTH_BUS_OFFS || s.recoveries != BENCH_HEALTH_BUS_OFFS) errors++;
+  if (s.recovery_max_us != max || s.recovery_sum_us != sum) errors++;
+  errors += restore_errors;
+
+  printf("{\"suite\":\"can_health\",\"bench\":\"bus_off_recovery\",\"bus_off\":%u,\"recoveries\":%u,"
+         "\"backoff_first_us\":%u,\"backoff_last_us\":%u,\"recovery_min_us\":%u,\"recovery_avg_us\":%u,"
+         "\"recovery_max_us\":%u,\"errors\":%u}\r\n",
+         (unsigned)s.bus_off, (unsigned)s.recoveries, (unsigned)first, (unsigned)last, (unsigned)min,
+         (unsigned)(s.recoveries ? s.recovery_sum_us / s.recoveries : 0), (unsigned)s.recovery_max_us,
+         (unsigned)errors);
+}
+
+#endif
+
+static void _bench_h_prepare(void *ctx) {
+  (void)ctx;
+  bench_h_code = 1 + (bench_h_code % 6);
+  bench_h_can.Instance->IR = FDCAN_IT_ARB_PROTOCOL_ERROR;
+  bench_h_can.Instance->PSR = bench_h_code | (7U << 8);
+  bench_h_can.Instance->ECR = 8U | (1U << 16);
+}
+
+static void _bench_h_isr(void *ctx) {
+  (void)ctx;
+  can_health_isr(&bench_h, bench_h_now);
+}
+
+static void _bench_h_tick(void *ctx) {
+  (void)ctx;
+  can_health_tick(&bench_h, bench_h_now);
+}
+
+static void _bench_h_stats(void *ctx) {
+  static can_health_stats_t s;
+
+  (void)ctx;
+  can_health_get_stats(&bench_h, &s);
+}
+
+void bench_can_health(void) {
+  bench_result_t res;
+
+#ifdef BENCH_HOST
+  // PSR and ECR are read-only on the target, the replays need the simulated registers
+  _bench_h_errors();
+  _bench_h_recovery();
+#endif
+
+  _bench_h_setup();
+  bench_run("can_health", "isr_protocol_error", _bench_h_isr, _bench_h_prepare, NULL, BENCH_HEALTH_ITERATIONS, &res);
+  bench_report(&res);
+  bench_run("can_health", "tick_idle", _bench_h_tick, NULL, NULL, BENCH_HEALTH_ITERATIONS, &res);
+  bench_report(&res);
+  bench_run("can_health", "snapshot", _bench_h_stats, NULL, NULL, BENCH_HEALTH_ITERATIONS, &res);
+  bench_report(&res);
+}
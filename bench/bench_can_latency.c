@@ -0,0 +1,275 @@
+#include <stddef.h>
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+#include "drivers/fdcan.h"
+#include "can/can_hist.h"
+#include "can/can_latency.h"
+
+#define BENCH_LAT_ITERATIONS  256U
+#define BENCH_LAT_TICK_Q8     (1000U << 8)    // 1 us counter tick (1 Mbit/s, prescaler 1)
+#define BENCH_LAT_CLOCK_HZ    1000000U        // second clock in us
+
+static can_hist_t bench_lat_hist;
+static can_latency_t bench_lat;
+static uint32_t bench_lat_seed = 0x1A7E5U;
+static uint32_t bench_lat_value;
+static uint16_t bench_lat_ts;
+
+static uint32_t _bench_lat_rand(void) {
+  bench_lat_seed = bench_lat_seed * 1103515245U + 12345U;
+  return bench_lat_seed >> 8;
+}
+
+#ifdef BENCH_HOST
+#include <stdlib.h>
+
+#define BENCH_LAT_VALUES      100000U
+#define BENCH_LAT_TEF_WORDS   2U
+
+static uint32_t bench_lat_exact[BENCH_LAT_VALUES];
+
+static int _bench_lat_cmp(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+/* Latency-like values: mostly a few us, a long tail, a few outliers over the full range */
+static uint32_t _bench_lat_sample(uint32_t i) {
+  uint32_t r = _bench_lat_rand();
+
+  switch (i % 10) {
+    case 9:  return (r << 8) ^ _bench_lat_rand();
+    case 8:  return r >> (r % 24);
+    default: return 2000U + r % 3000U;
+  }
+}
+
+/* Bucket layout, and every percentile against the sorted values: never below, at most one bucket width above */
+static uint32_t _bench_lat_hist_check(void) {
+  static const uint32_t permille[] = { 0, 1, 10, 100, 250, 500, 750, 900, 990, 999, 1000 };
+  static can_hist_t merged;
+  uint64_t sum = 0, rank;
+  uint32_t i, exact, got, errors = 0;
+
+  for (i = 0; i + 1 < CAN_HIST_BUCKETS; i++) {
+    if (can_hist_bucket_high(i) + 1U != can_hist_bucket_low(i + 1)) errors++;
+    if (can_hist_index(can_hist_bucket_low(i)) != i || can_hist_index(can_hist_bucket_high(i)) != i) errors++;
+    // width within 1/CAN_HIST_SUB of the bucket's values
+    if ((uint64_t)(can_hist_bucket_high(i) - can_hist_bucket_low(i)) * CAN_HIST_SUB > can_hist_bucket_low(i)) errors++;
+  }
+  if (can_hist_bucket_high(CAN_HIST_BUCKETS - 1U) != UINT32_MAX || can_hist_index(UINT32_MAX) != CAN_HIST_BUCKETS - 1U) errors++;
+
+  can_hist_reset(&bench_lat_hist);
+  if (can_hist_percentile(&bench_lat_hist, 500) != 0 || can_hist_mean(&bench_lat_hist) != 0) errors++;
+  for (i = 0; i < BENCH_LAT_VALUES; i++) {
+    bench_lat_exact[i] = _bench_lat_sample(i);
+    sum += bench_lat_exact[i];
+    can_hist_record(&bench_lat_hist, bench_lat_exact[i]);
+  }
+  qsort(bench_lat_exact, BENCH_LAT_VALUES, sizeof(bench_lat_exact[0]), _bench_lat_cmp);
+
+  if (bench_lat_hist.n != BENCH_LAT_VALUES || bench_lat_hist.sum != sum) errors++;
+  if (bench_lat_hist.min != bench_lat_exact[0] || bench_lat_hist.max != bench_lat_exact[BENCH_LAT_VALUES - 1]) errors++;
+  if (can_hist_mean(&bench_lat_hist) != (uint32_t)(sum / BENCH_LAT_VALUES)) errors++;
+  for (i = 0; i < sizeof(permille) / sizeof(permille[0]); i++) {
+    rank = ((uint64_t)BENCH_LAT_VALUES * permille[i] + 999U) / 1000U;
+    exact = bench_lat_exact[(rank == 0) ? 0 : rank - 1];
+    got = can_hist_percentile(&bench_lat_hist, permille[i]);
+    if (got < exact || got > can_hist_bucket_high(can_hist_index(exact))) errors++;
+  }
+
+  // two halves merged give the same histogram
+  can_hist_reset(&merged);
+  can_hist_merge(&merged, &bench_lat_hist);
+  can_hist_merge(&merged, &bench_lat_hist);
+  if (merged.n != 2U * BENCH_LAT_VALUES || merged.min != bench_lat_hist.min || merged.max != bench_lat_hist.max) errors++;
+  if (can_hist_percentile(&merged, 900) != can_hist_percentile(&bench_lat_hist, 900)) errors++;
+
+  printf("{\"suite\":\"can_latency\",\"bench\":\"hist_accuracy\",\"values\":%u,\"buckets\":%u,\"bytes\":%u,"
+         "\"p50\":%u,\"p90\":%u,\"p99\":%u,\"max\":%u,\"errors\":%u}\r\n",
+         (unsigned)BENCH_LAT_VALUES, (unsigned)CAN_HIST_BUCKETS, (unsigned)sizeof(can_hist_t),
+         (unsigned)can_hist_percentile(&bench_lat_hist, 500), (unsigned)can_hist_percentile(&bench_lat_hist, 900),
+         (unsigned)can_hist_percentile(&bench_lat_hist, 990), (unsigned)bench_lat_hist.max, (unsigned)errors);
+
+  return errors;
+}
+
+/* Tx Event FIFO element for the frame with 'marker', as the controller would write it */
+static void _bench_lat_tef(FDCAN_Handle_t *can, uint32_t get, uint32_t marker, uint32_t ts) {
+  uint32_t *e = (uint32_t *)(can->msgRam.TxEventFIFOSA + get * BENCH_LAT_TEF_WORDS * 4U);
+
+  e[0] = 0x123U << 18;
+  e[1] = (marker << 24) | (1U << 22) | (8U << 16) | (ts & 0xFFFFU);
+  can->Instance->TXEFS = 1U | (get << 8);
+}
+
+static FDCAN_Handle_t bench_lat_can;
+static uint8_t bench_lat_data[64];
+static FDCAN_TxElement_t bench_lat_tx = {
+  .Identifier = 0x123, .IdType = FDCAN_STANDARD_ID, .DataLength = 8, .Data = bench_lat_data
+};
+static uint32_t bench_lat_cb_marker[2];   // TxCallback markers: preempting frame first, then the frame sent
+static uint32_t bench_lat_cb_count;
+
+static uint32_t _bench_lat_element_marker(uint32_t index) {
+  const uint32_t *element = (const uint32_t *)(bench_lat_can.msgRam.TxFIFOQSA + index * 18U * 4U);
+
+  return element[1] >> 24;
+}
+
+static void _bench_lat_tx_callback(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx, uint32_t marker) {
+  (void)fdcan;
+  (void)tx;
+  if (bench_lat_cb_count < 2) bench_lat_cb_marker[bench_lat_cb_count] = marker;
+  bench_lat_cb_count++;
+}
+
+/* An interrupt sending into the next buffer between fdcan_send()'s request and its TxCallback */
+static void _bench_lat_preempt_send(void) {
+  uint32_t txfqs = bench_lat_can.Instance->TXFQS;
+
+  bench_lat_can.Instance->TXFQS = (((txfqs >> 16) + 1U) % FDCAN_TX_BUFFERS) << 16;
+  (void)fdcan_send(&bench_lat_can, &bench_lat_tx);
+  bench_lat_can.Instance->TXFQS = txfqs;
+}
+
+/* fdcan_send() stamps through the marker, Tx events come back out of a simulated FIFO */
+static void _bench_lat_pipeline(void) {
+  FDCAN_Handle_t *can = &bench_lat_can;
+  FDCAN_TxEvent_t ev;
+  uint32_t i, marker, put, ts, delay, now = 0, errors = 0, sent = 0, preempted = 0;
+  uint32_t *element;
+
+  memset(can, 0, sizeof(*can));
+  can->Instance = FDCAN2;
+  can->Init.NominalPrescaler = 1;
+  can->Init.NominalTimeSeg1 = 63;
+  can->Init.NominalTimeSeg2 = 16;
+  can->Init.NominalSyncJumpWidth = 4;
+  can->Init.TimestampPrescaler = 1;
+  can->Init.TxEvents = true;
+  fdcan_init(can);
+  can->Instance->IE = 0;
+  can->TxCallback = _bench_lat_tx_callback;
+  if (can_latency_init(&bench_lat, BENCH_LAT_TICK_Q8, BENCH_LAT_CLOCK_HZ) != 0) errors++;
+  if (bench_lat.wrap != 65536U) errors++;
+
+  // delays 1..600 us, the counter wrapping every 65536 us along the way
+  for (i = 0; i < 3000; i++) {
+    put = i % FDCAN_TX_BUFFERS;
+    ts = (i * 977U) & 0xFFFFU;
+    can->Instance->TSCV = ts;
+    can->Instance->TXFQS = put << 16;
+    // every 7th frame: another frame is sent before the TxCallback sees this one
+    bench_lat_cb_count = 0;
+    if (i % 7U == 0) sim_fdcan_txbar_preempt = _bench_lat_preempt_send;
+    if (fdcan_send(can, &bench_lat_tx) != 0) errors++;
+
+    marker = bench_lat_cb_marker[bench_lat_cb_count - 1U];
+    element = (uint32_t *)(can->msgRam.TxFIFOQSA + put * 18U * 4U);
+    if ((element[1] >> 24) != marker || (element[1] & BIT(23)) == 0) errors++;
+    if (i % 7U == 0) {
+      if (bench_lat_cb_count != 2 || bench_lat_cb_marker[0] != _bench_lat_element_marker((put + 1U) % FDCAN_TX_BUFFERS) ||
+          bench_lat_cb_marker[0] == marker) {
+        errors++;
+      }
+      preempted++;
+    } else if (bench_lat_cb_count != 1) {
+      errors++;
+    }
+    can_latency_tx_sent(&bench_lat, (uint8_t)marker, (uint16_t)fdcan_timestamp(can), now);
+
+    delay = 1U + i % 600U;
+    now += delay;
+    _bench_lat_tef(can, i % FDCAN_TX_EVENTS, marker, ts + delay);
+    if (fdcan_tx_event(can, &ev) != 0) errors++;
+    if (ev.MessageMarker != marker || ev.Identifier != 0x123 || ev.DataLength != 8 || ev.EventType != 1) errors++;
+    if (can->Instance->TXEFA != i % FDCAN_TX_EVENTS) errors++;
+    can_latency_tx_event(&bench_lat, (uint8_t)ev.MessageMarker, (uint16_t)ev.TxTimestamp, now);
+    can->Instance->TXEFS = 0;
+    sent++;
+  }
+  if (fdcan_tx_event(can, &ev) != 1) errors++;
+
+  // uniform 1..600 us: exact in the linear buckets, within a bucket above
+  if (bench_lat.tx.n != sent || bench_lat.tx.min != 1000 || bench_lat.tx.max != 600000) errors++;
+  if (can_hist_mean(&bench_lat.tx) != 300500) errors++;
+  if (can_hist_percentile(&bench_lat.tx, 500) < 300000 || can_hist_percentile(&bench_lat.tx, 500) > 300000 + 300000 / 16) errors++;
+
+  // an event without its stamp, a stamp overwritten by a later marker, a frame older than a counter period
+  can_latency_tx_event(&bench_lat, 200, 0, now);
+  can_latency_tx_sent(&bench_lat, 3, 0, now);
+  can_latency_tx_sent(&bench_lat, 11, 0, now);
+  can_latency_tx_event(&bench_lat, 3, 10, now);
+  can_latency_tx_event(&bench_lat, 11, 10, now + 70000);
+  if (bench_lat.tx_unmatched != 2 || bench_lat.tx_out_of_range != 1 || bench_lat.tx.n != sent) errors++;
+
+  // Rx: start of frame 150 us before the handler, across the counter wrap
+  for (i = 0; i < 1000; i++) {
+    can_latency_rx(&bench_lat, (uint16_t)(0xFFF0U + i), (uint16_t)(0xFFF0U + i + 150U));
+  }
+  if (bench_lat.rx.n != 1000 || bench_lat.rx.min != 150000 || bench_lat.rx.max != 150000) errors++;
+
+  can_latency_reset(&bench_lat);
+  if (bench_lat.tx.n != 0 || bench_lat.rx.n != 0 || bench_lat.tx_unmatched != 0) errors++;
+
+  printf("{\"suite\":\"can_latency\",\"bench\":\"tx_rx_pipeline\",\"tx\":%u,\"preempted\":%u,\"rx\":1000,"
+         "\"errors\":%u}\r\n",
+         (unsigned)sent, (unsigned)preempted, (unsigned)errors);
+}
+#endif
+
+static void _bench_lat_record(void *ctx) {
+  (void)ctx;
+  can_hist_record(&bench_lat_hist, bench_lat_value);
+}
+
+static void _bench_lat_record_prepare(void *ctx) {
+  (void)ctx;
+  bench_lat_value = _bench_lat_rand() >> (_bench_lat_rand() % 20);
+}
+
+static void _bench_lat_rx(void *ctx) {
+  (void)ctx;
+  can_latency_rx(&bench_lat, bench_lat_ts, (uint16_t)(bench_lat_ts + 37U));
+}
+
+static void _bench_lat_tx(void *ctx) {
+  (void)ctx;
+  can_latency_tx_sent(&bench_lat, (uint8_t)bench_lat_ts, bench_lat_ts, 0);
+  can_latency_tx_event(&bench_lat, (uint8_t)bench_lat_ts, (uint16_t)(bench_lat_ts + 120U), 200);
+}
+
+static void _bench_lat_ts_prepare(void *ctx) {
+  (void)ctx;
+  bench_lat_ts = (uint16_t)_bench_lat_rand();
+}
+
+static void _bench_lat_percentile(void *ctx) {
+  (void)ctx;
+  bench_lat_value = can_hist_percentile(&bench_lat_hist, 990);
+}
+
+void bench_can_latency(void) {
+  bench_result_t res;
+
+#ifdef BENCH_HOST
+  _bench_lat_hist_check();
+  _bench_lat_pipeline();
+#endif
+
+  can_hist_reset(&bench_lat_hist);
+  can_latency_init(&bench_lat, BENCH_LAT_TICK_Q8, BENCH_LAT_CLOCK_HZ);
+
+  bench_run("can_latency", "hist_record", _bench_lat_record, _bench_lat_record_prepare, NULL,
+            BENCH_LAT_ITERATIONS, &res);
+  bench_report(&res);
+  bench_run("can_latency", "rx_record", _bench_lat_rx, _bench_lat_ts_prepare, NULL, BENCH_LAT_ITERATIONS, &res);
+  bench_report(&res);
+  bench_run("can_latency", "tx_sent_event", _bench_lat_tx, _bench_lat_ts_prepare, NULL, BENCH_LAT_ITERATIONS, &res);
+  bench_report(&res);
+  bench_run("can_latency", "percentile_p99", _bench_lat_percentile, NULL, NULL, BENCH_LAT_ITERATIONS, &res);
+  bench_report(&res);
+}
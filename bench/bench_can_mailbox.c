@@ -0,0 +1,127 @@
+#include <stddef.h>
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+#include "can/can_mailbox.h"
+
+#define BENCH_MAILBOX_ITERATIONS  256U
+#define BENCH_MAILBOX_IDS         32U
+
+static can_mailbox_t bench_mb;
+static uint32_t bench_mb_ids[BENCH_MAILBOX_IDS];
+static uint8_t bench_mb_data[64];
+static can_mailbox_entry_t bench_mb_entry;
+static int bench_mb_index;
+
+static void _bench_write(void *ctx) {
+  (void)ctx;
+  can_mailbox_write(&bench_mb, 0x110, 0, 8, bench_mb_data, 1000);
+}
+
+static void _bench_read(void *ctx) {
+  (void)ctx;
+  (void)can_mailbox_read(&bench_mb, 0x110, &bench_mb_entry);
+}
+
+static void _bench_read_index(void *ctx) {
+  (void)ctx;
+  (void)can_mailbox_read_index(&bench_mb, bench_mb_index, &bench_mb_entry);
+}
+
+#ifdef BENCH_HOST
+#include <pthread.h>
+
+#define BENCH_MAILBOX_READERS     3U
+#define BENCH_MAILBOX_WRITES      2000000U
+
+/*
+ * One writer thread publishes frames whose payload bytes, timestamp and
+ * update count are all derived from the same sequence number; reader
+ * threads check every snapshot for a mix of two frames.
+ */
+static volatile int bench_mb_running;
+static uint32_t bench_mb_reads[BENCH_MAILBOX_READERS];
+static uint32_t bench_mb_busy[BENCH_MAILBOX_READERS];
+static uint32_t bench_mb_torn[BENCH_MAILBOX_READERS];
+
+static void *_bench_writer(void *arg) {
+  uint8_t data[64];
+  uint32_t i;
+
+  (void)arg;
+  for (i = 1; i <= BENCH_MAILBOX_WRITES; i++) {
+    memset(data, (int)(i & 0xFF), sizeof(data));
+    can_mailbox_write(&bench_mb, bench_mb_ids[i % 4], 0, 15, data, i);
+  }
+  bench_mb_running = 0;
+  return NULL;
+}
+
+static void *_bench_reader(void *arg) {
+  uint32_t r = (uint32_t)(uintptr_t)arg, j;
+  can_mailbox_entry_t e;
+  int rc;
+
+  while (bench_mb_running) {
+    rc = can_mailbox_read_index(&bench_mb, (int)(r % 4), &e);
+    if (rc == 2) bench_mb_busy[r]++;
+    if (rc != 0) continue;
+
+    bench_mb_reads[r]++;
+    for (j = 0; j < 64; j++) {
+      if (e.data[j] != (uint8_t)e.timestamp_us) break;
+    }
+    if (j != 64 || e.dlc != 15) bench_mb_torn[r]++;
+  }
+  return NULL;
+}
+
+static void _bench_threads(void) {
+  pthread_t writer, readers[BENCH_MAILBOX_READERS];
+  uint32_t i, reads = 0, busy = 0, torn = 0;
+
+  can_mailbox_init(&bench_mb, bench_mb_ids, BENCH_MAILBOX_IDS);
+  bench_mb_running = 1;
+
+  for (i = 0; i < BENCH_MAILBOX_READERS; i++) {
+    pthread_create(&readers[i], NULL, _bench_reader, (void *)(uintptr_t)i);
+  }
+  pthread_create(&writer, NULL, _bench_writer, NULL);
+
+  pthread_join(writer, NULL);
+  for (i = 0; i < BENCH_MAILBOX_READERS; i++) {
+    pthread_join(readers[i], NULL);
+    reads += bench_mb_reads[i];
+    busy += bench_mb_busy[i];
+    torn += bench_mb_torn[i];
+  }
+
+  // a torn snapshot fails the run, readers that never got one test nothing
+  printf("{\"suite\":\"can_mailbox\",\"bench\":\"threads\",\"writes\":%u,\"readers\":%u,"
+         "\"reads\":%u,\"retries_exhausted\":%u,\"torn\":%u,\"errors\":%u}\r\n",
+         (unsigned)BENCH_MAILBOX_WRITES, (unsigned)BENCH_MAILBOX_READERS, (unsigned)reads, (unsigned)busy,
+         (unsigned)torn, (unsigned)(torn + (reads == 0)));
+}
+#endif
+
+void bench_can_mailbox(void) {
+  bench_result_t res;
+  uint32_t i;
+
+  for (i = 0; i < BENCH_MAILBOX_IDS; i++) {
+    bench_mb_ids[i] = 0x100 + i * 0x10;
+  }
+  can_mailbox_init(&bench_mb, bench_mb_ids, BENCH_MAILBOX_IDS);
+  bench_mb_index = can_mailbox_index(&bench_mb, 0x110);
+
+  bench_run("can_mailbox", "can_mailbox_write_dlc8", _bench_write, NULL, NULL, BENCH_MAILBOX_ITERATIONS, &res);
+  bench_report(&res);
+  bench_run("can_mailbox", "can_mailbox_read_dlc8", _bench_read, NULL, NULL, BENCH_MAILBOX_ITERATIONS, &res);
+  bench_report(&res);
+  bench_run("can_mailbox", "can_mailbox_read_index_dlc8", _bench_read_index, NULL, NULL, BENCH_MAILBOX_ITERATIONS, &res);
+  bench_report(&res);
+
+#ifdef BENCH_HOST
+  _bench_threads();
+#endif
+}
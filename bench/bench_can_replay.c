@@ -0,0 +1,247 @@
+#include <stddef.h>
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+#include "drivers/fdcan.h"
+#include "drivers/timebase.h"
+#include "can/can_replay.h"
+
+#define BENCH_REPLAY_FRAMES     32U
+#define BENCH_REPLAY_BLOCK_SIZE 1024U
+#define BENCH_REPLAY_DELAY_US   100U
+
+static FDCAN_Handle_t bench_replay_can;
+static uint8_t bench_replay_log[BENCH_REPLAY_BLOCK_SIZE];
+static uint32_t bench_replay_log_len;
+static can_trace_frame_t bench_replay_frames[BENCH_REPLAY_FRAMES];
+static can_replay_t bench_replay;
+
+/* Four IDs interleaved, one of them extended, at uneven gaps of 150..224 us */
+static void _bench_replay_log(void) {
+  can_trace_encoder_t enc;
+  can_trace_frame_t *f;
+  uint32_t i;
+
+  can_trace_block_begin(&enc, bench_replay_log, sizeof(bench_replay_log), 0, 0);
+  for (i = 0; i < BENCH_REPLAY_FRAMES; i++) {
+    f = &bench_replay_frames[i];
+    memset(f, 0, sizeof(*f));
+    f->timestamp_us = 1000U + i * 150U + (i % 3U) * 37U;
+    f->id = 0x100U + (i % 4U);
+    if (i % 4U == 3U) {
+      f->id |= 0x18DA0000U;
+      f->flags = CAN_TRACE_FLAG_XTD;
+    }
+    f->dlc = 8;
+    f->data[0] = (uint8_t)i;
+    (void)can_trace_encode(&enc, f);
+  }
+  bench_replay_log_len = can_trace_block_used(bench_replay_log);
+}
+
+static void _bench_replay_init_can(void) {
+  bench_replay_can.Instance = FDCAN1;
+  bench_replay_can.Init.NominalPrescaler = 1;
+  bench_replay_can.Init.NominalTimeSeg1 = 63;
+  bench_replay_can.Init.NominalTimeSeg2 = 16;
+  bench_replay_can.Init.NominalSyncJumpWidth = 4;
+  bench_replay_can.Init.Loopback = true;
+  bench_replay_can.Init.TxQueue = true;
+  fdcan_init(&bench_replay_can);
+}
+
+#ifdef BENCH_HOST
+#include "sim.h"
+
+/*
+ * can_replay on the simulated DWT and TXBAR. Between polls the bench moves
+ * CYCCNT on by a main loop pass and raises the tick; inside the spin each
+ * turn advances it by sim_dwt_spin_cycles. A TXBAR write is a commit: the
+ * element in the slot must be the next expected frame and the commit must
+ * land in [due, due + one spin turn). Runs cover speed scaling, pass and
+ * block filters, a source that runs dry once and frames more than 2^31
+ * cycles late, which must go out at once with the error clamped.
+ */
+
+#define BENCH_REPLAY_POLL_CYCLES  37U            // main loop pass between polls
+#define BENCH_REPLAY_LATE_US      40000000U      // 2.56e9 cycles at 64 MHz
+
+static uint32_t bench_replay_gap_calls;
+
+/* RAM source that has nothing once, after the second frame */
+static int _bench_replay_gap_next(void *ctx, can_trace_frame_t *frame) {
+  can_replay_source_t *src = ctx;
+
+  if (++bench_replay_gap_calls == 3U) return 1;
+  return src->next(src->ctx, frame);
+}
+
+static void _bench_replay_advance(uint32_t cycles) {
+  DWT->CYCCNT += cycles;
+  sim_irq(SysTick_IRQn);
+}
+
+static uint32_t _bench_replay_slot_id(uint32_t index) {
+  const volatile uint32_t *element = (const volatile uint32_t *)(bench_replay_can.msgRam.TxFIFOQSA + index * 18U * 4U);
+  uint32_t w0 = element[0];
+
+  return (w0 & BIT(30)) ? (w0 & 0x1FFFFFFFU) : ((w0 >> 18) & 0x7FFU);
+}
+
+static bool _bench_replay_pass(const can_replay_config_t *cfg, uint32_t id) {
+  uint32_t i;
+  bool match = false;
+
+  if (cfg->filter_count == 0) return true;
+  for (i = 0; i < cfg->filter_count; i++) {
+    if (((id ^ cfg->filter_id[i]) & cfg->filter_mask[i]) == 0) match = true;
+  }
+  return match != cfg->filter_block;
+}
+
+/*
+ * Replay the log to the end. 'late_after' > 0 stalls the main loop for
+ * BENCH_REPLAY_LATE_US after that many commits, every later frame is overdue. Returns the number of
+ * mismatches; the engine's statistics are left in 'stats'.
+ */
+static uint32_t _bench_replay_run(const can_replay_config_t *cfg, const can_replay_source_t *src,
+                                  uint32_t late_after, can_replay_stats_t *stats) {
+  uint64_t start = 0, due, entry, committed, t0 = 0;
+  uint32_t errors = 0, expect = 0, sent = 0, hz = timebase_core_hz(), polls = 0;
+  bool started = false, stalled = false;
+
+  if (can_replay_start(&bench_replay, &bench_replay_can, cfg, src) != 0) return 1;
+  FDCAN1->TXBAR = 0;
+
+  while (polls++ < 1000000U) {
+    entry = timebase_cycles();
+    if (polls == 1U) start = entry + (uint64_t)cfg->start_delay_us * hz / 1000000U;
+    if (can_replay_poll(&bench_replay) != 0) break;
+    committed = timebase_cycles();
+
+    if (FDCAN1->TXBAR != 0) {
+      FDCAN1->TXBAR = 0;
+      while (expect < BENCH_REPLAY_FRAMES && !_bench_replay_pass(cfg, bench_replay_frames[expect].id)) expect++;
+      if (expect == BENCH_REPLAY_FRAMES) {
+        errors++;   // more commits than frames
+        break;
+      }
+      if (!started) t0 = bench_replay_frames[expect].timestamp_us;
+      started = true;
+
+      due = start + (bench_replay_frames[expect].timestamp_us - t0) * 1000U / cfg->speed_permille * hz / 1000000U;
+      if (_bench_replay_slot_id(0) != bench_replay_frames[expect].id) errors++;
+      if (stalled) {
+        if (committed != entry) errors++;   // long overdue: no spin at all
+      } else if (committed < due || committed - due >= sim_dwt_spin_cycles) {
+        errors++;
+      }
+      expect++;
+      sent++;
+
+      if (sent == late_after && !stalled) {
+        stalled = true;
+        _bench_replay_advance(BENCH_REPLAY_LATE_US / 1000U * (hz / 1000U));
+      }
+    }
+    _bench_replay_advance(BENCH_REPLAY_POLL_CYCLES);
+  }
+
+  can_replay_get_stats(&bench_replay, stats);
+  if (stats->sent != sent) errors++;
+  return errors;
+}
+
+void bench_can_replay(void) {
+  can_replay_ram_t ram;
+  can_replay_source_t ram_src, gap_src;
+  can_replay_config_t cfg;
+  can_replay_stats_t stats;
+  uint32_t errors = 0, sent = 0, filtered = 0, late = 0, underruns = 0, clamp_ns;
+  static const uint32_t speeds[3] = { 1000, 2000, 500 };
+  uint32_t i;
+
+  _bench_replay_log();
+  _bench_replay_init_can();
+  FDCAN1->TXFQS = 0;
+  if (timebase_init() != 0) errors++;
+  clamp_ns = timebase_cycles_to_ns(timebase_us_to_cycles(2000000U));
+
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.start_delay_us = BENCH_REPLAY_DELAY_US;
+
+  // original timing, twice as fast, half speed: every frame on its due cycle
+  for (i = 0; i < 3; i++) {
+    cfg.speed_permille = speeds[i];
+    can_replay_ram_init(&ram, bench_replay_log, bench_replay_log_len, &ram_src);
+    errors += _bench_replay_run(&cfg, &ram_src, 0, &stats);
+    if (stats.sent != BENCH_REPLAY_FRAMES || stats.late != 0 || stats.underruns != 0) errors++;
+    sent += stats.sent;
+  }
+
+  // pass filter: 0x101 only
+  cfg.speed_permille = 1000;
+  cfg.filter_id[0] = 0x101;
+  cfg.filter_mask[0] = 0x1FFFFFFFU;
+  cfg.filter_count = 1;
+  can_replay_ram_init(&ram, bench_replay_log, bench_replay_log_len, &ram_src);
+  errors += _bench_replay_run(&cfg, &ram_src, 0, &stats);
+  if (stats.sent != BENCH_REPLAY_FRAMES / 4U || stats.filtered != BENCH_REPLAY_FRAMES * 3U / 4U) errors++;
+  sent += stats.sent;
+  filtered += stats.filtered;
+
+  // block filter: drop 0x100 and 0x101
+  cfg.filter_id[0] = 0x100;
+  cfg.filter_mask[0] = 0x1FFFFFFEU;
+  cfg.filter_block = true;
+  can_replay_ram_init(&ram, bench_replay_log, bench_replay_log_len, &ram_src);
+  errors += _bench_replay_run(&cfg, &ram_src, 0, &stats);
+  if (stats.sent != BENCH_REPLAY_FRAMES / 2U || stats.filtered != BENCH_REPLAY_FRAMES / 2U) errors++;
+  sent += stats.sent;
+  filtered += stats.filtered;
+
+  // error statistics: the source runs dry once, from the third frame on the replay is 40 s behind
+  cfg.filter_count = 0;
+  cfg.filter_block = false;
+  can_replay_ram_init(&ram, bench_replay_log, bench_replay_log_len, &ram_src);
+  gap_src.next = _bench_replay_gap_next;
+  gap_src.ctx = &ram_src;
+  bench_replay_gap_calls = 0;
+  errors += _bench_replay_run(&cfg, &gap_src, 2, &stats);
+  if (stats.sent != BENCH_REPLAY_FRAMES || stats.late != BENCH_REPLAY_FRAMES - 2U || stats.underruns != 1) errors++;
+  if (stats.err_max_ns != (int32_t)clamp_ns || stats.err_min_ns < 0) errors++;
+  sent += stats.sent;
+  late += stats.late;
+  underruns += stats.underruns;
+
+  printf("{\"suite\":\"can_replay\",\"bench\":\"schedule\",\"runs\":6,\"sent\":%u,\"filtered\":%u,\"late\":%u,"
+         "\"underruns\":%u,\"errors\":%u}\r\n",
+         (unsigned)sent, (unsigned)filtered, (unsigned)late, (unsigned)underruns, (unsigned)errors);
+
+  // leave the state sim_reset() gives the other suites
+  sim_reset();
+}
+#else
+void bench_can_replay(void) {
+  can_replay_ram_t ram;
+  can_replay_source_t src;
+  can_replay_config_t cfg;
+  can_replay_stats_t stats;
+
+  _bench_replay_log();
+  _bench_replay_init_can();
+
+  // the log in internal loopback: error from the due cycle to the TXBAR write
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.start_delay_us = BENCH_REPLAY_DELAY_US;
+  can_replay_ram_init(&ram, bench_replay_log, bench_replay_log_len, &src);
+  if (can_replay_start(&bench_replay, &bench_replay_can, &cfg, &src) != 0) return;
+  can_replay_run(&bench_replay);
+  can_replay_get_stats(&bench_replay, &stats);
+
+  printf("{\"suite\":\"can_replay\",\"bench\":\"loopback\",\"sent\":%u,\"late\":%u,\"err_min_ns\":%d,"
+         "\"err_max_ns\":%d,\"errors\":%u}\r\n",
+         (unsigned)stats.sent, (unsigned)stats.late, (int)stats.err_min_ns, (int)stats.err_max_ns,
+         (unsigned)(BENCH_REPLAY_FRAMES - stats.sent));
+}
+#endif
@@ -0,0 +1,243 @@
+#include <stddef.h>
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+#include "drivers/fdcan.h"
+#include "can/can_selftest.h"
+
+#define BENCH_SELFTEST_ITERATIONS  256U
+
+static const can_selftest_config_t bench_st_cfg = {
+  .id_min = 0x100, .id_max = 0x7FF, .dlc_min = 0, .dlc_max = 15,   // raised to 6 by can_selftest_init()
+  .fd_permille = 500, .brs_permille = 500, .verify = true, .seed = 0x5E1F7E57U,
+};
+
+static can_trace_frame_t bench_st_frame;
+static uint32_t bench_st_seq;
+
+static void _bench_st_build(void *ctx) {
+  (void)ctx;
+  can_selftest_frame(&bench_st_cfg, bench_st_seq++, &bench_st_frame);
+}
+
+static void _bench_st_report(const char *name, const can_selftest_stats_t *s, uint32_t drops, uint32_t flips) {
+  uint32_t errors = 0;
+
+  if (bench_st_cfg.verify) {
+    errors += (s->lost > drops) ? s->lost - drops : drops - s->lost;
+    errors += (s->corrupt > flips) ? s->corrupt - flips : flips - s->corrupt;
+    errors += (s->received + s->lost != s->sent) ? 1 : 0;
+  }
+
+  printf("{\"suite\":\"can_selftest\",\"bench\":\"%s\",\"unit\":\"" BENCH_UNIT "\",\"sent\":%u,\"received\":%u,"
+         "\"lost\":%u,\"corrupt\":%u,\"injected_drops\":%u,\"injected_flips\":%u,\"tx_per_frame\":%u,"
+         "\"rx_per_frame\":%u,\"frames_per_s\":%u,\"errors\":%u}\r\n",
+         name, (unsigned)s->sent, (unsigned)s->received, (unsigned)s->lost, (unsigned)s->corrupt, (unsigned)drops,
+         (unsigned)flips, (unsigned)s->tx_cycles_per_frame, (unsigned)s->rx_cycles_per_frame,
+         (unsigned)s->frames_per_s, (unsigned)errors);
+}
+
+#ifdef BENCH_HOST
+
+#define BENCH_SELFTEST_FRAMES      200000U
+#define BENCH_SELFTEST_ELEMENT     (18U * 4U)
+
+/*
+ * Internal loopback on the simulated registers, Tx FIFO mode: each receive
+ * attempt first lets the bus move the oldest pending TX buffer into RX
+ * FIFO 0, where fdcan_receive() reads it. Faults are injected on the bus:
+ * dropped frames must come out as lost, frames with a flipped ID bit as
+ * corrupt.
+ */
+static FDCAN_Handle_t bench_st_can;
+static uint32_t bench_st_tx_get, bench_st_tx_count;
+static uint32_t bench_st_drop_every, bench_st_flip_every, bench_st_bus_frames;
+static uint32_t bench_st_drops, bench_st_flips;
+static uint32_t bench_st_last_ns;
+static uint64_t bench_st_ns;
+
+static void _bench_st_sync(void) {
+  FDCAN_t *regs = bench_st_can.Instance;
+
+  while (regs->TXBAR != 0) {
+    regs->TXBAR &= regs->TXBAR - 1;
+    bench_st_tx_count++;
+  }
+  regs->TXFQS = (FDCAN_TX_BUFFERS - bench_st_tx_count) |
+                (((bench_st_tx_get + bench_st_tx_count) % FDCAN_TX_BUFFERS) << 16) |
+                ((bench_st_tx_count == FDCAN_TX_BUFFERS) ? BIT(21) : 0);
+}
+
+static void _bench_st_bus_step(void) {
+  FDCAN_t *regs = bench_st_can.Instance;
+  uint32_t fill = regs->RXF0S & 0xF, get = (regs->RXF0S >> 8) & 0x3, put;
+  uint32_t *rx;
+
+  if (bench_st_tx_count == 0 || fill == 3) return;
+
+  bench_st_bus_frames++;
+  if (bench_st_drop_every != 0 && (bench_st_bus_frames % bench_st_drop_every) == 0) {
+    bench_st_drops++;
+  } else {
+    put = (get + fill) % 3;
+    rx = (uint32_t *)(bench_st_can.msgRam.RxFIFO0SA + put * BENCH_SELFTEST_ELEMENT);
+    memcpy(rx, (const void *)(bench_st_can.msgRam.TxFIFOQSA + bench_st_tx_get * BENCH_SELFTEST_ELEMENT),
+           BENCH_SELFTEST_ELEMENT);
+    if (bench_st_flip_every != 0 && (bench_st_bus_frames % bench_st_flip_every) == 0) {
+      rx[0] ^= BIT(18);   // identifier LSB
+      bench_st_flips++;
+    }
+    regs->RXF0S = (fill + 1) | (get << 8);
+  }
+
+  bench_st_tx_get = (bench_st_tx_get + 1) % FDCAN_TX_BUFFERS;
+  bench_st_tx_count--;
+  _bench_st_sync();
+}
+
+static int _bench_st_send(void *ctx, const can_trace_frame_t *frame) {
+  FDCAN_TxElement_t tx;
+  int rc;
+
+  tx.Identifier = frame->id;
+  tx.IdType = (frame->flags & CAN_TRACE_FLAG_XTD) ? FDCAN_EXTENDED_ID : FDCAN_STANDARD_ID;
+  tx.DataLength = frame->dlc;
+  tx.ErrorStateIndicator = 0;
+  tx.BitRateSwitch = (frame->flags & CAN_TRACE_FLAG_BRS) ? FDCAN_BRS_ON : FDCAN_BRS_OFF;
+  tx.FDFormat = (frame->flags & CAN_TRACE_FLAG_FDF) ? FDCAN_FD_CAN : FDCAN_CLASSIC_CAN;
+  tx.Deadline = 0;
+  tx.Data = (uint8_t *)frame->data;
+
+  rc = fdcan_send((FDCAN_Handle_t *)ctx, &tx);
+  _bench_st_sync();
+  return rc;
+}
+
+static int _bench_st_receive(void *ctx, can_trace_frame_t *frame) {
+  FDCAN_t *regs = bench_st_can.Instance;
+  FDCAN_RxElement_t rx;
+  uint32_t fill, get;
+
+  _bench_st_bus_step();
+
+  rx.Data = frame->data;
+  if (fdcan_receive((FDCAN_Handle_t *)ctx, &rx, FDCAN_RX_FIFO0) != 0) return 1;
+
+  // acknowledge (RXF0A): the get index moves on
+  fill = regs->RXF0S & 0xF;
+  get = (regs->RXF0S >> 8) & 0x3;
+  regs->RXF0S = (fill - 1) | (((get + 1) % 3) << 8);
+
+  frame->id = rx.Identifier;
+  frame->dlc = (uint8_t)rx.DataLength;
+  frame->flags = 0;
+  if (rx.IdType == FDCAN_EXTENDED_ID) frame->flags |= CAN_TRACE_FLAG_XTD;
+  if (rx.FDFormat == FDCAN_FD_CAN) frame->flags |= CAN_TRACE_FLAG_FDF;
+  if (rx.BitRateSwitch == FDCAN_BRS_ON) frame->flags |= CAN_TRACE_FLAG_BRS;
+  return 0;
+}
+
+static uint32_t _bench_st_cycles(void *ctx) {
+  (void)ctx;
+  return bench_now();
+}
+
+static uint64_t _bench_st_now_us(void *ctx) {
+  uint32_t now = bench_now();
+
+  (void)ctx;
+  bench_st_ns += (uint32_t)(now - bench_st_last_ns);
+  bench_st_last_ns = now;
+  return bench_st_ns / 1000U;
+}
+
+static const can_selftest_port_t bench_st_port = {
+  .send = _bench_st_send,
+  .receive = _bench_st_receive,
+  .cycles = _bench_st_cycles,
+  .now_us = _bench_st_now_us,
+};
+
+static void _bench_st_run(const char *name, uint32_t drop_every, uint32_t flip_every) {
+  can_selftest_config_t cfg = bench_st_cfg;
+  can_selftest_stats_t stats;
+  can_selftest_t st;
+
+  bench_st_can.Instance = FDCAN2;
+  bench_st_can.Init.NominalPrescaler = 1;
+  bench_st_can.Init.NominalTimeSeg1 = 63;
+  bench_st_can.Init.NominalTimeSeg2 = 16;
+  bench_st_can.Init.NominalSyncJumpWidth = 4;
+  bench_st_can.Init.FDMode = true;
+  bench_st_can.Init.Loopback = true;
+  bench_st_can.Init.TxQueue = false;
+  fdcan_init(&bench_st_can);
+  bench_st_can.Instance->RXF0S = 0;
+  bench_st_can.Instance->TXBAR = 0;
+  bench_st_tx_get = 0;
+  bench_st_tx_count = 0;
+  _bench_st_sync();
+
+  bench_st_drop_every = drop_every;
+  bench_st_flip_every = flip_every;
+  bench_st_bus_frames = 0;
+  bench_st_drops = 0;
+  bench_st_flips = 0;
+  bench_st_last_ns = bench_now();
+  bench_st_ns = 0;
+
+  cfg.frames = BENCH_SELFTEST_FRAMES;
+  cfg.drain_us = 1000;
+  can_selftest_init(&st, &cfg, &bench_st_port, &bench_st_can);
+  while (can_selftest_poll(&st) == 0) {
+  }
+  can_selftest_get_stats(&st, &stats);
+
+  _bench_st_report(name, &stats, bench_st_drops, bench_st_flips);
+}
+#else
+
+#include "can/can_selftest_fdcan.h"
+
+/* Real internal loopback: frame times dominate, the cycles show the driver cost */
+static void _bench_st_run(const char *name, uint32_t drop_every, uint32_t flip_every) {
+  static FDCAN_Handle_t can = { .Instance = FDCAN2 };
+  can_selftest_config_t cfg = bench_st_cfg;
+  can_selftest_stats_t stats;
+  can_selftest_t st;
+
+  (void)drop_every;
+  (void)flip_every;
+  can.Init.NominalPrescaler = 1;
+  can.Init.NominalTimeSeg1 = 31;
+  can.Init.NominalTimeSeg2 = 8;
+  can.Init.NominalSyncJumpWidth = 8;
+  can.Init.DataPrescaler = 1;
+  can.Init.DataTimeSeg1 = 5;
+  can.Init.DataTimeSeg2 = 2;
+  can.Init.DataSyncJumpWidth = 2;
+  can.Init.FDMode = true;
+  can.Init.Loopback = true;
+  fdcan_init(&can);
+
+  cfg.frames = 2000;
+  can_selftest_fdcan_init(&st, &can, &cfg);
+  can_selftest_fdcan_run(&st, &stats);
+
+  _bench_st_report(name, &stats, 0, 0);
+}
+#endif
+
+void bench_can_selftest(void) {
+  bench_result_t res;
+
+  _bench_st_run("loopback", 0, 0);
+#ifdef BENCH_HOST
+  _bench_st_run("loopback_faults", 997, 1499);
+#endif
+
+  // generator cost per frame, outside the measured driver cycles
+  bench_st_seq = 0;
+  bench_run("can_selftest", "frame_build", _bench_st_build, NULL, NULL, BENCH_SELFTEST_ITERATIONS, &res);
+  bench_report(&res);
+}
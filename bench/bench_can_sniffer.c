@@ -0,0 +1,281 @@
+#include <stddef.h>
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+#include "drivers/fdcan.h"
+#include "can/can_sniffer.h"
+
+#define BENCH_SNIFFER_ITERATIONS  256U
+#define BENCH_SNIFFER_WORDS       4096U
+#define BENCH_SNIFFER_IRQS        (FDCAN_IT_RX_FIFO0_NEW_MESSAGE | FDCAN_IT_RX_FIFO0_MESSAGE_LOST | \
+                                   FDCAN_IT_RX_FIFO1_NEW_MESSAGE | FDCAN_IT_RX_FIFO1_MESSAGE_LOST)
+
+static FDCAN_Handle_t bench_sn_can;
+static can_sniffer_t bench_sn;
+static uint32_t bench_sn_buf[BENCH_SNIFFER_WORDS];
+static can_trace_frame_t bench_sn_frame;
+
+static void _bench_sn_filters(void) {
+  FDCAN_Filter_t filter;
+  uint32_t parity;
+
+  for (parity = 0; parity < 2; parity++) {
+    filter.FilterIndex = parity;
+    filter.FilterType = FDCAN_FILTER_MASK;
+    filter.FilterConfig = (parity == 0) ? FDCAN_FILTER_TO_RXFIFO0 : FDCAN_FILTER_TO_RXFIFO1;
+    filter.FilterID1 = parity;
+    filter.FilterID2 = 1;
+    filter.IdType = FDCAN_STANDARD_ID;
+    fdcan_set_filter(&bench_sn_can, &filter);
+  }
+}
+
+static void _bench_sn_isr(void *ctx) {
+  (void)ctx;
+  (void)can_sniffer_isr(&bench_sn);
+}
+
+static void _bench_sn_drain(void) {
+  while (can_sniffer_read(&bench_sn, &bench_sn_frame) == 0);
+}
+
+#ifdef BENCH_HOST
+
+#define BENCH_SNIFFER_FRAMES      200000U
+#define BENCH_SNIFFER_DEPTH       3U
+#define BENCH_SNIFFER_ELEMENT     (18U * 4U)
+#define BENCH_SNIFFER_BLOCK_EVERY 2000U     // us between blocking windows
+#define BENCH_SNIFFER_BLOCK_MAX   500U      // longest window the interrupt cannot run, us
+
+/*
+ * Fully loaded 1 Mbit/s + 5 Mbit/s bus on the simulated registers: frames
+ * arrive back to back, half of them FD with BRS. The interrupt runs between
+ * frames except inside blocking windows (higher priority work, critical
+ * sections) of up to 500 us every 2 ms, during which the Rx FIFOs must hold
+ * the traffic. The same arrivals are captured with the parity split and with
+ * everything in Rx FIFO 0, and once with the split and no blocking, where
+ * nothing may be lost.
+ *
+ * A FIFO holds three frames: 333 us of back to back 8 byte classic frames.
+ * The split gives six, 666 us, only while the IDs alternate parity; a burst
+ * of one ID or of same-parity IDs still fills one FIFO in 333 us. Windows
+ * longer than that lose frames in both captures, the split only loses fewer.
+ */
+typedef struct {
+  uint32_t fill;
+  uint32_t get;
+} bench_sn_fifo_t;
+
+static bench_sn_fifo_t bench_sn_fifo[2];
+static uint8_t bench_sn_lost[BENCH_SNIFFER_FRAMES];
+static uint32_t bench_sn_seed;
+
+static void _bench_sn_status(uint32_t f) {
+  uint32_t status = bench_sn_fifo[f].fill | (bench_sn_fifo[f].get << 8);
+
+  if (f == 0) bench_sn_can.Instance->RXF0S = status;
+  else bench_sn_can.Instance->RXF1S = status;
+}
+
+/* Frame k: ID, format and payload follow from k, the payload starts with k */
+static void _bench_sn_make(uint32_t k, uint32_t *id, uint32_t *dlc, bool *fd) {
+  uint32_t h = k * 0x9E3779B9U;
+
+  h ^= h >> 15;
+  *id = h & 0x7FF;
+  *fd = (h >> 12) & 1;
+  *dlc = *fd ? 15 : 8;
+}
+
+/* Frame time at 1 Mbit/s nominal, 5 Mbit/s data: ~111 us classic 8 byte, ~170 us FD 64 byte with BRS */
+static uint32_t _bench_sn_frame_us(bool fd) {
+  return fd ? 170U : 111U;
+}
+
+static void _bench_sn_deliver(uint32_t k, uint32_t t_us, bool split) {
+  uint32_t id, dlc, f, put, *element, i;
+  bool fd;
+
+  _bench_sn_make(k, &id, &dlc, &fd);
+  f = (split && (id & 1)) ? 1 : 0;
+
+  if (bench_sn_fifo[f].fill == BENCH_SNIFFER_DEPTH) {
+    bench_sn_lost[k] = 1;
+    bench_sn_can.Instance->IR |= (f == 0) ? FDCAN_IT_RX_FIFO0_MESSAGE_LOST : FDCAN_IT_RX_FIFO1_MESSAGE_LOST;
+    return;
+  }
+
+  put = (bench_sn_fifo[f].get + bench_sn_fifo[f].fill) % BENCH_SNIFFER_DEPTH;
+  element = (uint32_t *)(((f == 0) ? bench_sn_can.msgRam.RxFIFO0SA : bench_sn_can.msgRam.RxFIFO1SA) +
+                         put * BENCH_SNIFFER_ELEMENT);
+  element[0] = id << 18;
+  element[1] = (t_us & 0xFFFF) | (dlc << 16) | (fd ? (FDCAN_FD_CAN | FDCAN_BRS_ON) : 0);
+  element[2] = k;
+  for (i = 3; i < 2 + (fd ? 16U : 2U); i++) {
+    element[i] = k ^ i;
+  }
+
+  bench_sn_fifo[f].fill++;
+  _bench_sn_status(f);
+  bench_sn_can.Instance->IR |= (f == 0) ? FDCAN_IT_RX_FIFO0_NEW_MESSAGE : FDCAN_IT_RX_FIFO1_NEW_MESSAGE;
+}
+
+/* Apply the RXFnA acknowledgements the interrupt wrote */
+static void _bench_sn_acks(void) {
+  uint32_t f, ack;
+
+  for (f = 0; f < 2; f++) {
+    ack = (f == 0) ? bench_sn_can.Instance->RXF0A : bench_sn_can.Instance->RXF1A;
+    if (ack != 0xFF) {
+      bench_sn_fifo[f].fill -= (ack + BENCH_SNIFFER_DEPTH - bench_sn_fifo[f].get) % BENCH_SNIFFER_DEPTH + 1;
+      bench_sn_fifo[f].get = (ack + 1) % BENCH_SNIFFER_DEPTH;
+      _bench_sn_status(f);
+    }
+  }
+  bench_sn_can.Instance->RXF0A = 0xFF;
+  bench_sn_can.Instance->RXF1A = 0xFF;
+  bench_sn_can.Instance->IR = 0;   // write-1-to-clear done by fdcan_irq_ack()
+}
+
+/* 'block_max_us' 0: the interrupt runs after every frame, a loss is an error */
+static void _bench_sn_run(const char *name, bool split, uint32_t block_max_us) {
+  uint32_t k, t_us = 0, expect = 0, errors = 0, captured = 0, model_lost = 0, id, dlc, block_start = 0, block_len = 0;
+  uint32_t start, isr_ns = 0, isr_frames = 0;
+  can_sniffer_stats_t stats;
+  bool fd;
+
+  bench_sn_can.Instance = FDCAN2;
+  bench_sn_can.Init.NominalPrescaler = 1;
+  bench_sn_can.Init.NominalTimeSeg1 = 31;
+  bench_sn_can.Init.NominalTimeSeg2 = 8;
+  bench_sn_can.Init.NominalSyncJumpWidth = 8;
+  bench_sn_can.Init.FDMode = true;
+  bench_sn_can.Init.BusMonitor = true;
+  bench_sn_can.Init.StdFiltersNbr = 2;
+  bench_sn_can.Init.TimestampPrescaler = 1;
+  fdcan_init(&bench_sn_can);
+  _bench_sn_filters();
+  bench_sn_can.Instance->IE = BENCH_SNIFFER_IRQS;
+  memset(bench_sn_fifo, 0, sizeof(bench_sn_fifo));
+  _bench_sn_status(0);
+  _bench_sn_status(1);
+  bench_sn_can.Instance->RXF0A = 0xFF;
+  bench_sn_can.Instance->RXF1A = 0xFF;
+  bench_sn_can.Instance->IR = 0;
+  memset(bench_sn_lost, 0, sizeof(bench_sn_lost));
+  bench_sn_seed = 0x5A1FU;
+
+  can_sniffer_init(&bench_sn, &bench_sn_can, bench_sn_buf, BENCH_SNIFFER_WORDS, 250);
+
+  for (k = 0; k <= BENCH_SNIFFER_FRAMES; k++) {
+    // a new blocking window every 2 ms
+    if (t_us - block_start >= BENCH_SNIFFER_BLOCK_EVERY) {
+      block_start = t_us;
+      bench_sn_seed = bench_sn_seed * 1103515245U + 12345U;
+      block_len = (bench_sn_seed >> 8) % (block_max_us + 1);
+    }
+
+    // the interrupt and the reader get the CPU between frames unless blocked
+    if (t_us - block_start >= block_len || k == BENCH_SNIFFER_FRAMES) {
+      if (bench_sn_can.Instance->IR != 0) {
+        DWT->CYCCNT = t_us * 250U;
+        start = bench_now();
+        isr_frames += can_sniffer_isr(&bench_sn);
+        isr_ns += bench_now() - start;
+        _bench_sn_acks();
+      }
+
+      while (can_sniffer_read(&bench_sn, &bench_sn_frame) == 0) {
+        while (expect < BENCH_SNIFFER_FRAMES && bench_sn_lost[expect]) expect++;
+        _bench_sn_make(expect, &id, &dlc, &fd);
+        if (bench_sn_frame.id != id || bench_sn_frame.dlc != dlc || memcmp(bench_sn_frame.data, &expect, 4) != 0 ||
+            ((bench_sn_frame.flags & CAN_TRACE_FLAG_FDF) != 0) != fd) {
+          errors++;
+        }
+        expect++;
+        captured++;
+      }
+    }
+    if (k == BENCH_SNIFFER_FRAMES) break;
+
+    _bench_sn_make(k, &id, &dlc, &fd);
+    t_us += _bench_sn_frame_us(fd);
+    _bench_sn_deliver(k, t_us, split);
+    model_lost += bench_sn_lost[k];
+  }
+
+  can_sniffer_get_stats(&bench_sn, &stats);
+  if (captured + model_lost != BENCH_SNIFFER_FRAMES) errors++;
+  if (block_max_us == 0 && (model_lost != 0 || stats.fifo_lost[0] + stats.fifo_lost[1] != 0)) errors++;
+
+  printf("{\"suite\":\"can_sniffer\",\"bench\":\"%s\",\"frames\":%u,\"captured\":%u,\"lost\":%u,"
+         "\"lost_irqs\":%u,\"ring_full\":%u,\"fifo0_peak\":%u,\"fifo1_peak\":%u,\"ring_peak_words\":%u,"
+         "\"isr_ns_per_frame\":%u,\"errors\":%u}\r\n",
+         name, (unsigned)BENCH_SNIFFER_FRAMES, (unsigned)captured, (unsigned)model_lost,
+         (unsigned)(stats.fifo_lost[0] + stats.fifo_lost[1]), (unsigned)stats.ring_full,
+         (unsigned)stats.fifo_peak[0], (unsigned)stats.fifo_peak[1], (unsigned)stats.ring_peak,
+         (unsigned)(isr_frames ? isr_ns / isr_frames : 0), (unsigned)errors);
+}
+
+/* Two frames per FIFO for every timed drain */
+static void _bench_sn_refill(void *ctx) {
+  (void)ctx;
+  _bench_sn_acks();
+  _bench_sn_drain();
+  _bench_sn_deliver(0, 0, true);
+  _bench_sn_deliver(1, 100, true);
+  _bench_sn_deliver(2, 200, true);
+  _bench_sn_deliver(3, 300, true);
+}
+#else
+
+/* Internal loopback (MON + LBCK): the frames sent come back into the parity FIFOs */
+static void _bench_sn_refill(void *ctx) {
+  static uint8_t data[8];
+  FDCAN_TxElement_t tx;
+  uint32_t i;
+
+  (void)ctx;
+  _bench_sn_drain();
+  tx.IdType = FDCAN_STANDARD_ID;
+  tx.DataLength = 8;
+  tx.ErrorStateIndicator = 0;
+  tx.BitRateSwitch = FDCAN_BRS_OFF;
+  tx.FDFormat = FDCAN_CLASSIC_CAN;
+  tx.Deadline = 0;
+  tx.Data = data;
+  for (i = 0; i < 2; i++) {
+    tx.Identifier = 0x100 + i;
+    while (fdcan_send(&bench_sn_can, &tx) != 0);
+  }
+  while (fdcan_rxfifo_level(&bench_sn_can, FDCAN_RX_FIFO0) == 0 || fdcan_rxfifo_level(&bench_sn_can, FDCAN_RX_FIFO1) == 0);
+}
+#endif
+
+void bench_can_sniffer(void) {
+  bench_result_t res;
+
+#ifdef BENCH_HOST
+  _bench_sn_run("fifo0_only", false, BENCH_SNIFFER_BLOCK_MAX);
+  _bench_sn_run("parity_split", true, BENCH_SNIFFER_BLOCK_MAX);
+  _bench_sn_run("unblocked", true, 0);
+#else
+  bench_sn_can.Instance = FDCAN2;
+  bench_sn_can.Init.NominalPrescaler = 1;
+  bench_sn_can.Init.NominalTimeSeg1 = 31;
+  bench_sn_can.Init.NominalTimeSeg2 = 8;
+  bench_sn_can.Init.NominalSyncJumpWidth = 8;
+  bench_sn_can.Init.Loopback = true;
+  bench_sn_can.Init.BusMonitor = true;
+  bench_sn_can.Init.StdFiltersNbr = 2;
+  bench_sn_can.Init.TimestampPrescaler = 1;
+  fdcan_init(&bench_sn_can);
+  _bench_sn_filters();
+  bench_sn_can.Instance->IE = BENCH_SNIFFER_IRQS;
+  can_sniffer_init(&bench_sn, &bench_sn_can, bench_sn_buf, BENCH_SNIFFER_WORDS, 250);
+#endif
+
+  // one interrupt draining a frame from each FIFO (host: two per FIFO)
+  bench_run("can_sniffer", "isr_drain", _bench_sn_isr, _bench_sn_refill, NULL, BENCH_SNIFFER_ITERATIONS, &res);
+  bench_report(&res);
+}
@@ -0,0 +1,140 @@
+#include <stddef.h>
+#include "bench.h"
+#include "printf.h"
+#include "can/can_trace_codec.h"
+
+#define BENCH_TRACE_ITERATIONS  256U
+#define BENCH_TRACE_FRAMES      4096U
+#define BENCH_TRACE_BLOCK_SIZE  1024U
+#define BENCH_TRACE_IDS         16U
+
+/* Size of a plain fixed-layout record: u64 timestamp, u32 id, flags, dlc, payload */
+#define BENCH_TRACE_RAW_HEADER  14U
+
+static const uint8_t bench_trace_dlc_bytes[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+
+static uint8_t bench_trace_block[BENCH_TRACE_BLOCK_SIZE];
+static can_trace_encoder_t bench_trace_enc;
+static can_trace_decoder_t bench_trace_dec;
+static can_trace_frame_t bench_trace_frames[BENCH_TRACE_FRAMES];
+static uint32_t bench_trace_next;
+static uint32_t bench_trace_decoded;
+static uint32_t bench_trace_errors;
+
+/*
+ * Synthetic vehicle-like traffic: a few fast IDs carrying counters and
+ * slowly moving signals, many slow IDs that rarely change, one FD frame.
+ */
+static void _bench_trace_generate(void) {
+  uint32_t i, j, slot, len, seed = 0x1234567U;
+  uint64_t t = 0;
+  can_trace_frame_t *f;
+
+  for (i = 0; i < BENCH_TRACE_FRAMES; i++) {
+    f = &bench_trace_frames[i];
+    slot = i % BENCH_TRACE_IDS;
+    seed = seed * 1103515245U + 12345U;
+    t += 50 + ((seed >> 16) & 0x3F);
+
+    f->timestamp_us = t;
+    f->id = 0x100 + slot * 0x10;
+    f->flags = 0;
+    f->dlc = 8;
+    if (slot == 15) {
+      f->id = 0x18FF0000U | slot;
+      f->flags = CAN_TRACE_FLAG_XTD;
+    } else if (slot == 14) {
+      f->flags = CAN_TRACE_FLAG_FDF | CAN_TRACE_FLAG_BRS;
+      f->dlc = 13;
+    }
+
+    len = bench_trace_dlc_bytes[f->dlc];
+    for (j = 0; j < len; j++) {
+      f->data[j] = (uint8_t)(slot * 7 + j);
+    }
+    f->data[0] = (uint8_t)(i / BENCH_TRACE_IDS);           // rolling counter
+    if (slot < 4) {
+      f->data[2] = (uint8_t)((seed >> 8) & 0x03);           // noisy low bits
+      f->data[3] = (uint8_t)(i / (BENCH_TRACE_IDS * 16));   // slow signal
+    }
+  }
+}
+
+static void _bench_trace_decoded(const can_trace_frame_t *frame, void *arg) {
+  const can_trace_frame_t *ref = &bench_trace_frames[bench_trace_decoded++];
+  uint32_t j, len = bench_trace_dlc_bytes[ref->dlc];
+
+  (void)arg;
+  if (frame->timestamp_us != ref->timestamp_us || frame->id != ref->id ||
+      frame->flags != ref->flags || frame->dlc != ref->dlc) {
+    bench_trace_errors++;
+    return;
+  }
+  for (j = 0; j < len; j++) {
+    if (frame->data[j] != ref->data[j]) {
+      bench_trace_errors++;
+      return;
+    }
+  }
+}
+
+static void _bench_trace_encode(void *ctx) {
+  (void)ctx;
+  (void)can_trace_encode(&bench_trace_enc, &bench_trace_frames[bench_trace_next]);
+}
+
+static void _bench_trace_encode_prepare(void *ctx) {
+  (void)ctx;
+  bench_trace_next = (bench_trace_next + 1) % BENCH_TRACE_FRAMES;
+  if (bench_trace_enc.used + CAN_TRACE_RECORD_MAX > BENCH_TRACE_BLOCK_SIZE || bench_trace_next == 0) {
+    can_trace_block_begin(&bench_trace_enc, bench_trace_block, BENCH_TRACE_BLOCK_SIZE, 0,
+                          bench_trace_frames[bench_trace_next].timestamp_us);
+  }
+}
+
+/* Encode the whole capture block by block, checking each block decodes back to the input */
+static void _bench_trace_ratio(void) {
+  uint32_t i, first = 0, raw = 0, encoded = 0, blocks = 0;
+
+  bench_trace_decoded = 0;
+  bench_trace_errors = 0;
+  can_trace_block_begin(&bench_trace_enc, bench_trace_block, BENCH_TRACE_BLOCK_SIZE, 0,
+                        bench_trace_frames[0].timestamp_us);
+
+  for (i = 0; i <= BENCH_TRACE_FRAMES; i++) {
+    if (i == BENCH_TRACE_FRAMES || can_trace_encode(&bench_trace_enc, &bench_trace_frames[i]) == 0) {
+      encoded += bench_trace_enc.used;
+      blocks++;
+      bench_trace_decoded = first;
+      if (can_trace_decode_block(&bench_trace_dec, bench_trace_block, BENCH_TRACE_BLOCK_SIZE,
+                                 _bench_trace_decoded, NULL) != (int)(i - first)) {
+        bench_trace_errors++;
+      }
+      if (i == BENCH_TRACE_FRAMES) break;
+
+      first = i;
+      can_trace_block_begin(&bench_trace_enc, bench_trace_block, BENCH_TRACE_BLOCK_SIZE, blocks,
+                            bench_trace_frames[i].timestamp_us);
+      (void)can_trace_encode(&bench_trace_enc, &bench_trace_frames[i]);
+    }
+    raw += BENCH_TRACE_RAW_HEADER + bench_trace_dlc_bytes[bench_trace_frames[i].dlc];
+  }
+
+  printf("{\"suite\":\"can_trace\",\"bench\":\"compression\",\"frames\":%u,\"blocks\":%u,"
+         "\"raw_bytes\":%u,\"encoded_bytes\":%u,\"ratio_x100\":%u,\"roundtrip_errors\":%u}\r\n",
+         (unsigned)BENCH_TRACE_FRAMES, (unsigned)blocks, (unsigned)raw, (unsigned)encoded,
+         (unsigned)(raw * 100U / encoded), (unsigned)bench_trace_errors);
+}
+
+void bench_can_trace(void) {
+  bench_result_t res;
+
+  _bench_trace_generate();
+  _bench_trace_ratio();
+
+  bench_trace_next = BENCH_TRACE_FRAMES - 1;
+  _bench_trace_encode_prepare(NULL);
+  bench_run("can_trace", "can_trace_encode", _bench_trace_encode, _bench_trace_encode_prepare, NULL,
+            BENCH_TRACE_ITERATIONS, &res);
+  bench_report(&res);
+}
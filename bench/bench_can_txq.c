@@ -0,0 +1,223 @@
+#include <stddef.h>
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+#include "can/can_txq.h"
+
+#define BENCH_TXQ_ITERATIONS  256U
+#define BENCH_TXQ_HW          3U        // TX FIFO elements of the controller
+#define BENCH_TXQ_KEYS        8U
+#define BENCH_TXQ_STEPS       20000U
+
+/*
+ * Simulated controller: three buffers sent in request order, the oldest
+ * one may be on the bus already (cancel then fails as on hardware).
+ */
+typedef struct {
+  uint32_t key;
+  uint32_t value;
+  bool pending;
+  uint32_t order;
+} bench_txq_hw_t;
+
+static can_txq_t bench_txq;
+static bench_txq_hw_t bench_txq_hw[BENCH_TXQ_HW];
+static uint32_t bench_txq_order;
+static bool bench_txq_busy;             // oldest buffer is being transmitted
+static uint32_t bench_txq_seed;
+
+static uint32_t bench_txq_pushed[BENCH_TXQ_KEYS];    // last value pushed per key
+static uint32_t bench_txq_sent[BENCH_TXQ_KEYS];      // last value transmitted per key
+static uint32_t bench_txq_log[16];
+static uint32_t bench_txq_log_len;
+static uint32_t bench_txq_errors;
+static uint32_t bench_txq_stale;
+static uint32_t bench_txq_frames;
+static can_txq_frame_t bench_txq_frame;
+
+static uint32_t _bench_txq_value(const can_txq_frame_t *frame) {
+  uint32_t v;
+
+  memcpy(&v, frame->data, 4);
+  return v;
+}
+
+static int _bench_txq_submit(void *ctx, const can_txq_frame_t *frame, uint32_t *slot) {
+  uint32_t i;
+
+  (void)ctx;
+  for (i = 0; i < BENCH_TXQ_HW; i++) {
+    if (!bench_txq_hw[i].pending) {
+      bench_txq_hw[i].key = frame->key;
+      bench_txq_hw[i].value = _bench_txq_value(frame);
+      bench_txq_hw[i].pending = true;
+      bench_txq_hw[i].order = bench_txq_order++;
+      *slot = i;
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int _bench_txq_oldest(void) {
+  int i, oldest = -1;
+
+  for (i = 0; i < (int)BENCH_TXQ_HW; i++) {
+    if (bench_txq_hw[i].pending && (oldest < 0 || bench_txq_hw[i].order < bench_txq_hw[oldest].order)) oldest = i;
+  }
+  return oldest;
+}
+
+/* Transmit the oldest buffer */
+static bool _bench_txq_bus_step(void) {
+  int i = _bench_txq_oldest();
+  uint32_t k;
+
+  bench_txq_busy = false;
+  if (i < 0) return false;
+
+  bench_txq_hw[i].pending = false;
+  k = bench_txq_hw[i].key & 0xFF;
+  if (k < BENCH_TXQ_KEYS) {
+    if (bench_txq_hw[i].value <= bench_txq_sent[k]) bench_txq_errors++;   // older payload after a fresher one
+    if (bench_txq_hw[i].value != bench_txq_pushed[k]) bench_txq_stale++;
+    bench_txq_sent[k] = bench_txq_hw[i].value;
+  }
+  if (bench_txq_log_len < 16) bench_txq_log[bench_txq_log_len++] = bench_txq_hw[i].key * 1000U + bench_txq_hw[i].value;
+  bench_txq_frames++;
+
+  return true;
+}
+
+static int _bench_txq_cancel(void *ctx, uint32_t slot) {
+  (void)ctx;
+  if (slot >= BENCH_TXQ_HW || !bench_txq_hw[slot].pending) return 1;
+  if (bench_txq_busy && (int)slot == _bench_txq_oldest()) {
+    (void)_bench_txq_bus_step();   // already on the bus, completes
+    return 1;
+  }
+  bench_txq_hw[slot].pending = false;
+  return 0;
+}
+
+static const can_txq_port_t bench_txq_port = {
+  .submit = _bench_txq_submit,
+  .cancel = _bench_txq_cancel,
+  .lock = NULL,
+  .unlock = NULL,
+};
+
+static void _bench_txq_reset(uint32_t options) {
+  memset(bench_txq_hw, 0, sizeof(bench_txq_hw));
+  memset(bench_txq_pushed, 0, sizeof(bench_txq_pushed));
+  memset(bench_txq_sent, 0, sizeof(bench_txq_sent));
+  bench_txq_order = 0;
+  bench_txq_busy = false;
+  bench_txq_log_len = 0;
+  bench_txq_errors = 0;
+  bench_txq_stale = 0;
+  bench_txq_frames = 0;
+  can_txq_init(&bench_txq, &bench_txq_port, NULL, options);
+}
+
+static void _bench_txq_push(uint32_t key, uint32_t value) {
+  bench_txq_frame.key = key;
+  bench_txq_frame.flags = 0;
+  bench_txq_frame.dlc = 8;
+  memset(bench_txq_frame.data, 0, 8);
+  memcpy(bench_txq_frame.data, &value, 4);
+  if (key < BENCH_TXQ_KEYS) bench_txq_pushed[key] = value;
+  if (can_txq_push(&bench_txq, &bench_txq_frame) != 0) bench_txq_errors++;
+}
+
+static void _bench_txq_drain(void) {
+  while (_bench_txq_bus_step() || can_txq_pending(&bench_txq) > 0) {
+    (void)can_txq_pump(&bench_txq);
+  }
+}
+
+/* Hardware full: A1 B1 C1 wait in software, A2 and C2 refresh them in place */
+static void _bench_txq_ordering(void) {
+  static const uint32_t expect[] = { 4001, 5002, 6003, 1010, 2011, 3012 };
+  uint32_t i, errors;
+
+  _bench_txq_reset(0);
+  _bench_txq_push(4, 1);
+  _bench_txq_push(5, 2);
+  _bench_txq_push(6, 3);
+  _bench_txq_push(1, 4);
+  _bench_txq_push(2, 5);
+  _bench_txq_push(3, 6);
+  _bench_txq_push(1, 10);
+  _bench_txq_push(2, 11);
+  _bench_txq_push(3, 12);
+  _bench_txq_drain();
+
+  errors = bench_txq_errors + ((bench_txq_log_len != 6) ? 1U : 0U);
+  for (i = 0; i < 6 && i < bench_txq_log_len; i++) {
+    if (bench_txq_log[i] != expect[i]) errors++;
+  }
+
+  printf("{\"suite\":\"can_txq\",\"bench\":\"ordering\",\"sent\":%u,\"coalesced\":%u,\"errors\":%u}\r\n",
+         (unsigned)bench_txq_log_len, (unsigned)bench_txq.stats.coalesced, (unsigned)errors);
+}
+
+/*
+ * Random producer faster than the bus: every transmitted payload must be
+ * newer than the previous one of its ID, the last one sent must be the last
+ * one pushed, and the software queue never exceeds the number of IDs.
+ */
+static void _bench_txq_freshness(const char *name, uint32_t options) {
+  uint32_t i, k, value = 0, errors;
+  can_txq_stats_t st;
+
+  _bench_txq_reset(options);
+  bench_txq_seed = 0x9E3779B9U;
+
+  for (i = 0; i < BENCH_TXQ_STEPS; i++) {
+    bench_txq_seed = bench_txq_seed * 1103515245U + 12345U;
+    _bench_txq_push((bench_txq_seed >> 16) % BENCH_TXQ_KEYS, ++value);
+
+    bench_txq_busy = ((bench_txq_seed >> 8) & 1) != 0;
+    if (((bench_txq_seed >> 4) & 3) == 0) {
+      (void)_bench_txq_bus_step();
+      (void)can_txq_pump(&bench_txq);
+    }
+  }
+  _bench_txq_drain();
+
+  errors = bench_txq_errors;
+  for (k = 0; k < BENCH_TXQ_KEYS; k++) {
+    if (bench_txq_pushed[k] != bench_txq_sent[k]) errors++;
+  }
+  can_txq_get_stats(&bench_txq, &st);
+  if (st.max_depth > BENCH_TXQ_KEYS) errors++;
+
+  printf("{\"suite\":\"can_txq\",\"bench\":\"%s\",\"pushed\":%u,\"sent\":%u,\"coalesced\":%u,\"replaced\":%u,"
+         "\"stale_sent\":%u,\"max_depth\":%u,\"errors\":%u}\r\n",
+         name, (unsigned)st.pushed, (unsigned)bench_txq_frames, (unsigned)st.coalesced, (unsigned)st.replaced,
+         (unsigned)bench_txq_stale, (unsigned)st.max_depth, (unsigned)errors);
+}
+
+static void _bench_txq_push_coalesce(void *ctx) {
+  (void)ctx;
+  (void)can_txq_push(&bench_txq, &bench_txq_frame);
+}
+
+void bench_can_txq(void) {
+  bench_result_t res;
+  uint32_t k;
+
+  _bench_txq_ordering();
+  _bench_txq_freshness("freshness", 0);
+  _bench_txq_freshness("freshness_replace", CAN_TXQ_REPLACE_PENDING);
+
+  // hardware full and every ID waiting: each push is a lookup and an in-place update
+  _bench_txq_reset(0);
+  for (k = 0; k < BENCH_TXQ_HW + BENCH_TXQ_KEYS; k++) {
+    _bench_txq_push(0x100 + k, k);
+  }
+  bench_txq_frame.key = 0x100 + BENCH_TXQ_HW + BENCH_TXQ_KEYS - 1;
+  bench_run("can_txq", "can_txq_push_coalesce", _bench_txq_push_coalesce, NULL, NULL, BENCH_TXQ_ITERATIONS, &res);
+  bench_report(&res);
+}
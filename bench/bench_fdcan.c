@@ -0,0 +1,156 @@
+#include <stddef.h>
+#include "bench.h"
+#include "drivers/fdcan.h"
+#ifndef BENCH_HOST
+#include "drivers/nvic.h"
+#endif
+
+#define BENCH_FDCAN_ITERATIONS  256U
+
+#ifdef BENCH_HOST
+#define fdcan_receive_flash  fdcan_receive   // RAMFUNC is empty on the host, both runs time the same code
+#else
+/* fdcan_receive() built without the .ramfunc placement, see fdcan_flash.o in the Makefile */
+int fdcan_receive_flash(FDCAN_Handle_t *fdcan, FDCAN_RxElement_t *rx, FDCAN_RxFIFO_t fifo);
+#endif
+
+static FDCAN_Handle_t bench_can;
+static uint8_t bench_tx_data[8] = { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80 };
+static uint8_t bench_rx_data[64];
+static FDCAN_TxElement_t bench_tx;
+static FDCAN_RxElement_t bench_rx;
+static FDCAN_Filter_t bench_filter;
+
+static void _bench_send(void *ctx) {
+  (void)ctx;
+  fdcan_send(&bench_can, &bench_tx);
+}
+
+static void _bench_send_prepare(void *ctx) {
+  bench_tx.DataLength = *(uint32_t *)ctx;
+#ifndef BENCH_HOST
+  // wait for a free TX FIFO slot and drop the looped-back frames
+  while (bench_can.Instance->TXFQS & BIT(21));
+  while (fdcan_rxfifo_level(&bench_can, FDCAN_RX_FIFO0) > 0) {
+    fdcan_receive(&bench_can, &bench_rx, FDCAN_RX_FIFO0);
+  }
+#endif
+}
+
+static void _bench_receive(void *ctx) {
+  (void)ctx;
+  fdcan_receive(&bench_can, &bench_rx, FDCAN_RX_FIFO0);
+}
+
+static void _bench_receive_flash(void *ctx) {
+  (void)ctx;
+  fdcan_receive_flash(&bench_can, &bench_rx, FDCAN_RX_FIFO0);
+}
+
+static void _bench_receive_prepare(void *ctx) {
+  (void)ctx;
+#ifndef BENCH_HOST
+  // loop one frame back so the FIFO holds something to drain
+  if (fdcan_rxfifo_level(&bench_can, FDCAN_RX_FIFO0) == 0) {
+    bench_tx.DataLength = 8;
+    while (fdcan_send(&bench_can, &bench_tx) != 0);
+    while (fdcan_rxfifo_level(&bench_can, FDCAN_RX_FIFO0) == 0);
+  }
+#endif
+}
+
+static void _bench_rxfifo_level(void *ctx) {
+  (void)ctx;
+  (void)fdcan_rxfifo_level(&bench_can, FDCAN_RX_FIFO0);
+}
+
+static void _bench_set_filter(void *ctx) {
+  (void)ctx;
+  fdcan_set_filter(&bench_can, &bench_filter);
+}
+
+#ifndef BENCH_HOST
+static volatile uint32_t bench_isr_stamp;
+static uint32_t bench_isr_entry[BENCH_FDCAN_ITERATIONS];
+static uint32_t bench_isr_total[BENCH_FDCAN_ITERATIONS];
+
+static void _bench_isr(void) {
+  bench_isr_stamp = bench_now();
+}
+
+/* Exception entry and entry-to-exit round trip through a software-pended FDCAN1 IT0 vector */
+static void _bench_isr_latency(void) {
+  bench_result_t res;
+  uint32_t i, start;
+
+  irq_register(FDCAN1_IT0_IRQn, _bench_isr);
+  nvic_enable_irq(FDCAN1_IT0_IRQn);
+
+  for (i = 0; i < BENCH_FDCAN_ITERATIONS; i++) {
+    start = bench_now();
+    nvic_set_pending(FDCAN1_IT0_IRQn);
+    __asm volatile ("dsb\n\tisb" ::: "memory");
+    bench_isr_total[i] = bench_now() - start;
+    bench_isr_entry[i] = bench_isr_stamp - start;
+  }
+
+  nvic_disable_irq(FDCAN1_IT0_IRQn);
+  irq_register(FDCAN1_IT0_IRQn, NULL);
+
+  bench_collect("fdcan", "isr_entry", bench_isr_entry, BENCH_FDCAN_ITERATIONS, &res);
+  bench_report(&res);
+  bench_collect("fdcan", "isr_roundtrip", bench_isr_total, BENCH_FDCAN_ITERATIONS, &res);
+  bench_report(&res);
+}
+#endif
+
+void bench_fdcan(void) {
+  bench_result_t res;
+  uint32_t dlc;
+
+  bench_can.Instance = FDCAN1;
+  bench_can.Init.NominalPrescaler = 1;
+  bench_can.Init.NominalTimeSeg1 = 63;
+  bench_can.Init.NominalTimeSeg2 = 16;
+  bench_can.Init.NominalSyncJumpWidth = 4;
+  bench_can.Init.StdFiltersNbr = 1;
+  bench_can.Init.ExtFiltersNbr = 0;
+  bench_can.Init.Loopback = true;
+  bench_can.Init.TxQueue = true;
+  fdcan_init(&bench_can);
+
+  // accept all standard IDs into FIFO0
+  bench_filter.FilterIndex = 0;
+  bench_filter.FilterType = 2;
+  bench_filter.FilterConfig = 1;
+  bench_filter.FilterID1 = 0x000;
+  bench_filter.FilterID2 = 0x000;
+
+  bench_tx.Identifier = 0x123;
+  bench_tx.Data = bench_tx_data;
+  bench_rx.Data = bench_rx_data;
+
+  bench_run("fdcan", "fdcan_set_filter", _bench_set_filter, NULL, NULL, BENCH_FDCAN_ITERATIONS, &res);
+  bench_report(&res);
+
+  // the delta between DLC 0 and DLC 8 is the _fdcan_copy2ram() payload loop
+  dlc = 0;
+  bench_run("fdcan", "fdcan_send_dlc0", _bench_send, _bench_send_prepare, &dlc, BENCH_FDCAN_ITERATIONS, &res);
+  bench_report(&res);
+  dlc = 8;
+  bench_run("fdcan", "fdcan_send_dlc8", _bench_send, _bench_send_prepare, &dlc, BENCH_FDCAN_ITERATIONS, &res);
+  bench_report(&res);
+
+  bench_run("fdcan", "fdcan_rxfifo_level", _bench_rxfifo_level, NULL, NULL, BENCH_FDCAN_ITERATIONS, &res);
+  bench_report(&res);
+  bench_run("fdcan", "fdcan_receive_dlc8", _bench_receive, _bench_receive_prepare, NULL, BENCH_FDCAN_ITERATIONS, &res);
+  bench_report(&res);
+  // same Rx drain executed from flash (wait states, ART prefetch) instead of SRAM
+  bench_run("fdcan", "fdcan_receive_flash_dlc8", _bench_receive_flash, _bench_receive_prepare, NULL,
+            BENCH_FDCAN_ITERATIONS, &res);
+  bench_report(&res);
+
+#ifndef BENCH_HOST
+  _bench_isr_latency();
+#endif
+}
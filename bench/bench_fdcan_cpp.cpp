@@ -0,0 +1,367 @@
+#include <stddef.h>
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+#include "drivers/fdcan.hpp"
+
+/*
+ * C driver against the Fdcan<> front end on the same work: the C path runs
+ * on FDCAN1 through its handle, the C++ one on FDCAN2, both in loopback
+ * with Tx events. The host build first checks the two write the same Tx
+ * elements and decode the same Rx elements.
+ */
+
+#define BENCH_CPP_ITERATIONS  256U
+#define BENCH_CPP_RF0N        BIT(0)
+#define BENCH_CPP_TC          BIT(7)
+
+struct BenchConfig : fdcan::DefaultConfig {
+  static constexpr bool loopback = true;
+  static constexpr bool tx_events = true;
+};
+
+using BenchBus = fdcan::Fdcan<fdcan::Instance::Fdcan2, BenchConfig>;
+
+static FDCAN_Handle_t bench_cc_can;
+static uint8_t bench_cpp_tx_data[8] = { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80 };
+static uint8_t bench_cc_rx_data[64];
+static uint8_t bench_cpp_rx_data[64];
+static FDCAN_TxElement_t bench_cpp_tx;
+static FDCAN_RxElement_t bench_cc_rx;
+static FDCAN_RxElement_t bench_cpp_rx;
+static uint32_t bench_cc_frames;
+static uint32_t bench_cpp_frames;
+
+#ifdef BENCH_HOST
+/* What the controller does on an RXF0A write: one element less, get index advanced */
+static void _bench_cpp_pop(FDCAN_t *regs) {
+  uint32_t status = regs->RXF0S;
+
+  regs->RXF0S = ((status & 0b1111) - 1U) | (((((status >> 8) & 0b11) + 1U) % SRAMCAN_RF0_NBR) << 8);
+}
+
+/* A frame in both FIFO0s: 'level' elements from get index 'get' */
+static void _bench_cpp_fill(uint32_t get, uint32_t level, uint32_t w0, uint32_t w1) {
+  FDCAN_t *regs[2] = { FDCAN1, FDCAN2 };
+  uint32_t i, k, *e;
+
+  for (i = 0; i < 2; i++) {
+    for (k = 0; k < level; k++) {
+      e = (uint32_t *)(FDCAN_SRAM_BASE + i * SRAMCAN_SIZE + SRAMCAN_RF0SA +
+                       ((get + k) % SRAMCAN_RF0_NBR) * SRAMCAN_RF0_SIZE);
+      e[0] = w0;
+      e[1] = w1;
+      e[2] = 0x44332211U + k;
+      e[3] = 0x88776655U;
+    }
+    regs[i]->RXF0S = level | (get << 8);
+  }
+}
+
+/*
+ * fdcan_tx_expire() cancels a C frame in buffer 0 and Bus::send() reuses the
+ * buffer: the cancellation is counted as such, and the C++ frame sent from
+ * it afterwards is not taken for a late one. Returns the number of mismatches.
+ */
+static uint32_t _bench_cpp_expire(void) {
+  FDCAN_Handle_t *can = BenchBus::handle();
+  FDCAN_TxElement_t tx = bench_cpp_tx;
+  uint32_t errors = 0;
+
+  can->Instance->TXFQS = 0;
+  can->Instance->TXBRP = can->Instance->TXBTO = can->Instance->TXBCF = 0;
+  tx.Deadline = 100;
+  if (fdcan_send(can, &tx) != 0) errors++;
+  can->Instance->TXBRP = BIT(0);
+
+  // past the deadline: cancelled before it won arbitration
+  if (fdcan_tx_expire(can, 200) != BIT(0) || can->Instance->TXBCR != BIT(0)) errors++;
+  can->Instance->TXBRP = 0;
+  can->Instance->TXBCF = BIT(0);
+
+  // the C++ frame in the same buffer, then on the bus: TXBAR cleared TXBCF, TXBTO set
+  if (BenchBus::send(bench_cpp_tx) != 0) errors++;
+  can->Instance->TXBCF = 0;
+  can->Instance->TXBTO = BIT(0);
+
+  (void)fdcan_tx_expire(can, 300);
+  if (can->TxStats.Expired != 1 || can->TxStats.Cancelled != 1 || can->TxStats.Late != 0) errors++;
+  if (can->TxCancelRequest != 0) errors++;
+
+  can->Instance->TXBTO = 0;
+  can->Instance->TXBCR = 0;
+  return errors;
+}
+#endif
+
+static void _bench_cc_on_rx(FDCAN_Handle_t *fdcan, const FDCAN_RxElement_t *rx) {
+  (void)rx;
+  bench_cc_frames++;
+#ifdef BENCH_HOST
+  _bench_cpp_pop(fdcan->Instance);
+#else
+  (void)fdcan;
+#endif
+}
+
+static void _bench_cpp_on_rx(const FDCAN_RxElement_t &rx) {
+  (void)rx;
+  bench_cpp_frames++;
+#ifdef BENCH_HOST
+  _bench_cpp_pop(FDCAN2);
+#endif
+}
+
+/*
+ * The front end inlines into its caller: these are the send, receive and
+ * handler bodies an application would write, in SRAM like the C driver's,
+ * and the symbols make fdcan-size compares with fdcan_send(),
+ * fdcan_receive() and bench_c_isr() + fdcan_irq_ack() + fdcan_receive().
+ */
+extern "C" RAMFUNC int bench_cpp_send(const FDCAN_TxElement_t *tx) {
+  return BenchBus::send(*tx);
+}
+
+extern "C" RAMFUNC int bench_cpp_receive(FDCAN_RxElement_t *rx) {
+  return BenchBus::receive(*rx);
+}
+
+extern "C" RAMFUNC uint32_t bench_cpp_isr(void) {
+  return BenchBus::isr(bench_cpp_rx, [](const FDCAN_RxElement_t &rx) { _bench_cpp_on_rx(rx); });
+}
+
+/* The C handler body: acknowledge, drain FIFO0 through RxCallback */
+extern "C" RAMFUNC uint32_t bench_c_isr(void) {
+  uint32_t ir = fdcan_irq_ack(&bench_cc_can);
+
+  while (fdcan_receive(&bench_cc_can, &bench_cc_rx, FDCAN_RX_FIFO0) == 0);
+  return ir;
+}
+
+static void _bench_cpp_setup(void) {
+  FDCAN_Init_t init;
+  FDCAN_Filter_t filter;
+
+  memset(&init, 0, sizeof(init));
+  init.NominalPrescaler = 1;
+  init.NominalTimeSeg1 = 63;
+  init.NominalTimeSeg2 = 16;
+  init.NominalSyncJumpWidth = 4;
+  init.StdFiltersNbr = 1;
+
+  memset(&bench_cc_can, 0, sizeof(bench_cc_can));
+  bench_cc_can.Instance = FDCAN1;
+  bench_cc_can.Init = init;
+  bench_cc_can.Init.Loopback = true;
+  bench_cc_can.Init.TxQueue = true;
+  bench_cc_can.Init.TxEvents = true;
+  fdcan_init(&bench_cc_can);
+  BenchBus::init(init);
+
+  // every standard ID into FIFO0
+  memset(&filter, 0, sizeof(filter));
+  filter.FilterType = FDCAN_FILTER_MASK;
+  filter.FilterConfig = FDCAN_FILTER_TO_RXFIFO0;
+  fdcan_set_filter(&bench_cc_can, &filter);
+  fdcan_set_filter(BenchBus::handle(), &filter);
+
+  bench_cpp_tx.Identifier = 0x123;
+  bench_cpp_tx.IdType = FDCAN_STANDARD_ID;
+  bench_cpp_tx.DataLength = 8;
+  bench_cpp_tx.Data = bench_cpp_tx_data;
+  bench_cc_rx.Data = bench_cc_rx_data;
+  bench_cpp_rx.Data = bench_cpp_rx_data;
+}
+
+#ifdef BENCH_HOST
+static bool _bench_cpp_rx_equal(void) {
+  return bench_cc_rx.Identifier == bench_cpp_rx.Identifier && bench_cc_rx.IdType == bench_cpp_rx.IdType &&
+         bench_cc_rx.DataLength == bench_cpp_rx.DataLength &&
+         bench_cc_rx.ErrorStateIndicator == bench_cpp_rx.ErrorStateIndicator &&
+         bench_cc_rx.RxTimestamp == bench_cpp_rx.RxTimestamp && bench_cc_rx.FilterIndex == bench_cpp_rx.FilterIndex &&
+         memcmp(bench_cc_rx_data, bench_cpp_rx_data, 8) == 0;
+}
+
+/* Both paths on the same frames: Tx element words, TXBAR, Rx decode, ISR drain */
+static void _bench_cpp_check(void) {
+  static const struct {
+    uint32_t id, type, dlc, esi;
+  } frames[] = {
+    { 0x123, FDCAN_STANDARD_ID, 8, 0 },
+    { 0x7FF, FDCAN_STANDARD_ID, 0, 1 },
+    { 0x18DAF110, FDCAN_EXTENDED_ID, 5, 0 },
+  };
+  const uint32_t *cc, *cpp;
+  uint32_t i, put, ir_cc, ir_cpp, errors = 0;
+
+  for (i = 0; i < sizeof(frames) / sizeof(frames[0]); i++) {
+    put = i % FDCAN_TX_BUFFERS;
+    FDCAN1->TXFQS = put << 16;
+    FDCAN2->TXFQS = put << 16;
+    bench_cpp_tx.Identifier = frames[i].id;
+    bench_cpp_tx.IdType = frames[i].type;
+    bench_cpp_tx.DataLength = frames[i].dlc;
+    bench_cpp_tx.ErrorStateIndicator = frames[i].esi;
+    BenchBus::handle()->TxDeadline[put] = 1;   // left by an earlier C send with a deadline
+    if (fdcan_send(&bench_cc_can, &bench_cpp_tx) != 0 || bench_cpp_send(&bench_cpp_tx) != 0) errors++;
+
+    cc = (const uint32_t *)(bench_cc_can.msgRam.TxFIFOQSA + put * SRAMCAN_TFQ_SIZE);
+    cpp = (const uint32_t *)(BenchBus::handle()->msgRam.TxFIFOQSA + put * SRAMCAN_TFQ_SIZE);
+    if (memcmp(cc, cpp, (2U + (frames[i].dlc + 3U) / 4U) * 4U) != 0) errors++;
+    if (FDCAN1->TXBAR != FDCAN2->TXBAR || FDCAN2->TXBAR != BIT(put)) errors++;
+    if (bench_cc_can.LatestTxFifoQRequest != BenchBus::handle()->LatestTxFifoQRequest) errors++;
+    if (bench_cc_can.TxDeadline[put] != 0 || BenchBus::handle()->TxDeadline[put] != 0) errors++;
+  }
+  if (bench_cc_can.TxMarker != BenchBus::handle()->TxMarker) errors++;
+
+  // no free buffer
+  FDCAN1->TXFQS = BIT(21);
+  FDCAN2->TXFQS = BIT(21);
+  if (fdcan_send(&bench_cc_can, &bench_cpp_tx) != 1 || bench_cpp_send(&bench_cpp_tx) != 1) errors++;
+  FDCAN1->TXFQS = 0;
+  FDCAN2->TXFQS = 0;
+
+  // standard and extended frames, at a get index past 0
+  _bench_cpp_fill(2, 1, (0x321U << 18) | BIT(31), (6U << 16) | (5U << 24) | 0xBEEFU);
+  if (fdcan_receive(&bench_cc_can, &bench_cc_rx, FDCAN_RX_FIFO0) != 0 || bench_cpp_receive(&bench_cpp_rx) != 0) errors++;
+  if (!_bench_cpp_rx_equal() || FDCAN1->RXF0A != 2 || FDCAN2->RXF0A != 2) errors++;
+  _bench_cpp_fill(1, 1, 0x18DA10F1U | FDCAN_EXTENDED_ID, (8U << 16) | 0x1234U);
+  if (fdcan_receive(&bench_cc_can, &bench_cc_rx, FDCAN_RX_FIFO0) != 0 || bench_cpp_receive(&bench_cpp_rx) != 0) errors++;
+  if (!_bench_cpp_rx_equal() || bench_cc_rx.IdType != FDCAN_EXTENDED_ID) errors++;
+
+  // empty FIFO
+  FDCAN1->RXF0S = 0;
+  FDCAN2->RXF0S = 0;
+  if (fdcan_receive(&bench_cc_can, &bench_cc_rx, FDCAN_RX_FIFO0) != 1 || bench_cpp_receive(&bench_cpp_rx) != 1) errors++;
+
+  // interrupt with three frames pending
+  _bench_cpp_fill(1, 3, 0x100U << 18, 8U << 16);
+  FDCAN1->IE = FDCAN2->IE = BENCH_CPP_RF0N | BENCH_CPP_TC;
+  FDCAN1->IR = FDCAN2->IR = BENCH_CPP_RF0N | BIT(9);
+  bench_cc_frames = 0;
+  bench_cpp_frames = 0;
+  bench_cc_can.RxCallback = _bench_cc_on_rx;
+  ir_cc = bench_c_isr();
+  ir_cpp = bench_cpp_isr();
+  if (ir_cc != BENCH_CPP_RF0N || ir_cpp != ir_cc || bench_cc_frames != 3 || bench_cpp_frames != 3) errors++;
+  if (!_bench_cpp_rx_equal() || FDCAN1->RXF0A != FDCAN2->RXF0A) errors++;
+  bench_cc_can.RxCallback = NULL;
+
+  errors += _bench_cpp_expire();
+
+  printf("{\"suite\":\"fdcan_cpp\",\"bench\":\"equivalence\",\"tx\":%u,\"rx\":5,\"errors\":%u}\r\n",
+         (unsigned)(sizeof(frames) / sizeof(frames[0])), (unsigned)errors);
+}
+#endif
+
+static void _bench_cc_send(void *ctx) {
+  (void)ctx;
+  fdcan_send(&bench_cc_can, &bench_cpp_tx);
+}
+
+static void _bench_cpp_send(void *ctx) {
+  (void)ctx;
+  bench_cpp_send(&bench_cpp_tx);
+}
+
+static void _bench_cpp_send_prepare(void *ctx) {
+  FDCAN_Handle_t *can = (FDCAN_Handle_t *)ctx;
+
+#ifdef BENCH_HOST
+  can->Instance->TXFQS = 0;
+#else
+  // wait for a free Tx buffer and drop the looped-back frames and Tx events
+  FDCAN_TxEvent_t ev;
+
+  while (can->Instance->TXFQS & BIT(21));
+  while (fdcan_rxfifo_level(can, FDCAN_RX_FIFO0) > 0) {
+    fdcan_rxfifo_release(can, FDCAN_RX_FIFO0, 1);
+  }
+  while (fdcan_tx_event(can, &ev) == 0);
+#endif
+}
+
+static void _bench_cc_receive(void *ctx) {
+  (void)ctx;
+  fdcan_receive(&bench_cc_can, &bench_cc_rx, FDCAN_RX_FIFO0);
+}
+
+static void _bench_cpp_receive(void *ctx) {
+  (void)ctx;
+  bench_cpp_receive(&bench_cpp_rx);
+}
+
+/* One frame in FIFO0 (and, for the ISR, its RF0N pending) */
+static void _bench_cpp_receive_prepare(void *ctx) {
+  FDCAN_Handle_t *can = (FDCAN_Handle_t *)ctx;
+
+#ifdef BENCH_HOST
+  can->Instance->RXF0S = 1;
+  can->Instance->IE = BENCH_CPP_RF0N;
+  can->Instance->IR = BENCH_CPP_RF0N;
+#else
+  FDCAN_TxEvent_t ev;
+
+  while (fdcan_tx_event(can, &ev) == 0);
+  if (fdcan_rxfifo_level(can, FDCAN_RX_FIFO0) == 0) {
+    bench_cpp_tx.DataLength = 8;
+    while (can->Instance->TXFQS & BIT(21));
+    if (can == &bench_cc_can) {
+      fdcan_send(can, &bench_cpp_tx);
+    } else {
+      bench_cpp_send(&bench_cpp_tx);
+    }
+    while (fdcan_rxfifo_level(can, FDCAN_RX_FIFO0) == 0);
+  }
+  can->Instance->IE = BENCH_CPP_RF0N;
+#endif
+}
+
+static void _bench_cc_isr(void *ctx) {
+  (void)ctx;
+  bench_c_isr();
+}
+
+static void _bench_cpp_isr(void *ctx) {
+  (void)ctx;
+  bench_cpp_isr();
+}
+
+extern "C" void bench_fdcan_cpp(void) {
+  bench_result_t res;
+
+  _bench_cpp_setup();
+#ifdef BENCH_HOST
+  _bench_cpp_check();
+#endif
+
+  bench_cpp_tx.Identifier = 0x123;
+  bench_cpp_tx.IdType = FDCAN_STANDARD_ID;
+  bench_cpp_tx.DataLength = 8;
+  bench_cpp_tx.ErrorStateIndicator = 0;
+
+  bench_run("fdcan_cpp", "c_send_dlc8", _bench_cc_send, _bench_cpp_send_prepare, &bench_cc_can,
+            BENCH_CPP_ITERATIONS, &res);
+  bench_report(&res);
+  bench_run("fdcan_cpp", "cpp_send_dlc8", _bench_cpp_send, _bench_cpp_send_prepare, BenchBus::handle(),
+            BENCH_CPP_ITERATIONS, &res);
+  bench_report(&res);
+
+  bench_run("fdcan_cpp", "c_receive_dlc8", _bench_cc_receive, _bench_cpp_receive_prepare, &bench_cc_can,
+            BENCH_CPP_ITERATIONS, &res);
+  bench_report(&res);
+  bench_run("fdcan_cpp", "cpp_receive_dlc8", _bench_cpp_receive, _bench_cpp_receive_prepare, BenchBus::handle(),
+            BENCH_CPP_ITERATIONS, &res);
+  bench_report(&res);
+
+  // acknowledge and one frame through the handler, RxCallback for the C path
+  bench_cc_can.RxCallback = _bench_cc_on_rx;
+  bench_run("fdcan_cpp", "c_isr_1frame", _bench_cc_isr, _bench_cpp_receive_prepare, &bench_cc_can,
+            BENCH_CPP_ITERATIONS, &res);
+  bench_report(&res);
+  bench_run("fdcan_cpp", "cpp_isr_1frame", _bench_cpp_isr, _bench_cpp_receive_prepare, BenchBus::handle(),
+            BENCH_CPP_ITERATIONS, &res);
+  bench_report(&res);
+
+  bench_cc_can.RxCallback = NULL;
+}
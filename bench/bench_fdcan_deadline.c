@@ -0,0 +1,175 @@
+#include <stddef.h>
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+#include "drivers/fdcan.h"
+
+#define BENCH_DEADLINE_ITERATIONS  256U
+
+static FDCAN_Handle_t bench_dl_can;
+
+static void _bench_expire_idle(void *ctx) {
+  (void)ctx;
+  (void)fdcan_tx_expire(&bench_dl_can, 1000);
+}
+
+#ifdef BENCH_HOST
+
+#define BENCH_DEADLINE_STEPS       5000U
+#define BENCH_DEADLINE_FRAME_US    100U     // one frame time per bus step
+#define BENCH_DEADLINE_BUDGET_US   300U     // deadline of each control frame
+
+/*
+ * Controller model on the simulated registers, Tx queue mode: the put index
+ * is the first free buffer, the lowest pending ID wins arbitration unless a
+ * higher priority node on the bus takes it (forced loss), and TXBCR
+ * withdraws pending buffers at the next arbitration round.
+ */
+static uint64_t bench_dl_now;
+static uint64_t bench_dl_deadline[BENCH_DEADLINE_STEPS + 1];
+static uint32_t bench_dl_on_time;
+static uint32_t bench_dl_late;
+static uint32_t bench_dl_refused;
+
+static void _bench_dl_sync(void) {
+  FDCAN_t *regs = bench_dl_can.Instance;
+  uint32_t i, free = 0, put = FDCAN_TX_BUFFERS;
+
+  // new requests
+  regs->TXBRP |= regs->TXBAR;
+  regs->TXBTO &= ~regs->TXBAR;
+  regs->TXBCF &= ~regs->TXBAR;
+  regs->TXBAR = 0;
+
+  // cancellations between frames finish at once
+  regs->TXBCF |= regs->TXBCR;
+  regs->TXBRP &= ~regs->TXBCR;
+  regs->TXBCR = 0;
+
+  for (i = 0; i < FDCAN_TX_BUFFERS; i++) {
+    if ((regs->TXBRP & BIT(i)) == 0) {
+      free++;
+      if (put == FDCAN_TX_BUFFERS) put = i;
+    }
+  }
+  regs->TXFQS = free | ((put % FDCAN_TX_BUFFERS) << 16) | ((free == 0) ? BIT(21) : 0);
+}
+
+static void _bench_dl_bus_step(bool lost) {
+  FDCAN_t *regs = bench_dl_can.Instance;
+  uint32_t i, id, best = FDCAN_TX_BUFFERS, best_id = 0, counter;
+  const uint32_t *element;
+
+  if (lost) return;
+
+  for (i = 0; i < FDCAN_TX_BUFFERS; i++) {
+    if ((regs->TXBRP & BIT(i)) == 0) continue;
+    element = (const uint32_t *)(bench_dl_can.msgRam.TxFIFOQSA + i * 18U * 4U);
+    id = element[0] >> 18;
+    if (best == FDCAN_TX_BUFFERS || id < best_id) {
+      best = i;
+      best_id = id;
+    }
+  }
+  if (best == FDCAN_TX_BUFFERS) return;
+
+  element = (const uint32_t *)(bench_dl_can.msgRam.TxFIFOQSA + best * 18U * 4U);
+  counter = element[2];
+  if (regs->TXBCR & BIT(best)) regs->TXBCF |= BIT(best);   // cancellation came too late
+  regs->TXBRP &= ~BIT(best);
+  regs->TXBTO |= BIT(best);
+
+  if (counter <= BENCH_DEADLINE_STEPS && bench_dl_deadline[counter] != 0 && bench_dl_now > bench_dl_deadline[counter]) {
+    bench_dl_late++;
+  } else {
+    bench_dl_on_time++;
+  }
+}
+
+/*
+ * One control frame per frame time with a 300 us budget, the bus is lost
+ * to other traffic in bursts. Without expiry, stale frames occupy the
+ * buffers and go out late; with expiry none is sent past its deadline.
+ */
+static void _bench_dl_run(const char *name, bool expire) {
+  uint8_t data[8] = { 0 };
+  FDCAN_TxElement_t tx;
+  uint32_t step, seed = 0xC0FFEEU;
+  bool lost, racing;
+
+  bench_dl_can.Instance = FDCAN2;
+  bench_dl_can.Init.NominalPrescaler = 1;
+  bench_dl_can.Init.NominalTimeSeg1 = 63;
+  bench_dl_can.Init.NominalTimeSeg2 = 16;
+  bench_dl_can.Init.NominalSyncJumpWidth = 4;
+  bench_dl_can.Init.TxQueue = true;
+  fdcan_init(&bench_dl_can);
+  bench_dl_can.Instance->TXBRP = 0;
+  bench_dl_can.Instance->TXBTO = 0;
+  bench_dl_can.Instance->TXBCF = 0;
+  _bench_dl_sync();
+
+  memset(bench_dl_deadline, 0, sizeof(bench_dl_deadline));
+  bench_dl_now = 1000;
+  bench_dl_on_time = 0;
+  bench_dl_late = 0;
+  bench_dl_refused = 0;
+
+  tx.IdType = FDCAN_STANDARD_ID;
+  tx.DataLength = 8;
+  tx.ErrorStateIndicator = 0;
+  tx.BitRateSwitch = FDCAN_BRS_OFF;
+  tx.FDFormat = FDCAN_CLASSIC_CAN;
+  tx.Data = data;
+
+  for (step = 1; step <= BENCH_DEADLINE_STEPS; step++) {
+    seed = seed * 1103515245U + 12345U;
+    // bursts of lost arbitration: 1 step in 4 lost, plus 20 step bursts every 500 steps
+    lost = ((seed >> 16) & 3) == 0 || (step % 500) < 20;
+    // now and then the frame is already on the bus when the cancellation arrives
+    racing = ((seed >> 20) & 7) == 0;
+
+    if (expire) (void)fdcan_tx_expire(&bench_dl_can, bench_dl_now);
+    if (racing) _bench_dl_bus_step(lost);
+    _bench_dl_sync();
+
+    tx.Identifier = 0x100 + (step & 0x3F);
+    tx.Deadline = bench_dl_now + BENCH_DEADLINE_BUDGET_US;
+    memcpy(data, &step, 4);
+    bench_dl_deadline[step] = tx.Deadline;
+    if (fdcan_send(&bench_dl_can, &tx) != 0) bench_dl_refused++;
+    _bench_dl_sync();
+
+    if (!racing) _bench_dl_bus_step(lost);
+    bench_dl_now += BENCH_DEADLINE_FRAME_US;
+  }
+  if (expire) (void)fdcan_tx_expire(&bench_dl_can, bench_dl_now);
+
+  printf("{\"suite\":\"fdcan_deadline\",\"bench\":\"%s\",\"frames\":%u,\"on_time\":%u,\"late_on_bus\":%u,"
+         "\"refused\":%u,\"expired\":%u,\"cancelled\":%u,\"late\":%u}\r\n",
+         name, (unsigned)BENCH_DEADLINE_STEPS, (unsigned)bench_dl_on_time, (unsigned)bench_dl_late,
+         (unsigned)bench_dl_refused, (unsigned)bench_dl_can.TxStats.Expired, (unsigned)bench_dl_can.TxStats.Cancelled,
+         (unsigned)bench_dl_can.TxStats.Late);
+}
+#endif
+
+void bench_fdcan_deadline(void) {
+  bench_result_t res;
+
+#ifdef BENCH_HOST
+  _bench_dl_run("no_expiry", false);
+  _bench_dl_run("expiry", true);
+#else
+  bench_dl_can.Instance = FDCAN2;
+  bench_dl_can.Init.NominalPrescaler = 1;
+  bench_dl_can.Init.NominalTimeSeg1 = 63;
+  bench_dl_can.Init.NominalTimeSeg2 = 16;
+  bench_dl_can.Init.NominalSyncJumpWidth = 4;
+  bench_dl_can.Init.Loopback = true;
+  fdcan_init(&bench_dl_can);
+#endif
+
+  // the cost paid on every periodic call when nothing has expired
+  bench_run("fdcan_deadline", "fdcan_tx_expire_idle", _bench_expire_idle, NULL, NULL, BENCH_DEADLINE_ITERATIONS, &res);
+  bench_report(&res);
+}
@@ -0,0 +1,245 @@
+#include <stddef.h>
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+#include "drivers/fdcan.h"
+
+#define BENCH_MP_ITERATIONS  256U
+
+static FDCAN_Handle_t bench_mp_can;
+static uint8_t bench_mp_data[8] = { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80 };
+static FDCAN_TxElement_t bench_mp_tx;
+
+static void _bench_send(void *ctx) {
+  (void)ctx;
+  (void)fdcan_send(&bench_mp_can, &bench_mp_tx);
+}
+
+static void _bench_send_mp(void *ctx) {
+  (void)ctx;
+  (void)fdcan_send_mp(&bench_mp_can, &bench_mp_tx);
+}
+
+static void _bench_send_prepare(void *ctx) {
+  (void)ctx;
+#ifndef BENCH_HOST
+  // wait for a free Tx buffer and drop the looped-back frames
+  while ((bench_mp_can.Instance->TXBRP & 0b111) == 0b111);
+  while (fdcan_rxfifo_level(&bench_mp_can, FDCAN_RX_FIFO0) > 0) {
+    FDCAN_RxElement_t rx;
+    uint8_t data[64];
+
+    rx.Data = data;
+    fdcan_receive(&bench_mp_can, &rx, FDCAN_RX_FIFO0);
+  }
+#endif
+}
+
+#ifdef BENCH_HOST
+#include <pthread.h>
+#include <sched.h>
+
+#define BENCH_MP_PRODUCERS    4U
+#define BENCH_MP_FRAMES       100000U   // per producer
+
+/*
+ * Producer threads stand in for the main loop and interrupts of different
+ * priorities, all queueing through fdcan_send_mp(). Unlike interrupts they
+ * run truly in parallel, a stronger test of the reservation. Each producer
+ * yields between its TXBRP read and the reservation (FDCAN_MP_RESERVE_GAP),
+ * so the others take buffers in that window even on a single core. A
+ * controller thread takes every pending buffer, checks the element (read
+ * twice, to catch a producer overwriting it) and clears its TXBRP bit. The
+ * traffic counters must add up to what was sent and rejected.
+ */
+static volatile int bench_mp_running;
+static uint8_t bench_mp_seen[BENCH_MP_PRODUCERS][BENCH_MP_FRAMES];
+static uint32_t bench_mp_corrupt;
+static uint32_t bench_mp_duplicate;
+static uint32_t bench_mp_retries[BENCH_MP_PRODUCERS];
+#ifdef FDCAN_STATS
+static FDCAN_IdStats_t bench_mp_ids[16];
+
+/* Stats against TxMpStats and the per-producer frame count, returns the number of mismatches */
+static uint32_t _bench_mp_stats_check(void) {
+  const FDCAN_Stats_t *s = &bench_mp_can.Stats;
+  uint32_t i, frames = 0, errors = 0;
+
+  if (s->TxFrames != bench_mp_can.TxMpStats.Sent || s->TxBytes != 8U * bench_mp_can.TxMpStats.Sent) errors++;
+  if (s->TxFull != bench_mp_can.TxMpStats.Full || s->IdOverflow != 0) errors++;
+  for (i = 0; i < sizeof(bench_mp_ids) / sizeof(bench_mp_ids[0]); i++) {
+    if (bench_mp_ids[i].Key == FDCAN_STATS_ID_FREE) continue;
+    if (bench_mp_ids[i].Key - 0x100U >= BENCH_MP_PRODUCERS || bench_mp_ids[i].TxFrames != BENCH_MP_FRAMES) errors++;
+    frames += bench_mp_ids[i].TxFrames;
+  }
+  if (frames != BENCH_MP_PRODUCERS * BENCH_MP_FRAMES) errors++;
+  return errors;
+}
+#endif
+
+static void _bench_mp_payload(uint8_t *data, uint32_t producer, uint32_t seq) {
+  uint32_t i, sum = 0;
+
+  memcpy(data, &seq, 4);
+  data[4] = (uint8_t)producer;
+  data[5] = (uint8_t)(seq * 31U + producer);
+  data[6] = 0x5A;
+  for (i = 0; i < 7; i++) sum += data[i];
+  data[7] = (uint8_t)sum;
+}
+
+static void *_bench_producer(void *arg) {
+  uint32_t p = (uint32_t)(uintptr_t)arg, seq;
+  uint8_t data[8];
+  FDCAN_TxElement_t tx;
+
+  tx.Identifier = 0x100 + p;
+  tx.IdType = FDCAN_STANDARD_ID;
+  tx.DataLength = 8;
+  tx.ErrorStateIndicator = 0;
+  tx.BitRateSwitch = FDCAN_BRS_OFF;
+  tx.FDFormat = FDCAN_CLASSIC_CAN;
+  tx.Deadline = 0;
+  tx.Data = data;
+
+  for (seq = 0; seq < BENCH_MP_FRAMES; seq++) {
+    _bench_mp_payload(data, p, seq);
+    while (fdcan_send_mp(&bench_mp_can, &tx) != 0) {
+      bench_mp_retries[p]++;
+      sched_yield();
+    }
+  }
+  return NULL;
+}
+
+static void _bench_mp_take(uint32_t index) {
+  const volatile uint32_t *element = (const volatile uint32_t *)(bench_mp_can.msgRam.TxFIFOQSA + index * 18U * 4U);
+  uint32_t w[4], i, p, seq;
+  uint8_t data[8], want[8];
+
+  for (i = 0; i < 4; i++) w[i] = element[i];
+  for (i = 0; i < 4; i++) {
+    if (element[i] != w[i]) {
+      bench_mp_corrupt++;
+      return;
+    }
+  }
+
+  memcpy(data, &w[2], 8);
+  p = data[4];
+  memcpy(&seq, data, 4);
+  if (p >= BENCH_MP_PRODUCERS || seq >= BENCH_MP_FRAMES || (w[0] >> 18) != 0x100 + p || ((w[1] >> 16) & 0xF) != 8) {
+    bench_mp_corrupt++;
+    return;
+  }
+  _bench_mp_payload(want, p, seq);
+  if (memcmp(data, want, 8) != 0) {
+    bench_mp_corrupt++;
+    return;
+  }
+  if (bench_mp_seen[p][seq]++ != 0) bench_mp_duplicate++;
+}
+
+static void *_bench_controller(void *arg) {
+  uint32_t *txbrp = (uint32_t *)&bench_mp_can.Instance->TXBRP;
+  uint32_t pending, i;
+
+  (void)arg;
+  for (;;) {
+    pending = __atomic_load_n(txbrp, __ATOMIC_ACQUIRE);
+    if (pending == 0) {
+      if (!bench_mp_running) break;
+      sched_yield();
+      continue;
+    }
+    for (i = 0; i < FDCAN_TX_BUFFERS; i++) {
+      if ((pending & BIT(i)) == 0) continue;
+      _bench_mp_take(i);
+      __atomic_fetch_and(txbrp, ~BIT(i), __ATOMIC_RELEASE);   // transmitted, buffer free again
+    }
+  }
+  return NULL;
+}
+
+static void _bench_threads(void) {
+  pthread_t controller, producers[BENCH_MP_PRODUCERS];
+  uint32_t p, seq, missing = 0, retries = 0, errors;
+
+  memset(bench_mp_seen, 0, sizeof(bench_mp_seen));
+  memset(bench_mp_retries, 0, sizeof(bench_mp_retries));
+  bench_mp_corrupt = 0;
+  bench_mp_duplicate = 0;
+
+  fdcan_init(&bench_mp_can);
+#ifdef FDCAN_STATS
+  fdcan_stats_ids(&bench_mp_can, bench_mp_ids, sizeof(bench_mp_ids) / sizeof(bench_mp_ids[0]));
+#endif
+  bench_mp_can.Instance->TXBRP = 0;
+  sim_fdcan_tx_model = 1;
+  bench_mp_running = 1;
+
+  pthread_create(&controller, NULL, _bench_controller, NULL);
+  for (p = 0; p < BENCH_MP_PRODUCERS; p++) {
+    pthread_create(&producers[p], NULL, _bench_producer, (void *)(uintptr_t)p);
+  }
+  for (p = 0; p < BENCH_MP_PRODUCERS; p++) {
+    pthread_join(producers[p], NULL);
+    retries += bench_mp_retries[p];
+  }
+  bench_mp_running = 0;
+  pthread_join(controller, NULL);
+  sim_fdcan_tx_model = 0;
+
+  for (p = 0; p < BENCH_MP_PRODUCERS; p++) {
+    for (seq = 0; seq < BENCH_MP_FRAMES; seq++) {
+      if (bench_mp_seen[p][seq] == 0) missing++;
+    }
+  }
+  errors = bench_mp_corrupt + bench_mp_duplicate + missing;
+  if (bench_mp_can.TxMpStats.Sent != BENCH_MP_PRODUCERS * BENCH_MP_FRAMES) errors++;
+  if (bench_mp_can.TxMpStats.Full != retries || bench_mp_can.TxMpStats.Contended == 0) errors++;
+#ifdef FDCAN_STATS
+  errors += _bench_mp_stats_check();
+#endif
+
+  printf("{\"suite\":\"fdcan_mp\",\"bench\":\"threads\",\"producers\":%u,\"frames\":%u,\"sent\":%u,\"full\":%u,"
+         "\"contended\":%u,\"retries\":%u,\"corrupt\":%u,\"duplicate\":%u,\"missing\":%u,\"errors\":%u}\r\n",
+         (unsigned)BENCH_MP_PRODUCERS, (unsigned)(BENCH_MP_PRODUCERS * BENCH_MP_FRAMES),
+         (unsigned)bench_mp_can.TxMpStats.Sent, (unsigned)bench_mp_can.TxMpStats.Full,
+         (unsigned)bench_mp_can.TxMpStats.Contended, (unsigned)retries, (unsigned)bench_mp_corrupt,
+         (unsigned)bench_mp_duplicate, (unsigned)missing, (unsigned)errors);
+}
+#endif
+
+void bench_fdcan_mp(void) {
+  bench_result_t res;
+
+  bench_mp_can.Instance = FDCAN1;
+  bench_mp_can.Init.NominalPrescaler = 1;
+  bench_mp_can.Init.NominalTimeSeg1 = 63;
+  bench_mp_can.Init.NominalTimeSeg2 = 16;
+  bench_mp_can.Init.NominalSyncJumpWidth = 4;
+  bench_mp_can.Init.Loopback = true;
+  bench_mp_can.Init.TxQueue = true;
+
+#ifdef BENCH_HOST
+  _bench_threads();
+#endif
+
+  fdcan_init(&bench_mp_can);
+#ifdef BENCH_HOST
+  bench_mp_can.Instance->TXBRP = 0;
+  bench_mp_can.Instance->TXFQS = 0;
+#endif
+
+  bench_mp_tx.Identifier = 0x123;
+  bench_mp_tx.IdType = FDCAN_STANDARD_ID;
+  bench_mp_tx.DataLength = 8;
+  bench_mp_tx.Data = bench_mp_data;
+
+  // uncontended: the price of the reservation over the TXFQS put index
+  bench_run("fdcan_mp", "fdcan_send_dlc8", _bench_send, _bench_send_prepare, NULL, BENCH_MP_ITERATIONS, &res);
+  bench_report(&res);
+  bench_run("fdcan_mp", "fdcan_send_mp_dlc8", _bench_send_mp, _bench_send_prepare, NULL, BENCH_MP_ITERATIONS, &res);
+  bench_report(&res);
+}
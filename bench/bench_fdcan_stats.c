@@ -0,0 +1,306 @@
+#include <stddef.h>
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+#include "drivers/fdcan.h"
+
+#ifdef FDCAN_STATS
+
+#define BENCH_STATS_ITERATIONS  256U
+#define BENCH_STATS_TABLE       64U
+#define BENCH_STATS_IDS         40U     // distinct IDs on the replayed bus
+#define BENCH_STATS_FRAMES      20000U
+#define BENCH_STATS_SMALL       16U     // table too small for the bus: overflow path
+
+#define BENCH_RXFS_RFL          BIT(25)
+#define BENCH_ELEMENT_WORDS     18U
+
+static FDCAN_Handle_t bench_st_can;
+static FDCAN_IdStats_t bench_st_table[BENCH_STATS_TABLE];
+static FDCAN_IdStats_t bench_st_copy[BENCH_STATS_TABLE];
+static FDCAN_Stats_t bench_st_snap;
+static uint8_t bench_st_tx_data[64] = { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80 };
+static uint8_t bench_st_rx_data[64];
+static FDCAN_TxElement_t bench_st_tx;
+static FDCAN_RxElement_t bench_st_rx;
+
+static void _bench_st_setup(void) {
+  FDCAN_Filter_t filter = { .FilterIndex = 0, .FilterType = FDCAN_FILTER_MASK, .FilterConfig = FDCAN_FILTER_TO_RXFIFO0 };
+
+  memset(&bench_st_can, 0, sizeof(bench_st_can));
+  bench_st_can.Instance = FDCAN1;
+  bench_st_can.Init.NominalPrescaler = 1;
+  bench_st_can.Init.NominalTimeSeg1 = 63;
+  bench_st_can.Init.NominalTimeSeg2 = 16;
+  bench_st_can.Init.NominalSyncJumpWidth = 4;
+  bench_st_can.Init.StdFiltersNbr = 1;
+  bench_st_can.Init.Loopback = true;
+  bench_st_can.Init.TxQueue = true;
+  fdcan_init(&bench_st_can);
+  fdcan_set_filter(&bench_st_can, &filter);   // every standard ID into FIFO0
+
+  bench_st_tx.Identifier = 0x123;
+  bench_st_tx.IdType = FDCAN_STANDARD_ID;
+  bench_st_tx.DataLength = 8;
+  bench_st_tx.Data = bench_st_tx_data;
+  bench_st_rx.Data = bench_st_rx_data;
+}
+
+#ifdef BENCH_HOST
+static uint32_t bench_st_seed = 0x57A75U;
+
+static uint32_t _bench_st_rand(void) {
+  bench_st_seed = bench_st_seed * 1103515245U + 12345U;
+  return bench_st_seed >> 8;
+}
+
+/* The replayed bus: BENCH_STATS_IDS IDs, every fourth one extended */
+static uint32_t _bench_st_key(uint32_t n) {
+  return (n % 4 == 3) ? (0x18DA0000U + n) | FDCAN_EXTENDED_ID : 0x100U + 3U * n;
+}
+
+/* Put one frame at the FIFO0 get index of the simulated FDCAN2 with the given fill level */
+static void _bench_st_element(FDCAN_Handle_t *can, uint32_t key, uint32_t dlc, uint32_t level, bool lost) {
+  uint32_t get = _bench_st_rand() % 3;
+  uint32_t *e = (uint32_t *)(can->msgRam.RxFIFO0SA + get * BENCH_ELEMENT_WORDS * 4U);
+
+  e[0] = (key & FDCAN_EXTENDED_ID) ? key : (key << 18);
+  e[1] = dlc << 16;
+  can->Instance->RXF0S = level | (get << 8) | (lost ? BENCH_RXFS_RFL : 0);
+}
+
+/* Replay with every counter known in advance, through both Rx paths */
+static void _bench_st_replay(void) {
+  static FDCAN_Handle_t can;
+  static uint32_t rx_expect[BENCH_STATS_IDS], tx_expect[BENCH_STATS_IDS];
+  static FDCAN_IdStats_t small[BENCH_STATS_SMALL];
+  uint32_t i, n, key, dlc, level, ids, found, errors = 0;
+  uint32_t rx = 0, rx_bytes = 0, tx = 0, tx_bytes = 0, tx_full = 0, lost = 0, high = 0;
+  FDCAN_Stats_t s, after;
+
+  memset(&can, 0, sizeof(can));
+  memset(rx_expect, 0, sizeof(rx_expect));
+  memset(tx_expect, 0, sizeof(tx_expect));
+  can.Instance = FDCAN2;
+  can.Init.NominalPrescaler = 1;
+  can.Init.NominalTimeSeg1 = 63;
+  can.Init.NominalTimeSeg2 = 16;
+  can.Init.NominalSyncJumpWidth = 4;
+  fdcan_init(&can);
+  can.Instance->IE = 0;
+  bench_st_tx.Data = bench_st_tx_data;
+  bench_st_rx.Data = bench_st_rx_data;
+  fdcan_stats_ids(&can, bench_st_table, BENCH_STATS_TABLE);
+
+  for (i = 0; i < BENCH_STATS_FRAMES; i++) {
+    n = _bench_st_rand() % BENCH_STATS_IDS;
+    key = _bench_st_key(n);
+    dlc = _bench_st_rand() % 16;
+
+    if (i % 3 == 2) {
+      // transmit, one attempt in eight finds the Tx FIFO full
+      can.Instance->TXFQS = (_bench_st_rand() % 8 == 0) ? BIT(21) : ((_bench_st_rand() % 3) << 16);
+      bench_st_tx.Identifier = key & ~FDCAN_EXTENDED_ID;
+      bench_st_tx.IdType = key & FDCAN_EXTENDED_ID;
+      bench_st_tx.DataLength = dlc;
+      if (fdcan_send(&can, &bench_st_tx) != 0) {
+        tx_full++;
+      } else {
+        tx++;
+        tx_bytes += fdcan_dlc_to_bytes(dlc);
+        tx_expect[n]++;
+      }
+      continue;
+    }
+
+    level = 1 + _bench_st_rand() % 3;
+    if (level > high) high = level;
+    _bench_st_element(&can, key, dlc, level, (i % 97) == 0);
+    if (i % 97 == 0) lost++;
+
+    if (i & 1) {
+      if (fdcan_receive(&can, &bench_st_rx, FDCAN_RX_FIFO0) != 0) errors++;
+      if (bench_st_rx.Identifier != (key & ~FDCAN_EXTENDED_ID)) errors++;
+    } else {
+      fdcan_rxfifo_release(&can, FDCAN_RX_FIFO0, 1);
+    }
+    rx++;
+    rx_bytes += fdcan_dlc_to_bytes(dlc);
+    rx_expect[n]++;
+  }
+  fdcan_stats_isr(&can, 100);
+  fdcan_stats_isr(&can, 300);
+
+  fdcan_stats_snapshot(&can, &s, true);
+  if (s.RxFrames != rx || s.RxBytes != rx_bytes || s.TxFrames != tx || s.TxBytes != tx_bytes) errors++;
+  if (s.TxFull != tx_full || s.RxLost[0] != lost || s.RxLost[1] != 0 || s.RxHighWater[0] != high) errors++;
+  if (s.IsrCount != 2 || s.IsrCycles != 400 || s.IsrMaxCycles != 300 || s.IdOverflow != 0) errors++;
+
+  // the reset took everything back to zero in the same critical section
+  fdcan_stats_snapshot(&can, &after, false);
+  if (after.RxFrames != 0 || after.TxFull != 0 || after.IsrCycles != 0) errors++;
+
+  ids = fdcan_stats_ids_snapshot(&can, bench_st_copy, BENCH_STATS_TABLE, true);
+  if (ids != BENCH_STATS_IDS) errors++;
+  for (n = 0; n < BENCH_STATS_IDS; n++) {
+    for (i = 0, found = 0; i < ids; i++) {
+      if (bench_st_copy[i].Key != _bench_st_key(n)) continue;
+      found++;
+      if (bench_st_copy[i].RxFrames != rx_expect[n] || bench_st_copy[i].TxFrames != tx_expect[n]) errors++;
+    }
+    if (found != 1) errors++;
+  }
+  if (fdcan_stats_ids_snapshot(&can, bench_st_copy, BENCH_STATS_TABLE, false) != BENCH_STATS_IDS) errors++;
+  if (bench_st_copy[0].RxFrames != 0 || bench_st_copy[0].TxFrames != 0) errors++;
+
+  // a table smaller than the bus: frames without a slot only count in IdOverflow
+  fdcan_stats_ids(&can, small, BENCH_STATS_SMALL);
+  for (n = 0; n < BENCH_STATS_IDS; n++) {
+    _bench_st_element(&can, _bench_st_key(n), 8, 1, false);
+    fdcan_receive(&can, &bench_st_rx, FDCAN_RX_FIFO0);
+  }
+  fdcan_stats_snapshot(&can, &s, false);
+  ids = fdcan_stats_ids_snapshot(&can, bench_st_copy, BENCH_STATS_TABLE, false);
+  if (ids > BENCH_STATS_SMALL || ids + s.IdOverflow != BENCH_STATS_IDS) errors++;
+
+  printf("{\"suite\":\"fdcan_stats\",\"bench\":\"replay\",\"rx\":%u,\"rx_bytes\":%u,\"tx\":%u,\"tx_full\":%u,"
+         "\"lost\":%u,\"high_water\":%u,\"ids\":%u,\"overflow_small_table\":%u,\"errors\":%u}\r\n",
+         (unsigned)rx, (unsigned)rx_bytes, (unsigned)tx, (unsigned)tx_full, (unsigned)lost, (unsigned)high,
+         (unsigned)BENCH_STATS_IDS, (unsigned)s.IdOverflow, (unsigned)errors);
+}
+#endif
+
+static void _bench_st_send(void *ctx) {
+  (void)ctx;
+  fdcan_send(&bench_st_can, &bench_st_tx);
+}
+
+static void _bench_st_send_prepare(void *ctx) {
+  (void)ctx;
+#ifndef BENCH_HOST
+  while (bench_st_can.Instance->TXFQS & BIT(21));
+  while (fdcan_rxfifo_level(&bench_st_can, FDCAN_RX_FIFO0) > 0) {
+    fdcan_receive(&bench_st_can, &bench_st_rx, FDCAN_RX_FIFO0);
+  }
+#endif
+}
+
+static void _bench_st_receive(void *ctx) {
+  (void)ctx;
+  fdcan_receive(&bench_st_can, &bench_st_rx, FDCAN_RX_FIFO0);
+}
+
+static void _bench_st_receive_prepare(void *ctx) {
+  (void)ctx;
+#ifdef BENCH_HOST
+  bench_st_can.Instance->RXF0S = 1;
+#else
+  if (fdcan_rxfifo_level(&bench_st_can, FDCAN_RX_FIFO0) == 0) {
+    while (fdcan_send(&bench_st_can, &bench_st_tx) != 0);
+    while (fdcan_rxfifo_level(&bench_st_can, FDCAN_RX_FIFO0) == 0);
+  }
+#endif
+}
+
+#ifndef BENCH_HOST
+/*
+ * fdcan.c built once more without FDCAN_STATS (fdcan_nostats.o in the Makefile). The statistics
+ * close the handle, so the copy runs on the same one and the difference is the counter cost.
+ */
+int fdcan_send_nostats(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx);
+int fdcan_receive_nostats(FDCAN_Handle_t *fdcan, FDCAN_RxElement_t *rx, FDCAN_RxFIFO_t fifo);
+
+static void _bench_st_send_nostats(void *ctx) {
+  (void)ctx;
+  fdcan_send_nostats(&bench_st_can, &bench_st_tx);
+}
+
+static void _bench_st_receive_nostats(void *ctx) {
+  (void)ctx;
+  fdcan_receive_nostats(&bench_st_can, &bench_st_rx, FDCAN_RX_FIFO0);
+}
+
+static uint32_t _bench_st_diff(uint32_t with, uint32_t without) {
+  return (with > without) ? with - without : 0;
+}
+#endif
+
+static void _bench_st_snapshot(void *ctx) {
+  (void)ctx;
+  fdcan_stats_snapshot(&bench_st_can, &bench_st_snap, true);
+}
+
+static void _bench_st_ids_snapshot(void *ctx) {
+  (void)ctx;
+  (void)fdcan_stats_ids_snapshot(&bench_st_can, bench_st_copy, BENCH_STATS_TABLE, true);
+}
+
+void bench_fdcan_stats(void) {
+  bench_result_t res;
+  uint32_t i, send[3], receive[3];   // p50: without counters, with them, with the per-ID table
+
+#ifdef BENCH_HOST
+  _bench_st_replay();
+#endif
+
+  // same calls as the fdcan suite; the target also times them without the counters
+  _bench_st_setup();
+#ifndef BENCH_HOST
+  bench_run("fdcan_stats", "fdcan_send_dlc8_nostats", _bench_st_send_nostats, _bench_st_send_prepare, NULL,
+            BENCH_STATS_ITERATIONS, &res);
+  bench_report(&res);
+  send[0] = res.p50;
+  bench_run("fdcan_stats", "fdcan_receive_dlc8_nostats", _bench_st_receive_nostats, _bench_st_receive_prepare, NULL,
+            BENCH_STATS_ITERATIONS, &res);
+  bench_report(&res);
+  receive[0] = res.p50;
+#endif
+  bench_run("fdcan_stats", "fdcan_send_dlc8", _bench_st_send, _bench_st_send_prepare, NULL,
+            BENCH_STATS_ITERATIONS, &res);
+  bench_report(&res);
+  send[1] = res.p50;
+  bench_run("fdcan_stats", "fdcan_receive_dlc8", _bench_st_receive, _bench_st_receive_prepare, NULL,
+            BENCH_STATS_ITERATIONS, &res);
+  bench_report(&res);
+  receive[1] = res.p50;
+
+  // per-ID counters on top, the frame's ID found after other IDs filled the table
+  fdcan_stats_ids(&bench_st_can, bench_st_table, BENCH_STATS_TABLE);
+  for (i = 0; i < BENCH_STATS_IDS; i++) {
+    bench_st_tx.Identifier = 0x200 + i;
+    _bench_st_send_prepare(NULL);
+    fdcan_send(&bench_st_can, &bench_st_tx);
+  }
+  bench_st_tx.Identifier = 0x123;
+  bench_run("fdcan_stats", "fdcan_send_dlc8_ids", _bench_st_send, _bench_st_send_prepare, NULL,
+            BENCH_STATS_ITERATIONS, &res);
+  bench_report(&res);
+  send[2] = res.p50;
+  bench_run("fdcan_stats", "fdcan_receive_dlc8_ids", _bench_st_receive, _bench_st_receive_prepare, NULL,
+            BENCH_STATS_ITERATIONS, &res);
+  bench_report(&res);
+  receive[2] = res.p50;
+
+#ifndef BENCH_HOST
+  printf("{\"suite\":\"fdcan_stats\",\"bench\":\"overhead\",\"unit\":\"cycles\",\"send\":%u,\"receive\":%u,"
+         "\"send_ids\":%u,\"receive_ids\":%u}\r\n",
+         (unsigned)_bench_st_diff(send[1], send[0]), (unsigned)_bench_st_diff(receive[1], receive[0]),
+         (unsigned)_bench_st_diff(send[2], send[1]), (unsigned)_bench_st_diff(receive[2], receive[1]));
+#else
+  (void)send;   // no copy without the counters on the host
+  (void)receive;
+#endif
+
+  bench_run("fdcan_stats", "snapshot_reset", _bench_st_snapshot, NULL, NULL, BENCH_STATS_ITERATIONS, &res);
+  bench_report(&res);
+  bench_run("fdcan_stats", "ids_snapshot_reset_64", _bench_st_ids_snapshot, NULL, NULL, BENCH_STATS_ITERATIONS, &res);
+  bench_report(&res);
+}
+
+#else
+
+void bench_fdcan_stats(void) {
+  // built with stats=0: nothing to measure, compare the fdcan suite against a stats=1 build
+}
+
+#endif
@@ -0,0 +1,111 @@
+#include "bench.h"
+#include "printf.h"
+
+#ifdef BENCH_HOST
+
+#include <stdio.h>
+#include "sim.h"
+
+void _putchar(char c) {
+  putchar(c);
+}
+
+int main(void)
+{
+  sim_reset();
+  bench_init();
+
+  bench_rcc();
+  bench_timebase();
+  bench_fdcan();
+  bench_fdcan_deadline();
+  bench_fdcan_stats();
+  bench_printf();
+  bench_printf_cpp();
+  bench_can_trace();
+  bench_slcan();
+  bench_can_mailbox();
+  bench_can_change();
+  bench_can_txq();
+  bench_can_busload();
+  bench_can_selftest();
+  bench_can_sniffer();
+  bench_can_autobaud();
+  bench_can_health();
+  bench_can_latency();
+  bench_can_replay();
+  bench_trace();
+  bench_fdcan_cpp();
+  bench_fdcan_mp();
+
+  printf("{\"bench_end\":{}}\r\n");
+
+  return 0;
+}
+
+#else
+
+#include "stm32h563.h"
+#include "drivers/gpio.h"
+#include "drivers/rcc.h"
+#include "drivers/usart.h"
+#include "drivers/timebase.h"
+
+static USART_t *DEBUG_UART = USART3;
+
+void _putchar(char c) {
+    usart_send_char(DEBUG_UART, c);
+}
+
+void SystemInit(void)
+{
+    rcc_clock_init(&rcc_clock_250mhz);
+
+    rcc_enable_usart(USART3);
+
+    rcc_enable_gpio(BANK('D'));
+
+    gpio_setup(PIN('D', 8), GPIO_MODE_AF, GPIO_PULLUP, GPIO_OTYPE_PP, GPIO_SPEED_MEDIUM, 7);
+    gpio_setup(PIN('D', 9), GPIO_MODE_AF, GPIO_PULLUP, GPIO_OTYPE_PP, GPIO_SPEED_MEDIUM, 7);
+
+    usart_setup(USART3, 115200, rcc_get_usart_clk_hz(USART3));
+}
+
+int main(void)
+{
+  timebase_init();
+  bench_init();
+
+  printf("{\"bench_start\":{\"core_hz\":%u}}\r\n", (unsigned)timebase_core_hz());
+
+  bench_rcc();
+  bench_timebase();
+  bench_fdcan();
+  bench_fdcan_deadline();
+  bench_fdcan_stats();
+  bench_printf();
+  bench_printf_cpp();
+  bench_can_trace();
+  bench_slcan();
+  bench_can_mailbox();
+  bench_can_change();
+  bench_can_txq();
+  bench_can_busload();
+  bench_can_selftest();
+  bench_can_sniffer();
+  bench_can_autobaud();
+  bench_can_health();
+  bench_can_latency();
+  bench_can_replay();
+  bench_trace();
+  bench_fdcan_cpp();
+  bench_fdcan_mp();
+
+  printf("{\"bench_end\":{}}\r\n");
+
+  while (1);
+
+  return 0;
+}
+
+#endif
@@ -0,0 +1,65 @@
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+
+#define BENCH_PRINTF_ITERATIONS 128U
+
+/* typical CAN trace line */
+#define BENCH_TRACE_FORMAT "%08u RX %03X [%u] %02X %02X %02X %02X %02X %02X %02X %02X\r\n"
+
+PRINTF_FMT_DEFINE(bench_trace_fmt, BENCH_TRACE_FORMAT, 13);
+
+static char bench_line[96];
+
+static void _bench_snprintf(void *ctx) {
+  (void)ctx;
+  snprintf_(bench_line, sizeof(bench_line), BENCH_TRACE_FORMAT,
+            123456u, 0x123u, 8u, 0x10u, 0x20u, 0x30u, 0x40u, 0x50u, 0x60u, 0x70u, 0x80u);
+}
+
+static void _bench_snprintf_fmt(void *ctx) {
+  (void)ctx;
+  snprintf_fmt_(bench_line, sizeof(bench_line), &bench_trace_fmt,
+                123456u, 0x123u, 8u, 0x10u, 0x20u, 0x30u, 0x40u, 0x50u, 0x60u, 0x70u, 0x80u);
+}
+
+/*
+ * Pre-parsed formats must print exactly what _vsnprintf() prints, including
+ * %f/%e in builds without float support (the bare specifier) and '*' widths.
+ */
+static uint32_t _bench_fmt_check(const char *format, ...) {
+  char want[96], got[96];
+  printf_spec_t specs[12];
+  printf_fmt_t fmt = { format, specs };
+  va_list va;
+  int n_want, n_got;
+
+  if (printf_compile(format, specs, 12) < 0) return 1;
+  va_start(va, format);
+  n_want = vsnprintf_(want, sizeof(want), format, va);
+  va_end(va);
+  va_start(va, format);
+  n_got = vsnprintf_fmt_(got, sizeof(got), &fmt, va);
+  va_end(va);
+
+  return (n_want != n_got || strcmp(want, got) != 0) ? 1U : 0U;
+}
+
+void bench_printf(void) {
+  bench_result_t res;
+  uint32_t errors = 0;
+
+  PRINTF_FMT_COMPILE(bench_trace_fmt);
+
+  errors += _bench_fmt_check(BENCH_TRACE_FORMAT, 123456u, 0x123u, 8u, 0x10u, 0x20u, 0x30u, 0x40u, 0x50u, 0x60u, 0x70u, 0x80u);
+  errors += _bench_fmt_check("%-6s|%5c|%%|%+d|% i|%.3s", "ab", 'x', 42, -7, "abcdef");
+  errors += _bench_fmt_check("%#x %#o %b %*u %-*d|", 255u, 8u, 5u, 6, 12u, 4, -3);
+  errors += _bench_fmt_check("%f %.2F %e %G %u", 1.5, -2.25, 12345.678, 0.0001, 7u);
+  errors += _bench_fmt_check("%hhu %hd %lu %q|", 300u, 70000, 123456789ul);
+  printf("{\"suite\":\"printf\",\"bench\":\"fmt_equivalence\",\"formats\":5,\"errors\":%u}\r\n", (unsigned)errors);
+
+  bench_run("printf", "snprintf_trace_line", _bench_snprintf, NULL, NULL, BENCH_PRINTF_ITERATIONS, &res);
+  bench_report(&res);
+  bench_run("printf", "snprintf_fmt_trace_line", _bench_snprintf_fmt, NULL, NULL, BENCH_PRINTF_ITERATIONS, &res);
+  bench_report(&res);
+}
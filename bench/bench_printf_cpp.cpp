@@ -0,0 +1,37 @@
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+
+/*
+ * PRINTF_FMT_DEFINE() in C++: the spec arrays are built by the compiler,
+ * under the -fno-exceptions of the bench and firmware builds. The output
+ * must match _vsnprintf() on the same arguments.
+ */
+
+PRINTF_FMT_DEFINE(bench_cpp_line_fmt, "%08u RX %03X [%u] %02X %02X\r\n", 6);
+PRINTF_FMT_DEFINE(bench_cpp_mixed_fmt, "%-6s|%5c|%%|%+d|%*u|%.3s", 7);
+PRINTF_FMT_DEFINE(bench_cpp_float_fmt, "%f %.2F %e %u", 5);
+
+static uint32_t _bench_cpp_fmt_check(const printf_fmt_t *fmt, ...) {
+  char want[96], got[96];
+  va_list va;
+  int n_want, n_got;
+
+  va_start(va, fmt);
+  n_want = vsnprintf_(want, sizeof(want), fmt->format, va);
+  va_end(va);
+  va_start(va, fmt);
+  n_got = vsnprintf_fmt_(got, sizeof(got), fmt, va);
+  va_end(va);
+
+  return (n_want != n_got || strcmp(want, got) != 0) ? 1U : 0U;
+}
+
+void bench_printf_cpp(void) {
+  uint32_t errors = 0;
+
+  errors += _bench_cpp_fmt_check(&bench_cpp_line_fmt, 123456u, 0x123u, 8u, 0x10u, 0x20u);
+  errors += _bench_cpp_fmt_check(&bench_cpp_mixed_fmt, "ab", 'x', 42, 6, 12u, "abcdef");
+  errors += _bench_cpp_fmt_check(&bench_cpp_float_fmt, 1.5, -2.25, 12345.678, 7u);
+  printf("{\"suite\":\"printf\",\"bench\":\"constexpr_equivalence\",\"formats\":3,\"errors\":%u}\r\n", (unsigned)errors);
+}
@@ -0,0 +1,111 @@
+#include <stddef.h>
+#include "bench.h"
+#include "printf.h"
+#include "drivers/rcc.h"
+
+#ifdef BENCH_HOST
+#include "sim.h"
+
+/*
+ * rcc_clock_init() against the clock tree model of sim_host.c: from the
+ * power-on state (HSI, VOS3), again while already on PLL1P, and down to a
+ * slower configuration. The model counts transitions the hardware would
+ * not allow at that moment; the transition log gives the order.
+ */
+
+/* Power-on reset values of the blocks rcc_clock_init() touches */
+static void _bench_rcc_por(void) {
+  RCC->CR = BIT(0) | BIT(1) | (0b01 << 3);   // HSION, HSIRDY, HSIDIV /2
+  RCC->CFGR1 = 0;
+  RCC->CFGR2 = 0;
+  RCC->PLL1CFGR = 0;
+  RCC->PLL1DIVR = 0x01010280;
+  RCC->CCIPR5 = 0;
+  PWR->VOSCR = 0;
+  PWR->VOSSR = BIT(3);
+  FLASH->ACR = 0x13;
+  ICACHE->CR = 0;
+  ICACHE->SR = 0;
+  sim_rcc_log_len = 0;
+  sim_rcc_violations = 0;
+}
+
+static uint32_t _bench_rcc_find(uint8_t event) {
+  uint32_t i;
+
+  for (i = 0; i < sim_rcc_log_len; i++) {
+    if (sim_rcc_log[i] == event) return i;
+  }
+  return SIM_RCC_LOG;
+}
+
+/* Final clock tree and register values for 'cfg', 0 if all as expected */
+static uint32_t _bench_rcc_final(const RCC_ClockConfig_t *cfg, uint32_t sysclk, uint32_t fdcan_hz) {
+  uint32_t errors = 0;
+
+  if (rcc_get_sysclk_hz() != sysclk) errors++;
+  if (rcc_get_hclk_hz() != sysclk / cfg->ahb_div) errors++;
+  if (rcc_get_pclk1_hz() != sysclk / cfg->ahb_div / cfg->apb1_div) errors++;
+  if (rcc_get_fdcan_clk_hz() != fdcan_hz) errors++;
+  if ((RCC->CFGR1 & 0b11) != 0b11) errors++;
+  if ((FLASH->ACR & 0b1111) != (sysclk / cfg->ahb_div - 1) / 42000000UL) errors++;
+  if (((FLASH->ACR >> 4) & 0b11) != (sysclk / cfg->ahb_div - 1) / 84000000UL) errors++;
+  if (((PWR->VOSCR >> 4) & 0b11) != 0b11) errors++;
+  if (((RCC->CCIPR5 >> 8) & 0b11) != 0b01) errors++;
+  if (!(ICACHE->CR & BIT(0))) errors++;
+
+  return errors;
+}
+
+void bench_rcc(void) {
+  static const RCC_ClockConfig_t slow = {
+    .hse_bypass = true, .pll_m = 2, .pll_n = 50, .pll_p = 2, .pll_q = 4,   // 100 MHz, 50 MHz FDCAN
+    .ahb_div = 1, .apb1_div = 2, .apb2_div = 1, .apb3_div = 1,
+  };
+  static const RCC_ClockConfig_t bad = {
+    .hse_bypass = true, .pll_m = 1, .pll_n = 125, .pll_p = 2, .pll_q = 10,  // 500 MHz SYSCLK
+    .ahb_div = 1, .apb1_div = 1, .apb2_div = 1, .apb3_div = 1,
+  };
+  uint32_t errors = 0, violations = 0, vos0, pll_on, sw_pll, cfgr1;
+
+  // from power-on: VOS0 ready before PLL1 locks, PLL1 locked before the switch
+  _bench_rcc_por();
+  if (rcc_clock_init(&rcc_clock_250mhz) != 0) errors++;
+  vos0 = _bench_rcc_find(SIM_RCC_VOS0);
+  pll_on = _bench_rcc_find(SIM_RCC_PLL1_ON);
+  sw_pll = _bench_rcc_find(SIM_RCC_SW_PLL1);
+  if (!(vos0 < pll_on && pll_on < sw_pll && sw_pll < SIM_RCC_LOG)) errors++;
+  errors += _bench_rcc_final(&rcc_clock_250mhz, 250000000UL, 50000000UL);
+  violations += sim_rcc_violations;
+
+  // again while running on PLL1P: back to HSI before PLL1 stops
+  sim_rcc_log_len = 0;
+  sim_rcc_violations = 0;
+  if (rcc_clock_init(&rcc_clock_250mhz) != 0) errors++;
+  if (!(_bench_rcc_find(SIM_RCC_SW_HSI) < _bench_rcc_find(SIM_RCC_PLL1_OFF))) errors++;
+  errors += _bench_rcc_final(&rcc_clock_250mhz, 250000000UL, 50000000UL);
+  violations += sim_rcc_violations;
+
+  // down to 100 MHz: wait states reduced only after the switch
+  sim_rcc_violations = 0;
+  if (rcc_clock_init(&slow) != 0) errors++;
+  errors += _bench_rcc_final(&slow, 100000000UL, 50000000UL);
+  violations += sim_rcc_violations;
+
+  // out of range: rejected before any register is written
+  cfgr1 = RCC->CFGR1;
+  sim_rcc_log_len = 0;
+  if (rcc_clock_init(&bad) != 1 || rcc_clock_init(NULL) != 1) errors++;
+  if (RCC->CFGR1 != cfgr1 || sim_rcc_log_len != 0) errors++;
+
+  printf("{\"suite\":\"rcc\",\"bench\":\"clock_init_sequence\",\"runs\":3,\"violations\":%u,\"errors\":%u}\r\n",
+         (unsigned)violations, (unsigned)(errors + violations));
+
+  // leave the state sim_reset() gives the other suites
+  sim_reset();
+}
+#else
+void bench_rcc(void) {
+  // the target runs rcc_clock_init() in SystemInit(), switching clocks under the bench is not measured
+}
+#endif
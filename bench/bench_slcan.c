@@ -0,0 +1,118 @@
+#include <stddef.h>
+#include <string.h>
+#include "bench.h"
+#include "can/slcan.h"
+
+#define BENCH_SLCAN_ITERATIONS  256U
+#define BENCH_SLCAN_BATCH       32U
+
+/* Memory port: a CAN side that always has a frame, a serial side that takes everything */
+static slcan_t bench_engine;
+static slcan_frame_t bench_slcan_frame;
+static char bench_slcan_line[SLCAN_LINE_MAX];
+static uint32_t bench_slcan_line_len;
+static uint32_t bench_slcan_pending;
+static uint32_t bench_slcan_written;
+
+static int _bench_port_open(void *ctx, uint32_t nominal_bps, uint32_t data_bps, bool listen_only) {
+  (void)ctx; (void)nominal_bps; (void)data_bps; (void)listen_only;
+  return 0;
+}
+
+static void _bench_port_close(void *ctx) {
+  (void)ctx;
+}
+
+static int _bench_port_send(void *ctx, const slcan_frame_t *frame) {
+  (void)ctx; (void)frame;
+  return 0;
+}
+
+static int _bench_port_receive(void *ctx, slcan_frame_t *frame) {
+  (void)ctx;
+  if (bench_slcan_pending == 0) return 1;
+  bench_slcan_pending--;
+  *frame = bench_slcan_frame;
+  return 0;
+}
+
+static uint32_t _bench_port_read(void *ctx, uint8_t *buf, uint32_t max) {
+  (void)ctx; (void)buf; (void)max;
+  return 0;
+}
+
+static uint32_t _bench_port_write(void *ctx, const uint8_t *buf, uint32_t len) {
+  (void)ctx; (void)buf;
+  bench_slcan_written += len;
+  return len;
+}
+
+static uint32_t _bench_port_time_ms(void *ctx) {
+  (void)ctx;
+  return 1234;
+}
+
+static const slcan_port_t bench_slcan_port = {
+  .open = _bench_port_open,
+  .close = _bench_port_close,
+  .send = _bench_port_send,
+  .receive = _bench_port_receive,
+  .read = _bench_port_read,
+  .write = _bench_port_write,
+  .time_ms = _bench_port_time_ms,
+};
+
+static void _bench_format(void *ctx) {
+  (void)ctx;
+  bench_slcan_line_len = slcan_format_frame(&bench_slcan_frame, 1234, bench_slcan_line);
+}
+
+static void _bench_parse(void *ctx) {
+  (void)ctx;
+  (void)slcan_parse_frame(bench_slcan_line, bench_slcan_line_len - 1, &bench_slcan_frame);
+}
+
+static void _bench_input(void *ctx) {
+  (void)ctx;
+  slcan_input(&bench_engine, (const uint8_t *)bench_slcan_line, bench_slcan_line_len);
+  bench_engine.out_head = bench_engine.out_tail = 0;
+}
+
+/* Bus -> host path: BENCH_SLCAN_BATCH frames drained and flushed in one poll */
+static void _bench_poll(void *ctx) {
+  (void)ctx;
+  slcan_poll(&bench_engine);
+}
+
+static void _bench_poll_prepare(void *ctx) {
+  (void)ctx;
+  bench_slcan_pending = BENCH_SLCAN_BATCH;
+}
+
+void bench_slcan(void) {
+  bench_result_t res;
+  static const uint8_t open_cmd[] = "Z1\rO\r";
+  uint32_t i;
+
+  slcan_init(&bench_engine, &bench_slcan_port, NULL);
+  slcan_input(&bench_engine, open_cmd, sizeof(open_cmd) - 1);
+
+  bench_slcan_frame.id = 0x123;
+  bench_slcan_frame.dlc = 8;
+  for (i = 0; i < 8; i++) {
+    bench_slcan_frame.data[i] = (uint8_t)(0x11 * i);
+  }
+
+  bench_run("slcan", "slcan_format_frame_dlc8", _bench_format, NULL, NULL, BENCH_SLCAN_ITERATIONS, &res);
+  bench_report(&res);
+  bench_run("slcan", "slcan_parse_frame_dlc8", _bench_parse, NULL, NULL, BENCH_SLCAN_ITERATIONS, &res);
+  bench_report(&res);
+
+  // host -> bus: parse, send and reply for one complete command line
+  bench_slcan_line_len = slcan_format_frame(&bench_slcan_frame, -1, bench_slcan_line);
+  bench_run("slcan", "slcan_input_tx_dlc8", _bench_input, NULL, NULL, BENCH_SLCAN_ITERATIONS, &res);
+  bench_report(&res);
+
+  bench_run("slcan", "slcan_poll_rx_x32_dlc8", _bench_poll, _bench_poll_prepare, NULL, BENCH_SLCAN_ITERATIONS, &res);
+  bench_report(&res);
+}
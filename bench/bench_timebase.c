@@ -0,0 +1,145 @@
+#include <stddef.h>
+#include "bench.h"
+#include "printf.h"
+#include "drivers/timebase.h"
+
+#ifdef BENCH_HOST
+#include "sim.h"
+
+/*
+ * timebase_cycles() across CYCCNT wraps. The bench owns the 64-bit "true"
+ * cycle count and mirrors its low word into the simulated CYCCNT; SysTick is
+ * raised by hand, so a window around each wrap can be stepped with no tick
+ * in it, or with one just before, at or just after the wrap. The last window
+ * interrupts the seqlock at its barriers: a tick preempting a reader that
+ * holds the slot, and a reader preempting the tick between slot and 'seq'.
+ * Every read must equal the true count and never go backwards.
+ */
+
+#define BENCH_TB_WRAP       0x100000000ULL
+#define BENCH_TB_WINDOW     0x800U     // cycles stepped on each side of a wrap
+#define BENCH_TB_STEP       0x40U
+
+static uint64_t bench_tb_now;          // cycles since timebase_init()
+static uint64_t bench_tb_last;         // last value read
+static uint64_t bench_tb_inner;        // value read by the preempting reader
+static uint32_t bench_tb_reads;
+static uint32_t bench_tb_errors;
+
+static void _bench_tb_set(uint64_t now) {
+  bench_tb_now = now;
+  DWT->CYCCNT = (uint32_t)now;
+}
+
+static void _bench_tb_tick(void) {
+  sim_irq(SysTick_IRQn);
+}
+
+/* Run to 'now' with a tick every quarter wrap, as the 1 kHz SysTick keeps the gaps far shorter */
+static void _bench_tb_run_to(uint64_t now) {
+  while (now - bench_tb_now > BENCH_TB_WRAP / 4U) {
+    _bench_tb_set(bench_tb_now + BENCH_TB_WRAP / 4U);
+    _bench_tb_tick();
+  }
+  _bench_tb_set(now);
+}
+
+static void _bench_tb_check(uint64_t value, uint64_t expect) {
+  bench_tb_reads++;
+  if (value != expect || value < bench_tb_last) bench_tb_errors++;
+  bench_tb_last = value;
+}
+
+static void _bench_tb_read(void) {
+  _bench_tb_check(timebase_cycles(), bench_tb_now);
+}
+
+/* Preempts a reader: time moves on and the tick publishes a new slot */
+static void _bench_tb_preempt_tick(void) {
+  _bench_tb_set(bench_tb_now + BENCH_TB_STEP);
+  _bench_tb_tick();
+}
+
+/* Preempts the tick handler between the slot and 'seq' */
+static void _bench_tb_preempt_read(void) {
+  _bench_tb_set(bench_tb_now + 1U);
+  bench_tb_inner = timebase_cycles();
+}
+
+/*
+ * Step from 'wrap' - window to 'wrap' + window. The last tick before the window is
+ * half a wrap earlier; 'tick_at' adds one inside it (0: none).
+ */
+static void _bench_tb_cross(uint64_t wrap, uint64_t tick_at) {
+  uint64_t now;
+
+  _bench_tb_run_to(wrap - BENCH_TB_WRAP / 2U);
+  _bench_tb_tick();
+  _bench_tb_read();
+
+  for (now = wrap - BENCH_TB_WINDOW; now <= wrap + BENCH_TB_WINDOW; now += BENCH_TB_STEP) {
+    _bench_tb_set(now);
+    if (now == tick_at) _bench_tb_tick();
+    _bench_tb_read();
+  }
+}
+
+void bench_timebase(void) {
+  uint64_t wrap, value;
+  uint32_t preempted = 0;
+
+  bench_tb_reads = 0;
+  bench_tb_errors = 0;
+  bench_tb_last = 0;
+  bench_tb_now = 0;
+
+  if (timebase_init() != 0) bench_tb_errors++;
+  _bench_tb_read();
+
+  // no tick in the window, then one just before, exactly at and just after the wrap
+  _bench_tb_cross(1U * BENCH_TB_WRAP, 0);
+  _bench_tb_cross(2U * BENCH_TB_WRAP, 2U * BENCH_TB_WRAP - BENCH_TB_STEP);
+  _bench_tb_cross(3U * BENCH_TB_WRAP, 3U * BENCH_TB_WRAP);
+  _bench_tb_cross(4U * BENCH_TB_WRAP, 4U * BENCH_TB_WRAP + BENCH_TB_STEP);
+
+  // the whole 2^32 since the last tick but one cycle, across a wrap
+  _bench_tb_run_to(5U * BENCH_TB_WRAP - 0x10U);
+  _bench_tb_tick();
+  _bench_tb_set(6U * BENCH_TB_WRAP - 0x11U);
+  _bench_tb_read();
+  _bench_tb_tick();
+
+  // preemption at the seqlock barriers, around the next wrap
+  wrap = 7U * BENCH_TB_WRAP;
+  _bench_tb_run_to(wrap - BENCH_TB_WRAP / 2U);
+  _bench_tb_tick();
+  _bench_tb_set(wrap - BENCH_TB_WINDOW);
+  while (bench_tb_now <= wrap + BENCH_TB_WINDOW) {
+    // reader interrupted by the tick after taking the slot: it has to retry
+    sim_timebase_preempt = _bench_tb_preempt_tick;
+    value = timebase_cycles();
+    if (sim_timebase_preempt != NULL) bench_tb_errors++;
+    _bench_tb_check(value, bench_tb_now);
+    preempted++;
+
+    // tick interrupted mid-publish by a reader: it reads the previous, complete slot
+    _bench_tb_set(bench_tb_now + BENCH_TB_STEP / 2U);
+    sim_timebase_preempt = _bench_tb_preempt_read;
+    _bench_tb_tick();
+    if (sim_timebase_preempt != NULL) bench_tb_errors++;
+    _bench_tb_check(bench_tb_inner, bench_tb_now);
+    _bench_tb_read();
+    preempted++;
+  }
+
+  printf("{\"suite\":\"timebase\",\"bench\":\"rollover\",\"wraps\":7,\"reads\":%u,\"preempted\":%u,\"errors\":%u}\r\n",
+         (unsigned)bench_tb_reads, (unsigned)preempted, (unsigned)bench_tb_errors);
+
+  // leave the state sim_reset() gives the other suites
+  sim_reset();
+}
+#else
+void bench_timebase(void) {
+  // the target runs on the real SysTick, a wrap of CYCCNT takes 17 s at 250 MHz
+}
+#endif
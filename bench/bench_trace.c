@@ -0,0 +1,184 @@
+#include <stddef.h>
+#include <string.h>
+#include "bench.h"
+#include "printf.h"
+#include "drivers/fdcan.h"
+#include "drivers/trace.h"
+
+#ifdef TRACE_ENABLE
+
+#define BENCH_TRACE_ITERATIONS  256U
+#define BENCH_TRACE_OVERRUN     1500U   // marks emitted into the 1024-event ring
+#define BENCH_ELEMENT_WORDS     18U
+
+static FDCAN_Handle_t bench_tr_can;
+static uint8_t bench_tr_data[64] = { 0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80 };
+static uint8_t bench_tr_rx_data[64];
+static FDCAN_TxElement_t bench_tr_tx;
+static FDCAN_RxElement_t bench_tr_rx;
+static uint8_t bench_tr_buf[sizeof(trace_block_t) + TRACE_RING_EVENTS * sizeof(trace_event_t)];
+static uint32_t bench_tr_arg;
+
+static void _bench_tr_setup(FDCAN_t *instance) {
+  memset(&bench_tr_can, 0, sizeof(bench_tr_can));
+  bench_tr_can.Instance = instance;
+  bench_tr_can.Init.NominalPrescaler = 1;
+  bench_tr_can.Init.NominalTimeSeg1 = 63;
+  bench_tr_can.Init.NominalTimeSeg2 = 16;
+  bench_tr_can.Init.NominalSyncJumpWidth = 4;
+  bench_tr_can.Init.Loopback = true;
+  bench_tr_can.Init.TxQueue = true;
+  fdcan_init(&bench_tr_can);
+
+  bench_tr_tx.Identifier = 0x123;
+  bench_tr_tx.IdType = FDCAN_STANDARD_ID;
+  bench_tr_tx.DataLength = 8;
+  bench_tr_tx.Data = bench_tr_data;
+  bench_tr_rx.Data = bench_tr_rx_data;
+}
+
+#ifdef BENCH_HOST
+typedef struct {
+  uint8_t id;
+  uint8_t unit;
+  uint16_t aux;
+  uint32_t arg;
+} bench_tr_expect_t;
+
+/* One RX interrupt draining two frames on FDCAN2, then a send and a send into a full Tx FIFO */
+static const bench_tr_expect_t bench_tr_sequence[] = {
+  { TRACE_EV_ISR_ENTER,        0, FDCAN2_IT0_IRQn + 16, 0 },
+  { TRACE_EV_FDCAN_IRQ_ACK,    1, 0, 0x1 },
+  { TRACE_EV_FDCAN_RXFIFO,     1, 0, 2 },
+  { TRACE_EV_FDCAN_RX,         1, 0, 0x321 },
+  { TRACE_EV_FDCAN_RX_ACK,     1, 0, 1 },
+  { TRACE_EV_FDCAN_RXFIFO,     1, 0, 1 },
+  { TRACE_EV_FDCAN_RX,         1, 0, 0x18DA00F1U | FDCAN_EXTENDED_ID },
+  { TRACE_EV_FDCAN_RX_ACK,     1, 0, 2 },
+  { TRACE_EV_ISR_EXIT,         0, FDCAN2_IT0_IRQn + 16, 0 },
+  { TRACE_EV_FDCAN_TX_SLOT,    1, 2, 0x123 },
+  { TRACE_EV_FDCAN_TX_REQUEST, 1, 2, 0 },
+  { TRACE_EV_FDCAN_TX_FULL,    1, 0, 0 },
+};
+
+static void _bench_tr_element(uint32_t get, uint32_t key, uint32_t level) {
+  uint32_t *e = (uint32_t *)(bench_tr_can.msgRam.RxFIFO0SA + get * BENCH_ELEMENT_WORDS * 4U);
+
+  e[0] = (key & FDCAN_EXTENDED_ID) ? key : (key << 18);
+  e[1] = 8U << 16;
+  bench_tr_can.Instance->RXF0S = level | (get << 8);
+}
+
+/* The drivers' trace points in a known order, read back with trace_export() and trace_flush() */
+static void _bench_tr_sequence(void) {
+  const trace_block_t *block = (const trace_block_t *)bench_tr_buf;
+  const trace_event_t *ev = (const trace_event_t *)(bench_tr_buf + sizeof(trace_block_t));
+  uint32_t count = sizeof(bench_tr_sequence) / sizeof(bench_tr_sequence[0]);
+  uint32_t i, len, flushed, overrun, errors = 0;
+
+  _bench_tr_setup(FDCAN2);
+  bench_tr_can.Instance->IE = BIT(0);
+  trace_init();
+
+  TRACE_ISR_ENTER(FDCAN2_IT0_IRQn);
+  bench_tr_can.Instance->IR = BIT(0);
+  fdcan_irq_ack(&bench_tr_can);
+  _bench_tr_element(1, 0x321, 2);
+  fdcan_receive(&bench_tr_can, &bench_tr_rx, FDCAN_RX_FIFO0);
+  _bench_tr_element(2, 0x18DA00F1U | FDCAN_EXTENDED_ID, 1);
+  fdcan_receive(&bench_tr_can, &bench_tr_rx, FDCAN_RX_FIFO0);
+  TRACE_ISR_EXIT(FDCAN2_IT0_IRQn);
+  bench_tr_can.Instance->TXFQS = 2U << 16;
+  if (fdcan_send(&bench_tr_can, &bench_tr_tx) != 0) errors++;
+  bench_tr_can.Instance->TXFQS = BIT(21);
+  if (fdcan_send(&bench_tr_can, &bench_tr_tx) == 0) errors++;
+
+  len = trace_export(bench_tr_buf, sizeof(bench_tr_buf));
+  if (len != sizeof(trace_block_t) + count * sizeof(trace_event_t)) errors++;
+  if (block->magic != TRACE_STREAM_MAGIC || block->count != count || block->lost != 0) errors++;
+  for (i = 0; i < count && i < block->count; i++) {
+    if (ev[i].id != bench_tr_sequence[i].id || ev[i].unit != bench_tr_sequence[i].unit) errors++;
+    if (ev[i].aux != bench_tr_sequence[i].aux || ev[i].arg != bench_tr_sequence[i].arg) errors++;
+    if (i > 0 && (int32_t)(ev[i].cycles - ev[i - 1].cycles) < 0) errors++;
+  }
+  // a buffer for a header and two events gets the latest two
+  len = trace_export(bench_tr_buf, sizeof(trace_block_t) + 2 * sizeof(trace_event_t) + 5);
+  if (len != sizeof(trace_block_t) + 2 * sizeof(trace_event_t) || ev[0].id != TRACE_EV_FDCAN_TX_REQUEST) errors++;
+  if (trace_export(bench_tr_buf, sizeof(trace_block_t) - 1) != 0) errors++;
+
+  flushed = trace_flush(0);
+  if (flushed != count || trace_flush(0) != 0) errors++;
+
+  // the writers lap the reader: the ring keeps the newest events, the flush reports the rest as lost
+  for (i = 0; i < BENCH_TRACE_OVERRUN; i++) {
+    TRACE_MARK(1, i);
+  }
+  len = trace_export(bench_tr_buf, sizeof(bench_tr_buf));
+  if (block->count != TRACE_RING_EVENTS || ev[0].arg != BENCH_TRACE_OVERRUN - TRACE_RING_EVENTS) errors++;
+  if (ev[TRACE_RING_EVENTS - 1].arg != BENCH_TRACE_OVERRUN - 1) errors++;
+  overrun = trace_flush(100);
+  overrun += trace_flush(0);
+  if (overrun != TRACE_RING_EVENTS) errors++;
+
+  printf("{\"suite\":\"trace\",\"bench\":\"sequence\",\"events\":%u,\"flushed\":%u,\"overrun_flushed\":%u,"
+         "\"overrun_lost\":%u,\"errors\":%u}\r\n", (unsigned)count, (unsigned)flushed, (unsigned)overrun,
+         (unsigned)(BENCH_TRACE_OVERRUN - TRACE_RING_EVENTS), (unsigned)errors);
+}
+#endif
+
+static void _bench_tr_mark(void *ctx) {
+  (void)ctx;
+  TRACE_MARK(2, bench_tr_arg++);
+}
+
+static void _bench_tr_receive(void *ctx) {
+  (void)ctx;
+  fdcan_receive(&bench_tr_can, &bench_tr_rx, FDCAN_RX_FIFO0);
+}
+
+static void _bench_tr_receive_prepare(void *ctx) {
+  (void)ctx;
+#ifdef BENCH_HOST
+  bench_tr_can.Instance->RXF0S = 1;
+#else
+  if (fdcan_rxfifo_level(&bench_tr_can, FDCAN_RX_FIFO0) == 0) {
+    while (fdcan_send(&bench_tr_can, &bench_tr_tx) != 0);
+    while (fdcan_rxfifo_level(&bench_tr_can, FDCAN_RX_FIFO0) == 0);
+  }
+#endif
+}
+
+static void _bench_tr_export(void *ctx) {
+  (void)ctx;
+  (void)trace_export(bench_tr_buf, sizeof(bench_tr_buf));
+}
+
+void bench_trace(void) {
+  bench_result_t res;
+
+#ifdef BENCH_HOST
+  _bench_tr_sequence();
+#endif
+
+  bench_run("trace", "emit", _bench_tr_mark, NULL, NULL, BENCH_TRACE_ITERATIONS, &res);
+  bench_report(&res);
+
+  // same call as the fdcan suite; the difference to a trace=0 build is three trace points
+  _bench_tr_setup(FDCAN1);
+  bench_run("trace", "fdcan_receive_dlc8", _bench_tr_receive, _bench_tr_receive_prepare, NULL,
+            BENCH_TRACE_ITERATIONS, &res);
+  bench_report(&res);
+
+  bench_run("trace", "export_1024", _bench_tr_export, NULL, NULL, 64, &res);
+  bench_report(&res);
+
+  trace_flush(0);
+}
+
+#else
+
+void bench_trace(void) {
+  // built with trace=0: every trace point compiled out, nothing to measure
+}
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef SIM_H
+#define SIM_H
+
+/*
+ * Simulated register blocks for host builds.
+ * Force-included (-include sim.h) ahead of stm32h563.h so the instance
+ * macros point at plain host memory instead of peripheral addresses.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern uint32_t sim_rcc[];
+extern uint8_t  sim_gpio[];
+extern uint32_t sim_fdcan1[];
+extern uint32_t sim_fdcan2[];
+extern uint32_t sim_fdcan_sram[];
+extern uint32_t sim_dwt[];
+extern uint32_t sim_pwr[];
+extern uint32_t sim_flash[];
+extern uint32_t sim_icache[];
+extern uint32_t sim_systick[];
+extern uint32_t sim_dcb[];
+
+#define RCC                 ((RCC_t *) sim_rcc)
+#define GPIO_BASE           ((uintptr_t) sim_gpio)
+#define FDCAN1              ((FDCAN_t *) sim_fdcan1)
+#define FDCAN2              ((FDCAN_t *) sim_fdcan2)
+#define FDCAN_SRAM_BASE     ((uintptr_t) sim_fdcan_sram)
+#define DWT                 ((DWT_t *) sim_dwt)   // CYCCNT advanced by the benches
+#define PWR                 ((PWR_t *) sim_pwr)
+#define FLASH               ((FLASH_t *) sim_flash)
+#define ICACHE              ((ICACHE_t *) sim_icache)
+#define SysTick             ((SysTick_t *) sim_systick)
+#define DCB                 ((DCB_t *) sim_dcb)
+#define RAMFUNC
+
+// Trace timestamps from the bench clock (ns)
+uint32_t bench_now(void);
+#define TRACE_CLOCK()       bench_now()
+#define TRACE_CLOCK_HZ      1000000000U
+
+// Tx requests through the simulated controller, see sim_fdcan_tx_model
+void sim_fdcan_txbar(volatile void *regs, uint32_t bits);
+// When set, the next TXBAR write clears it and calls it after the request: an interrupt sending in between
+extern void (*volatile sim_fdcan_txbar_preempt)(void);
+#define FDCAN_TXBAR_WRITE(instance, bits)  sim_fdcan_txbar((instance), (bits))
+
+/*
+ * Off by default: TXBAR is a plain store and TXBRP/TXFQS stay as the bench
+ * set them. On, a request sets its TXBRP bit (atomically, producers may be
+ * threads) and the bench stands in for the controller by clearing it.
+ */
+extern volatile int sim_fdcan_tx_model;
+
+// With the model on, fdcan_send_mp() yields between its TXBRP read and the reservation, every other call
+void sim_fdcan_mp_gap(void);
+#define FDCAN_MP_RESERVE_GAP()  sim_fdcan_mp_gap()
+
+/*
+ * Clock tree model. rcc.c calls RCC_POLL() while it waits on a ready flag;
+ * the model then lets the status bits follow their controls (VOSSR, HSERDY,
+ * PLL1RDY, SWS) and checks each transition against the state the hardware
+ * requires at that moment: VOS0 before PLL1 locks above 200 MHz or SYSCLK
+ * goes above it, flash LATENCY/WRHIGHFREQ in place before a switch raises
+ * HCLK, PLL1 not stopped while it is SYSCLK.
+ */
+void sim_rcc_step(void);
+#define RCC_POLL()          sim_rcc_step()
+
+enum {
+  SIM_RCC_VOS0 = 1,   // VOS0 reached
+  SIM_RCC_HSE_ON,     // HSERDY set
+  SIM_RCC_PLL1_OFF,   // PLL1RDY cleared
+  SIM_RCC_PLL1_ON,    // PLL1 locked
+  SIM_RCC_SW_HSI,     // SYSCLK switched to HSI
+  SIM_RCC_SW_PLL1,    // SYSCLK switched to PLL1P
+};
+
+#define SIM_RCC_LOG         16U
+extern uint8_t  sim_rcc_log[SIM_RCC_LOG];   // transitions in order
+extern uint32_t sim_rcc_log_len;
+extern uint32_t sim_rcc_violations;         // transitions taken out of sequence
+
+// can_replay busy-waits on CYCCNT: each turn of the loop advances it by sim_dwt_spin_cycles
+extern uint32_t sim_dwt_spin_cycles;
+void sim_dwt_spin(void);
+#define CAN_REPLAY_SPIN()   sim_dwt_spin()
+
+/*
+ * Interrupts. irq_register() fills a simulated vector table instead of the
+ * SRAM copy nvic.c relocates; sim_irq() runs a handler the way the core would
+ * on that exception, synchronously from the caller.
+ */
+void sim_irq(int irqn);
+
+/*
+ * Preemption point at the barriers of the timebase seqlock. When set, the
+ * next barrier clears it and calls it: the bench runs its "interrupt"
+ * between the slot and 'seq', in a reader or in the tick handler.
+ */
+extern void (*volatile sim_timebase_preempt)(void);
+void sim_timebase_dmb(void);
+#define TIMEBASE_DMB()      sim_timebase_dmb()
+
+/**
+ * @brief Put the simulated blocks in the state the drivers expect after boot:
+ * HSE and PLL1 (Q output) running, one frame pending in RX FIFO 0.
+ */
+void sim_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
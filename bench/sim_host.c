@@ -0,0 +1,168 @@
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+#include "stm32h563.h"
+#include "bench.h"
+#include "drivers/nvic.h"
+#include "drivers/rcc.h"
+
+uint32_t sim_rcc[0x400 / 4];
+uint8_t  sim_gpio[9 * GPIO_PORT_OFFSET];
+uint32_t sim_fdcan1[0x400 / 4];
+uint32_t sim_fdcan2[0x400 / 4];
+uint32_t sim_fdcan_sram[0x800 / 4];
+uint32_t sim_dwt[0x20 / 4];
+uint32_t sim_pwr[0x20 / 4];
+uint32_t sim_flash[0x40 / 4];
+uint32_t sim_icache[0x20 / 4];
+uint32_t sim_systick[0x10 / 4];
+uint32_t sim_dcb[0x20 / 4];
+uint8_t  sim_rcc_log[SIM_RCC_LOG];
+uint32_t sim_rcc_log_len;
+uint32_t sim_rcc_violations;
+volatile int sim_fdcan_tx_model;
+void (*volatile sim_timebase_preempt)(void);
+void (*volatile sim_fdcan_txbar_preempt)(void);
+uint32_t sim_dwt_spin_cycles;
+static irq_handler_t sim_vectors[IRQ_VECTOR_COUNT];
+
+void sim_reset(void) {
+  memset(sim_rcc, 0, sizeof(sim_rcc));
+  memset(sim_gpio, 0, sizeof(sim_gpio));
+  memset(sim_fdcan1, 0, sizeof(sim_fdcan1));
+  memset(sim_fdcan2, 0, sizeof(sim_fdcan2));
+  memset(sim_fdcan_sram, 0, sizeof(sim_fdcan_sram));
+  memset(sim_dwt, 0, sizeof(sim_dwt));
+  memset(sim_pwr, 0, sizeof(sim_pwr));
+  memset(sim_flash, 0, sizeof(sim_flash));
+  memset(sim_icache, 0, sizeof(sim_icache));
+  memset(sim_systick, 0, sizeof(sim_systick));
+  memset(sim_dcb, 0, sizeof(sim_dcb));
+  memset(sim_vectors, 0, sizeof(sim_vectors));
+  sim_fdcan_tx_model = 0;
+  sim_timebase_preempt = NULL;
+  sim_fdcan_txbar_preempt = NULL;
+  sim_dwt_spin_cycles = 4;
+  sim_rcc_log_len = 0;
+  sim_rcc_violations = 0;
+
+  RCC->CR = BIT(16) | BIT(17) | BIT(24) | BIT(25);  // HSEON/RDY, PLL1ON/RDY
+  RCC->PLL1CFGR = BIT(17);      // PLL1QEN
+  PWR->VOSSR = BIT(3);          // VOS3, VOSRDY
+  FLASH->ACR = 0x13;            // reset value: LATENCY 3, WRHIGHFREQ 1
+
+  FDCAN1->RXF0S = 1;            // fill level 1, get index 0
+  FDCAN2->RXF0S = 1;
+}
+
+void sim_fdcan_txbar(volatile void *regs, uint32_t bits) {
+  FDCAN_t *fdcan = (FDCAN_t *)regs;
+  void (*preempt)(void) = sim_fdcan_txbar_preempt;
+
+  if (sim_fdcan_tx_model) {
+    sched_yield();   // let other producers run while the buffer is filled but not yet pending
+    __atomic_fetch_or((uint32_t *)&fdcan->TXBRP, bits, __ATOMIC_RELEASE);
+  }
+  fdcan->TXBAR = bits;
+
+  if (preempt != NULL) {
+    sim_fdcan_txbar_preempt = NULL;
+    preempt();
+  }
+}
+
+void sim_fdcan_mp_gap(void) {
+  static __thread uint32_t calls;
+
+  // every other reservation: another producer takes the buffer this one is about to reserve
+  if (sim_fdcan_tx_model && (calls++ & 1U) != 0) sched_yield();
+}
+
+void sim_dwt_spin(void) {
+  DWT->CYCCNT += sim_dwt_spin_cycles;
+}
+
+void irq_register(IRQn_t irqn, irq_handler_t handler) {
+  if ((int32_t)irqn + 16 < 0 || (int32_t)irqn + 16 >= (int32_t)IRQ_VECTOR_COUNT) return;
+  sim_vectors[irqn + 16] = handler;
+}
+
+void sim_irq(int irqn) {
+  irq_handler_t handler = sim_vectors[irqn + 16];
+
+  if (handler != NULL) handler();
+}
+
+void sim_timebase_dmb(void) {
+  void (*preempt)(void) = sim_timebase_preempt;
+
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (preempt != NULL) {
+    sim_timebase_preempt = NULL;
+    preempt();
+  }
+}
+
+static void _sim_rcc_log(uint8_t event) {
+  if (sim_rcc_log_len < SIM_RCC_LOG) sim_rcc_log[sim_rcc_log_len++] = event;
+}
+
+/* SYSCLK a switch to 'sw' gives, from the PLL1 registers as the hardware would see them */
+static uint32_t _sim_sysclk_hz(uint32_t sw) {
+  uint32_t m = (RCC->PLL1CFGR >> 8) & 0b111111;
+  uint32_t n = (RCC->PLL1DIVR & 0x1FF) + 1;
+  uint32_t p = ((RCC->PLL1DIVR >> 9) & 0x7F) + 1;
+
+  switch (sw) {
+    case 0b00: return RCC_HSI_HZ >> ((RCC->CR >> 3) & 0b11);
+    case 0b01: return RCC_CSI_HZ;
+    case 0b10: return RCC_HSE_HZ;
+    default:   return (m == 0) ? 0 : (uint32_t)((uint64_t)RCC_HSE_HZ / m * n / p);
+  }
+}
+
+void sim_rcc_step(void) {
+  static const uint16_t hpre_div[8] = { 2, 4, 8, 16, 64, 128, 256, 512 };
+  uint32_t cr = RCC->CR, vos = (PWR->VOSCR >> 4) & 0b11, vos0 = (((PWR->VOSSR >> 14) & 0b11) == 0b11);
+  uint32_t sw = RCC->CFGR1 & 0b11, sws = (RCC->CFGR1 >> 3) & 0b11, hpre = RCC->CFGR2 & 0b1111, hclk;
+
+  if (((PWR->VOSSR >> 14) & 0b11) != vos) {
+    PWR->VOSSR = (vos << 14) | BIT(3);
+    vos0 = (vos == 0b11);
+    if (vos0) _sim_rcc_log(SIM_RCC_VOS0);
+  }
+
+  if ((cr & BIT(16)) && !(cr & BIT(17))) {
+    RCC->CR |= BIT(17);
+    _sim_rcc_log(SIM_RCC_HSE_ON);
+  }
+
+  if (!(cr & BIT(24)) && (cr & BIT(25))) {
+    if (sws == 0b11) sim_rcc_violations++;   // stopping the clock the core runs on
+    RCC->CR &= ~BIT(25);
+    _sim_rcc_log(SIM_RCC_PLL1_OFF);
+  } else if ((cr & BIT(24)) && !(cr & BIT(25))) {
+    if (!(RCC->CR & BIT(17))) return;         // no reference yet
+    if (_sim_sysclk_hz(0b11) > 200000000UL && !vos0) sim_rcc_violations++;
+    RCC->CR |= BIT(25);
+    _sim_rcc_log(SIM_RCC_PLL1_ON);
+  }
+
+  if (sw != sws && (sw != 0b11 || (RCC->CR & BIT(25)))) {
+    hclk = _sim_sysclk_hz(sw) / ((hpre & 0b1000) ? hpre_div[hpre & 0b111] : 1U);
+    // VOS0 flash table: one wait state per 42 MHz, WRHIGHFREQ per 84 MHz
+    if ((FLASH->ACR & 0b1111) < (hclk - 1) / 42000000UL) sim_rcc_violations++;
+    if (((FLASH->ACR >> 4) & 0b11) < (hclk - 1) / 84000000UL) sim_rcc_violations++;
+    if (hclk > 200000000UL && !vos0) sim_rcc_violations++;
+    RCC->CFGR1 = (RCC->CFGR1 & ~(0b11 << 3)) | (sw << 3);
+    _sim_rcc_log((sw == 0b11) ? SIM_RCC_SW_PLL1 : SIM_RCC_SW_HSI);
+  }
+}
+
+uint32_t bench_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
@@ -0,0 +1,123 @@
+#ifndef CAN_AUTOBAUD_H
+#define CAN_AUTOBAUD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Automatic bitrate detection.
+ *
+ * The controller listens in bus monitoring mode (it never drives the bus,
+ * so a wrong guess cannot disturb the harness) while the candidates are
+ * tried one after the other:
+ *   - a protocol error in the arbitration phase (PSR.LEC stuff, form, CRC)
+ *     rejects the candidate at once, a wrong rate fails on the first frame
+ *   - 'confirm' frames received without error in between lock it; an FD
+ *     frame failing only in the data phase counts, its arbitration and
+ *     control field were decoded at this rate
+ *   - nothing at all for the observation window moves on; the window is at
+ *     least three average frame intervals (errors at wrong rates count as
+ *     frames too), and a full pass without evidence doubles it (up to 8x)
+ * Candidates are tried in the order given, the hint first: the common
+ * rates lead the default table, so on a busy bus lock takes about one
+ * frame time per wrong candidate plus 'confirm' frames.
+ *
+ * With fd set, the data phase rate is found afterwards at the locked
+ * nominal rate: a BRS frame with a data phase error (PSR.DLEC) moves to
+ * the next data candidate, one received correctly locks it. A bus without
+ * BRS traffic for data_window_us reports data_bps 0; once a data phase
+ * error showed BRS traffic exists, the wait is also at least 16 frame
+ * intervals, so a slow FD bus is not cut short.
+ *
+ * Simulated buses at 20% and 50% load (bench_can_autobaud.c) lock the
+ * nominal rate within 11 ms from 250 kbit/s up, 74 ms at 125k, 87 ms at
+ * 100k and 190 ms at 50k: the rates below 125k miss 100 ms, their frames
+ * and windows are too long. With fd set a classic bus adds data_window_us
+ * to that (94 ms in total at 125k, 107 ms at 100k, 210 ms at 50k).
+ *
+ * Controller access goes through can_autobaud_port_t, see
+ * can_autobaud_fdcan.h for the FDCAN binding.
+ */
+
+#define CAN_AUTOBAUD_MAX_CANDIDATES   16U
+
+typedef struct {
+  const uint32_t *nominal;      // candidate nominal rates in bit/s, NULL selects the default table
+  uint32_t nominal_count;
+  const uint32_t *data;         // candidate data rates, NULL selects the default table
+  uint32_t data_count;
+  uint32_t hint_bps;            // tried first (e.g. the last rate that locked), 0 if none
+  bool     fd;                  // detect the data phase rate as well
+  uint32_t confirm;             // frames needed to lock, 0 selects 2
+  uint32_t window_us;           // shortest observation window, 0 selects 3000
+  uint32_t data_window_us;      // wait for BRS traffic after the nominal lock, 0 selects 20000
+  uint32_t timeout_us;          // give up, 0 selects 1 s
+} can_autobaud_config_t;
+
+typedef struct {
+  uint32_t frames;              // frames received without error since the last sample
+  uint32_t brs_frames;          // of which FD frames with bit rate switching
+  uint32_t errors;              // arbitration phase protocol errors seen (PSR.LEC)
+  uint32_t data_errors;         // data phase protocol errors seen (PSR.DLEC)
+} can_autobaud_evidence_t;
+
+typedef struct {
+  int      (*configure)(void *ctx, uint32_t nominal_bps, uint32_t data_bps);  // restart listening, 1 if not possible
+  void     (*sample)(void *ctx, can_autobaud_evidence_t *ev);                 // evidence since the last call
+  uint64_t (*now_us)(void *ctx);
+} can_autobaud_port_t;
+
+typedef struct {
+  uint32_t nominal_bps;         // 0 if no rate locked
+  uint32_t data_bps;            // 0 without fd or without BRS traffic
+  uint32_t lock_us;             // start to nominal lock
+  uint32_t total_us;            // start to done, data phase included
+  uint32_t candidates;          // rates configured
+  uint32_t rejected;            // candidates rejected on errors
+} can_autobaud_result_t;
+
+typedef enum {
+  CAN_AUTOBAUD_NOMINAL = 0,
+  CAN_AUTOBAUD_DATA,
+  CAN_AUTOBAUD_LOCKED,
+  CAN_AUTOBAUD_FAILED
+} can_autobaud_state_t;
+
+typedef struct {
+  const can_autobaud_port_t *port;
+  void *ctx;
+  can_autobaud_config_t cfg;
+  can_autobaud_state_t state;
+  uint32_t order[CAN_AUTOBAUD_MAX_CANDIDATES];  // nominal rates, hint first
+  uint32_t order_count;
+  uint32_t index;               // current nominal candidate
+  uint32_t data_index;          // current data candidate
+  uint32_t confirmed;           // frames at the current candidate
+  uint32_t brs_seen;            // of which BRS frames received correctly
+  uint32_t data_errors_seen;    // BRS frames failing in the data phase
+  uint32_t window_us;           // current observation window
+  uint32_t interval_us;         // average time between frames seen, 0 if unknown
+  uint64_t last_event_us;
+  bool     evidence;            // anything seen during this pass
+  uint64_t start_us;
+  uint64_t candidate_us;        // current candidate configured, or last frame
+  can_autobaud_result_t result;
+} can_autobaud_t;
+
+/**
+ * @brief Check the configuration and configure the first candidate.
+ * @return 0 if success, 1 on an empty or oversized candidate table.
+ */
+int can_autobaud_init(can_autobaud_t *ab, const can_autobaud_config_t *cfg, const can_autobaud_port_t *port,
+                      void *ctx);
+
+/**
+ * @brief Take the evidence since the last call and move between candidates.
+ * Call it in a loop; every call is short, the windows are timed with now_us().
+ * @return 0 while detecting, 1 when locked or failed (see the result).
+ */
+int can_autobaud_poll(can_autobaud_t *ab);
+
+void can_autobaud_get_result(const can_autobaud_t *ab, can_autobaud_result_t *result);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef CAN_AUTOBAUD_FDCAN_H
+#define CAN_AUTOBAUD_FDCAN_H
+
+#include "fdcan.h"
+#include "can/can_autobaud.h"
+
+/**
+ * @brief Detect the bus bitrate on a controller, then start it normally.
+ * Candidates are tried in bus monitoring mode with all frames accepted into
+ * Rx FIFO 0 (drained and dropped while detecting). Evidence is the Rx FIFO
+ * fill level and the PEA/PED protocol error flags with PSR.LEC/DLEC.
+ * On lock the nominal bit timing of fdcan->Init, and the data bit timing
+ * with FDMode set when a data rate was found, are filled with
+ * fdcan_calc_bittiming(). fdcan_init() then runs with the rest of the
+ * caller's Init unchanged, e.g. BusMonitor false to join the bus; without a
+ * data rate FDMode and the data timing stay as given. timebase_init() must
+ * have run.
+ * @param cfg NULL for the defaults.
+ * @param result Filled in either way, may be NULL.
+ * @return 0 if a rate locked, 1 on timeout (controller left in INIT).
+ */
+int can_autobaud_fdcan_detect(FDCAN_Handle_t *fdcan, const can_autobaud_config_t *cfg,
+                              can_autobaud_result_t *result);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef CAN_BIND_FDCAN_H
+#define CAN_BIND_FDCAN_H
+
+#include <stddef.h>
+#include "fdcan.h"
+
+/*
+ * Per-controller RxCallback binding shared by the *_fdcan glue modules.
+ * Each module keeps one binding per controller (FDCAN1, FDCAN2): its state
+ * for that controller and the RxCallback it replaced, which its own
+ * callback calls after it so earlier hooks keep seeing every frame.
+ */
+
+typedef struct {
+  FDCAN_Handle_t *fdcan;
+  void *ctx;           // module state bound to the controller
+  void (*chained)(FDCAN_Handle_t *fdcan, const FDCAN_RxElement_t *rx);
+} can_bind_t;
+
+/**
+ * @brief Binding slot of a controller.
+ * @return 0 for FDCAN1, 1 for FDCAN2, -1 otherwise.
+ */
+static inline int can_bind_channel(const FDCAN_Handle_t *fdcan) {
+  if (fdcan == NULL) return -1;
+  if (fdcan->Instance == FDCAN1) return 0;
+  if (fdcan->Instance == FDCAN2) return 1;
+  return -1;
+}
+
+/**
+ * @brief Bind 'ctx' to a controller and install 'callback' as its RxCallback.
+ * Attaching again replaces 'ctx' but keeps the chain of the first attach.
+ * @param binding The module's two bindings.
+ * @return 0 if success, 1 if the handle is not FDCAN1/FDCAN2 or ctx is NULL.
+ */
+static inline int can_bind_rx(can_bind_t *binding, FDCAN_Handle_t *fdcan, void *ctx,
+                              void (*callback)(FDCAN_Handle_t *fdcan, const FDCAN_RxElement_t *rx)) {
+  int ch = can_bind_channel(fdcan);
+
+  if (ch < 0 || ctx == NULL) return 1;
+
+  binding[ch].fdcan = fdcan;
+  binding[ch].ctx = ctx;
+  if (fdcan->RxCallback != callback) {
+    binding[ch].chained = fdcan->RxCallback;
+  }
+  fdcan->RxCallback = callback;
+
+  return 0;
+}
+
+/* Binding a callback runs for, the handle is FDCAN1 or FDCAN2 */
+static inline can_bind_t *can_bind_of(can_bind_t *binding, const FDCAN_Handle_t *fdcan) {
+  return &binding[(fdcan->Instance == FDCAN2) ? 1 : 0];
+}
+
+/* Pass the frame on to the callback installed before */
+static inline void can_bind_chain(const can_bind_t *b, FDCAN_Handle_t *fdcan, const FDCAN_RxElement_t *rx) {
+  if (b->chained != NULL) {
+    b->chained(fdcan, rx);
+  }
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef CAN_BUSLOAD_H
+#define CAN_BUSLOAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Bus load monitor.
+ *
+ * Every frame seen by the node (received, and sent by the node itself) is
+ * converted to its wire time from exact field lengths:
+ *   classic   SOF, arbitration, control, data, CRC15 (dynamically stuffed),
+ *             CRC/ACK delimiters, ACK, EOF and intermission
+ *   CAN FD    SOF .. BRS at the nominal rate; ESI, DLC and data (dynamically
+ *             stuffed), stuff count, CRC17/CRC21 with fixed stuff bits and the
+ *             CRC delimiter at the data rate when BRS is set; ACK .. IFS nominal
+ * Stuff bits are either the worst case for the field lengths, or the actual
+ * ones, counted with a byte-wise transition table (and a byte-wise CRC15
+ * table for classic frames, whose CRC is inside the stuffed region).
+ *
+ * Busy time is summed into 10 ms buckets; utilisation is reported over the
+ * last complete 10 ms, 100 ms and 1 s.
+ */
+
+#define CAN_BUSLOAD_BUCKET_US     10000U
+#define CAN_BUSLOAD_BUCKETS       100U      // 1 s of history
+
+/* Frame flags, same bits as the trace recorder */
+#define CAN_BUSLOAD_XTD           (1U << 6)
+#define CAN_BUSLOAD_FDF           (1U << 5)
+#define CAN_BUSLOAD_BRS           (1U << 4)
+#define CAN_BUSLOAD_ESI           (1U << 3)
+
+typedef enum {
+  CAN_BUSLOAD_STUFF_WORST = 0,    // upper bound, no look at the payload
+  CAN_BUSLOAD_STUFF_ACTUAL = 1,   // exact for the payload (and CRC) on the wire
+} can_busload_stuffing_t;
+
+typedef struct {
+  uint32_t nominal_bps;
+  uint32_t data_bps;              // used for frames with BRS, ignored otherwise
+  can_busload_stuffing_t stuffing;
+} can_busload_config_t;
+
+typedef struct {
+  uint16_t nominal;               // bits at the nominal rate
+  uint16_t data;                  // bits at the data rate
+  uint16_t stuff;                 // stuff bits included in the two above (dynamic and fixed)
+} can_busload_bits_t;
+
+typedef struct {
+  uint16_t load_10ms_permille;
+  uint16_t load_100ms_permille;
+  uint16_t load_1s_permille;
+  uint16_t peak_10ms_permille;    // highest 10 ms bucket since init
+  uint32_t frames;
+  uint64_t busy_ns;               // wire time of all frames since init
+} can_busload_stats_t;
+
+typedef struct {
+  can_busload_config_t cfg;
+  uint32_t nominal_ns_q8;         // ns per bit, 24.8 fixed point
+  uint32_t data_ns_q8;
+  uint64_t bucket_start_us;
+  uint32_t bucket_ns;             // busy time of the bucket in progress
+  uint32_t bucket[CAN_BUSLOAD_BUCKETS];
+  uint32_t head;                  // most recent complete bucket
+  uint32_t sum_100ms;             // last 10 complete buckets
+  uint32_t sum_1s;                // last 100 complete buckets
+  uint16_t peak_permille;
+  uint32_t frames;
+  uint64_t busy_ns;
+  bool started;
+} can_busload_t;
+
+/**
+ * @brief Configure the bitrates and stuffing model, clear the history.
+ * @return 0 if success, 1 if a needed bitrate is 0.
+ */
+int can_busload_init(can_busload_t *bl, const can_busload_config_t *cfg);
+
+/**
+ * @brief Wire length of a frame split by bitrate phase.
+ * @param dlc Data length code (classic frames carry at most 8 bytes).
+ * @param data Payload, only read with CAN_BUSLOAD_STUFF_ACTUAL.
+ */
+void can_busload_frame_bits(const can_busload_t *bl, uint32_t id, uint8_t flags, uint8_t dlc, const uint8_t *data,
+                            can_busload_bits_t *bits);
+
+/**
+ * @brief Wire time of a frame in ns at the configured bitrates.
+ */
+uint32_t can_busload_wire_ns(const can_busload_t *bl, uint32_t id, uint8_t flags, uint8_t dlc, const uint8_t *data);
+
+/**
+ * @brief Account one frame seen on the bus at now_us. Cheap enough for the RX interrupt;
+ * one context at a time (the FDCAN binding masks interrupts for TX frames).
+ */
+void can_busload_record(can_busload_t *bl, uint32_t id, uint8_t flags, uint8_t dlc, const uint8_t *data,
+                        uint64_t now_us);
+
+/**
+ * @brief Utilisation of the windows ending at now_us.
+ */
+void can_busload_get(can_busload_t *bl, uint64_t now_us, can_busload_stats_t *stats);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef CAN_BUSLOAD_FDCAN_H
+#define CAN_BUSLOAD_FDCAN_H
+
+#include "fdcan.h"
+#include "can/can_busload.h"
+
+/**
+ * @brief Monitor the load of a controller's bus.
+ * Bitrates are derived from the controller's bit timing and the FDCAN kernel
+ * clock, so call it after fdcan_init(). Received frames are accounted from
+ * the RxCallback, the node's own frames from the TxCallback when queued;
+ * both chain to callbacks already installed. Only frames accepted by the
+ * filters are seen, accept everything for a full picture.
+ * @return 0 if success, 1 if the handle is not FDCAN1/FDCAN2.
+ */
+int can_busload_attach(can_busload_t *bl, FDCAN_Handle_t *fdcan, can_busload_stuffing_t stuffing);
+
+/**
+ * @brief can_busload_get() at timebase_us(), safe against the callbacks.
+ */
+void can_busload_fdcan_get(can_busload_t *bl, can_busload_stats_t *stats);
+
+#endif
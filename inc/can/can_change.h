@@ -0,0 +1,101 @@
+#ifndef CAN_CHANGE_H
+#define CAN_CHANGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Payload change detection for the RX dispatch path.
+ *
+ * Every registered ID keeps the previous payload and a relevance mask.
+ * A new frame is XORed word by word against the previous one under the
+ * mask; the handler only runs when a relevant bit (or the length) changed,
+ * so periodic frames repeating the same values cost a compare instead of
+ * a full decode. Bits of rolling counters, CRCs and other always-moving
+ * fields are cleared from the mask with can_change_ignore().
+ *
+ * Handlers also get a bitmap of the bytes that changed (bit n = byte n),
+ * built with USUB8/SEL on cores with the DSP extension and with a portable
+ * bit trick elsewhere, so decoders can skip untouched signals.
+ */
+
+#ifndef CAN_CHANGE_MAX_IDS
+#define CAN_CHANGE_MAX_IDS      64U
+#endif
+
+#define CAN_CHANGE_HASH_SIZE    (2U * CAN_CHANGE_MAX_IDS)   // power of two
+#define CAN_CHANGE_EXT          (1UL << 31)                 // OR into an ID for extended identifiers
+#define CAN_CHANGE_WORDS        16U                         // 64 byte payload
+
+typedef void (*can_change_handler_t)(void *ctx, uint32_t key, const uint8_t *data, uint8_t len,
+                                     uint64_t changed);
+
+typedef struct {
+  uint32_t key;                      // id | CAN_CHANGE_EXT
+  uint8_t  len;                      // length of the previous payload
+  bool     valid;                    // a payload was seen
+  uint32_t mask[CAN_CHANGE_WORDS];   // relevant bits, all set by default
+  uint32_t last[CAN_CHANGE_WORDS];   // previous payload
+  can_change_handler_t handler;
+  void *ctx;
+  uint32_t frames;
+  uint32_t skipped;
+} can_change_entry_t;
+
+typedef struct {
+  can_change_entry_t entry[CAN_CHANGE_MAX_IDS];
+  uint32_t count;
+  uint32_t hash_key[CAN_CHANGE_HASH_SIZE];
+  uint8_t  hash_index[CAN_CHANGE_HASH_SIZE];   // entry + 1, 0 = empty
+  can_change_handler_t fallback;               // IDs without an entry, NULL to drop them
+  void *fallback_ctx;
+  uint32_t frames;
+  uint32_t skipped;
+} can_change_t;
+
+/**
+ * @brief Reset the stage; frames of unregistered IDs go to fallback (may be NULL).
+ */
+void can_change_init(can_change_t *chg, can_change_handler_t fallback, void *ctx);
+
+/**
+ * @brief Register an ID with the handler called on relevant changes.
+ * @return Entry index, -1 if the table is full or the ID is already registered.
+ */
+int can_change_add(can_change_t *chg, uint32_t key, can_change_handler_t handler, void *ctx);
+
+/**
+ * @brief Entry of an ID.
+ * @return Entry index, -1 if the ID is not registered.
+ */
+int can_change_index(const can_change_t *chg, uint32_t key);
+
+/**
+ * @brief Exclude a signal from change detection (counters, CRCs, ...).
+ * Bits are numbered little-endian as in DBC Intel layout: bit n is bit n % 8
+ * of byte n / 8. The field is start_bit .. start_bit + length - 1.
+ * @return 0 if success, 1 if the entry does not exist or the field exceeds 64 bytes.
+ */
+int can_change_ignore(can_change_t *chg, int index, uint32_t start_bit, uint32_t length);
+
+/**
+ * @brief Replace the relevance mask of an entry with a byte mask (missing bytes are relevant).
+ * @return 0 if success, 1 if the entry does not exist or len exceeds 64.
+ */
+int can_change_set_mask(can_change_t *chg, int index, const uint8_t *mask, uint32_t len);
+
+/**
+ * @brief Run a received frame through the stage.
+ * The first frame of an ID and any length change always dispatch.
+ * @return 1 if a handler ran, 0 if the frame was skipped or dropped.
+ */
+int can_change_process(can_change_t *chg, uint32_t key, const uint8_t *data, uint8_t len);
+
+/**
+ * @brief Compare a payload against the previous one and store it.
+ * Only the first len bytes (at most 64) are read, data needs no alignment.
+ * @return Changed-byte bitmap restricted to mask, 0 if nothing relevant changed.
+ */
+uint64_t can_change_diff(uint32_t *last, const uint32_t *mask, const uint8_t *data, uint32_t len);
+
+#endif
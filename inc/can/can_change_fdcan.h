@@ -0,0 +1,16 @@
+#ifndef CAN_CHANGE_FDCAN_H
+#define CAN_CHANGE_FDCAN_H
+
+#include "fdcan.h"
+#include "can/can_change.h"
+
+/**
+ * @brief Run every frame received on a controller through a change detection stage.
+ * Installs an RxCallback that chains to the one already installed, so hooks
+ * that must see every frame (e.g. can_trace_attach()) keep working. Handlers
+ * run in the context that calls fdcan_receive().
+ * @return 0 if success, 1 if the handle is not FDCAN1/FDCAN2.
+ */
+int can_change_attach(can_change_t *chg, FDCAN_Handle_t *fdcan);
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef CAN_HEALTH_H
+#define CAN_HEALTH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32h563.h"
+#include "fdcan.h"
+
+/*
+ * Controller health: error state, error counters and bus-off recovery.
+ *
+ * Everything is driven by the controller's own status interrupts (EW, EP,
+ * BO and, optionally, PEA/PED for every protocol error); PSR and ECR are
+ * read only when one of them fires, so a healthy bus costs nothing.
+ * TEC/REC peaks are therefore the highest values seen at an interrupt,
+ * ECR.CEL adds up every error the controller logged in between.
+ *
+ * On bus-off the controller stops on its own (CCCR.INIT). After the
+ * back-off can_health_tick() clears INIT; the controller then waits for
+ * 128 x 11 recessive bits, reports BO cleared, and the first transmission
+ * completed after that (TC) ends the recovery. Only for that wait the SMSG
+ * interrupt group (HPM, TC, TCF) is routed to line 1 with TC and every
+ * TXBTIE bit enabled; the first SMSG event hands the group back to line 0
+ * with ILS, TXBTIE and TC enable as they were, its flags still pending for
+ * a line 0 Tx complete user. An HPM or TCF event that comes first ends the
+ * wait without a recovery time. The
+ * back-off doubles for every bus-off that follows the previous recovery
+ * within stable_us, up to backoff_max_us, so a node with a broken
+ * transceiver does not keep hammering the bus.
+ *
+ * Recovery time is measured from the bus-off interrupt to that first
+ * successful transmission: back-off, recovery sequence and the wait for
+ * something to send all included.
+ */
+
+typedef enum {
+  CAN_HEALTH_ERROR_ACTIVE = 0,
+  CAN_HEALTH_ERROR_WARNING,     // a counter reached 96
+  CAN_HEALTH_ERROR_PASSIVE,     // a counter reached 128
+  CAN_HEALTH_BUS_OFF,           // TEC overflowed, waiting for the back-off
+  CAN_HEALTH_RECOVERING         // INIT cleared, recovery sequence or first TX pending
+} can_health_state_t;
+
+typedef struct {
+  uint32_t backoff_us;          // first wait after bus-off, 0 recovers at once
+  uint32_t backoff_max_us;      // cap for the doubling, 0 selects 64 x backoff_us
+  uint32_t stable_us;           // recovery older than this resets the back-off, 0 selects 1 s
+  bool     manual;              // stay off the bus until can_health_recover()
+  bool     protocol_errors;     // count LEC/DLEC codes, one interrupt per error on the bus
+} can_health_config_t;
+
+typedef struct {
+  can_health_state_t state;
+  uint8_t  tec;                 // at the last health interrupt
+  uint8_t  rec;
+  uint8_t  tec_peak;
+  uint8_t  rec_peak;
+  uint32_t warning;             // entries into error warning
+  uint32_t passive;             // entries into error passive
+  uint32_t bus_off;
+  uint32_t recoveries;          // bus-offs ended by a successful transmission
+  uint32_t lec[8];              // arbitration phase errors by PSR.LEC code: 1 stuff, 2 form,
+  uint32_t dlec[8];             // 3 ack, 4 bit1, 5 bit0, 6 CRC; dlec likewise for the data phase
+  uint32_t errors_logged;       // sum of ECR.CEL
+  uint32_t irqs;
+  uint32_t backoff_us;          // back-off applied to the last bus-off
+  uint32_t recovery_last_us;    // bus-off to first successful TX
+  uint32_t recovery_max_us;
+  uint64_t recovery_sum_us;
+} can_health_stats_t;
+
+typedef struct {
+  FDCAN_Handle_t *fdcan;
+  can_health_config_t cfg;
+  uint32_t psr;                 // EP/EW/BO at the last interrupt
+  uint32_t backoff_us;          // next back-off
+  uint64_t bus_off_us;          // entered bus-off
+  uint64_t recover_at_us;       // can_health_tick() clears INIT from here on
+  uint64_t recovered_us;        // last recovery completed
+  volatile bool pending;        // bus-off waiting for the back-off
+  bool     tx_watch;            // SMSG on line 1 until the first TX after recovery
+  bool     saved_tc;            // TC enable, TXBTIE and ILS before tx_watch
+  uint32_t saved_txbtie;
+  uint32_t saved_ils;
+  can_health_stats_t stats;
+} can_health_t;
+
+/**
+ * @brief Bind health monitoring to an initialised controller.
+ * Interrupt routing is up to the caller, see can_health_start()
+ * (can_health_fdcan.h).
+ * @return 0 if success, 1 on invalid arguments.
+ */
+int can_health_init(can_health_t *h, FDCAN_Handle_t *fdcan, const can_health_config_t *cfg);
+
+/**
+ * @brief Interrupt line 1 handler body: acknowledges the line 1 sources,
+ * samples PSR/ECR and runs the error state machine.
+ */
+void can_health_isr(can_health_t *h, uint64_t now_us);
+
+/**
+ * @brief Start the recovery once the back-off has elapsed. Cheap when
+ * nothing is pending; call it periodically (the FDCAN binding uses the
+ * 1 kHz timebase tick).
+ */
+void can_health_tick(can_health_t *h, uint64_t now_us);
+
+/**
+ * @brief Start the recovery now, back-off or not (manual mode).
+ * @return 0 if the controller was bus-off, 1 otherwise.
+ */
+int can_health_recover(can_health_t *h);
+
+/**
+ * @brief End the wait for the first transmission after a recovery, if any:
+ * SMSG routing, TXBTIE and TC enable go back to what they were. Used on
+ * bus-off and by can_health_stop().
+ */
+void can_health_release(can_health_t *h);
+
+void can_health_get_stats(const can_health_t *h, can_health_stats_t *stats);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef CAN_HEALTH_FDCAN_H
+#define CAN_HEALTH_FDCAN_H
+
+#include "fdcan.h"
+#include "can/can_health.h"
+
+/**
+ * @brief Start health monitoring on an initialised controller.
+ * The error interrupt groups (EP, ELO, EW, BO, PEA, PED, ...) are routed
+ * to interrupt line 1 (FDCANx_IT1) with fdcan_irq_route(), so line 0
+ * handlers keep their own sources. The SMSG group (HPM, TC, TCF) joins
+ * them only from the end of a recovery sequence to the first transmission,
+ * see can_health.h. Bus-off
+ * back-off runs from the timebase tick hook, which this takes over;
+ * timebase_init() must have run.
+ * @param priority NVIC priority of the controller's IT1 interrupt.
+ * @return 0 if success, 1 on invalid arguments.
+ */
+int can_health_start(can_health_t *h, FDCAN_Handle_t *fdcan, const can_health_config_t *cfg, uint8_t priority);
+
+/**
+ * @brief Stop monitoring: line 1 disabled, no more automatic recovery.
+ */
+void can_health_stop(can_health_t *h);
+
+/**
+ * @brief Consistent copy of the counters, taken with interrupts masked.
+ */
+void can_health_snapshot(const can_health_t *h, can_health_stats_t *stats);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef CAN_HIST_H
+#define CAN_HIST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Log-linear (HDR-style) histogram of 32-bit values in fixed memory.
+ *
+ * Values below CAN_HIST_SUB get a bucket each; above, every power of two
+ * is split into CAN_HIST_SUB equal buckets, so a bucket is never wider
+ * than 1/CAN_HIST_SUB of the values it holds (6.25% with the default 4
+ * sub-bucket bits) over the whole 0 .. 2^32-1 range. Recording is a CLZ,
+ * a shift and a few increments, with no division and no search.
+ *
+ * A histogram has a single writer; readers copy it with interrupts masked
+ * (see can_latency_snapshot()) or from the writer's context.
+ */
+
+#ifndef CAN_HIST_SUB_BITS
+#define CAN_HIST_SUB_BITS   4U
+#endif
+
+#define CAN_HIST_SUB        (1U << CAN_HIST_SUB_BITS)
+#define CAN_HIST_BUCKETS    ((33U - CAN_HIST_SUB_BITS) * CAN_HIST_SUB)   // 464, 1856 bytes of counts
+
+typedef struct {
+  uint32_t count[CAN_HIST_BUCKETS];
+  uint32_t n;                   // values recorded
+  uint32_t min;                 // UINT32_MAX while empty
+  uint32_t max;
+  uint64_t sum;
+} can_hist_t;
+
+void can_hist_reset(can_hist_t *h);
+
+/**
+ * @brief Bucket of a value.
+ */
+static inline uint32_t can_hist_index(uint32_t v) {
+  uint32_t shift;
+
+  if (v < CAN_HIST_SUB) return v;
+  shift = (31U - (uint32_t)__builtin_clz(v)) - CAN_HIST_SUB_BITS;
+  return (shift + 1U) * CAN_HIST_SUB + ((v >> shift) - CAN_HIST_SUB);
+}
+
+static inline void can_hist_record(can_hist_t *h, uint32_t v) {
+  h->count[can_hist_index(v)]++;
+  h->n++;
+  h->sum += v;
+  if (v < h->min) h->min = v;
+  if (v > h->max) h->max = v;
+}
+
+/**
+ * @brief Smallest and largest value of a bucket.
+ */
+uint32_t can_hist_bucket_low(uint32_t index);
+uint32_t can_hist_bucket_high(uint32_t index);
+
+/**
+ * @brief Value at or below which 'permille' of the recorded values lie:
+ * the upper bound of the bucket holding it, never above max.
+ * 0 returns min, 1000 max; 0 if the histogram is empty.
+ */
+uint32_t can_hist_percentile(const can_hist_t *h, uint32_t permille);
+
+uint32_t can_hist_mean(const can_hist_t *h);
+
+/**
+ * @brief Add the counts of 'src' to 'dst', e.g. to combine controllers or
+ * successive snapshots.
+ */
+void can_hist_merge(can_hist_t *dst, const can_hist_t *src);
+
+#endif
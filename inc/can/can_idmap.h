@@ -0,0 +1,51 @@
+#ifndef CAN_IDMAP_H
+#define CAN_IDMAP_H
+
+#include <stdint.h>
+
+/*
+ * ID lookup shared by the per-ID modules (can_mailbox, can_change).
+ *
+ * The owner keeps two arrays of 'size' slots, a power of two at least twice
+ * the number of keys: the keys, and the index stored for each plus one
+ * (0 = empty). Linear probing on a table at most half full keeps the probe
+ * sequences short enough for the RX interrupt.
+ */
+
+static inline uint32_t can_idmap_hash(uint32_t key, uint32_t size) {
+  key ^= key >> 16;
+  key *= 0x45D9F3BU;
+  key ^= key >> 16;
+  return key & (size - 1);
+}
+
+/* Slot holding 'key', or the empty slot ending its probe sequence */
+static inline uint32_t can_idmap_slot(const uint32_t *keys, const uint8_t *index, uint32_t size, uint32_t key) {
+  uint32_t h;
+
+  for (h = can_idmap_hash(key, size); index[h] != 0 && keys[h] != key; h = (h + 1) & (size - 1));
+  return h;
+}
+
+/**
+ * @brief Index stored for 'key'.
+ * @return 0.., -1 if the key is not in the table.
+ */
+static inline int can_idmap_find(const uint32_t *keys, const uint8_t *index, uint32_t size, uint32_t key) {
+  return (int)index[can_idmap_slot(keys, index, size, key)] - 1;
+}
+
+/**
+ * @brief Store 'value' (0..254) for 'key'. The caller bounds the number of keys.
+ * @return 0 if added, 1 if the key is already in the table.
+ */
+static inline int can_idmap_add(uint32_t *keys, uint8_t *index, uint32_t size, uint32_t key, uint32_t value) {
+  uint32_t h = can_idmap_slot(keys, index, size, key);
+
+  if (index[h] != 0) return 1;
+  keys[h] = key;
+  index[h] = (uint8_t)(value + 1);
+  return 0;
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef CAN_LATENCY_H
+#define CAN_LATENCY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "can/can_hist.h"
+#include "fdcan.h"
+
+/*
+ * End-to-end frame latency, in nanoseconds, into two can_hist_t:
+ *   tx  fdcan_send() to the start of the frame on the bus: the timestamp
+ *       counter (TSCV) sampled when the frame is queued against the Tx
+ *       Event FIFO timestamp, matched through the message marker
+ *   rx  start of the frame on the bus to the RxCallback: the Rx FIFO
+ *       timestamp against TSCV when the callback runs, so it includes the
+ *       frame's own duration, Rx FIFO wait and interrupt latency
+ *
+ * Both ends are read from the controller's 16-bit timestamp counter, so the
+ * resolution is one counter tick (TimestampPrescaler nominal bit times, 1 us
+ * at 1 Mbit/s) and intervals must stay below one counter period (65536
+ * ticks). Tx intervals that may have wrapped are detected against a
+ * second clock and counted in tx_out_of_range; an Rx frame left in its FIFO
+ * for longer than a period shows up as a shorter latency.
+ */
+
+#define CAN_LATENCY_STAMPS    8U    // power of two above the markers in flight (Tx buffers + Tx events)
+
+typedef struct {
+  uint32_t sent;                // second clock at fdcan_send()
+  uint16_t ts;                  // timestamp counter at fdcan_send()
+  uint8_t  marker;
+  bool     used;
+} can_latency_stamp_t;
+
+typedef struct {
+  FDCAN_Handle_t *fdcan;
+  uint32_t tick_ns_q8;          // timestamp counter tick, ns Q24.8
+  uint32_t wrap;                // counter period in second clock units
+  can_latency_stamp_t stamp[CAN_LATENCY_STAMPS];
+  uint32_t tx_unmatched;        // Tx events without their stamp: other send paths, Tx Event FIFO overrun
+  uint32_t tx_out_of_range;     // sent more than a counter period before the event, not recorded
+  can_hist_t tx;
+  can_hist_t rx;
+} can_latency_t;
+
+/**
+ * @brief Empty histograms and stamps.
+ * @param tick_ns_q8 Timestamp counter tick in ns, Q24.8.
+ * @param clock_hz Frequency of the second clock passed as 'now' to
+ * can_latency_tx_sent()/can_latency_tx_event() (e.g. core cycles).
+ * @return 0 if success, 1 on invalid arguments.
+ */
+int can_latency_init(can_latency_t *lat, uint32_t tick_ns_q8, uint32_t clock_hz);
+
+/**
+ * @brief A frame written with message marker 'marker' was queued at
+ * timestamp counter 'ts'.
+ */
+void can_latency_tx_sent(can_latency_t *lat, uint8_t marker, uint16_t ts, uint32_t now);
+
+/**
+ * @brief The Tx Event FIFO reports 'marker' started at 'tx_ts'.
+ */
+void can_latency_tx_event(can_latency_t *lat, uint8_t marker, uint16_t tx_ts, uint32_t now);
+
+/**
+ * @brief A frame with Rx timestamp 'rx_ts' reached its handler at 'now_ts'.
+ */
+static inline void can_latency_rx(can_latency_t *lat, uint16_t rx_ts, uint16_t now_ts) {
+  uint32_t ticks = (uint16_t)(now_ts - rx_ts);
+
+  can_hist_record(&lat->rx, (uint32_t)(((uint64_t)ticks * lat->tick_ns_q8) >> 8));
+}
+
+/**
+ * @brief Clear histograms and counters, keep the stamps of frames in flight.
+ */
+void can_latency_reset(can_latency_t *lat);
+
+#endif
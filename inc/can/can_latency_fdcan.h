@@ -0,0 +1,32 @@
+#ifndef CAN_LATENCY_FDCAN_H
+#define CAN_LATENCY_FDCAN_H
+
+#include "fdcan.h"
+#include "can/can_latency.h"
+
+/**
+ * @brief Profile the latency of a controller's frames.
+ * Needs fdcan_init() with Init.TimestampPrescaler set (the counter is the
+ * time base) and, for the Tx side, Init.TxEvents. Installs an RxCallback
+ * and, with TxEvents, a TxCallback, both chaining to the ones already
+ * installed. Only frames sent with fdcan_send() are stamped; the
+ * TxCallback also drains the Tx Event FIFO, call can_latency_poll() to
+ * pick up the last events of a burst.
+ * @return 0 if success, 1 on invalid arguments or a stopped counter.
+ */
+int can_latency_attach(can_latency_t *lat, FDCAN_Handle_t *fdcan);
+
+/**
+ * @brief Read the Tx Event FIFO into the tx histogram. Cheap when empty;
+ * call it from the main loop or a periodic tick, often enough that the
+ * FIFO (FDCAN_TX_EVENTS elements) does not overflow.
+ */
+void can_latency_poll(can_latency_t *lat);
+
+/**
+ * @brief Copy the histograms (either may be NULL), each with interrupts
+ * masked, and clear them and the counters if 'reset' is set.
+ */
+void can_latency_snapshot(can_latency_t *lat, can_hist_t *tx, can_hist_t *rx, bool reset);
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef CAN_MAILBOX_H
+#define CAN_MAILBOX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Per-ID last-value cache.
+ *
+ * The RX path stores every frame of a configured ID into that ID's slot;
+ * consumers read the latest value whenever they like instead of draining
+ * the FIFOs themselves. Each slot holds two copies and a sequence counter
+ * (odd while a write is in progress, +2 per publish): the writer fills the
+ * copy not currently published, then publishes it. A reader copies the
+ * published entry and retries only if the writer started rewriting that
+ * copy meanwhile, which takes a second write, so readers never hold up the
+ * writer and the writer never waits. One writer per slot (one RX context per ID).
+ */
+
+#ifndef CAN_MAILBOX_MAX_IDS
+#define CAN_MAILBOX_MAX_IDS     64U
+#endif
+
+#define CAN_MAILBOX_HASH_SIZE   (2U * CAN_MAILBOX_MAX_IDS)   // power of two
+#define CAN_MAILBOX_EXT         (1UL << 31)                  // OR into an ID for extended identifiers
+#define CAN_MAILBOX_RETRIES     8U
+
+typedef struct {
+  uint64_t timestamp_us;  // reception time
+  uint32_t count;         // updates since init, tells consumers about missed frames
+  uint8_t  flags;         // CAN_MAILBOX_FLAG_*
+  uint8_t  dlc;
+  uint8_t  data[64];
+} can_mailbox_entry_t;
+
+#define CAN_MAILBOX_FLAG_FDF    (1U << 0)
+#define CAN_MAILBOX_FLAG_BRS    (1U << 1)
+#define CAN_MAILBOX_FLAG_ESI    (1U << 2)
+
+typedef struct {
+  volatile uint32_t seq;  // published copy is entry[seq / 2 & 1]
+  uint32_t key;           // id | CAN_MAILBOX_EXT
+  can_mailbox_entry_t entry[2];
+} can_mailbox_slot_t;
+
+typedef struct {
+  can_mailbox_slot_t slot[CAN_MAILBOX_MAX_IDS];
+  uint32_t count;
+  uint32_t hash_key[CAN_MAILBOX_HASH_SIZE];
+  uint8_t  hash_index[CAN_MAILBOX_HASH_SIZE];   // slot + 1, 0 = empty
+  uint32_t unknown;                             // frames of IDs without a slot
+} can_mailbox_t;
+
+/**
+ * @brief Configure the cached IDs (CAN_MAILBOX_EXT marks extended ones).
+ * Slots are assigned in array order, so can_mailbox_index() of ids[i] is i.
+ * @return 0 if success, 1 if count exceeds CAN_MAILBOX_MAX_IDS or an ID is repeated.
+ */
+int can_mailbox_init(can_mailbox_t *mb, const uint32_t *ids, uint32_t count);
+
+/**
+ * @brief Slot of an ID, resolve once and use the _index functions in hot loops.
+ * @return Slot index, -1 if the ID is not configured.
+ */
+int can_mailbox_index(const can_mailbox_t *mb, uint32_t key);
+
+/**
+ * @brief Publish a frame (writer side, typically the RX interrupt).
+ * @return 0 if stored, 1 if the ID has no slot.
+ */
+int can_mailbox_write(can_mailbox_t *mb, uint32_t key, uint8_t flags, uint8_t dlc, const uint8_t *data,
+                      uint64_t timestamp_us);
+
+/**
+ * @brief Consistent snapshot of the latest frame of a slot.
+ * @return 0 if success, 1 if nothing was received yet, 2 if the retries ran out
+ * (the writer published more than CAN_MAILBOX_RETRIES times during the copy).
+ */
+int can_mailbox_read_index(const can_mailbox_t *mb, int index, can_mailbox_entry_t *out);
+int can_mailbox_read(const can_mailbox_t *mb, uint32_t key, can_mailbox_entry_t *out);
+
+/**
+ * @brief Snapshot only if the frame is at most max_age_us old at now_us.
+ * @return 0 if fresh, 1 if never received, 2 if retries ran out, 3 if stale.
+ */
+int can_mailbox_read_fresh(const can_mailbox_t *mb, uint32_t key, uint64_t now_us, uint64_t max_age_us,
+                           can_mailbox_entry_t *out);
+
+/**
+ * @brief Update counter of a slot, cheap check for new data.
+ */
+uint32_t can_mailbox_updates(const can_mailbox_t *mb, int index);
+
+#endif
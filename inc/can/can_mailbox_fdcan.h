@@ -0,0 +1,24 @@
+#ifndef CAN_MAILBOX_FDCAN_H
+#define CAN_MAILBOX_FDCAN_H
+
+#include "fdcan.h"
+#include "can/can_mailbox.h"
+
+/**
+ * @brief Feed every frame received on a controller into a mailbox.
+ * Installs an RxCallback that chains to the one already installed, so call
+ * it after fdcan_init() and after other RX hooks (e.g. can_trace_attach()).
+ * @return 0 if success, 1 if the handle is not FDCAN1/FDCAN2.
+ */
+int can_mailbox_attach(can_mailbox_t *mb, FDCAN_Handle_t *fdcan);
+
+/**
+ * @brief Drain both RX FIFOs from the FDCAN interrupt line 0.
+ * The handler empties the FIFOs on every new-message interrupt, so the
+ * hardware never overflows however slowly the mailbox is read.
+ * @param priority NVIC priority of the controller's IT0 interrupt.
+ * @return 0 if success, 1 if the handle is not FDCAN1/FDCAN2.
+ */
+int can_mailbox_irq_enable(FDCAN_Handle_t *fdcan, uint8_t priority);
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef CAN_REPLAY_H
+#define CAN_REPLAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32h563.h"
+#include "fdcan.h"
+#include "can/can_trace_codec.h"
+
+/*
+ * Timing-accurate replay of recorded traffic.
+ *
+ * Frames come from a source in the binary trace format (can_trace_codec.h),
+ * either a RAM/flash image or a stream over a USART. Each frame is copied
+ * into the next TX slot ahead of time (fdcan_tx_prepare()); at its due time
+ * the engine busy-waits on the cycle counter with interrupts masked for the
+ * last spin_us and starts it with one TXBAR write. The timing error is the
+ * distance between that write and the scheduled time: arbitration and a busy
+ * bus add to it on the wire.
+ */
+
+#ifndef CAN_REPLAY_MAX_FILTERS
+#define CAN_REPLAY_MAX_FILTERS    8U
+#endif
+
+#ifndef CAN_REPLAY_UART_BLOCK_MAX
+#define CAN_REPLAY_UART_BLOCK_MAX 1024U
+#endif
+
+/**
+ * @brief Frame source.
+ * next() returns 0 with a frame, 1 if none is available yet, 2 at the end of the log.
+ */
+typedef struct {
+  int (*next)(void *ctx, can_trace_frame_t *frame);
+  void *ctx;
+} can_replay_source_t;
+
+typedef struct {
+  uint32_t speed_permille;  // 1000: original timing, 2000: twice as fast, 500: half speed
+  uint32_t spin_us;         // busy-wait window before a due time, 0 selects 20 us
+  uint32_t tolerance_ns;    // errors above this count as late, 0 selects 1000 ns
+  uint32_t start_delay_us;  // gap between can_replay_start() and the first frame
+  uint32_t filter_id[CAN_REPLAY_MAX_FILTERS];
+  uint32_t filter_mask[CAN_REPLAY_MAX_FILTERS];
+  uint32_t filter_count;    // 0: replay every frame
+  bool filter_block;        // false: replay only matching IDs, true: drop matching IDs
+} can_replay_config_t;
+
+typedef struct {
+  uint32_t sent;
+  uint32_t filtered;
+  uint32_t late;            // |error| > tolerance_ns
+  uint32_t underruns;       // source had nothing while a frame was wanted
+  int32_t  err_min_ns;      // timing errors are clamped to +-2 s
+  int32_t  err_max_ns;
+  int64_t  err_sum_ns;
+  uint64_t err_abs_sum_ns;
+} can_replay_stats_t;
+
+typedef enum {
+  CAN_REPLAY_IDLE = 0,
+  CAN_REPLAY_RUNNING,
+  CAN_REPLAY_DONE
+} can_replay_state_t;
+
+typedef struct {
+  FDCAN_Handle_t *fdcan;
+  can_replay_config_t cfg;
+  can_replay_source_t src;
+  can_replay_state_t state;
+  can_trace_frame_t frame;  // next frame to send
+  FDCAN_TxElement_t tx;
+  bool have_frame;
+  bool staged;              // frame copied into TX slot 'slot'
+  bool starved;
+  uint32_t slot;
+  bool started;
+  uint64_t t0_us;           // log time of the first replayed frame
+  uint64_t start_cycles;
+  uint64_t due_cycles;
+  can_replay_stats_t stats;
+} can_replay_t;
+
+/* RAM/flash source over a trace image (export stream or bare blocks) */
+typedef struct {
+  const uint8_t *data;
+  uint32_t len;
+  uint32_t pos;             // next block
+  bool in_block;
+  can_trace_decoder_t dec;
+} can_replay_ram_t;
+
+/*
+ * USART source: the host sends the export stream header, then one block
+ * each time the target sends CAN_REPLAY_UART_CREDIT, and an empty block
+ * (used == 16) to end the replay. Two block buffers are kept, so one block
+ * is received while the other is replayed.
+ */
+#define CAN_REPLAY_UART_CREDIT    'R'
+
+typedef struct {
+  USART_t *usart;
+  uint8_t buf[2][CAN_REPLAY_UART_BLOCK_MAX];
+  uint32_t fill;            // buffer being received
+  uint32_t fill_len;
+  uint32_t need;            // bytes wanted before the next parse step
+  bool header_done;
+  bool ready;               // buffer !fill holds a block to decode
+  bool in_block;
+  bool ended;
+  can_trace_decoder_t dec;
+} can_replay_uart_t;
+
+void can_replay_ram_init(can_replay_ram_t *ram, const uint8_t *data, uint32_t len, can_replay_source_t *src);
+void can_replay_uart_init(can_replay_uart_t *uart, USART_t *usart, can_replay_source_t *src);
+
+/**
+ * @brief Start replaying on an initialised controller.
+ * @return 0 if success, 1 on invalid arguments.
+ */
+int can_replay_start(can_replay_t *replay, FDCAN_Handle_t *fdcan, const can_replay_config_t *cfg,
+                     const can_replay_source_t *src);
+
+/**
+ * @brief Service the replay. Returns quickly unless a frame is due within
+ * spin_us; call it in a tight loop.
+ * @return 0 while running, 1 when done or stopped.
+ */
+int can_replay_poll(can_replay_t *replay);
+
+/**
+ * @brief Poll until the log ends.
+ */
+void can_replay_run(can_replay_t *replay);
+
+void can_replay_stop(can_replay_t *replay);
+void can_replay_get_stats(const can_replay_t *replay, can_replay_stats_t *stats);
+
+#endif
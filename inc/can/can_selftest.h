@@ -0,0 +1,130 @@
+#ifndef CAN_SELFTEST_H
+#define CAN_SELFTEST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "can/can_trace_codec.h"
+
+/*
+ * Traffic generator and driver throughput self-test.
+ *
+ * Frames are sent back to back through the normal TX path for as long as
+ * the controller accepts them. IDs, DLCs and the FD/BRS share are drawn
+ * from the configured ranges; every frame is a pure function of the seed
+ * and its sequence number, so a receiver can rebuild what it should have
+ * seen without any shared state.
+ *
+ * Payload layout (len = payload bytes of the DLC):
+ *   bytes 0..3      sequence number, little endian, truncated to len
+ *   bytes 4..len-2  pseudo-random fill
+ *   byte  len-1     CRC-8 (poly 0x2F) of bytes 0..len-2, when len >= 6
+ *
+ * With verify set (internal loopback, or a peer echoing the traffic) every
+ * received frame is checked: gaps in the sequence count as lost, a frame
+ * that differs from the one rebuilt for its sequence number as corrupt.
+ * Verification needs the full sequence number and the CRC, so DLCs below
+ * CAN_SELFTEST_VERIFY_DLC_MIN are not generated in that mode (a lost frame
+ * next to a DLC 0 frame would otherwise count as corrupt). Without verify
+ * (external mode) the generator just loads the bus with any DLC and
+ * received frames are counted.
+ *
+ * Cycles are only taken around the port's send and receive calls, so the
+ * per-frame cost is that of the driver, not of the generator. Controller
+ * access goes through can_selftest_port_t, see can_selftest_fdcan.h for
+ * the FDCAN binding.
+ */
+
+#define CAN_SELFTEST_VERIFY_DLC_MIN  6U   // sequence number and CRC-8 in every frame
+
+typedef struct {
+  uint32_t id_min;          // IDs drawn uniformly from id_min..id_max
+  uint32_t id_max;
+  bool     extended;        // 29-bit identifiers
+  uint8_t  dlc_min;         // DLCs drawn uniformly from dlc_min..dlc_max, classic frames
+  uint8_t  dlc_max;         // are capped at 8; with verify dlc_min is raised to 6
+  uint16_t fd_permille;     // share of CAN FD frames
+  uint16_t brs_permille;    // share of the FD frames sent with bit rate switching
+  uint32_t frames;          // frames to send, 0: until can_selftest_stop()
+  uint32_t drain_us;        // wait for outstanding frames after the last send, 0 selects 10000
+  bool     verify;          // check received frames against the generator
+  uint32_t seed;
+} can_selftest_config_t;
+
+typedef struct {
+  int      (*send)(void *ctx, const can_trace_frame_t *frame);  // 0 if queued, 1 if all TX buffers are busy
+  int      (*receive)(void *ctx, can_trace_frame_t *frame);     // 0 with a frame, 1 if none
+  uint32_t (*cycles)(void *ctx);                                // free-running 32-bit cycle counter
+  uint64_t (*now_us)(void *ctx);
+} can_selftest_port_t;
+
+typedef struct {
+  uint32_t sent;                // frames accepted by the controller
+  uint32_t tx_busy;             // send attempts refused, all TX buffers pending
+  uint32_t received;
+  uint32_t lost;                // sequence numbers never received (verify only)
+  uint32_t corrupt;             // header, payload or checksum mismatch (verify only)
+  uint64_t tx_bytes;            // payload bytes
+  uint64_t rx_bytes;
+  uint64_t tx_cycles;           // spent in successful send calls
+  uint64_t rx_cycles;           // spent in receive calls returning a frame
+  uint64_t elapsed_us;          // first send to last frame (or now while running)
+
+  // derived by can_selftest_get_stats()
+  uint32_t frames_per_s;        // sent
+  uint32_t bytes_per_s;         // sent payload
+  uint32_t tx_cycles_per_frame;
+  uint32_t rx_cycles_per_frame;
+  uint32_t loss_ppm;            // (lost + corrupt) per million sent, verify only
+} can_selftest_stats_t;
+
+typedef enum {
+  CAN_SELFTEST_IDLE = 0,
+  CAN_SELFTEST_RUNNING,
+  CAN_SELFTEST_DRAINING,
+  CAN_SELFTEST_DONE
+} can_selftest_state_t;
+
+typedef struct {
+  const can_selftest_port_t *port;
+  void *ctx;
+  can_selftest_config_t cfg;
+  can_selftest_state_t state;
+  uint32_t next_seq;            // next frame to send
+  uint32_t expect_seq;          // next frame expected back
+  bool have_frame;              // tx holds frame next_seq, refused last time
+  can_trace_frame_t tx;
+  can_trace_frame_t rx;
+  can_trace_frame_t ref;
+  uint64_t start_us;
+  uint64_t last_us;             // last send or receive
+  can_selftest_stats_t stats;
+} can_selftest_t;
+
+/**
+ * @brief Bind a self-test to a port and check its configuration.
+ * @return 0 if success, 1 on an empty or invalid ID/DLC range (with verify: dlc_max below 6).
+ */
+int can_selftest_init(can_selftest_t *st, const can_selftest_config_t *cfg, const can_selftest_port_t *port,
+                      void *ctx);
+
+/**
+ * @brief Drain received frames, then send until the controller is full.
+ * Call it in a tight loop (or from the TX complete / RX interrupt).
+ * @return 0 while running, 1 when done or stopped.
+ */
+int can_selftest_poll(can_selftest_t *st);
+
+/**
+ * @brief Stop sending; outstanding frames are still drained and verified.
+ */
+void can_selftest_stop(can_selftest_t *st);
+
+/**
+ * @brief Build frame 'seq' of the configured traffic, as sent and as expected back.
+ */
+void can_selftest_frame(const can_selftest_config_t *cfg, uint32_t seq, can_trace_frame_t *frame);
+
+void can_selftest_get_stats(const can_selftest_t *st, can_selftest_stats_t *stats);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef CAN_SELFTEST_FDCAN_H
+#define CAN_SELFTEST_FDCAN_H
+
+#include "fdcan.h"
+#include "can/can_selftest.h"
+
+/**
+ * @brief Run a self-test on a controller, after fdcan_init().
+ * Frames go out through fdcan_send() and come back through fdcan_receive()
+ * on Rx FIFO 0, so TX/RX callbacks see the generated traffic as well.
+ * Use cfg->verify with Init.Loopback (internal loopback, nothing reaches
+ * the pins) and without it to load a real bus. Cycles are DWT cycles from
+ * timebase_cycles32(), so timebase_init() must have run.
+ * @return 0 if success, 1 on an invalid configuration.
+ */
+int can_selftest_fdcan_init(can_selftest_t *st, FDCAN_Handle_t *fdcan, const can_selftest_config_t *cfg);
+
+/**
+ * @brief Poll until done, then fill in the statistics.
+ */
+void can_selftest_fdcan_run(can_selftest_t *st, can_selftest_stats_t *stats);
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef CAN_SNIFFER_H
+#define CAN_SNIFFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32h563.h"
+#include "fdcan.h"
+#include "can/can_trace_codec.h"
+
+/*
+ * Passive high-rate capture.
+ *
+ * The controller runs in bus monitoring mode (CCCR.MON): it receives
+ * everything and never drives the bus, not even the ACK bit. Filters split
+ * the traffic by ID parity, even IDs into Rx FIFO 0 and odd IDs into Rx
+ * FIFO 1, so both 3-element FIFOs fill in parallel. Frames of the same ID
+ * always share a FIFO and keep their order; across FIFOs the interrupt
+ * merges by RX timestamp.
+ *
+ * The split doubles the buffering only for traffic that alternates parity.
+ * A burst of one ID, or of IDs of the same parity, lands in one FIFO and has
+ * three elements, as without the split. The interrupt must run before the
+ * fourth frame into a FIFO completes, counted from the first frame it holds:
+ *   same FIFO          3 frame times: 141 us at 1 Mbit/s with DLC 0,
+ *                      333 us with 8 byte classic frames
+ *   alternating parity 6 frame times: 282 us / 666 us
+ * FD frames with BRS take longer on the wire (~170 us for 64 bytes at
+ * 1M/5M) and leave proportionally more time.
+ *
+ * The interrupt does nothing but copy raw message RAM elements into a ring
+ * of words, with a cycle stamp:
+ *   word 0, 1  element words 0 and 1 (fdcan_rxfifo_peek())
+ *   word 2     timebase_cycles32() when the element was drained
+ *   word 3..   payload words
+ * A record never wraps: when it does not fit before the end of the buffer,
+ * CAN_SNIFFER_PAD marks the rest unused. Decoding is left to
+ * can_sniffer_read() in thread context.
+ *
+ * Losses are counted where they happen: RF0L/RF1L (message lost interrupts)
+ * for frames the controller could not store, ring_full for frames read
+ * while the ring had no room. A lost interrupt means at least one frame.
+ */
+
+#define CAN_SNIFFER_PAD           0xFFFFFFFFU   // not a valid element word 0 (ESI with RTR)
+#define CAN_SNIFFER_RECORD_MAX    (1U + 2U + 16U)   // words
+
+typedef struct {
+  uint32_t frames;            // records stored
+  uint32_t fifo_lost[2];      // message lost interrupts of Rx FIFO 0/1
+  uint32_t ring_full;         // frames discarded, no room in the ring
+  uint32_t fifo_peak[2];      // highest fill level seen by the interrupt
+  uint32_t ring_peak;         // most words in use
+} can_sniffer_stats_t;
+
+typedef struct {
+  FDCAN_Handle_t *fdcan;
+  uint32_t *buf;
+  uint32_t size;              // words
+  uint32_t head;              // written by the interrupt only
+  uint32_t tail;              // written by the reader only
+  uint32_t cycles_per_us;
+  uint64_t last_cycles;       // reader: 64-bit extension of the stamps
+  bool have_cycles;
+  can_sniffer_stats_t stats;
+} can_sniffer_t;
+
+/**
+ * @brief Bind a capture ring to a controller already in bus monitoring mode.
+ * Most users want can_sniffer_start() (can_sniffer_fdcan.h) instead.
+ * @param words Ring size, at least 2 * CAN_SNIFFER_RECORD_MAX.
+ * @param cycles_per_us Stamp rate for can_sniffer_read() timestamps.
+ * @return 0 if success, 1 on invalid arguments.
+ */
+int can_sniffer_init(can_sniffer_t *sn, FDCAN_Handle_t *fdcan, uint32_t *buf, uint32_t words,
+                     uint32_t cycles_per_us);
+
+/**
+ * @brief Drain both Rx FIFOs into the ring, oldest frame first.
+ * The interrupt handler body: acknowledges IR, counts lost messages and
+ * reads each FIFO status once per call.
+ * @return Frames drained.
+ */
+uint32_t can_sniffer_isr(can_sniffer_t *sn);
+
+/**
+ * @brief Take the oldest captured frame. Its timestamp is the drain stamp
+ * in microseconds, extended to 64 bit from consecutive records (gaps over
+ * 2^32 cycles between two frames fold).
+ * @return 0 with a frame, 1 if the ring is empty.
+ */
+int can_sniffer_read(can_sniffer_t *sn, can_trace_frame_t *frame);
+
+/**
+ * @brief Words currently in use in the ring.
+ */
+uint32_t can_sniffer_pending(const can_sniffer_t *sn);
+
+void can_sniffer_get_stats(const can_sniffer_t *sn, can_sniffer_stats_t *stats);
+
+#endif
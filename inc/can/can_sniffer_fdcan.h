@@ -0,0 +1,31 @@
+#ifndef CAN_SNIFFER_FDCAN_H
+#define CAN_SNIFFER_FDCAN_H
+
+#include "fdcan.h"
+#include "can/can_sniffer.h"
+
+/**
+ * @brief Start a passive capture on a controller.
+ * fdcan->Init must hold the bus bit timing (and FDMode for an FD bus); the
+ * controller is (re)initialised in bus monitoring mode with the timestamp
+ * counter running, the ID parity filters and interrupt line 0 feeding
+ * can_sniffer_isr(). RxCallback is not used, read frames with
+ * can_sniffer_read(). timebase_init() must have run.
+ * @param words Ring size in words, 19 per 64-byte frame at most.
+ * @param priority NVIC priority of the controller's IT0 interrupt.
+ * @return 0 if success, 1 on invalid arguments.
+ */
+int can_sniffer_start(can_sniffer_t *sn, FDCAN_Handle_t *fdcan, uint32_t *buf, uint32_t words, uint8_t priority);
+
+/**
+ * @brief Stop capturing and take the controller off the bus (INIT).
+ * Frames still in the ring can be read afterwards.
+ */
+void can_sniffer_stop(can_sniffer_t *sn);
+
+/**
+ * @brief Consistent copy of the counters, taken with interrupts masked.
+ */
+void can_sniffer_snapshot(const can_sniffer_t *sn, can_sniffer_stats_t *stats);
+
+#endif
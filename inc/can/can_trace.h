@@ -0,0 +1,89 @@
+#ifndef CAN_TRACE_H
+#define CAN_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32h563.h"
+#include "fdcan.h"
+#include "can/can_trace_codec.h"
+
+/*
+ * RAM trace recorder.
+ *
+ * Frames are encoded into a ring of CAN_TRACE_BLOCK_COUNT blocks (see
+ * can_trace_codec.h). While armed the ring keeps the most recent history
+ * (pre-trigger); once triggered, post_blocks more blocks are
+ * filled and the capture stops, freezing the ring for export.
+ */
+
+#ifndef CAN_TRACE_BLOCK_SIZE
+#define CAN_TRACE_BLOCK_SIZE    1024U
+#endif
+
+#ifndef CAN_TRACE_BLOCK_COUNT
+#define CAN_TRACE_BLOCK_COUNT   256U       // 256 KB of SRAM
+#endif
+
+#define CAN_TRACE_STREAM_MAGIC  0x43525443UL  // "CTRC"
+#define CAN_TRACE_STREAM_VER    1U
+
+typedef enum {
+  CAN_TRACE_IDLE = 0,
+  CAN_TRACE_ARMED,          // recording, waiting for the trigger
+  CAN_TRACE_TRIGGERED,      // recording the post-trigger blocks
+  CAN_TRACE_STOPPED         // ring frozen, ready for export
+} can_trace_state_t;
+
+typedef struct {
+  uint32_t trigger_id;      // compared as (id & trigger_mask) == (trigger_id & trigger_mask)
+  uint32_t trigger_mask;    // 0: trigger only through can_trace_trigger()
+  bool     trigger_ext;     // trigger_id is an extended identifier
+  uint32_t post_blocks;     // blocks recorded from the trigger on (0: until can_trace_stop())
+} can_trace_config_t;
+
+typedef struct {
+  uint32_t frames;          // frames recorded
+  uint32_t overwritten;     // blocks dropped from the pre-trigger history
+  uint32_t bytes;           // encoded bytes
+  uint32_t trigger_seq;     // block holding the trigger frame
+  uint64_t trigger_us;
+} can_trace_stats_t;
+
+/**
+ * @brief Reset the recorder and apply a configuration. State becomes IDLE.
+ * @return 0 if success, 1 if cfg is invalid.
+ */
+int can_trace_init(const can_trace_config_t *cfg);
+
+/**
+ * @brief Install the recorder as RX/TX callback of an FDCAN handle.
+ * Call after fdcan_init(), which clears the callbacks; callbacks already
+ * installed are chained after the recorder.
+ * @return 0 if success, 1 if the handle is not FDCAN1/FDCAN2.
+ */
+int can_trace_attach(FDCAN_Handle_t *fdcan);
+
+/**
+ * @brief Capture control. arm() restarts an empty capture.
+ */
+void can_trace_arm(void);
+void can_trace_trigger(void);
+void can_trace_stop(void);
+can_trace_state_t can_trace_state(void);
+void can_trace_get_stats(can_trace_stats_t *stats);
+
+/**
+ * @brief Record one frame. Safe from interrupt context.
+ */
+void can_trace_record(const can_trace_frame_t *frame);
+
+/**
+ * @brief Stream the frozen ring over a USART, oldest block first.
+ * Stream: magic u32, version u8, reserved u8, block size u16, block count u32,
+ * trigger seq u32, trigger_us u64, then each block truncated to its used size.
+ * @return 0 if success, 1 if a capture is running.
+ */
+int can_trace_export(USART_t *usart);
+
+#endif
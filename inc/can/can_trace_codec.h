@@ -0,0 +1,119 @@
+#ifndef CAN_TRACE_CODEC_H
+#define CAN_TRACE_CODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Binary CAN trace format.
+ *
+ * A trace is a sequence of fixed-size blocks. Each block starts with a
+ * header carrying an absolute timestamp and is decodable on its own, so a
+ * ring of blocks can drop its oldest block without breaking the rest.
+ *
+ * Block header (16 bytes, little endian):
+ *   magic u16 ('CT'), used u16 (bytes incl. header), seq u32, base_us u64
+ *
+ * Record:
+ *   flags u8    CAN_TRACE_FLAG_*
+ *   dlc   u8    data length code (low nibble)
+ *   dt    varint microseconds since the previous record (or base_us)
+ *   id    u16 (standard) or u32 (extended)
+ *   data  full payload, or with CAN_TRACE_FLAG_DELTA a byte change mask
+ *         ((len + 7) / 8 bytes, LSB = byte 0) followed by the changed bytes
+ *         only, relative to the previous frame with the same ID in the block.
+ */
+
+#define CAN_TRACE_MAGIC         0x5443U   // "CT"
+#define CAN_TRACE_HEADER_SIZE   16U
+#define CAN_TRACE_RECORD_MAX    (2U + 5U + 4U + 64U)
+#define CAN_TRACE_DT_MAX        0x7FFFFFFFFULL  // 5-byte varint, ~9.5 h
+
+#define CAN_TRACE_FLAG_TX       (1U << 7)  // frame sent by this node
+#define CAN_TRACE_FLAG_XTD      (1U << 6)  // extended identifier
+#define CAN_TRACE_FLAG_FDF      (1U << 5)  // CAN FD frame
+#define CAN_TRACE_FLAG_BRS      (1U << 4)  // bit rate switch
+#define CAN_TRACE_FLAG_ESI      (1U << 3)  // error state indicator
+#define CAN_TRACE_FLAG_DELTA    (1U << 2)  // payload delta-encoded (internal)
+#define CAN_TRACE_FLAG_CH_MASK  0x03U      // controller index (0 = FDCAN1)
+
+#ifndef CAN_TRACE_CACHE_SIZE
+#define CAN_TRACE_CACHE_SIZE    32U        // per-ID payload history, power of two
+#endif
+
+typedef struct {
+  uint64_t timestamp_us;
+  uint32_t id;
+  uint8_t  flags;       // CAN_TRACE_FLAG_* (DELTA is never set here)
+  uint8_t  dlc;
+  uint8_t  data[64];
+} can_trace_frame_t;
+
+/* Last payload per ID, shared by encoder and decoder */
+typedef struct {
+  uint32_t tag;         // id | XTD << 31, 0xFFFFFFFF when empty
+  uint8_t  len;
+  uint8_t  data[64];
+} can_trace_cache_t;
+
+typedef struct {
+  uint8_t *block;
+  uint32_t size;
+  uint32_t used;
+  uint64_t last_us;
+  can_trace_cache_t cache[CAN_TRACE_CACHE_SIZE];
+} can_trace_encoder_t;
+
+typedef struct {
+  const uint8_t *block;
+  uint32_t pos;
+  uint32_t used;
+  uint64_t last_us;
+  can_trace_cache_t cache[CAN_TRACE_CACHE_SIZE];
+} can_trace_decoder_t;
+
+typedef void (*can_trace_frame_cb_t)(const can_trace_frame_t *frame, void *arg);
+
+/**
+ * @brief Start a new block (header written, history cleared).
+ * @param block Block memory, at least CAN_TRACE_HEADER_SIZE + CAN_TRACE_RECORD_MAX bytes.
+ * @param size Block size in bytes (max 65535).
+ * @param seq Block sequence number.
+ * @param base_us Absolute timestamp the first record is relative to.
+ */
+void can_trace_block_begin(can_trace_encoder_t *enc, uint8_t *block, uint32_t size, uint32_t seq, uint64_t base_us);
+
+/**
+ * @brief Append one frame to the current block.
+ * The 'used' field of the header is updated after the record is complete.
+ * @return Bytes written, 0 if the record does not fit or the gap exceeds
+ *         CAN_TRACE_DT_MAX (start a new block).
+ */
+uint32_t can_trace_encode(can_trace_encoder_t *enc, const can_trace_frame_t *frame);
+
+/**
+ * @brief Start decoding a block record by record with can_trace_decode_next().
+ * @return 0 if success, 1 if the block header is invalid.
+ */
+int can_trace_decode_begin(can_trace_decoder_t *dec, const uint8_t *block, uint32_t size);
+
+/**
+ * @brief Decode the next record of the current block.
+ * @return 1 if a frame was decoded, 0 at the end of the block, -1 if a record is truncated.
+ */
+int can_trace_decode_next(can_trace_decoder_t *dec, can_trace_frame_t *frame);
+
+/**
+ * @brief Decode every record of a block.
+ * @return Number of frames, -1 if the block header is invalid or a record is truncated.
+ */
+int can_trace_decode_block(can_trace_decoder_t *dec, const uint8_t *block, uint32_t size,
+                           can_trace_frame_cb_t cb, void *arg);
+
+/**
+ * @brief Block header accessors.
+ */
+uint32_t can_trace_block_seq(const uint8_t *block);
+uint32_t can_trace_block_used(const uint8_t *block);
+
+#endif
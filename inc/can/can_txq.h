@@ -0,0 +1,103 @@
+#ifndef CAN_TXQ_H
+#define CAN_TXQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Coalescing software transmit queue.
+ *
+ * Frames wait here while the controller's TX buffers are busy. A frame
+ * whose ID already waits in the queue updates that entry in place instead
+ * of queueing a duplicate, so every ID occupies at most one entry, keeps
+ * its place in line and always goes out with the latest payload.
+ *
+ * Guarantees:
+ *  - entries reach the controller in the order their ID was first queued
+ *  - the payload handed to the controller is the last one pushed for that ID
+ *  - the queue never holds more entries than there are distinct IDs
+ *
+ * With CAN_TXQ_REPLACE_PENDING, a push whose ID is still pending in a
+ * hardware buffer cancels that buffer and submits the new payload instead
+ * (if the old frame won the race and was sent, the new one is queued as
+ * usual). In Tx FIFO mode the replacement goes behind the frames already
+ * in hardware; in Tx queue mode the ID decides as always.
+ *
+ * Controller access goes through can_txq_port_t, see can_txq_fdcan.h for
+ * the FDCAN binding. can_txq_pump() must run when hardware buffers free up
+ * (TX complete interrupt or main loop).
+ */
+
+#ifndef CAN_TXQ_DEPTH
+#define CAN_TXQ_DEPTH           32U
+#endif
+
+#define CAN_TXQ_HW_SLOTS        32U          // upper bound of hardware buffer indexes
+#define CAN_TXQ_EXT             (1UL << 31)  // OR into an ID for extended identifiers
+
+#define CAN_TXQ_FLAG_FDF        (1U << 0)
+#define CAN_TXQ_FLAG_BRS        (1U << 1)
+
+#define CAN_TXQ_REPLACE_PENDING (1U << 0)    // can_txq_init() option
+
+typedef struct {
+  uint32_t key;         // id | CAN_TXQ_EXT
+  uint8_t  flags;       // CAN_TXQ_FLAG_*
+  uint8_t  dlc;
+  uint8_t  data[64];
+} can_txq_frame_t;
+
+typedef struct {
+  int      (*submit)(void *ctx, const can_txq_frame_t *frame, uint32_t *slot); // 0 if requested, 1 if no free buffer
+  int      (*cancel)(void *ctx, uint32_t slot);   // 0 if cancelled unsent, 1 if sent or not pending
+  uint32_t (*lock)(void *ctx);                    // may be NULL if push and pump share one context
+  void     (*unlock)(void *ctx, uint32_t state);
+} can_txq_port_t;
+
+typedef struct {
+  uint32_t pushed;      // can_txq_push() calls accepted
+  uint32_t coalesced;   // pushes merged into a waiting entry
+  uint32_t replaced;    // pending hardware buffers cancelled and refilled
+  uint32_t submitted;   // frames handed to the controller
+  uint32_t full;        // pushes refused, queue full
+  uint32_t max_depth;   // high-water mark of the queue
+} can_txq_stats_t;
+
+typedef struct {
+  const can_txq_port_t *port;
+  void *ctx;
+  uint32_t options;
+  can_txq_frame_t entry[CAN_TXQ_DEPTH];
+  uint32_t head;        // next entry to submit
+  uint32_t count;
+  uint32_t hw_key[CAN_TXQ_HW_SLOTS];   // key last submitted into each hardware buffer
+  uint32_t hw_valid;                   // bit n: hw_key[n] is set
+  can_txq_stats_t stats;
+} can_txq_t;
+
+/**
+ * @brief Bind an empty queue to a port.
+ * @param options CAN_TXQ_REPLACE_PENDING or 0.
+ */
+void can_txq_init(can_txq_t *q, const can_txq_port_t *port, void *ctx, uint32_t options);
+
+/**
+ * @brief Queue a frame, or refresh the waiting frame of the same ID, then pump.
+ * @return 0 if queued, coalesced or replaced, 1 if the queue is full.
+ */
+int can_txq_push(can_txq_t *q, const can_txq_frame_t *frame);
+
+/**
+ * @brief Move waiting frames to the controller while it has free buffers.
+ * @return Number of frames submitted.
+ */
+uint32_t can_txq_pump(can_txq_t *q);
+
+/**
+ * @brief Frames waiting in the software queue.
+ */
+uint32_t can_txq_pending(const can_txq_t *q);
+
+void can_txq_get_stats(const can_txq_t *q, can_txq_stats_t *stats);
+
+#endif
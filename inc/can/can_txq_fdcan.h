@@ -0,0 +1,16 @@
+#ifndef CAN_TXQ_FDCAN_H
+#define CAN_TXQ_FDCAN_H
+
+#include "fdcan.h"
+#include "can/can_txq.h"
+
+/**
+ * @brief Bind a coalescing queue to a controller, after fdcan_init().
+ * Push and pump may run in different interrupt contexts, the queue is
+ * guarded with short PRIMASK sections. Frames submitted by the queue still
+ * reach the controller's TxCallback.
+ * @param options CAN_TXQ_REPLACE_PENDING or 0.
+ */
+void can_txq_fdcan_init(can_txq_t *q, FDCAN_Handle_t *fdcan, uint32_t options);
+
+#endif
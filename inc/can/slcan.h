@@ -0,0 +1,108 @@
+#ifndef SLCAN_H
+#define SLCAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * SLCAN (Lawicel) protocol engine with the common CAN FD extensions.
+ *
+ * Commands (CR terminated, answered with CR or BEL on error):
+ *   Sn        nominal bitrate, n = 0..8 (10k 20k 50k 100k 125k 250k 500k 800k 1M)
+ *   Yn        data bitrate, n = 1, 2, 4, 5, 8 (Mbit/s)
+ *   O / L / C open, open listen-only, close
+ *   Zn        receive timestamps off/on (ms, 0..59999)
+ *   tiiiL..   standard frame        Tiiiiiiii L..  extended frame
+ *   diiiL..   standard FD frame     Diiiiiiii L..  extended FD frame
+ *   biiiL..   standard FD with BRS  Biiiiiiii L..  extended FD with BRS
+ *   V / N / F version, serial number, status flags
+ * L is the DLC as one hex digit, followed by the payload in hex.
+ *
+ * The engine is transport agnostic: serial and CAN access go through
+ * slcan_port_t, see slcan_fdcan.h for the FDCAN/USART binding.
+ */
+
+#define SLCAN_FRAME_XTD       (1U << 0)
+#define SLCAN_FRAME_FDF       (1U << 1)
+#define SLCAN_FRAME_BRS       (1U << 2)
+
+#define SLCAN_LINE_MAX        (1U + 8U + 1U + 128U + 4U + 1U)  // T + id + dlc + data + time + CR
+
+#ifndef SLCAN_OUT_SIZE
+#define SLCAN_OUT_SIZE        2048U       // serial output batch buffer
+#endif
+
+typedef struct {
+  uint32_t id;
+  uint8_t  flags;       // SLCAN_FRAME_*
+  uint8_t  dlc;
+  uint8_t  data[64];
+} slcan_frame_t;
+
+typedef struct {
+  /* CAN side */
+  int      (*open)(void *ctx, uint32_t nominal_bps, uint32_t data_bps, bool listen_only); // 0 if success
+  void     (*close)(void *ctx);
+  int      (*send)(void *ctx, const slcan_frame_t *frame);      // 0 if queued, 1 if full
+  int      (*receive)(void *ctx, slcan_frame_t *frame);         // 0 if a frame was read, 1 if empty
+  /* Serial side, both non-blocking */
+  uint32_t (*read)(void *ctx, uint8_t *buf, uint32_t max);
+  uint32_t (*write)(void *ctx, const uint8_t *buf, uint32_t len);
+  /* Milliseconds for receive timestamps */
+  uint32_t (*time_ms)(void *ctx);
+} slcan_port_t;
+
+typedef struct {
+  uint32_t rx_frames;   // bus -> host
+  uint32_t tx_frames;   // host -> bus
+  uint32_t tx_full;     // host frames refused because the controller was full
+  uint32_t errors;      // rejected commands
+  uint32_t overflows;   // input lines longer than SLCAN_LINE_MAX
+} slcan_stats_t;
+
+typedef struct {
+  const slcan_port_t *port;
+  void *ctx;
+  bool is_open;
+  bool timestamps;
+  uint32_t nominal_bps;
+  uint32_t data_bps;
+  char line[SLCAN_LINE_MAX];
+  uint32_t line_len;
+  uint8_t out[SLCAN_OUT_SIZE];
+  uint32_t out_head;    // end of pending output
+  uint32_t out_tail;    // first byte not yet written
+  slcan_stats_t stats;
+} slcan_t;
+
+/**
+ * @brief Bind the engine to a port. The channel starts closed at 500 kbit/s, 2 Mbit/s data.
+ */
+void slcan_init(slcan_t *slcan, const slcan_port_t *port, void *ctx);
+
+/**
+ * @brief One service pass: read serial input and run complete commands,
+ * forward received frames while output space is left, flush output.
+ * Never blocks; call from the main loop.
+ */
+void slcan_poll(slcan_t *slcan);
+
+/**
+ * @brief Feed serial bytes to the command parser (slcan_poll() does this from port->read).
+ */
+void slcan_input(slcan_t *slcan, const uint8_t *buf, uint32_t len);
+
+/**
+ * @brief Encode a frame as an SLCAN line (CR included, no NUL).
+ * @param timestamp_ms Appended as 4 hex digits if >= 0.
+ * @return Line length.
+ */
+uint32_t slcan_format_frame(const slcan_frame_t *frame, int32_t timestamp_ms, char *out);
+
+/**
+ * @brief Decode a frame command (t/T/d/D/b/B), without the trailing CR.
+ * @return 0 if success, 1 if malformed.
+ */
+int slcan_parse_frame(const char *line, uint32_t len, slcan_frame_t *frame);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef SLCAN_FDCAN_H
+#define SLCAN_FDCAN_H
+
+#include "stm32h563.h"
+#include "fdcan.h"
+#include "can/slcan.h"
+
+/**
+ * @brief Bind an SLCAN engine to an FDCAN controller and a USART.
+ * The controller is (re)initialised by the open command with bit timings
+ * computed from the FDCAN kernel clock, all frames go to RX FIFO0.
+ * The USART must already be set up; its hardware FIFOs are enabled here.
+ * @return 0 if success, 1 on invalid arguments.
+ */
+int slcan_fdcan_init(slcan_t *slcan, FDCAN_Handle_t *fdcan, USART_t *usart);
+
+#endif
@@ -6,6 +6,147 @@
 
 #include "stm32h563.h"
 
+/** @defgroup FDCAN_id_type FDCAN ID Type (element XTD bit) */
+#define FDCAN_STANDARD_ID ((uint32_t)0x00000000U) /* Standard ID element */
+#define FDCAN_EXTENDED_ID ((uint32_t)0x40000000U) /* Extended ID element */
+
+/** @defgroup FDCAN_bit_rate_switching FDCAN Bit Rate Switching (element BRS bit) */
+#define FDCAN_BRS_OFF ((uint32_t)0x00000000U) /* FDCAN frames transmitted/received without bit rate switching */
+#define FDCAN_BRS_ON  ((uint32_t)0x00100000U) /* FDCAN frames transmitted/received with bit rate switching    */
+
+/** @defgroup FDCAN_format FDCAN format (element FDF bit) */
+#define FDCAN_CLASSIC_CAN ((uint32_t)0x00000000U) /* Frame transmitted/received in Classic CAN format */
+#define FDCAN_FD_CAN      ((uint32_t)0x00200000U) /* Frame transmitted/received in FDCAN format       */
+
+/** @defgroup FDCAN_filter_type FDCAN Filter Type (SFT/EFT) */
+#define FDCAN_FILTER_RANGE ((uint32_t)0x00000000U) /* Range filter from FilterID1 to FilterID2                        */
+#define FDCAN_FILTER_DUAL  ((uint32_t)0x00000001U) /* Dual ID filter for FilterID1 or FilterID2                       */
+#define FDCAN_FILTER_MASK  ((uint32_t)0x00000002U) /* Classic filter: FilterID1 = filter, FilterID2 = mask            */
+
+/** @defgroup FDCAN_filter_config FDCAN Filter Configuration (SFEC/EFEC) */
+#define FDCAN_FILTER_DISABLE       ((uint32_t)0x00000000U) /* Disable filter element                          */
+#define FDCAN_FILTER_TO_RXFIFO0    ((uint32_t)0x00000001U) /* Store in Rx FIFO 0 if filter matches            */
+#define FDCAN_FILTER_TO_RXFIFO1    ((uint32_t)0x00000002U) /* Store in Rx FIFO 1 if filter matches            */
+#define FDCAN_FILTER_REJECT        ((uint32_t)0x00000003U) /* Reject ID if filter matches                     */
+
+/**
+  * @brief  Bit timing computed by fdcan_calc_bittiming()
+  */
+typedef struct
+{
+  uint32_t Prescaler;
+  uint32_t SyncJumpWidth;
+  uint32_t TimeSeg1;
+  uint32_t TimeSeg2;
+} FDCAN_BitTiming_t;
+
+/** @defgroup FDCAN_interrupts FDCAN interrupt sources (IR/IE bits) */
+#define FDCAN_IT_RX_FIFO0_NEW_MESSAGE  ((uint32_t)0x00000001U) /* New message written to Rx FIFO 0 */
+#define FDCAN_IT_RX_FIFO0_FULL         ((uint32_t)0x00000002U) /* Rx FIFO 0 full                  */
+#define FDCAN_IT_RX_FIFO0_MESSAGE_LOST ((uint32_t)0x00000004U) /* Rx FIFO 0 message lost          */
+#define FDCAN_IT_RX_FIFO1_NEW_MESSAGE  ((uint32_t)0x00000008U) /* New message written to Rx FIFO 1 */
+#define FDCAN_IT_RX_FIFO1_FULL         ((uint32_t)0x00000010U) /* Rx FIFO 1 full                  */
+#define FDCAN_IT_RX_FIFO1_MESSAGE_LOST ((uint32_t)0x00000020U) /* Rx FIFO 1 message lost          */
+#define FDCAN_IT_TX_COMPLETE           ((uint32_t)0x00000080U) /* Transmission completed          */
+#define FDCAN_IT_TX_ABORT_COMPLETE     ((uint32_t)0x00000100U) /* Transmission cancellation done  */
+#define FDCAN_IT_TX_FIFO_EMPTY         ((uint32_t)0x00000200U) /* Tx FIFO empty                   */
+#define FDCAN_IT_ERROR_PASSIVE         ((uint32_t)0x00020000U) /* Error passive status changed    */
+#define FDCAN_IT_ERROR_WARNING         ((uint32_t)0x00040000U) /* Error warning status changed    */
+#define FDCAN_IT_BUS_OFF               ((uint32_t)0x00080000U) /* Bus off status changed          */
+#define FDCAN_IT_ARB_PROTOCOL_ERROR    ((uint32_t)0x00200000U) /* Arbitration phase protocol error */
+#define FDCAN_IT_DATA_PROTOCOL_ERROR   ((uint32_t)0x00400000U) /* Data phase protocol error       */
+
+/** @defgroup FDCAN_interrupt_groups FDCAN interrupt line groups (ILS bits) */
+#define FDCAN_IT_GROUP_RX_FIFO0        ((uint32_t)0x00000001U) /* RF0L, RF0F, RF0N                */
+#define FDCAN_IT_GROUP_RX_FIFO1        ((uint32_t)0x00000002U) /* RF1L, RF1F, RF1N                */
+#define FDCAN_IT_GROUP_SMSG            ((uint32_t)0x00000004U) /* TCF, TC, HPM                    */
+#define FDCAN_IT_GROUP_TX_FIFO_ERROR   ((uint32_t)0x00000008U) /* TEFL, TEFF, TEFN, TFE           */
+#define FDCAN_IT_GROUP_MISC            ((uint32_t)0x00000010U) /* TOO, MRAF, TSW                  */
+#define FDCAN_IT_GROUP_BIT_LINE_ERROR  ((uint32_t)0x00000020U) /* EP, ELO                         */
+#define FDCAN_IT_GROUP_PROTOCOL_ERROR  ((uint32_t)0x00000040U) /* ARA, PED, PEA, WDI, BO, EW      */
+
+#define FDCAN_TX_BUFFERS               (3U)                    /* Tx FIFO/Queue elements per instance */
+#define FDCAN_TX_EVENTS                (3U)                    /* Tx Event FIFO elements per instance */
+
+/* Message RAM layout, fixed on the H5: FDCAN2's block follows FDCAN1's at FDCAN_SRAM_BASE */
+#define SRAMCAN_FLS_NBR                  (28U)         /* Max. Filter List Standard Number      */
+#define SRAMCAN_FLE_NBR                  ( 8U)         /* Max. Filter List Extended Number      */
+#define SRAMCAN_RF0_NBR                  ( 3U)         /* RX FIFO 0 Elements Number             */
+#define SRAMCAN_RF1_NBR                  ( 3U)         /* RX FIFO 1 Elements Number             */
+#define SRAMCAN_TEF_NBR                  ( 3U)         /* TX Event FIFO Elements Number         */
+#define SRAMCAN_TFQ_NBR                  ( 3U)         /* TX FIFO/Queue Elements Number         */
+
+#define SRAMCAN_FLS_SIZE            ( 1U * 4U)         /* Filter Standard Element Size in bytes */
+#define SRAMCAN_FLE_SIZE            ( 2U * 4U)         /* Filter Extended Element Size in bytes */
+#define SRAMCAN_RF0_SIZE            (18U * 4U)         /* RX FIFO 0 Elements Size in bytes      */
+#define SRAMCAN_RF1_SIZE            (18U * 4U)         /* RX FIFO 1 Elements Size in bytes      */
+#define SRAMCAN_TEF_SIZE            ( 2U * 4U)         /* TX Event FIFO Elements Size in bytes  */
+#define SRAMCAN_TFQ_SIZE            (18U * 4U)         /* TX FIFO/Queue Elements Size in bytes  */
+
+#define SRAMCAN_FLSSA ((uint32_t)0)                                                      /* Filter List Standard Start
+                                                                                            Address                  */
+#define SRAMCAN_FLESA ((uint32_t)(SRAMCAN_FLSSA + (SRAMCAN_FLS_NBR * SRAMCAN_FLS_SIZE))) /* Filter List Extended Start
+                                                                                            Address                  */
+#define SRAMCAN_RF0SA ((uint32_t)(SRAMCAN_FLESA + (SRAMCAN_FLE_NBR * SRAMCAN_FLE_SIZE))) /* Rx FIFO 0 Start Address  */
+#define SRAMCAN_RF1SA ((uint32_t)(SRAMCAN_RF0SA + (SRAMCAN_RF0_NBR * SRAMCAN_RF0_SIZE))) /* Rx FIFO 1 Start Address  */
+#define SRAMCAN_TEFSA ((uint32_t)(SRAMCAN_RF1SA + (SRAMCAN_RF1_NBR * SRAMCAN_RF1_SIZE))) /* Tx Event FIFO Start
+                                                                                            Address */
+#define SRAMCAN_TFQSA ((uint32_t)(SRAMCAN_TEFSA + (SRAMCAN_TEF_NBR * SRAMCAN_TEF_SIZE))) /* Tx FIFO/Queue Start
+                                                                                            Address                  */
+#define SRAMCAN_SIZE  ((uint32_t)(SRAMCAN_TFQSA + (SRAMCAN_TFQ_NBR * SRAMCAN_TFQ_SIZE))) /* Message RAM size         */
+
+/**
+  * @brief  Deadline statistics kept by fdcan_tx_expire()
+  */
+typedef struct
+{
+  uint32_t Expired;     /* Pending buffers found past their deadline, cancellation requested */
+  uint32_t Cancelled;   /* Cancellations confirmed by TXBCF, the frame never reached the bus  */
+  uint32_t Late;        /* Cancellations that lost the race, TXBTO shows the frame was sent  */
+} FDCAN_TxStats_t;
+
+/**
+  * @brief  Counters kept by fdcan_send_mp()
+  */
+typedef struct
+{
+  uint32_t Sent;        /* Frames queued                                                          */
+  uint32_t Full;        /* Rejected, every Tx buffer pending or being filled by another context   */
+  uint32_t Contended;   /* Reservation retries: another context ran between LDREX and STREX      */
+} FDCAN_TxMpStats_t;
+
+#ifdef FDCAN_STATS
+/**
+  * @brief  Traffic statistics, compiled in with FDCAN_STATS (Makefile stats=1)
+  */
+typedef struct
+{
+  uint32_t RxFrames;        /* Frames read by fdcan_receive() or released by fdcan_rxfifo_release() */
+  uint32_t RxBytes;         /* Their payload bytes                                                  */
+  uint32_t TxFrames;        /* Frames queued by fdcan_send(), fdcan_send_mp() or fdcan_tx_prepare() */
+  uint32_t TxBytes;
+  uint32_t TxFull;          /* fdcan_send()/_mp()/fdcan_tx_prepare() rejected, no free Tx buffer    */
+  uint32_t RxLost[2];       /* Message lost events per Rx FIFO (IR.RFnL)                           */
+  uint32_t RxHighWater[2];  /* Highest RXFnS fill level seen when reading a FIFO                    */
+  uint32_t IsrCount;        /* Handlers timed with FDCAN_STATS_ISR_BEGIN/END                        */
+  uint32_t IsrMaxCycles;
+  uint64_t IsrCycles;
+  uint32_t IdOverflow;      /* Frames whose ID found no slot in the per-ID table                   */
+} FDCAN_Stats_t;
+
+/**
+  * @brief  Per-ID counters, one entry of the table given to fdcan_stats_ids()
+  */
+typedef struct
+{
+  uint32_t Key;             /* Identifier | FDCAN_EXTENDED_ID, FDCAN_STATS_ID_FREE if unused */
+  uint32_t RxFrames;
+  uint32_t TxFrames;
+} FDCAN_IdStats_t;
+
+#define FDCAN_STATS_ID_FREE  ((uint32_t)0xFFFFFFFFU)
+#endif
+
 typedef enum {
   FDCAN_RX_FIFO0 = 0,
   FDCAN_RX_FIFO1 = 1
@@ -52,20 +193,26 @@ typedef struct
   uint32_t NominalTimeSeg2;              /*!< Specifies the number of time quanta in Bit Segment 2.
                                               This parameter must be a number between 2 and 128            */
 
-  // uint32_t DataPrescaler;                /*!< Specifies the value by which the oscillator frequency is
-  //                                             divided for generating the data bit time quanta.
-  //                                             This parameter must be a number between 1 and 32             */
-  //
-  // uint32_t DataSyncJumpWidth;            /*!< Specifies the maximum number of time quanta the FDCAN
-  //                                             hardware is allowed to lengthen or shorten a data bit to
-  //                                             perform resynchronization.
-  //                                             This parameter must be a number between 1 and 16             */
-  //
-  // uint32_t DataTimeSeg1;                 /*!< Specifies the number of time quanta in Data Bit Segment 1.
-  //                                             This parameter must be a number between 1 and 32             */
-  //
-  // uint32_t DataTimeSeg2;                 /*!< Specifies the number of time quanta in Data Bit Segment 2.
-                                              // This parameter must be a number between 1 and 16             */
+  uint32_t DataPrescaler;                /*!< Specifies the value by which the oscillator frequency is
+                                              divided for generating the data bit time quanta.
+                                              Used only when FDMode is set.
+                                              This parameter must be a number between 1 and 32             */
+
+  uint32_t DataSyncJumpWidth;            /*!< Specifies the maximum number of time quanta the FDCAN
+                                              hardware is allowed to lengthen or shorten a data bit to
+                                              perform resynchronization.
+                                              This parameter must be a number between 1 and 16             */
+
+  uint32_t DataTimeSeg1;                 /*!< Specifies the number of time quanta in Data Bit Segment 1.
+                                              This parameter must be a number between 1 and 32             */
+
+  uint32_t DataTimeSeg2;                 /*!< Specifies the number of time quanta in Data Bit Segment 2.
+                                              This parameter must be a number between 1 and 16             */
+
+  bool FDMode;                           /*!< Enable CAN FD operation with bit rate switching
+                                              (CCCR.FDOE and CCCR.BRSE), data phase timed by Data*     */
+
+  bool BusMonitor;                       /*!< Bus monitoring (listen-only) mode, CCCR.MON              */
 
   uint32_t StdFiltersNbr;                /*!< Specifies the number of standard Message ID filters.
                                               This parameter must be a number between 0 and 28             */
@@ -73,9 +220,16 @@ typedef struct
   uint32_t ExtFiltersNbr;                /*!< Specifies the number of extended Message ID filters.
                                               This parameter must be a number between 0 and 8             */
 
+  uint32_t TimestampPrescaler;           /*!< Rx/Tx timestamp counter prescaler in nominal bit times
+                                              (TSCC.TCP + 1), a number between 1 and 16.
+                                              0 leaves the counter stopped (RxTimestamp reads 0)           */
+
   bool TxQueue;              /*!< Tx FIFO/Queue Mode selection.
                                               This parameter can be a value of @ref FDCAN_txFifoQueue_Mode */
 
+  bool TxEvents;                         /*!< Store a Tx Event FIFO element (EFC) for every frame sent,
+                                              marked with the handle's TxMarker; read with fdcan_tx_event() */
+
 } FDCAN_Init_t;
 
 /**
@@ -83,55 +237,33 @@ typedef struct
   */
 typedef struct
 {
-  uint32_t StandardFilterSA; /*!< Specifies the Standard Filter List Start Address.
-                                  This parameter must be a 32-bit word address      */
+  uintptr_t StandardFilterSA; /*!< Specifies the Standard Filter List Start Address.
+                                   This parameter must be a 32-bit word address      */
 
-  uint32_t ExtendedFilterSA; /*!< Specifies the Extended Filter List Start Address.
-                                  This parameter must be a 32-bit word address      */
+  uintptr_t ExtendedFilterSA; /*!< Specifies the Extended Filter List Start Address.
+                                   This parameter must be a 32-bit word address      */
 
-  uint32_t RxFIFO0SA;        /*!< Specifies the Rx FIFO 0 Start Address.
-                                  This parameter must be a 32-bit word address      */
+  uintptr_t RxFIFO0SA;        /*!< Specifies the Rx FIFO 0 Start Address.
+                                   This parameter must be a 32-bit word address      */
 
-  uint32_t RxFIFO1SA;        /*!< Specifies the Rx FIFO 1 Start Address.
-                                  This parameter must be a 32-bit word address      */
+  uintptr_t RxFIFO1SA;        /*!< Specifies the Rx FIFO 1 Start Address.
+                                   This parameter must be a 32-bit word address      */
 
-  uint32_t TxEventFIFOSA;    /*!< Specifies the Tx Event FIFO Start Address.
-                                  This parameter must be a 32-bit word address      */
+  uintptr_t TxEventFIFOSA;    /*!< Specifies the Tx Event FIFO Start Address.
+                                   This parameter must be a 32-bit word address      */
 
-  uint32_t TxFIFOQSA;        /*!< Specifies the Tx FIFO/Queue Start Address.
-                                  This parameter must be a 32-bit word address      */
+  uintptr_t TxFIFOQSA;        /*!< Specifies the Tx FIFO/Queue Start Address.
+                                   This parameter must be a 32-bit word address      */
 
 } FDCAN_MsgRamAddress_t;
 
-/**
-  * @brief  FDCAN handle structure definition
-  */
-typedef struct
-{
-  FDCAN_t         *Instance;        /*!< Register base address     */
-
-  FDCAN_Init_t           Init;             /*!< FDCAN required parameters */
-
-  FDCAN_MsgRamAddress_t  msgRam;           /*!< FDCAN Message RAM blocks  */
-
-  uint32_t                    LatestTxFifoQRequest; /*!< FDCAN Tx buffer index
-                                               of latest Tx FIFO/Queue request */
-
-  // __IO HAL_FDCAN_State_t State;            /*!< FDCAN communication state */
-
-  // HAL_Lock_t             Lock;             /*!< FDCAN locking object      */
-
-  // __IO uint32_t               ErrorCode;        /*!< FDCAN Error code          */
-
-} FDCAN_Handle_t;
-
 /**
   * @brief  FDCAN filter structure definition
   */
 typedef struct
 {
-  // uint32_t IdType;           /*!< Specifies the identifier type.
-  //                                 This parameter can be a value of @ref FDCAN_id_type       */
+  uint32_t IdType;           /*!< Specifies the identifier type.
+                                  This parameter can be a value of @ref FDCAN_id_type       */
 
   uint32_t FilterIndex;      /*!< Specifies the filter which will be initialized.
                                   This parameter must be a number between:
@@ -168,9 +300,9 @@ typedef struct
                                       - 0 and 0x7FF, if IdType is FDCAN_STANDARD_ID
                                       - 0 and 0x1FFFFFFF, if IdType is FDCAN_EXTENDED_ID               */
 
-  // uint32_t IdType;              /*!< Specifies the identifier type for the message that will be
-  //                                    transmitted.
-  //                                    This parameter can be a value of @ref FDCAN_id_type               */
+  uint32_t IdType;              /*!< Specifies the identifier type for the message that will be
+                                     transmitted.
+                                     This parameter can be a value of @ref FDCAN_id_type               */
 
   // uint32_t TxFrameType;         /*!< Specifies the frame type of the message that will be transmitted.
   //                                    This parameter can be a value of @ref FDCAN_frame_type            */
@@ -181,13 +313,13 @@ typedef struct
   uint32_t ErrorStateIndicator; /*!< Specifies the error state indicator.
                                      This parameter can be a value of @ref FDCAN_error_state_indicator */
 
-  // uint32_t BitRateSwitch;       /*!< Specifies whether the Tx frame will be transmitted with or without
-  //                                    bit rate switching.
-  //                                    This parameter can be a value of @ref FDCAN_bit_rate_switching    */
+  uint32_t BitRateSwitch;       /*!< Specifies whether the Tx frame will be transmitted with or without
+                                     bit rate switching.
+                                     This parameter can be a value of @ref FDCAN_bit_rate_switching    */
 
-  // uint32_t FDFormat;            /*!< Specifies whether the Tx frame will be transmitted in classic or
-  //                                    FD format.
-                                     // This parameter can be a value of @ref FDCAN_format                */
+  uint32_t FDFormat;            /*!< Specifies whether the Tx frame will be transmitted in classic or
+                                     FD format.
+                                     This parameter can be a value of @ref FDCAN_format                */
 
   // uint32_t TxEventFifoControl;  /*!< Specifies the event FIFO control.
   //                                    This parameter can be a value of @ref FDCAN_EFC                   */
@@ -196,6 +328,10 @@ typedef struct
   //                                    element for identification of Tx message status.
                                      // This parameter must be a number between 0 and 0xFF                */
 
+  uint64_t Deadline;            /*!< Specifies the latest useful transmission time in timebase_us()
+                                     microseconds, 0 if the frame never expires.
+                                     fdcan_tx_expire() cancels pending frames past their deadline      */
+
   uint8_t *Data;
 
 } FDCAN_TxElement_t;
@@ -210,9 +346,9 @@ typedef struct
                                         - 0 and 0x7FF, if IdType is FDCAN_STANDARD_ID
                                         - 0 and 0x1FFFFFFF, if IdType is FDCAN_EXTENDED_ID               */
 
-  // uint32_t IdType;                /*!< Specifies the identifier type of the received message.
-  //                                      This parameter can be a value of @ref FDCAN_id_type               */
-  //
+  uint32_t IdType;                /*!< Specifies the identifier type of the received message.
+                                       This parameter can be a value of @ref FDCAN_id_type               */
+
   // uint32_t RxFrameType;           /*!< Specifies the the received message frame type.
   //                                      This parameter can be a value of @ref FDCAN_frame_type            */
 
@@ -222,13 +358,13 @@ typedef struct
   uint32_t ErrorStateIndicator;   /*!< Specifies the error state indicator.
                                        This parameter can be a value of @ref FDCAN_error_state_indicator */
 
-  // uint32_t BitRateSwitch;         /*!< Specifies whether the Rx frame is received with or without bit
-  //                                      rate switching.
-  //                                      This parameter can be a value of @ref FDCAN_bit_rate_switching    */
-  //
-  // uint32_t FDFormat;              /*!< Specifies whether the Rx frame is received in classic or FD
-  //                                      format.
-  //                                      This parameter can be a value of @ref FDCAN_format                */
+  uint32_t BitRateSwitch;         /*!< Specifies whether the Rx frame is received with or without bit
+                                       rate switching.
+                                       This parameter can be a value of @ref FDCAN_bit_rate_switching    */
+
+  uint32_t FDFormat;              /*!< Specifies whether the Rx frame is received in classic or FD
+                                       format.
+                                       This parameter can be a value of @ref FDCAN_format                */
 
   uint32_t RxTimestamp;           /*!< Specifies the timestamp counter value captured on start of frame
                                        reception.
@@ -251,11 +387,247 @@ typedef struct
 
 } FDCAN_RxElement_t;
 
+/**
+  * @brief  FDCAN Tx Event FIFO element
+  */
+typedef struct
+{
+  uint32_t Identifier;            /*!< Identifier of the frame sent                              */
+
+  uint32_t IdType;                /*!< FDCAN_STANDARD_ID or FDCAN_EXTENDED_ID                    */
+
+  uint32_t DataLength;            /*!< Data length code                                          */
+
+  uint32_t TxTimestamp;           /*!< Timestamp counter at the start of frame, 0..0xFFFF        */
+
+  uint32_t MessageMarker;         /*!< TxMarker the frame was written with, 0..0xFF              */
+
+  uint32_t EventType;             /*!< 1 Tx event, 2 transmitted despite a cancellation request  */
+
+} FDCAN_TxEvent_t;
+
+/**
+  * @brief  FDCAN handle structure definition
+  */
+typedef struct FDCAN_Handle
+{
+  FDCAN_t         *Instance;        /*!< Register base address     */
+
+  FDCAN_Init_t           Init;             /*!< FDCAN required parameters */
+
+  FDCAN_MsgRamAddress_t  msgRam;           /*!< FDCAN Message RAM blocks  */
+
+  uint32_t                    LatestTxFifoQRequest; /*!< FDCAN Tx buffer index
+                                               of latest Tx FIFO/Queue request */
+
+  // __IO HAL_FDCAN_State_t State;            /*!< FDCAN communication state */
+
+  // HAL_Lock_t             Lock;             /*!< FDCAN locking object      */
+
+  // __IO uint32_t               ErrorCode;        /*!< FDCAN Error code          */
+
+  void (*RxCallback)(struct FDCAN_Handle *fdcan, const FDCAN_RxElement_t *rx); /*!< Called by fdcan_receive()
+                                               for every frame read, NULL if unused.
+                                               Reset by fdcan_init()          */
+
+  void (*TxCallback)(struct FDCAN_Handle *fdcan, const FDCAN_TxElement_t *tx, uint32_t marker); /*!< Called by
+                                               fdcan_send() for every frame queued, with
+                                               the message marker it was written with
+                                               (Init.TxEvents, else 0). NULL if unused.
+                                               Reset by fdcan_init()          */
+
+  uint64_t                    TxDeadline[FDCAN_TX_BUFFERS]; /*!< Deadline of the frame last
+                                               written to each Tx buffer, 0 if none */
+
+  uint32_t                    TxCancelRequest; /*!< Tx buffers with a deadline
+                                               cancellation not yet settled   */
+
+  FDCAN_TxStats_t             TxStats;          /*!< Deadline statistics, reset by
+                                               fdcan_init()                   */
+
+  uint32_t                    IrqLine1;         /*!< IR bits routed to interrupt
+                                               line 1 by fdcan_irq_route()    */
+
+  uint32_t                    TxMarker;         /*!< Message marker of the next frame
+                                               sent with Init.TxEvents, low 8 bits
+                                               used. Reset by fdcan_init()    */
+
+  uint32_t                    TxOwned;          /*!< Tx buffers reserved by
+                                               fdcan_send_mp() and not yet
+                                               requested                      */
+
+  FDCAN_TxMpStats_t           TxMpStats;        /*!< fdcan_send_mp() counters,
+                                               reset by fdcan_init()          */
+
+#ifdef FDCAN_STATS
+  FDCAN_Stats_t               Stats;            /*!< Traffic statistics, reset by
+                                               fdcan_init()                   */
+
+  FDCAN_IdStats_t            *IdStats;          /*!< Per-ID table, NULL if unused.
+                                               Reset by fdcan_init()          */
+
+  uint32_t                    IdStatsMask;      /*!< Table size - 1            */
+#endif
+
+} FDCAN_Handle_t;
+
 int fdcan_init(FDCAN_Handle_t *fdcan);
+
+/**
+  * fdcan_stop() sets INIT and waits for the controller to leave the bus
+  * after the frame in progress. Returns 1 if INIT does not read back set
+  * within a bounded wait (no kernel clock), 0 once stopped.
+  */
+int fdcan_stop(FDCAN_Handle_t *fdcan);
+
+/**
+  * fdcan_start() clears INIT again, e.g. to recover from bus-off (the
+  * controller sets INIT itself on entering bus-off). It returns at once,
+  * bus integration (or the 128 x 11 recessive bit recovery sequence) runs
+  * in hardware.
+  */
+int fdcan_start(FDCAN_Handle_t *fdcan);
+
+int fdcan_calc_bittiming(uint32_t kernel_hz, uint32_t bitrate, uint32_t sample_point_permille, bool data_phase,
+                         FDCAN_BitTiming_t *bt);
 int fdcan_set_filter(FDCAN_Handle_t *fdcan, const FDCAN_Filter_t *filter);
 int fdcan_send(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx);
+
+/**
+  * fdcan_send_mp() is fdcan_send() for several producers: the main loop and
+  * interrupts of any priority may call it concurrently without masking
+  * interrupts. A caller first reserves a Tx buffer that is neither pending
+  * (TXBRP) nor reserved by another context with an exclusive load/store
+  * (LDREX/STREX) on TxOwned, then fills and requests it; a context
+  * preempted between the two retries against the new state, counted in
+  * TxMpStats.Contended. It never waits on another producer. Needs
+  * Init.TxQueue (any free buffer may be written in queue mode) and every
+  * producer of the controller on this function; TxCallback is not called.
+  * The FDCAN_STATS Tx counters are updated with atomic adds.
+  * Returns 1 if no buffer is free or the controller is in FIFO mode.
+  */
+int fdcan_send_mp(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx);
+
+/**
+  * fdcan_tx_prepare() copies a frame into the next free TX slot without
+  * requesting transmission, fdcan_tx_commit() then starts it with a single
+  * TXBAR write. Only one slot can be prepared at a time and nothing else may
+  * send in between. TxCallback is not called on this path.
+  */
+int fdcan_tx_prepare(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx, uint32_t *index);
+void fdcan_tx_commit(FDCAN_Handle_t *fdcan, uint32_t index);
+
+/**
+  * Message marker of the frame prepared in Tx buffer 'index' (Init.TxEvents,
+  * 0 without), read back from the element, e.g. to pass to a TxCallback.
+  */
+uint32_t fdcan_tx_marker(FDCAN_Handle_t *fdcan, uint32_t index);
+
+/**
+  * fdcan_tx_cancel() withdraws a requested TX buffer through TXBCR. A frame
+  * already on the bus is not aborted, the call waits for it to finish.
+  * Returns 0 if the buffer was cancelled unsent, 1 if it was transmitted
+  * or not pending.
+  */
+int fdcan_tx_cancel(FDCAN_Handle_t *fdcan, uint32_t index);
+
+/**
+  * fdcan_tx_expire() requests cancellation (TXBCR) of every pending buffer
+  * whose deadline is before now_us and settles earlier requests into
+  * TxStats. It never waits: an expired frame losing arbitration is withdrawn
+  * at the next arbitration round and its buffer becomes free for fresher
+  * traffic. Call it periodically with timebase_us(), e.g. from a timer or
+  * before fdcan_send(), both may run. Returns the mask of buffers this call
+  * asked to cancel; one already requested is neither returned nor counted.
+  */
+uint32_t fdcan_tx_expire(FDCAN_Handle_t *fdcan, uint64_t now_us);
+
+/**
+  * fdcan_tx_settle() moves the cancellations the controller has finished
+  * from TxCancelRequest into TxStats. Every path writing TXBAR calls it
+  * first, since a new request clears the buffer's TXBCF/TXBTO; a sender
+  * outside this driver (fdcan.hpp) must do the same.
+  */
+void fdcan_tx_settle(FDCAN_Handle_t *fdcan);
+
 int fdcan_rxfifo_level(const FDCAN_Handle_t *fdcan, FDCAN_RxFIFO_t fifo);
+
+/**
+  * Zero-copy access to Rx FIFO elements for capture paths: no decoding and
+  * no RxCallback. fdcan_rxfifo_peek() returns the element 'offset' places
+  * after the get index, in message RAM layout, or NULL past the fill level:
+  *   word 0   ESI(31) XTD(30) RTR(29) ID(28:0), a standard ID in 28:18
+  *   word 1   ANMF(31) FIDX(30:24) FDF(21) BRS(20) DLC(19:16) RXTS(15:0)
+  *   word 2.. payload, byte 0 in the low byte
+  * fdcan_rxfifo_release() acknowledges the first 'count' elements with a
+  * single RXFnA write.
+  */
+const uint32_t *fdcan_rxfifo_peek(const FDCAN_Handle_t *fdcan, FDCAN_RxFIFO_t fifo, uint32_t offset);
+void fdcan_rxfifo_release(FDCAN_Handle_t *fdcan, FDCAN_RxFIFO_t fifo, uint32_t count);
+void fdcan_irq_enable(FDCAN_Handle_t *fdcan, uint32_t it);
+void fdcan_irq_disable(FDCAN_Handle_t *fdcan, uint32_t it);
+uint32_t fdcan_irq_ack(FDCAN_Handle_t *fdcan);
+
+/**
+  * fdcan_irq_route() moves whole interrupt groups (FDCAN_IT_GROUP_*) to
+  * interrupt line 1 (FDCANx_IT1), the others stay on line 0. Each line's
+  * handler then acknowledges only its own sources: fdcan_irq_ack() those of
+  * line 0, fdcan_irq_ack_line1() those of line 1.
+  */
+void fdcan_irq_route(FDCAN_Handle_t *fdcan, uint32_t groups);
+uint32_t fdcan_irq_ack_line1(FDCAN_Handle_t *fdcan);
 int fdcan_receive(FDCAN_Handle_t *fdcan, FDCAN_RxElement_t *rx, FDCAN_RxFIFO_t fifo);
 int fdcan_is_available(FDCAN_Handle_t *fdcan);
 
+/**
+  * fdcan_tx_event() reads and acknowledges the oldest Tx Event FIFO element,
+  * returns 1 if the FIFO is empty. Elements exist only for frames written
+  * with Init.TxEvents set; the FIFO holds FDCAN_TX_EVENTS of them and drops
+  * newer ones (IR.TEFL) when it is not read in time. fdcan_timestamp()
+  * returns the running timestamp counter (TSCV) the Rx/Tx timestamps are
+  * taken from, in units of Init.TimestampPrescaler nominal bit times.
+  */
+int fdcan_tx_event(FDCAN_Handle_t *fdcan, FDCAN_TxEvent_t *ev);
+uint32_t fdcan_timestamp(const FDCAN_Handle_t *fdcan);
+
+#ifdef FDCAN_STATS
+/**
+  * Statistics are updated inline by the Rx/Tx paths, a few increments per
+  * frame; building with stats=0 removes them along with this API.
+  * fdcan_stats_snapshot() copies the counters with interrupts masked and,
+  * if 'reset' is set, clears them in the same critical section, so no event
+  * is lost or counted twice between two snapshots.
+  *
+  * fdcan_stats_ids() adds per-ID Rx/Tx counters in a caller-provided open
+  * addressing table ('size' a power of two, some headroom over the number
+  * of IDs on the bus). An ID takes a slot on its first frame; when its 8
+  * probe slots are taken the frame only counts in IdOverflow.
+  * fdcan_stats_ids_snapshot() copies up to 'max' used entries and returns
+  * their number, 'reset' clears the counters but keeps the IDs.
+  *
+  * Handlers wrap their body in FDCAN_STATS_ISR_BEGIN()/FDCAN_STATS_ISR_END()
+  * to account their DWT cycles to the controller.
+  */
+int fdcan_stats_ids(FDCAN_Handle_t *fdcan, FDCAN_IdStats_t *table, uint32_t size);
+void fdcan_stats_snapshot(FDCAN_Handle_t *fdcan, FDCAN_Stats_t *stats, bool reset);
+uint32_t fdcan_stats_ids_snapshot(FDCAN_Handle_t *fdcan, FDCAN_IdStats_t *ids, uint32_t max, bool reset);
+void fdcan_stats_isr(FDCAN_Handle_t *fdcan, uint32_t cycles);
+
+#define FDCAN_STATS_ISR_BEGIN()     uint32_t fdcan_isr_start = DWT->CYCCNT
+#define FDCAN_STATS_ISR_END(fdcan)  fdcan_stats_isr((fdcan), DWT->CYCCNT - fdcan_isr_start)
+#else
+#define FDCAN_STATS_ISR_BEGIN()
+#define FDCAN_STATS_ISR_END(fdcan)
+#endif
+
+/**
+  * @brief  Payload size in bytes for a data length code (0..15 -> 0..64)
+  */
+static inline uint32_t fdcan_dlc_to_bytes(uint32_t dlc)
+{
+  static const uint8_t dlc_bytes[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+
+  return dlc_bytes[dlc & 0xFU];
+}
+
 #endif
@@ -0,0 +1,214 @@
+#ifndef FDCAN_HPP
+#define FDCAN_HPP
+
+extern "C" {
+#include "fdcan.h"
+#include "trace.h"
+}
+
+/*
+ * C++17 front end of the FDCAN driver, header only.
+ *
+ * Fdcan<Instance, Config> fixes the controller and its options at compile
+ * time: register block, message RAM blocks and Rx FIFO are constants, and
+ * Config's feature flags are constexpr, so send(), receive() and isr()
+ * compile to straight-line register and message RAM accesses with no
+ * handle loads and no branches on options the build does not use.
+ *
+ *   struct BusConfig : fdcan::DefaultConfig {
+ *     static constexpr bool tx_events = true;
+ *   };
+ *   using Bus = fdcan::Fdcan<fdcan::Instance::Fdcan1, BusConfig>;
+ *
+ *   Bus::init(timing);                     // FDCAN_Init_t with the bit timing
+ *   Bus::send(tx);
+ *   Bus::isr(rx, [](const FDCAN_RxElement_t &f) { ... });   // inlined handler
+ *
+ * Each instantiation owns a C handle, Bus::handle(), set up by
+ * fdcan_init(), so the rest of the C API (filters, interrupts, Tx events,
+ * deadlines, the can/ modules) works on the same controller. Use a single
+ * Config per instance. The fast paths leave out what the handle would
+ * have to dispatch at run time: RxCallback/TxCallback, deadlines (frames
+ * sent here never expire, though a C frame's cancellation is settled
+ * before its buffer is reused) and the FDCAN_STATS counters; trace points
+ * are kept.
+ *
+ * send(), receive() and isr() are always inlined: each call site gets a
+ * copy specialised for it. Call them from one function per use, e.g. the
+ * interrupt handler, and make that function RAMFUNC to run them from SRAM
+ * (GCC ignores section attributes on members of class templates).
+ */
+
+#define FDCAN_INLINE  inline __attribute__((always_inline))
+
+namespace fdcan {
+
+enum class Instance { Fdcan1, Fdcan2 };   // FDCAN1/FDCAN2 are register block macros
+
+enum class RxFifo { FIFO0 = FDCAN_RX_FIFO0, FIFO1 = FDCAN_RX_FIFO1 };
+
+struct DefaultConfig {
+  static constexpr RxFifo rx_fifo = RxFifo::FIFO0;   // FIFO read by receive() and isr()
+  static constexpr bool tx_queue = true;              // Init.TxQueue
+  static constexpr bool loopback = false;             // Init.Loopback
+  static constexpr bool fd_mode = false;              // Init.FDMode, classic frames carry at most 8 bytes
+  static constexpr bool tx_events = false;            // Init.TxEvents, marker written by send()
+};
+
+template <Instance I, typename Config = DefaultConfig>
+class Fdcan {
+public:
+  static constexpr uint32_t unit = (I == Instance::Fdcan2) ? 1U : 0U;   // trace unit
+  static constexpr uintptr_t ram_offset = (I == Instance::Fdcan2) ? SRAMCAN_SIZE : 0U;
+  static constexpr bool fifo1 = (Config::rx_fifo == RxFifo::FIFO1);
+
+  static FDCAN_Handle_t *handle() { return &handle_; }
+
+  /**
+   * @brief Configure the controller with the bit timing and filter counts
+   * of 'timing', the Config flags override its mode fields.
+   * @return fdcan_init() result.
+   */
+  static int init(const FDCAN_Init_t &timing) {
+    handle_.Instance = regs();
+    handle_.Init = timing;
+    handle_.Init.TxQueue = Config::tx_queue;
+    handle_.Init.Loopback = Config::loopback;
+    handle_.Init.FDMode = Config::fd_mode;
+    handle_.Init.TxEvents = Config::tx_events;
+    return fdcan_init(&handle_);
+  }
+
+  /**
+   * @brief fdcan_send() for this instance.
+   * @return 0 if queued, 1 if no Tx buffer is free.
+   */
+  FDCAN_INLINE static int send(const FDCAN_TxElement_t &tx) {
+    uint32_t status = regs()->TXFQS, index, w1, w2, length, i;
+    uint32_t *e;
+
+    if ((status & BIT(21)) != 0) {
+      TRACE(TRACE_EV_FDCAN_TX_FULL, unit, 0, 0);
+      return 1;
+    }
+    index = (status >> 16) & 0b11;
+    TRACE(TRACE_EV_FDCAN_TX_SLOT, unit, index, tx.Identifier | tx.IdType);
+    // a buffer fdcan_tx_expire() cancelled: account for it before TXBAR clears TXBCF
+    if (__atomic_load_n(&handle_.TxCancelRequest, __ATOMIC_RELAXED) != 0) fdcan_tx_settle(&handle_);
+
+    if (tx.IdType == FDCAN_STANDARD_ID) {
+      w1 = tx.Identifier << 18U;
+    } else {
+      w1 = (tx.Identifier & 0x1FFFFFFFU) | FDCAN_EXTENDED_ID;
+    }
+    if (tx.ErrorStateIndicator != 0) w1 |= BIT(31);
+
+    w2 = tx.DataLength << 16U;
+    if constexpr (Config::fd_mode) {
+      w2 |= tx.BitRateSwitch | tx.FDFormat;
+      length = fdcan_dlc_to_bytes(tx.DataLength);
+    } else {
+      length = (tx.DataLength > 8U) ? 8U : tx.DataLength;
+    }
+    if constexpr (Config::tx_events) {
+      // atomic like fdcan_send(): the C path may send on this handle from an interrupt
+      w2 |= BIT(23) | ((__atomic_fetch_add(&handle_.TxMarker, 1U, __ATOMIC_RELAXED) & 0xFFU) << 24U);
+    }
+
+    e = reinterpret_cast<uint32_t *>(FDCAN_SRAM_BASE + ram_offset + SRAMCAN_TFQSA + index * SRAMCAN_TFQ_SIZE);
+    e[0] = w1;
+    e[1] = w2;
+    for (i = 0; i < length; i += 4U) {
+      e[2U + i / 4U] = ((uint32_t)tx.Data[i + 3U] << 24U) | ((uint32_t)tx.Data[i + 2U] << 16U) |
+                       ((uint32_t)tx.Data[i + 1U] << 8U) | (uint32_t)tx.Data[i];
+    }
+
+    handle_.TxDeadline[index] = 0;   // a deadline left by a C send must not cancel this frame
+    regs()->TXBAR = (uint32_t)1 << index;
+    TRACE(TRACE_EV_FDCAN_TX_REQUEST, unit, index, 0);
+    handle_.LatestTxFifoQRequest = (uint32_t)1 << index;
+
+    return 0;
+  }
+
+  /**
+   * @brief fdcan_receive() from Config::rx_fifo.
+   * @return 0 if a frame was read, 1 if the FIFO is empty.
+   */
+  FDCAN_INLINE static int receive(FDCAN_RxElement_t &rx) {
+    uint32_t status = fifo1 ? regs()->RXF1S : regs()->RXF0S;
+    uint32_t index, w, length, i;
+    const uint32_t *e;
+    const uint8_t *data;
+
+    if ((status & 0b1111) == 0) return 1;
+    TRACE(TRACE_EV_FDCAN_RXFIFO, unit, fifo1, status & 0b1111);
+
+    index = (status >> 8) & 0b11;
+    e = reinterpret_cast<const uint32_t *>(FDCAN_SRAM_BASE + ram_offset +
+                                           (fifo1 ? SRAMCAN_RF1SA + index * SRAMCAN_RF1_SIZE
+                                                  : SRAMCAN_RF0SA + index * SRAMCAN_RF0_SIZE));
+
+    w = e[0];
+    rx.IdType = w & FDCAN_EXTENDED_ID;
+    rx.Identifier = (rx.IdType == FDCAN_STANDARD_ID) ? ((w & 0x1FFC0000U) >> 18U) : (w & 0x1FFFFFFFU);
+    rx.ErrorStateIndicator = w & BIT(31);
+
+    w = e[1];
+    rx.RxTimestamp = w & 0xFFFFU;
+    rx.DataLength = (w >> 16U) & 0xFU;
+    rx.FilterIndex = (w >> 24U) & 0x7FU;
+    if constexpr (Config::fd_mode) {
+      rx.BitRateSwitch = w & FDCAN_BRS_ON;
+      rx.FDFormat = w & FDCAN_FD_CAN;
+      length = fdcan_dlc_to_bytes(rx.DataLength);
+    } else {
+      rx.BitRateSwitch = 0;
+      rx.FDFormat = 0;
+      length = (rx.DataLength > 8U) ? 8U : rx.DataLength;
+    }
+
+    data = reinterpret_cast<const uint8_t *>(e + 2);
+    for (i = 0; i < length; i++) {
+      rx.Data[i] = data[i];
+    }
+
+    if constexpr (fifo1) {
+      regs()->RXF1A = index;
+    } else {
+      regs()->RXF0A = index;
+    }
+    TRACE(TRACE_EV_FDCAN_RX, unit, fifo1, rx.Identifier | rx.IdType);
+    TRACE(TRACE_EV_FDCAN_RX_ACK, unit, fifo1, index);
+
+    return 0;
+  }
+
+  /**
+   * @brief Interrupt line 0 handler body: fdcan_irq_ack(), then every frame
+   * of Config::rx_fifo through 'on_rx' (inlined, unlike RxCallback), read
+   * into 'rx'.
+   * @return The IR bits acknowledged.
+   */
+  template <typename Handler>
+  FDCAN_INLINE static uint32_t isr(FDCAN_RxElement_t &rx, Handler &&on_rx) {
+    uint32_t ir = regs()->IR & regs()->IE & ~handle_.IrqLine1;
+
+    regs()->IR = ir; // write 1 to clear
+    TRACE(TRACE_EV_FDCAN_IRQ_ACK, unit, 0, ir);
+    while (receive(rx) == 0) {
+      on_rx(static_cast<const FDCAN_RxElement_t &>(rx));
+    }
+
+    return ir;
+  }
+
+private:
+  FDCAN_INLINE static FDCAN_t *regs() { return (I == Instance::Fdcan2) ? FDCAN2 : FDCAN1; }
+
+  inline static FDCAN_Handle_t handle_{};
+};
+
+}
+
+#endif
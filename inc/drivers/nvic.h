@@ -0,0 +1,78 @@
+#ifndef NVIC_H
+#define NVIC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32h563.h"
+
+#define IRQ_VECTOR_COUNT    (16 + IRQ_COUNT)  // core exceptions + device interrupts
+
+typedef void (*irq_handler_t)(void);
+
+/**
+ * @brief Copy the flash vector table to SRAM and point VTOR at the copy.
+ * Called automatically by the first irq_register(); calling it again is a no-op.
+ */
+void irq_vector_relocate(void);
+
+/**
+ * @brief Install a handler for an exception or interrupt.
+ * Each controller instance can get its own handler, e.g.
+ * irq_register(FDCAN1_IT0_IRQn, can1_rx_isr), instead of one shared handler
+ * looking up the instance at runtime.
+ * @param irqn Interrupt number (negative values for core exceptions).
+ * @param handler Function to run, NULL restores the startup handler.
+ */
+void irq_register(IRQn_t irqn, irq_handler_t handler);
+
+/**
+ * @brief Enable/disable a device interrupt in the NVIC.
+ * @param irqn Device interrupt number (>= 0).
+ */
+void nvic_enable_irq(IRQn_t irqn);
+void nvic_disable_irq(IRQn_t irqn);
+
+/**
+ * @brief Set the priority of an exception or interrupt.
+ * NMI and HardFault have fixed priorities: setting is ignored, reading returns 0.
+ * @param irqn Interrupt number, MemoryManagement_IRQn or above.
+ * @param priority 0 (highest) .. 15 (lowest).
+ */
+void nvic_set_priority(IRQn_t irqn, uint8_t priority);
+uint8_t nvic_get_priority(IRQn_t irqn);
+
+/**
+ * @brief Pending state control of a device interrupt.
+ */
+void nvic_set_pending(IRQn_t irqn);
+void nvic_clear_pending(IRQn_t irqn);
+bool nvic_is_pending(IRQn_t irqn);
+
+/**
+ * @brief Mask interrupts and return the previous PRIMASK for irq_restore().
+ * For short critical sections only.
+ */
+static inline uint32_t irq_save(void) {
+  uint32_t primask = 0;
+
+#ifdef __arm__
+  __asm volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+#else
+  __asm volatile ("" ::: "memory");   // host build against simulated peripherals
+#endif
+  return primask;
+}
+
+/**
+ * @brief Restore the interrupt mask saved by irq_save().
+ */
+static inline void irq_restore(uint32_t primask) {
+#ifdef __arm__
+  __asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+#else
+  (void)primask;
+  __asm volatile ("" ::: "memory");
+#endif
+}
+
+#endif
@@ -2,8 +2,39 @@
 #define RCC_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "stm32h563.h"
 
+#ifndef RCC_HSE_HZ
+#define RCC_HSE_HZ          8000000UL    // ST-LINK MCO on the Nucleo
+#endif
+#define RCC_HSI_HZ          64000000UL   // HSI before HSIDIV
+#define RCC_CSI_HZ          4000000UL
+#define RCC_SYSCLK_MAX_HZ   250000000UL  // VOS0 limit
+
+/**
+ * @brief System clock tree configuration (PLL1 driven by HSE).
+ *
+ * SYSCLK = RCC_HSE_HZ / pll_m * pll_n / pll_p
+ * FDCAN kernel clock = RCC_HSE_HZ / pll_m * pll_n / pll_q
+ */
+typedef struct {
+    bool     hse_bypass; /*!< HSE is an external clock signal rather than a crystal      */
+    uint32_t pll_m;      /*!< PLL1 reference divider, 1..63 (reference must be 1..16 MHz) */
+    uint32_t pll_n;      /*!< PLL1 multiplier, 4..512                                     */
+    uint32_t pll_p;      /*!< PLL1 P divider (SYSCLK), 2..128 and even                    */
+    uint32_t pll_q;      /*!< PLL1 Q divider (FDCAN kernel clock), 1..128                 */
+    uint32_t ahb_div;    /*!< HCLK divider: 1, 2, 4, 8, 16, 64, 128, 256 or 512           */
+    uint32_t apb1_div;   /*!< PCLK1 divider: 1, 2, 4, 8 or 16                             */
+    uint32_t apb2_div;   /*!< PCLK2 divider: 1, 2, 4, 8 or 16                             */
+    uint32_t apb3_div;   /*!< PCLK3 divider: 1, 2, 4, 8 or 16                             */
+} RCC_ClockConfig_t;
+
+/**
+ * @brief 250 MHz SYSCLK/HCLK/PCLKx from the 8 MHz HSE, 50 MHz FDCAN kernel clock.
+ */
+extern const RCC_ClockConfig_t rcc_clock_250mhz;
+
 /**
  * @brief Enable clock for a specific GPIO Bank.
  * @param bank_idx 0 for Bank A, 1 for Bank B, etc.
@@ -21,6 +52,35 @@ void rcc_enable_usart(USART_t *usart);
  */
 void rcc_enable_fdcan();
 
+/**
+ * @brief Bring up PLL1Q as FDCAN kernel clock.
+ * Leaves PLL1 untouched if rcc_clock_init() already started it with the Q output.
+ */
 void pll1_q_init();
 
+/**
+ * @brief Switch the core to PLL1P.
+ * Raises the voltage scaling to VOS0, programs PLL1, flash latency and WRHIGHFREQ,
+ * bus prescalers and the FDCAN kernel clock mux, then enables the ICACHE.
+ * Safe to call from SystemInit() (uses no initialised data).
+ * @param cfg Clock tree configuration.
+ * @return 0 on success, 1 if the configuration is out of range.
+ */
+int rcc_clock_init(const RCC_ClockConfig_t *cfg);
+
+/**
+ * @brief Current clock frequencies, decoded from the RCC registers.
+ */
+uint32_t rcc_get_sysclk_hz(void);
+uint32_t rcc_get_hclk_hz(void);
+uint32_t rcc_get_pclk1_hz(void);
+uint32_t rcc_get_pclk2_hz(void);
+uint32_t rcc_get_pclk3_hz(void);
+uint32_t rcc_get_fdcan_clk_hz(void);
+
+/**
+ * @brief Peripheral clock feeding a USART instance.
+ */
+uint32_t rcc_get_usart_clk_hz(const USART_t *usart);
+
 #endif
@@ -5,8 +5,8 @@
 #include "stm32h563.h"
 
 /**
- * @brief Initialize SysTick timer.
- * @param ticks Number of ticks between interrupts.
+ * @brief Initialize SysTick timer, clocked from the processor clock (HCLK).
+ * @param ticks Number of HCLK cycles between interrupts (max 2^24).
  */
 void systick_init(uint32_t ticks);
 
@@ -0,0 +1,67 @@
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <stdint.h>
+#include "stm32h563.h"
+
+#define TIMEBASE_TICK_HZ    1000U   // SysTick rate extending CYCCNT
+
+/**
+ * @brief Start the 64-bit monotonic clock.
+ * The DWT cycle counter provides the resolution, a 1 kHz SysTick interrupt
+ * extends it to 64 bit. Conversion factors are calibrated from the current
+ * HCLK, so call it after rcc_clock_init() and after .bss is set up (from main).
+ * The SysTick handler is installed with irq_register().
+ * @return 0 on success, 1 if the clock is unknown.
+ */
+int timebase_init(void);
+
+/**
+ * @brief Raw 32-bit cycle counter, wraps every 2^32 / HCLK seconds.
+ * Cheapest timestamp for short intervals.
+ */
+static inline uint32_t timebase_cycles32(void) {
+  return DWT->CYCCNT;
+}
+
+/**
+ * @brief 64-bit core cycles since timebase_init().
+ * Lock-free and consistent from any priority, including ISRs preempting the tick.
+ */
+uint64_t timebase_cycles(void);
+
+/**
+ * @brief 64-bit microseconds since timebase_init().
+ */
+uint64_t timebase_us(void);
+
+/**
+ * @brief 32-bit milliseconds since timebase_init() (wraps after ~49 days).
+ */
+uint32_t timebase_ms(void);
+
+/**
+ * @brief Calibrated conversions for intervals measured with timebase_cycles32().
+ * Results are truncated to 32 bit: up to ~4.29 s for ns.
+ */
+uint32_t timebase_cycles_to_us(uint32_t cycles);
+uint32_t timebase_cycles_to_ns(uint32_t cycles);
+uint32_t timebase_us_to_cycles(uint32_t us);
+
+/**
+ * @brief Core clock the conversions are calibrated for.
+ */
+uint32_t timebase_core_hz(void);
+
+/**
+ * @brief Busy-wait for at least 'us' microseconds.
+ */
+void timebase_delay_us(uint32_t us);
+
+/**
+ * @brief Call 'hook' from the 1 kHz tick interrupt, NULL removes it.
+ * One hook at a time; it runs at SysTick priority and must be short.
+ */
+void timebase_set_tick_hook(void (*hook)(void));
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32h563.h"
+
+/*
+ * Driver trace points.
+ *
+ * TRACE_*() macros in the FDCAN, USART and timebase drivers (and in any
+ * handler that wants them) record fixed-size binary events with a cycle
+ * timestamp. Without TRACE_ENABLE (Makefile trace=0) they expand to nothing
+ * and their arguments are not evaluated.
+ *
+ * Events go into one lock-free ring (the Cortex-M33 is single core): a
+ * writer reserves its slot with an atomic increment, so the macros are safe
+ * from any priority and cost a handful of cycles. When the ring is full the
+ * oldest events are overwritten. The back end decides what happens next:
+ *   TRACE_BACKEND_RAM   the ring stays in SRAM, read it with trace_export()
+ *                       or the debugger (flight recorder)
+ *   TRACE_BACKEND_UART  trace_flush() streams new events on TRACE_USART
+ *   TRACE_BACKEND_FILE  host builds: trace_flush() appends to TRACE_FILE
+ *
+ * The stream is a sequence of blocks, a trace_block_t header followed by
+ * 'count' events; the header magic lets a reader resynchronise, e.g. past
+ * console text on a shared UART. tools/trace_timeline.c converts it into
+ * a Chrome/Perfetto timeline.
+ */
+
+#ifndef TRACE_RING_EVENTS
+#define TRACE_RING_EVENTS     1024U      // power of two, 12 bytes each
+#endif
+
+#define TRACE_BACKEND_RAM     0
+#define TRACE_BACKEND_UART    1
+#define TRACE_BACKEND_FILE    2
+
+#ifndef TRACE_BACKEND
+#define TRACE_BACKEND         TRACE_BACKEND_RAM
+#endif
+
+#ifndef TRACE_USART
+#define TRACE_USART           USART3
+#endif
+
+#ifndef TRACE_FILE
+#define TRACE_FILE            "trace.bin"
+#endif
+
+// Timestamp source, overridden by simulation builds
+#ifndef TRACE_CLOCK
+#define TRACE_CLOCK()         (DWT->CYCCNT)
+#define TRACE_CLOCK_HZ        timebase_core_hz()
+#endif
+
+#define TRACE_STREAM_MAGIC    0x43525444UL  // "DTRC"
+
+typedef enum {
+  TRACE_EV_ISR_ENTER = 1,     // aux: exception number (IRQn + 16)
+  TRACE_EV_ISR_EXIT,          // aux: exception number
+  TRACE_EV_MARK,              // application marker, aux and arg free
+  TRACE_EV_FDCAN_RXFIFO,      // aux: FIFO, arg: fill level before reading
+  TRACE_EV_FDCAN_RX,          // aux: FIFO, arg: Identifier | FDCAN_EXTENDED_ID
+  TRACE_EV_FDCAN_RX_ACK,      // aux: FIFO, arg: index written to RXFnA
+  TRACE_EV_FDCAN_TX_SLOT,     // aux: Tx buffer, arg: Identifier | FDCAN_EXTENDED_ID
+  TRACE_EV_FDCAN_TX_REQUEST,  // aux: Tx buffer written to TXBAR
+  TRACE_EV_FDCAN_TX_FULL,     // no free Tx buffer
+  TRACE_EV_FDCAN_IRQ_ACK,     // aux: interrupt line, arg: IR bits cleared
+  TRACE_EV_USART_TX,          // arg: bytes written by usart_write()
+  TRACE_EV_USART_RX,          // arg: bytes read by usart_read()
+  TRACE_EV_COUNT
+} trace_event_id_t;
+
+typedef struct {
+  uint32_t cycles;            // TRACE_CLOCK(), wraps
+  uint8_t  id;                // trace_event_id_t
+  uint8_t  unit;              // peripheral instance, 0 for FDCAN1, 1 for FDCAN2
+  uint16_t aux;
+  uint32_t arg;
+} trace_event_t;
+
+typedef struct {
+  uint32_t magic;             // TRACE_STREAM_MAGIC
+  uint32_t clock_hz;          // timestamp frequency
+  uint16_t count;             // events following the header
+  uint16_t lost;              // events overwritten before they could be sent, saturates
+} trace_block_t;
+
+typedef struct {
+  volatile uint32_t head;     // events ever reserved
+  uint32_t tail;              // next event for trace_flush()
+  trace_event_t ev[TRACE_RING_EVENTS];
+} trace_ring_t;
+
+#ifdef TRACE_ENABLE
+
+extern trace_ring_t trace_ring;
+
+static inline void trace_emit(uint8_t id, uint8_t unit, uint16_t aux, uint32_t arg) {
+  uint32_t i = __atomic_fetch_add(&trace_ring.head, 1, __ATOMIC_RELAXED);
+  trace_event_t *e = &trace_ring.ev[i & (TRACE_RING_EVENTS - 1U)];
+
+  e->cycles = TRACE_CLOCK();
+  e->id = id;
+  e->unit = unit;
+  e->aux = aux;
+  e->arg = arg;
+}
+
+#define TRACE(id, unit, aux, arg)  trace_emit((id), (uint8_t)(unit), (uint16_t)(aux), (uint32_t)(arg))
+
+/**
+ * @brief Empty the ring; the file back end also truncates TRACE_FILE.
+ */
+void trace_init(void);
+
+/**
+ * @brief Send the events recorded since the last flush (UART, file back
+ * ends), at most 'max' of them, 0 for all. Thread context only: it must
+ * not preempt a writer. Does nothing with the RAM back end.
+ * @return Number of events sent.
+ */
+uint32_t trace_flush(uint32_t max);
+
+/**
+ * @brief Copy the most recent events that fit in 'len' bytes as one block,
+ * oldest first, whatever the back end. Thread context only.
+ * @return Bytes written, 0 if len cannot hold a header.
+ */
+uint32_t trace_export(uint8_t *buf, uint32_t len);
+
+#else
+
+#define TRACE(id, unit, aux, arg)  ((void)0)
+
+#endif
+
+#define TRACE_ISR_ENTER(irqn)      TRACE(TRACE_EV_ISR_ENTER, 0, (irqn) + 16, 0)
+#define TRACE_ISR_EXIT(irqn)       TRACE(TRACE_EV_ISR_EXIT, 0, (irqn) + 16, 0)
+#define TRACE_MARK(aux, arg)       TRACE(TRACE_EV_MARK, 0, (aux), (arg))
+
+#endif
@@ -34,4 +34,22 @@ bool usart_data_available(USART_t *usart);
  */
 char usart_receive_char(USART_t *usart);
 
+/**
+ * @brief Enable the 8-byte TX/RX hardware FIFOs (FIFOEN).
+ * Call after usart_setup(); ISR TXE/RXNE then mean FIFO not full/not empty.
+ */
+void usart_enable_fifo(USART_t *usart);
+
+/**
+ * @brief Non-blocking write, stops when the transmitter is full.
+ * @return Number of bytes accepted.
+ */
+uint32_t usart_write(USART_t *usart, const uint8_t *buf, uint32_t len);
+
+/**
+ * @brief Non-blocking read of whatever has been received.
+ * @return Number of bytes stored in buf.
+ */
+uint32_t usart_read(USART_t *usart, uint8_t *buf, uint32_t max);
+
 #endif
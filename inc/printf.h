@@ -33,7 +33,9 @@
 #define _PRINTF_H_
 
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 
 #ifdef __cplusplus
@@ -109,9 +111,323 @@ int vprintf_(const char* format, va_list va);
 int fctprintf(void (*out)(char character, void* arg), void* arg, const char* format, ...);
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Pre-parsed format strings
+//
+// A literal format is decoded once into an array of printf_spec_t steps. Each
+// step emits a run of literal characters taken straight from the format string,
+// followed by one already-decoded conversion. Hot call sites then skip the
+// flag/width/precision/length parsing that _vsnprintf() redoes on every call.
+//
+// C++ (C++14 or later): the spec array is built by the compiler and lands in flash
+//   PRINTF_FMT_DEFINE(can_rx_fmt, "RX ID: 0x%03X, Len: %u\r\n", 3);
+//   printf_fmt_(&can_rx_fmt, id, len);
+//
+// C: the same macro reserves the spec array, which is parsed once at init
+//   PRINTF_FMT_DEFINE(can_rx_fmt, "RX ID: 0x%03X, Len: %u\r\n", 3);
+//   PRINTF_FMT_COMPILE(can_rx_fmt);
+//   printf_fmt_(&can_rx_fmt, id, len);
+// Tables generated offline can also be written directly into flash with PRINTF_SPEC().
+///////////////////////////////////////////////////////////////////////////////
+
+// conversion step kinds
+#define PRINTF_CONV_END       0U   // emit trailing literal run and stop
+#define PRINTF_CONV_SIGNED    1U   // %d %i
+#define PRINTF_CONV_UNSIGNED  2U   // %u %x %X %o %b, radix in 'base'
+#define PRINTF_CONV_FLOAT     3U   // %f %F, emitted as the bare specifier without float support
+#define PRINTF_CONV_EXP       4U   // %e %E %g %G, likewise without exponential support
+#define PRINTF_CONV_CHAR      5U   // %c
+#define PRINTF_CONV_STRING    6U   // %s
+#define PRINTF_CONV_POINTER   7U   // %p
+#define PRINTF_CONV_LITERAL   8U   // %% and unknown specifiers, character in 'base'
+
+// conversion flags, same bit layout as the internal flags of printf.c
+#define PRINTF_FLAG_ZEROPAD   (1U <<  0U)
+#define PRINTF_FLAG_LEFT      (1U <<  1U)
+#define PRINTF_FLAG_PLUS      (1U <<  2U)
+#define PRINTF_FLAG_SPACE     (1U <<  3U)
+#define PRINTF_FLAG_HASH      (1U <<  4U)
+#define PRINTF_FLAG_UPPERCASE (1U <<  5U)
+#define PRINTF_FLAG_CHAR      (1U <<  6U)
+#define PRINTF_FLAG_SHORT     (1U <<  7U)
+#define PRINTF_FLAG_LONG      (1U <<  8U)
+#define PRINTF_FLAG_LONG_LONG (1U <<  9U)
+#define PRINTF_FLAG_PRECISION (1U << 10U)
+#define PRINTF_FLAG_ADAPT_EXP (1U << 11U)
+#define PRINTF_FLAG_WIDTH_ARG (1U << 12U)  // width is taken from the argument list ('*')
+#define PRINTF_FLAG_PREC_ARG  (1U << 13U)  // precision is taken from the argument list ('.*')
+
+
+/**
+ * One pre-decoded step of a format string (10 bytes)
+ */
+typedef struct {
+  uint16_t lit_pos;     // offset of the literal run inside the format string
+  uint16_t lit_len;     // length of the literal run emitted before the conversion
+  uint16_t flags;       // PRINTF_FLAG_* bits
+  uint8_t  width;       // field width
+  uint8_t  precision;   // precision
+  uint8_t  conv;        // PRINTF_CONV_* kind
+  uint8_t  base;        // radix for integer conversions, specifier character otherwise
+} printf_spec_t;
+
+
+/**
+ * A format string together with its pre-decoded steps
+ */
+typedef struct {
+  const char*          format;  // original format, literal runs are copied from here
+  const printf_spec_t* specs;   // steps, terminated by a PRINTF_CONV_END entry
+} printf_fmt_t;
+
+
+/**
+ * Initializer for a hand-written or generated printf_spec_t table
+ */
+#define PRINTF_SPEC(lit_pos, lit_len, conv, base, flags, width, precision) \
+  { (uint16_t)(lit_pos), (uint16_t)(lit_len), (uint16_t)(flags), (uint8_t)(width), (uint8_t)(precision), (uint8_t)(conv), (uint8_t)(base) }
+
+
+/**
+ * printf/snprintf/fctprintf variants executing a pre-parsed format
+ * \param fmt A format built with PRINTF_FMT_DEFINE() or a PRINTF_SPEC() table
+ * \return Same as the non pre-parsed counterparts
+ */
+int printf_fmt_(const printf_fmt_t* fmt, ...);
+int snprintf_fmt_(char* buffer, size_t count, const printf_fmt_t* fmt, ...);
+int vsnprintf_fmt_(char* buffer, size_t count, const printf_fmt_t* fmt, va_list va);
+int fctprintf_fmt(void (*out)(char character, void* arg), void* arg, const printf_fmt_t* fmt, ...);
+
+
 #ifdef __cplusplus
 }
 #endif
 
 
-#endif  // _PRINTF_H_
+#ifdef __cplusplus
+#define PRINTF_CONSTEXPR constexpr
+#else
+#define PRINTF_CONSTEXPR static inline
+#endif
+
+
+/**
+ * Parse a format string into printf_spec_t steps
+ * Evaluated by the compiler when used from PRINTF_FMT_DEFINE() in C++
+ * \param format The format string, it must outlive the produced steps
+ * \param specs Output array
+ * \param count Number of entries available in specs
+ * \return The number of entries used including the terminating PRINTF_CONV_END step,
+ *         or -1 if specs is too small or a width/precision does not fit in 8 bit
+ */
+PRINTF_CONSTEXPR int printf_compile(const char* format, printf_spec_t* specs, size_t count)
+{
+  size_t pos = 0U, lit = 0U, n = 0U;
+
+  while (n < count) {
+    printf_spec_t* spec = &specs[n++];
+    unsigned int flags = 0U, width = 0U, precision = 0U;
+    bool more = true;
+
+    // collect the literal run up to the next conversion
+    lit = pos;
+    while ((format[pos] != '\0') && (format[pos] != '%')) {
+      pos++;
+    }
+    spec->lit_pos   = (uint16_t)lit;
+    spec->lit_len   = (uint16_t)(pos - lit);
+    spec->flags     = 0U;
+    spec->width     = 0U;
+    spec->precision = 0U;
+    spec->base      = 0U;
+    spec->conv      = PRINTF_CONV_END;
+    if (format[pos] == '\0') {
+      return (int)n;
+    }
+    pos++;
+
+    // flags
+    while (more) {
+      switch (format[pos]) {
+        case '0': flags |= PRINTF_FLAG_ZEROPAD; pos++; break;
+        case '-': flags |= PRINTF_FLAG_LEFT;    pos++; break;
+        case '+': flags |= PRINTF_FLAG_PLUS;    pos++; break;
+        case ' ': flags |= PRINTF_FLAG_SPACE;   pos++; break;
+        case '#': flags |= PRINTF_FLAG_HASH;    pos++; break;
+        default : more = false;                        break;
+      }
+    }
+
+    // width
+    if (format[pos] == '*') {
+      flags |= PRINTF_FLAG_WIDTH_ARG;
+      pos++;
+    }
+    while ((format[pos] >= '0') && (format[pos] <= '9')) {
+      width = width * 10U + (unsigned int)(format[pos++] - '0');
+    }
+
+    // precision
+    if (format[pos] == '.') {
+      flags |= PRINTF_FLAG_PRECISION;
+      pos++;
+      if (format[pos] == '*') {
+        flags |= PRINTF_FLAG_PREC_ARG;
+        pos++;
+      }
+      while ((format[pos] >= '0') && (format[pos] <= '9')) {
+        precision = precision * 10U + (unsigned int)(format[pos++] - '0');
+      }
+    }
+
+    if ((width > 0xFFU) || (precision > 0xFFU)) {
+      return -1;
+    }
+
+    // length
+    switch (format[pos]) {
+      case 'l' :
+        flags |= PRINTF_FLAG_LONG;
+        pos++;
+        if (format[pos] == 'l') {
+          flags |= PRINTF_FLAG_LONG_LONG;
+          pos++;
+        }
+        break;
+      case 'h' :
+        flags |= PRINTF_FLAG_SHORT;
+        pos++;
+        if (format[pos] == 'h') {
+          flags |= PRINTF_FLAG_CHAR;
+          pos++;
+        }
+        break;
+      case 't' :
+        flags |= (sizeof(ptrdiff_t) == sizeof(long) ? PRINTF_FLAG_LONG : PRINTF_FLAG_LONG_LONG);
+        pos++;
+        break;
+      case 'j' :
+        flags |= (sizeof(intmax_t) == sizeof(long) ? PRINTF_FLAG_LONG : PRINTF_FLAG_LONG_LONG);
+        pos++;
+        break;
+      case 'z' :
+        flags |= (sizeof(size_t) == sizeof(long) ? PRINTF_FLAG_LONG : PRINTF_FLAG_LONG_LONG);
+        pos++;
+        break;
+      default :
+        break;
+    }
+
+    // specifier, pre-applying the flag adjustments _vsnprintf() does per call
+    switch (format[pos]) {
+      case 'd' :
+      case 'i' :
+        spec->conv = PRINTF_CONV_SIGNED;
+        spec->base = 10U;
+        flags &= ~PRINTF_FLAG_HASH;
+        break;
+      case 'u' :
+      case 'x' :
+      case 'X' :
+      case 'o' :
+      case 'b' :
+        spec->conv = PRINTF_CONV_UNSIGNED;
+        spec->base = (format[pos] == 'u') ? 10U : (format[pos] == 'o') ? 8U : (format[pos] == 'b') ? 2U : 16U;
+        if (format[pos] == 'u') {
+          flags &= ~PRINTF_FLAG_HASH;
+        }
+        if (format[pos] == 'X') {
+          flags |= PRINTF_FLAG_UPPERCASE;
+        }
+        flags &= ~(PRINTF_FLAG_PLUS | PRINTF_FLAG_SPACE);
+        break;
+      case 'f' :
+      case 'F' :
+        spec->conv = PRINTF_CONV_FLOAT;
+        spec->base = (uint8_t)format[pos];
+        if (format[pos] == 'F') flags |= PRINTF_FLAG_UPPERCASE;
+        break;
+      case 'e' :
+      case 'E' :
+      case 'g' :
+      case 'G' :
+        spec->conv = PRINTF_CONV_EXP;
+        spec->base = (uint8_t)format[pos];
+        if ((format[pos] == 'g') || (format[pos] == 'G')) flags |= PRINTF_FLAG_ADAPT_EXP;
+        if ((format[pos] == 'E') || (format[pos] == 'G')) flags |= PRINTF_FLAG_UPPERCASE;
+        break;
+      case 'c' :
+        spec->conv = PRINTF_CONV_CHAR;
+        break;
+      case 's' :
+        spec->conv = PRINTF_CONV_STRING;
+        break;
+      case 'p' :
+        spec->conv = PRINTF_CONV_POINTER;
+        spec->base = 16U;
+        width = sizeof(void*) * 2U;
+        flags |= PRINTF_FLAG_ZEROPAD | PRINTF_FLAG_UPPERCASE;
+        break;
+      case '\0' :
+        // dangling '%': _vsnprintf() stops here as well
+        return (int)n;
+      default :
+        spec->conv = PRINTF_CONV_LITERAL;
+        spec->base = (uint8_t)format[pos];
+        break;
+    }
+    pos++;
+
+    // ignore '0' flag when precision is given
+    if (((spec->conv == PRINTF_CONV_SIGNED) || (spec->conv == PRINTF_CONV_UNSIGNED)) && (flags & PRINTF_FLAG_PRECISION)) {
+      flags &= ~PRINTF_FLAG_ZEROPAD;
+    }
+
+    spec->flags     = (uint16_t)flags;
+    spec->width     = (uint8_t)width;
+    spec->precision = (uint8_t)precision;
+  }
+
+  return -1;
+}
+
+
+#ifdef __cplusplus
+
+template <size_t N>
+struct printf_fmt_storage {
+  printf_spec_t specs[N];
+};
+
+// never defined: reaching it in a constant expression is the compile error (no throw under -fno-exceptions)
+void printf_fmt_does_not_fit_its_spec_array(void);
+
+template <size_t N>
+constexpr printf_fmt_storage<N> printf_fmt_build(const char* format)
+{
+  printf_fmt_storage<N> storage {};
+  if (printf_compile(format, storage.specs, N) < 0) {
+    printf_fmt_does_not_fit_its_spec_array();
+  }
+  return storage;
+}
+
+#define PRINTF_FMT_DEFINE(name, literal, n) \
+  static constexpr printf_fmt_storage<(n)> name##_specs_ = printf_fmt_build<(n)>(literal); \
+  static constexpr printf_fmt_t name = { literal, name##_specs_.specs }
+
+#define PRINTF_FMT_COMPILE(name) (0)
+
+#else
+
+#define PRINTF_FMT_DEFINE(name, literal, n) \
+  static printf_spec_t name##_specs_[(n)]; \
+  static const printf_fmt_t name = { literal, name##_specs_ }
+
+#define PRINTF_FMT_COMPILE(name) \
+  printf_compile((name).format, name##_specs_, sizeof(name##_specs_) / sizeof(name##_specs_[0]))
+
+#endif
+
+
+#endif  // _PRINTF_H_
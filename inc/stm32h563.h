@@ -13,6 +13,14 @@
 #define PINNO(pin)          ((pin) & 0x00FF)
 #define PINBANK(pin)        ((pin) >> 8)
 
+/*
+ * Place a function in SRAM (.ramfunc, copied by the startup code).
+ * Calls from flash reach it through linker-generated long-branch veneers.
+ */
+#ifndef RAMFUNC
+#define RAMFUNC             __attribute__((section(".ramfunc"), noinline))
+#endif
+
 /* ========================================================================== */
 /* REGISTER DEFINITIONS                             */
 /* ========================================================================== */
@@ -121,6 +129,90 @@ typedef struct {
     volatile uint32_t CALIB;
 } SysTick_t;
 
+/* --- DWT Registers --- */
+typedef struct {
+    volatile uint32_t CTRL;      // Control
+    volatile uint32_t CYCCNT;    // Cycle Count
+    volatile uint32_t CPICNT;
+    volatile uint32_t EXCCNT;
+    volatile uint32_t SLEEPCNT;
+    volatile uint32_t LSUCNT;
+    volatile uint32_t FOLDCNT;
+    volatile uint32_t PCSR;
+} DWT_t;
+
+/* --- Debug Control Block Registers --- */
+typedef struct {
+    volatile uint32_t DHCSR;
+    volatile uint32_t DCRSR;
+    volatile uint32_t DCRDR;
+    volatile uint32_t DEMCR;     // Debug Exception and Monitor Control
+} DCB_t;
+
+/* --- NVIC Registers --- */
+typedef struct {
+    volatile uint32_t ISER[16];  // Interrupt Set Enable
+    uint32_t          RESERVED0[16];
+    volatile uint32_t ICER[16];  // Interrupt Clear Enable
+    uint32_t          RESERVED1[16];
+    volatile uint32_t ISPR[16];  // Interrupt Set Pending
+    uint32_t          RESERVED2[16];
+    volatile uint32_t ICPR[16];  // Interrupt Clear Pending
+    uint32_t          RESERVED3[16];
+    volatile uint32_t IABR[16];  // Interrupt Active Bit
+    uint32_t          RESERVED4[16];
+    volatile uint32_t ITNS[16];  // Interrupt Target Non-secure
+    uint32_t          RESERVED5[16];
+    volatile uint8_t  IPR[496];  // Interrupt Priority (one byte per IRQ)
+} NVIC_t;
+
+/* --- SCB Registers --- */
+typedef struct {
+    volatile uint32_t CPUID;
+    volatile uint32_t ICSR;
+    volatile uint32_t VTOR;      // Vector Table Offset
+    volatile uint32_t AIRCR;
+    volatile uint32_t SCR;
+    volatile uint32_t CCR;
+    volatile uint8_t  SHPR[12];  // System Handler Priority (exceptions 4..15)
+    volatile uint32_t SHCSR;
+} SCB_t;
+
+/* --- PWR Registers --- */
+typedef struct {
+    volatile uint32_t PMCR;
+    volatile uint32_t PMSR;
+    uint32_t          RESERVED0[2];
+    volatile uint32_t VOSCR;  // Voltage Scaling Control
+    volatile uint32_t VOSSR;  // Voltage Scaling Status
+} PWR_t;
+
+/* --- FLASH Registers --- */
+typedef struct {
+    volatile uint32_t ACR;    // Access Control Register
+    volatile uint32_t NSKEYR;
+    volatile uint32_t SECKEYR;
+    volatile uint32_t OPTKEYR;
+    volatile uint32_t NSOBKKEYR;
+    volatile uint32_t SECOBKKEYR;
+    volatile uint32_t OPSR;
+    volatile uint32_t OPTCR;
+    volatile uint32_t NSSR;
+    volatile uint32_t SECSR;
+    volatile uint32_t NSCR;
+    volatile uint32_t SECCR;
+} FLASH_t;
+
+/* --- ICACHE Registers --- */
+typedef struct {
+    volatile uint32_t CR;
+    volatile uint32_t SR;
+    volatile uint32_t IER;
+    volatile uint32_t FCR;
+    volatile uint32_t HMONR;
+    volatile uint32_t MMONR;
+} ICACHE_t;
+
 /* --- FDCAN Registers (Added for your Project) --- */
 typedef struct {
     volatile uint32_t CREL;   // Core Release Register
@@ -169,6 +261,34 @@ typedef struct {
     volatile uint32_t CKDIV;
 } FDCAN_t;
 
+/* ========================================================================== */
+/* INTERRUPT NUMBERS                                */
+/* ========================================================================== */
+
+#define NVIC_PRIO_BITS      4U    // implemented priority bits
+#define IRQ_COUNT           131   // device interrupts (WWDG .. LPTIM6)
+
+typedef enum {
+    NonMaskableInt_IRQn = -14,
+    HardFault_IRQn      = -13,
+    MemoryManagement_IRQn = -12,
+    BusFault_IRQn       = -11,
+    UsageFault_IRQn     = -10,
+    SecureFault_IRQn    = -9,
+    SVCall_IRQn         = -5,
+    DebugMonitor_IRQn   = -4,
+    PendSV_IRQn         = -2,
+    SysTick_IRQn        = -1,
+    WWDG_IRQn           = 0,
+    FDCAN1_IT0_IRQn     = 39,
+    FDCAN1_IT1_IRQn     = 40,
+    TIM2_IRQn           = 45,
+    TIM5_IRQn           = 48,
+    USART3_IRQn         = 60,
+    FDCAN2_IT0_IRQn     = 109,
+    FDCAN2_IT1_IRQn     = 110
+} IRQn_t;
+
 /* ========================================================================== */
 /* MEMORY MAP                                     */
 /* ========================================================================== */
@@ -180,12 +300,39 @@ typedef struct {
 #define AHB2_BASE           0x42020000UL
 #define AHB4_BASE           0x44020000UL
 
+/*
+ * Instances (and the GPIO/FDCAN message RAM bases) can be redirected to
+ * simulated register blocks for host builds, e.g. -DRCC=(&sim_rcc).
+ */
+
 /* RCC */
 #define RCC_BASE            (AHB4_BASE + 0x0C00UL)
+#ifndef RCC
 #define RCC                 ((RCC_t *) RCC_BASE)
+#endif
+
+/* PWR */
+#define PWR_BASE            (AHB4_BASE + 0x0800UL)
+#ifndef PWR
+#define PWR                 ((PWR_t *) PWR_BASE)
+#endif
+
+/* FLASH interface */
+#define FLASH_R_BASE        (AHB1_BASE + 0x2000UL)
+#ifndef FLASH
+#define FLASH               ((FLASH_t *) FLASH_R_BASE)
+#endif
+
+/* ICACHE */
+#define ICACHE_BASE         (AHB1_BASE + 0x10400UL)
+#ifndef ICACHE
+#define ICACHE              ((ICACHE_t *) ICACHE_BASE)
+#endif
 
 /* GPIO */
+#ifndef GPIO_BASE
 #define GPIO_BASE           (AHB2_BASE)
+#endif
 #define GPIO_PORT_OFFSET    0x0400UL
 #define GPIO(bank)          ((GPIO_t *) (GPIO_BASE + (GPIO_PORT_OFFSET * (bank))))
 
@@ -194,19 +341,51 @@ typedef struct {
 #define USART2_BASE         (APB1_BASE + 0x4400UL)
 #define USART3_BASE         (APB1_BASE + 0x4800UL) // 0x40004800
 
+#ifndef USART1
 #define USART1              ((USART_t *) USART1_BASE)
 #define USART2              ((USART_t *) USART2_BASE)
 #define USART3              ((USART_t *) USART3_BASE)
+#endif
 
 /* SysTick */
 #define SYSTICK_BASE        0xE000E010UL
+#ifndef SysTick
 #define SysTick             ((SysTick_t *) SYSTICK_BASE)
+#endif
+
+/* DWT */
+#define DWT_BASE            0xE0001000UL
+#ifndef DWT
+#define DWT                 ((DWT_t *) DWT_BASE)
+#endif
+
+/* Debug Control Block */
+#define DCB_BASE            0xE000EDF0UL
+#ifndef DCB
+#define DCB                 ((DCB_t *) DCB_BASE)
+#endif
+
+/* NVIC */
+#define NVIC_BASE           0xE000E100UL
+#ifndef NVIC
+#define NVIC                ((NVIC_t *) NVIC_BASE)
+#endif
+
+/* SCB */
+#define SCB_BASE            0xE000ED00UL
+#ifndef SCB
+#define SCB                 ((SCB_t *) SCB_BASE)
+#endif
 
 /* FDCAN */
+#ifndef FDCAN_SRAM_BASE
 #define FDCAN_SRAM_BASE     (0x4000AC00UL)
+#endif
 #define FDCAN1_BASE         (0x4000A400UL)
 #define FDCAN2_BASE         (0x4000A800UL)
+#ifndef FDCAN1
 #define FDCAN1              ((FDCAN_t *) FDCAN1_BASE)
 #define FDCAN2              ((FDCAN_t *) FDCAN2_BASE)
+#endif
 
 #endif /* STM32H563_H */
@@ -0,0 +1,207 @@
+#include <stddef.h>
+#include <string.h>
+#include "can/can_autobaud.h"
+
+#define AUTOBAUD_CONFIRM            2U
+#define AUTOBAUD_WINDOW_US          5000U
+#define AUTOBAUD_WINDOW_SCALE_MAX   8U
+#define AUTOBAUD_WINDOW_INTERVALS   3U
+#define AUTOBAUD_DATA_WINDOW_US     20000U
+#define AUTOBAUD_DATA_INTERVALS     16U
+#define AUTOBAUD_TIMEOUT_US         1000000U
+
+/* Most common first: vehicle and industrial buses, then the slow CANopen rates */
+static const uint32_t autobaud_nominal[] = {
+  500000, 250000, 1000000, 125000, 800000, 100000, 50000, 20000, 10000
+};
+static const uint32_t autobaud_data[] = {
+  2000000, 5000000, 4000000, 1000000, 8000000
+};
+
+static uint32_t _autobaud_data_bps(const can_autobaud_t *ab) {
+  return ab->cfg.fd ? ab->cfg.data[ab->data_index] : 0;
+}
+
+/* Configure candidate ab->index or the next one the port accepts, 1 after the last */
+static int _autobaud_configure(can_autobaud_t *ab, uint64_t now) {
+  for (; ab->index < ab->order_count; ab->index++) {
+    if (ab->port->configure(ab->ctx, ab->order[ab->index], _autobaud_data_bps(ab)) == 0) {
+      ab->result.candidates++;
+      ab->confirmed = 0;
+      ab->brs_seen = 0;
+      ab->data_errors_seen = 0;
+      ab->candidate_us = now;
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+static void _autobaud_next(can_autobaud_t *ab, uint64_t now) {
+  ab->index++;
+  if (_autobaud_configure(ab, now) == 0) return;
+
+  // end of a pass: a quiet bus gets longer windows
+  if (!ab->evidence && ab->window_us < ab->cfg.window_us * AUTOBAUD_WINDOW_SCALE_MAX) {
+    ab->window_us *= 2;
+  }
+  ab->evidence = false;
+  ab->index = 0;
+  if (_autobaud_configure(ab, now) != 0) ab->state = CAN_AUTOBAUD_FAILED;
+}
+
+/* Any frame, good or not, tells how busy the bus is: windows cover a few frame intervals */
+static void _autobaud_interval(can_autobaud_t *ab, uint64_t now) {
+  uint32_t d;
+
+  if (ab->last_event_us != 0) {
+    d = (uint32_t)(now - ab->last_event_us);
+    ab->interval_us = (ab->interval_us == 0) ? d : (3 * ab->interval_us + d) / 4;
+  }
+  ab->last_event_us = now;
+}
+
+static uint32_t _autobaud_window(const can_autobaud_t *ab) {
+  uint32_t w = AUTOBAUD_WINDOW_INTERVALS * ab->interval_us;
+  uint32_t min = ab->window_us;
+
+  // a good frame at a wrong rate is next to impossible: wait longer for the confirmation
+  if (ab->confirmed != 0) min = ab->cfg.window_us * AUTOBAUD_WINDOW_SCALE_MAX;
+
+  return (w > min) ? w : min;
+}
+
+static void _autobaud_done(can_autobaud_t *ab, can_autobaud_state_t state, uint64_t now) {
+  ab->state = state;
+  ab->result.total_us = (uint32_t)(now - ab->start_us);
+  if (state == CAN_AUTOBAUD_FAILED) {
+    ab->result.nominal_bps = 0;
+    ab->result.data_bps = 0;
+  }
+}
+
+int can_autobaud_init(can_autobaud_t *ab, const can_autobaud_config_t *cfg, const can_autobaud_port_t *port,
+                      void *ctx) {
+  uint32_t i;
+
+  if (ab == NULL || cfg == NULL || port == NULL) return 1;
+
+  memset(ab, 0, sizeof(*ab));
+  ab->port = port;
+  ab->ctx = ctx;
+  ab->cfg = *cfg;
+  if (ab->cfg.nominal == NULL) {
+    ab->cfg.nominal = autobaud_nominal;
+    ab->cfg.nominal_count = sizeof(autobaud_nominal) / sizeof(autobaud_nominal[0]);
+  }
+  if (ab->cfg.data == NULL) {
+    ab->cfg.data = autobaud_data;
+    ab->cfg.data_count = sizeof(autobaud_data) / sizeof(autobaud_data[0]);
+  }
+  if (ab->cfg.confirm == 0) ab->cfg.confirm = AUTOBAUD_CONFIRM;
+  if (ab->cfg.window_us == 0) ab->cfg.window_us = AUTOBAUD_WINDOW_US;
+  if (ab->cfg.data_window_us == 0) ab->cfg.data_window_us = AUTOBAUD_DATA_WINDOW_US;
+  if (ab->cfg.timeout_us == 0) ab->cfg.timeout_us = AUTOBAUD_TIMEOUT_US;
+
+  if (ab->cfg.nominal_count == 0 || ab->cfg.nominal_count > CAN_AUTOBAUD_MAX_CANDIDATES - 1) return 1;
+  if (ab->cfg.fd && ab->cfg.data_count == 0) return 1;
+
+  if (ab->cfg.hint_bps != 0) ab->order[ab->order_count++] = ab->cfg.hint_bps;
+  for (i = 0; i < ab->cfg.nominal_count; i++) {
+    if (ab->cfg.nominal[i] != ab->cfg.hint_bps) ab->order[ab->order_count++] = ab->cfg.nominal[i];
+  }
+
+  ab->window_us = ab->cfg.window_us;
+  ab->start_us = port->now_us(ctx);
+  ab->state = CAN_AUTOBAUD_NOMINAL;
+  if (_autobaud_configure(ab, ab->start_us) != 0) {
+    _autobaud_done(ab, CAN_AUTOBAUD_FAILED, ab->start_us);
+  }
+
+  return 0;
+}
+
+static void _autobaud_data_next(can_autobaud_t *ab, uint64_t now) {
+  ab->candidate_us = now;
+
+  // an exhausted table leaves the data rate unknown, the nominal lock stands
+  while (++ab->data_index < ab->cfg.data_count) {
+    if (ab->port->configure(ab->ctx, ab->result.nominal_bps, ab->cfg.data[ab->data_index]) == 0) {
+      ab->result.candidates++;
+      return;
+    }
+  }
+  _autobaud_done(ab, CAN_AUTOBAUD_LOCKED, now);
+}
+
+int can_autobaud_poll(can_autobaud_t *ab) {
+  can_autobaud_evidence_t ev;
+  uint64_t now;
+
+  if (ab->state == CAN_AUTOBAUD_LOCKED || ab->state == CAN_AUTOBAUD_FAILED) return 1;
+
+  ab->port->sample(ab->ctx, &ev);
+  now = ab->port->now_us(ab->ctx);
+
+  if (ab->state == CAN_AUTOBAUD_NOMINAL) {
+    if (ev.errors != 0 || ev.frames != 0 || ev.data_errors != 0) _autobaud_interval(ab, now);
+
+    if (ev.errors != 0) {
+      ab->evidence = true;
+      ab->result.rejected++;
+      _autobaud_next(ab, now);
+    } else if (ev.frames != 0 || ev.data_errors != 0) {
+      // a data phase error still means arbitration and control field decoded at this rate
+      ab->evidence = true;
+      ab->confirmed += ev.frames + ev.data_errors;
+      ab->brs_seen += ev.brs_frames;
+      ab->data_errors_seen += ev.data_errors;
+      ab->candidate_us = now;
+      if (ab->confirmed >= ab->cfg.confirm) {
+        ab->result.nominal_bps = ab->order[ab->index];
+        ab->result.lock_us = (uint32_t)(now - ab->start_us);
+        if (!ab->cfg.fd) {
+          _autobaud_done(ab, CAN_AUTOBAUD_LOCKED, now);
+        } else if (ab->data_errors_seen != 0) {
+          ab->state = CAN_AUTOBAUD_DATA;
+          _autobaud_data_next(ab, now);
+        } else if (ab->brs_seen != 0) {
+          // the first data candidate already carried BRS frames
+          ab->result.data_bps = ab->cfg.data[ab->data_index];
+          _autobaud_done(ab, CAN_AUTOBAUD_LOCKED, now);
+        } else {
+          ab->state = CAN_AUTOBAUD_DATA;
+        }
+      }
+    } else if (now - ab->candidate_us >= _autobaud_window(ab)) {
+      _autobaud_next(ab, now);
+    }
+  } else {
+    if (ev.frames != 0 || ev.data_errors != 0) _autobaud_interval(ab, now);
+
+    if (ev.data_errors != 0) {
+      ab->data_errors_seen += ev.data_errors;
+      _autobaud_data_next(ab, now);
+    } else if (ev.brs_frames != 0) {
+      ab->result.data_bps = ab->cfg.data[ab->data_index];
+      _autobaud_done(ab, CAN_AUTOBAUD_LOCKED, now);
+    } else if (now - ab->candidate_us >= ab->cfg.data_window_us &&
+               (ab->data_errors_seen == 0 || now - ab->candidate_us >= AUTOBAUD_DATA_INTERVALS * ab->interval_us)) {
+      // a slow bus gets more intervals only once BRS traffic is known to exist
+      _autobaud_done(ab, CAN_AUTOBAUD_LOCKED, now);
+    }
+  }
+
+  if (ab->state == CAN_AUTOBAUD_FAILED) {
+    _autobaud_done(ab, CAN_AUTOBAUD_FAILED, now);
+  } else if (ab->state == CAN_AUTOBAUD_NOMINAL && now - ab->start_us >= ab->cfg.timeout_us) {
+    _autobaud_done(ab, CAN_AUTOBAUD_FAILED, now);
+  }
+
+  return (ab->state == CAN_AUTOBAUD_LOCKED || ab->state == CAN_AUTOBAUD_FAILED) ? 1 : 0;
+}
+
+void can_autobaud_get_result(const can_autobaud_t *ab, can_autobaud_result_t *result) {
+  *result = ab->result;
+}
@@ -0,0 +1,114 @@
+#include <stddef.h>
+#include "can/can_autobaud_fdcan.h"
+#include "rcc.h"
+#include "timebase.h"
+
+#define AUTOBAUD_NOMINAL_SP_PERMILLE  875U
+#define AUTOBAUD_DATA_SP_PERMILLE     750U
+#define AUTOBAUD_LEC_NONE             0U
+#define AUTOBAUD_LEC_NO_CHANGE        7U
+
+/* Bit timing into fdcan->Init, the data phase fields only with a data rate */
+static int _autobaud_fdcan_timing(FDCAN_Handle_t *fdcan, uint32_t nominal_bps, uint32_t data_bps) {
+  FDCAN_BitTiming_t nominal, data;
+  uint32_t clk = rcc_get_fdcan_clk_hz();
+
+  if (fdcan_calc_bittiming(clk, nominal_bps, AUTOBAUD_NOMINAL_SP_PERMILLE, false, &nominal) != 0) return 1;
+  if (data_bps != 0 && fdcan_calc_bittiming(clk, data_bps, AUTOBAUD_DATA_SP_PERMILLE, true, &data) != 0) return 1;
+
+  fdcan->Init.NominalPrescaler = nominal.Prescaler;
+  fdcan->Init.NominalSyncJumpWidth = nominal.SyncJumpWidth;
+  fdcan->Init.NominalTimeSeg1 = nominal.TimeSeg1;
+  fdcan->Init.NominalTimeSeg2 = nominal.TimeSeg2;
+  if (data_bps != 0) {
+    fdcan->Init.FDMode = true;
+    fdcan->Init.DataPrescaler = data.Prescaler;
+    fdcan->Init.DataSyncJumpWidth = data.SyncJumpWidth;
+    fdcan->Init.DataTimeSeg1 = data.TimeSeg1;
+    fdcan->Init.DataTimeSeg2 = data.TimeSeg2;
+  }
+
+  return 0;
+}
+
+static int _autobaud_fdcan_configure(void *ctx, uint32_t nominal_bps, uint32_t data_bps) {
+  FDCAN_Handle_t *fdcan = ctx;
+
+  if (_autobaud_fdcan_timing(fdcan, nominal_bps, data_bps) != 0) return 1;
+
+  fdcan->Init.FDMode = (data_bps != 0);
+  fdcan->Init.BusMonitor = true;
+  fdcan->Init.Loopback = false;
+  fdcan->Init.StdFiltersNbr = 0;  // non-matching frames are accepted into FIFO0
+  fdcan->Init.ExtFiltersNbr = 0;
+  fdcan->Init.TxQueue = false;
+  fdcan_init(fdcan);
+
+  // evidence from the previous candidate must not carry over
+  (void)fdcan->Instance->PSR;
+  fdcan->Instance->IR = FDCAN_IT_ARB_PROTOCOL_ERROR | FDCAN_IT_DATA_PROTOCOL_ERROR;
+
+  return 0;
+}
+
+static void _autobaud_fdcan_sample(void *ctx, can_autobaud_evidence_t *ev) {
+  FDCAN_Handle_t *fdcan = ctx;
+  uint32_t psr, ir, lec, dlec, level, i;
+  const uint32_t *element;
+
+  // PEA/PED latch any error since the last sample, PSR only the last code (read sets it to 7)
+  ir = fdcan->Instance->IR & (FDCAN_IT_ARB_PROTOCOL_ERROR | FDCAN_IT_DATA_PROTOCOL_ERROR);
+  fdcan->Instance->IR = ir;
+  psr = fdcan->Instance->PSR;
+  lec = psr & 0x7U;
+  dlec = (psr >> 8) & 0x7U;
+
+  ev->errors = ((ir & FDCAN_IT_ARB_PROTOCOL_ERROR) || (lec != AUTOBAUD_LEC_NONE && lec != AUTOBAUD_LEC_NO_CHANGE));
+  ev->data_errors = ((ir & FDCAN_IT_DATA_PROTOCOL_ERROR) ||
+                     (dlec != AUTOBAUD_LEC_NONE && dlec != AUTOBAUD_LEC_NO_CHANGE));
+
+  level = (uint32_t)fdcan_rxfifo_level(fdcan, FDCAN_RX_FIFO0);
+  ev->frames = level;
+  ev->brs_frames = 0;
+  for (i = 0; i < level; i++) {
+    element = fdcan_rxfifo_peek(fdcan, FDCAN_RX_FIFO0, i);
+    if (element[1] & FDCAN_BRS_ON) ev->brs_frames++;
+  }
+  fdcan_rxfifo_release(fdcan, FDCAN_RX_FIFO0, level);
+}
+
+static uint64_t _autobaud_fdcan_now_us(void *ctx) {
+  (void)ctx;
+  return timebase_us();
+}
+
+static const can_autobaud_port_t autobaud_fdcan_port = {
+  .configure = _autobaud_fdcan_configure,
+  .sample = _autobaud_fdcan_sample,
+  .now_us = _autobaud_fdcan_now_us,
+};
+
+int can_autobaud_fdcan_detect(FDCAN_Handle_t *fdcan, const can_autobaud_config_t *cfg,
+                              can_autobaud_result_t *result) {
+  static const can_autobaud_config_t defaults = { .fd = true };
+  FDCAN_Init_t init;
+  can_autobaud_t ab;
+  can_autobaud_result_t res;
+
+  if (fdcan == NULL) return 1;
+  init = fdcan->Init;
+
+  if (can_autobaud_init(&ab, (cfg != NULL) ? cfg : &defaults, &autobaud_fdcan_port, fdcan) != 0) return 1;
+  while (can_autobaud_poll(&ab) == 0);
+  can_autobaud_get_result(&ab, &res);
+  if (result != NULL) *result = res;
+
+  fdcan->Init = init;
+  if (res.nominal_bps == 0) {
+    fdcan_stop(fdcan);
+    return 1;
+  }
+
+  _autobaud_fdcan_timing(fdcan, res.nominal_bps, res.data_bps);
+  return fdcan_init(fdcan);
+}
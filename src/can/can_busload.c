@@ -0,0 +1,254 @@
+#include <stddef.h>
+#include <string.h>
+#include "stm32h563.h"
+#include "fdcan.h"
+#include "can/can_busload.h"
+
+#define BUSLOAD_CRC15_POLY     0x4599U
+#define BUSLOAD_TAIL_BITS      12U    // ACK, ACK delimiter, EOF, intermission
+#define BUSLOAD_STATES         10U    // last bit (0/1) x run length (1..5)
+
+/*
+ * Stuffing state machine: state = last bit * 5 + run length - 1. A run of
+ * five equal bits owes a stuff bit, inserted (and counted) only when the
+ * next bit follows, so the CAN FD data field end is handled by the caller.
+ * busload_stuff[state][byte] = stuff bits << 4 | next state, MSB first.
+ */
+static uint8_t busload_stuff[BUSLOAD_STATES][256];
+static uint16_t busload_crc15[256];
+static bool busload_tables;
+
+static inline uint32_t _busload_bit(uint32_t state, uint32_t bit, uint32_t *stuff) {
+  uint32_t last = state / 5, run = state % 5 + 1;
+
+  if (run == 5) {
+    (*stuff)++;
+    last ^= 1;
+    run = 1;
+  }
+  if (bit == last) {
+    run++;
+  } else {
+    last = bit;
+    run = 1;
+  }
+
+  return last * 5 + run - 1;
+}
+
+static void _busload_build_tables(void) {
+  uint32_t state, byte, bit, s, stuff, crc;
+
+  for (state = 0; state < BUSLOAD_STATES; state++) {
+    for (byte = 0; byte < 256; byte++) {
+      s = state;
+      stuff = 0;
+      for (bit = 0; bit < 8; bit++) {
+        s = _busload_bit(s, (byte >> (7 - bit)) & 1, &stuff);
+      }
+      busload_stuff[state][byte] = (uint8_t)((stuff << 4) | s);
+    }
+  }
+
+  for (byte = 0; byte < 256; byte++) {
+    crc = byte << 7;
+    for (bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x4000U) ? ((crc << 1) ^ BUSLOAD_CRC15_POLY) : (crc << 1);
+    }
+    busload_crc15[byte] = (uint16_t)(crc & 0x7FFF);
+  }
+
+  busload_tables = true;
+}
+
+/* Feed the low nbits of value, MSB first, through the stuffing table */
+static inline uint32_t _busload_stuff_bits(uint32_t state, uint64_t value, uint32_t nbits, uint32_t *stuff) {
+  uint32_t t;
+
+  while (nbits >= 8) {
+    nbits -= 8;
+    t = busload_stuff[state][(value >> nbits) & 0xFF];
+    *stuff += t >> 4;
+    state = t & 0xF;
+  }
+  while (nbits > 0) {
+    nbits--;
+    state = _busload_bit(state, (uint32_t)(value >> nbits) & 1, stuff);
+  }
+
+  return state;
+}
+
+static inline uint32_t _busload_crc15_bits(uint32_t crc, uint64_t value, uint32_t nbits) {
+  uint32_t b;
+
+  while (nbits >= 8) {
+    nbits -= 8;
+    crc = ((crc << 8) ^ busload_crc15[((crc >> 7) ^ (uint32_t)(value >> nbits)) & 0xFF]) & 0x7FFF;
+  }
+  while (nbits > 0) {
+    nbits--;
+    b = ((uint32_t)(value >> nbits) & 1) ^ ((crc >> 14) & 1);
+    crc = (crc << 1) & 0x7FFF;
+    if (b) crc ^= BUSLOAD_CRC15_POLY;
+  }
+
+  return crc;
+}
+
+int can_busload_init(can_busload_t *bl, const can_busload_config_t *cfg) {
+  if (cfg == NULL || cfg->nominal_bps == 0 || cfg->data_bps == 0) return 1;
+
+  if (!busload_tables) _busload_build_tables();
+
+  memset(bl, 0, sizeof(*bl));
+  bl->cfg = *cfg;
+  bl->nominal_ns_q8 = (uint32_t)((1000000000ULL << 8) / cfg->nominal_bps);
+  bl->data_ns_q8 = (uint32_t)((1000000000ULL << 8) / cfg->data_bps);
+
+  return 0;
+}
+
+RAMFUNC void can_busload_frame_bits(const can_busload_t *bl, uint32_t id, uint8_t flags, uint8_t dlc,
+                                    const uint8_t *data, can_busload_bits_t *bits) {
+  bool fd = (flags & CAN_BUSLOAD_FDF) != 0, brs = fd && (flags & CAN_BUSLOAD_BRS) != 0;
+  bool actual = bl->cfg.stuffing == CAN_BUSLOAD_STUFF_ACTUAL;
+  uint32_t len, arb, ctrl, region, fixed, i, state, stuff_nom = 0, stuff_data = 0, crc = 0;
+  uint64_t hdr;
+
+  dlc &= 0xF;
+  len = fd ? fdcan_dlc_to_bytes(dlc) : ((dlc > 8) ? 8 : dlc);
+
+  // arbitration field up to and including the bit before ESI (FD) or the control bits (classic)
+  if (flags & CAN_BUSLOAD_XTD) {
+    hdr = (((uint64_t)((id >> 18) & 0x7FF) << 2 | 0x3) << 18) | (id & 0x3FFFF);  // base ID, SRR, IDE, ID ext
+    arb = 31;
+  } else {
+    hdr = id & 0x7FF;
+    arb = 11;
+  }
+  if (fd) {
+    i = (flags & CAN_BUSLOAD_XTD) ? 4 : 5;                   // (RRS, IDE) or RRS, then FDF = 1, res, BRS
+    hdr = (hdr << i) | 0x4U | (brs ? 1U : 0U);
+    hdr = (hdr << 5) | ((flags & CAN_BUSLOAD_ESI) ? 0x10U : 0U) | dlc;
+    arb += i;
+    ctrl = 5;
+  } else {
+    hdr = (hdr << 7) | dlc;                                  // RTR, IDE or r1, r0 all dominant
+    arb += 3;
+    ctrl = 4;
+  }
+
+  region = 1 + arb + ctrl + 8 * len + (fd ? 0 : 15);
+
+  if (!actual) {
+    if (fd) {
+      // no stuff bit after the last data bit, the first fixed stuff bit takes its place
+      stuff_nom = (arb - 1) / 4;
+      stuff_data = (region - 2) / 4 - stuff_nom;
+    } else {
+      stuff_nom = (region - 1) / 4;
+    }
+  } else {
+    state = 0;   // SOF: dominant, run of one
+    if (fd) {
+      state = _busload_stuff_bits(state, hdr >> ctrl, arb, &stuff_nom);
+      state = _busload_stuff_bits(state, hdr, ctrl, &stuff_data);
+      for (i = 0; i < len; i++) {
+        state = _busload_stuff_bits(state, data[i], 8, &stuff_data);
+      }
+    } else {
+      crc = _busload_crc15_bits(0, hdr, arb + ctrl + 1);   // SOF is the leading zero
+      state = _busload_stuff_bits(state, hdr, arb + ctrl, &stuff_nom);
+      for (i = 0; i < len; i++) {
+        crc = _busload_crc15_bits(crc, data[i], 8);
+        state = _busload_stuff_bits(state, data[i], 8, &stuff_nom);
+      }
+      state = _busload_stuff_bits(state, crc, 15, &stuff_nom);
+      if (state % 5 == 4) stuff_nom++;   // run of five at the CRC end, stuffed before the delimiter
+    }
+  }
+
+  if (fd) {
+    // stuff count (4), CRC17/21, fixed stuff bits, CRC delimiter
+    fixed = (len <= 16) ? 6 : 7;
+    i = 4 + ((len <= 16) ? 17 : 21) + fixed + 1;
+    if (brs) {
+      bits->nominal = (uint16_t)(1 + arb + stuff_nom + BUSLOAD_TAIL_BITS);
+      bits->data = (uint16_t)(ctrl + 8 * len + stuff_data + i);
+    } else {
+      bits->nominal = (uint16_t)(region + stuff_nom + stuff_data + i + BUSLOAD_TAIL_BITS);
+      bits->data = 0;
+    }
+    bits->stuff = (uint16_t)(stuff_nom + stuff_data + fixed);
+  } else {
+    bits->nominal = (uint16_t)(region + stuff_nom + 1 + BUSLOAD_TAIL_BITS);
+    bits->data = 0;
+    bits->stuff = (uint16_t)stuff_nom;
+  }
+}
+
+RAMFUNC uint32_t can_busload_wire_ns(const can_busload_t *bl, uint32_t id, uint8_t flags, uint8_t dlc,
+                                     const uint8_t *data) {
+  can_busload_bits_t bits;
+
+  can_busload_frame_bits(bl, id, flags, dlc, data, &bits);
+  return (uint32_t)(((uint64_t)bits.nominal * bl->nominal_ns_q8 + (uint64_t)bits.data * bl->data_ns_q8) >> 8);
+}
+
+/* Close the buckets that ended before now_us */
+RAMFUNC static void _busload_roll(can_busload_t *bl, uint64_t now_us) {
+  uint32_t v;
+
+  if (!bl->started) {
+    bl->started = true;
+    bl->bucket_start_us = now_us;
+    return;
+  }
+
+  if (now_us >= bl->bucket_start_us + (CAN_BUSLOAD_BUCKETS + 1U) * CAN_BUSLOAD_BUCKET_US) {
+    // idle for more than the whole history: every window is empty, skip ahead
+    v = bl->bucket_ns / CAN_BUSLOAD_BUCKET_US;
+    if (v > bl->peak_permille) bl->peak_permille = (uint16_t)v;
+    memset(bl->bucket, 0, sizeof(bl->bucket));
+    bl->sum_100ms = 0;
+    bl->sum_1s = 0;
+    bl->bucket_ns = 0;
+    bl->bucket_start_us += (now_us - bl->bucket_start_us) / CAN_BUSLOAD_BUCKET_US * CAN_BUSLOAD_BUCKET_US;
+    return;
+  }
+
+  while (now_us >= bl->bucket_start_us + CAN_BUSLOAD_BUCKET_US) {
+    v = bl->bucket_ns;
+    bl->head = (bl->head + 1) % CAN_BUSLOAD_BUCKETS;
+    bl->sum_1s += v - bl->bucket[bl->head];
+    bl->bucket[bl->head] = v;
+    bl->sum_100ms += v - bl->bucket[(bl->head + CAN_BUSLOAD_BUCKETS - 10) % CAN_BUSLOAD_BUCKETS];
+    if (v / (CAN_BUSLOAD_BUCKET_US) > bl->peak_permille) bl->peak_permille = (uint16_t)(v / CAN_BUSLOAD_BUCKET_US);
+
+    bl->bucket_ns = 0;
+    bl->bucket_start_us += CAN_BUSLOAD_BUCKET_US;
+  }
+}
+
+RAMFUNC void can_busload_record(can_busload_t *bl, uint32_t id, uint8_t flags, uint8_t dlc, const uint8_t *data,
+                                uint64_t now_us) {
+  uint32_t ns = can_busload_wire_ns(bl, id, flags, dlc, data);
+
+  _busload_roll(bl, now_us);
+  bl->bucket_ns += ns;
+  bl->busy_ns += ns;
+  bl->frames++;
+}
+
+void can_busload_get(can_busload_t *bl, uint64_t now_us, can_busload_stats_t *stats) {
+  _busload_roll(bl, now_us);
+
+  // ns per bucket / (bucket length in ns) * 1000
+  stats->load_10ms_permille = (uint16_t)(bl->bucket[bl->head] / CAN_BUSLOAD_BUCKET_US);
+  stats->load_100ms_permille = (uint16_t)(bl->sum_100ms / (10U * CAN_BUSLOAD_BUCKET_US));
+  stats->load_1s_permille = (uint16_t)(bl->sum_1s / (CAN_BUSLOAD_BUCKETS * CAN_BUSLOAD_BUCKET_US));
+  stats->peak_10ms_permille = bl->peak_permille;
+  stats->frames = bl->frames;
+  stats->busy_ns = bl->busy_ns;
+}
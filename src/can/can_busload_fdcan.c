@@ -0,0 +1,86 @@
+#include <stddef.h>
+#include "can/can_busload_fdcan.h"
+#include "nvic.h"
+#include "rcc.h"
+#include "timebase.h"
+
+typedef struct {
+  can_busload_t *bl;
+  void (*rx_chained)(FDCAN_Handle_t *fdcan, const FDCAN_RxElement_t *rx);
+  void (*tx_chained)(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx, uint32_t marker);
+} busload_binding_t;
+
+static busload_binding_t busload_binding[2];   // FDCAN1, FDCAN2
+
+static inline uint8_t _busload_flags(uint32_t id_type, uint32_t fdf, uint32_t brs, uint32_t esi) {
+  uint8_t flags = 0;
+
+  if (id_type == FDCAN_EXTENDED_ID) flags |= CAN_BUSLOAD_XTD;
+  if (fdf == FDCAN_FD_CAN) flags |= CAN_BUSLOAD_FDF;
+  if (brs == FDCAN_BRS_ON) flags |= CAN_BUSLOAD_BRS;
+  if (esi != 0) flags |= CAN_BUSLOAD_ESI;
+  return flags;
+}
+
+RAMFUNC static void _busload_rx_callback(FDCAN_Handle_t *fdcan, const FDCAN_RxElement_t *rx) {
+  busload_binding_t *b = &busload_binding[(fdcan->Instance == FDCAN2) ? 1 : 0];
+
+  can_busload_record(b->bl, rx->Identifier,
+                     _busload_flags(rx->IdType, rx->FDFormat, rx->BitRateSwitch, rx->ErrorStateIndicator),
+                     (uint8_t)rx->DataLength, rx->Data, timebase_us());
+
+  if (b->rx_chained != NULL) {
+    b->rx_chained(fdcan, rx);
+  }
+}
+
+RAMFUNC static void _busload_tx_callback(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx, uint32_t marker) {
+  busload_binding_t *b = &busload_binding[(fdcan->Instance == FDCAN2) ? 1 : 0];
+  uint32_t primask = irq_save();   // fdcan_send() may run outside the RX interrupt
+
+  can_busload_record(b->bl, tx->Identifier,
+                     _busload_flags(tx->IdType, tx->FDFormat, tx->BitRateSwitch, tx->ErrorStateIndicator),
+                     (uint8_t)tx->DataLength, tx->Data, timebase_us());
+  irq_restore(primask);
+
+  if (b->tx_chained != NULL) {
+    b->tx_chained(fdcan, tx, marker);
+  }
+}
+
+int can_busload_attach(can_busload_t *bl, FDCAN_Handle_t *fdcan, can_busload_stuffing_t stuffing) {
+  can_busload_config_t cfg;
+  uint32_t clk = rcc_get_fdcan_clk_hz(), tq;
+  int ch;
+
+  if (bl == NULL || fdcan == NULL) return 1;
+  if (fdcan->Instance == FDCAN1) ch = 0;
+  else if (fdcan->Instance == FDCAN2) ch = 1;
+  else return 1;
+
+  tq = fdcan->Init.NominalPrescaler * (1 + fdcan->Init.NominalTimeSeg1 + fdcan->Init.NominalTimeSeg2);
+  cfg.nominal_bps = (tq != 0) ? clk / tq : 0;
+  tq = fdcan->Init.DataPrescaler * (1 + fdcan->Init.DataTimeSeg1 + fdcan->Init.DataTimeSeg2);
+  cfg.data_bps = (fdcan->Init.FDMode && tq != 0) ? clk / tq : cfg.nominal_bps;
+  cfg.stuffing = stuffing;
+  if (can_busload_init(bl, &cfg) != 0) return 1;
+
+  busload_binding[ch].bl = bl;
+  if (fdcan->RxCallback != _busload_rx_callback) {
+    busload_binding[ch].rx_chained = fdcan->RxCallback;
+  }
+  if (fdcan->TxCallback != _busload_tx_callback) {
+    busload_binding[ch].tx_chained = fdcan->TxCallback;
+  }
+  fdcan->RxCallback = _busload_rx_callback;
+  fdcan->TxCallback = _busload_tx_callback;
+
+  return 0;
+}
+
+void can_busload_fdcan_get(can_busload_t *bl, can_busload_stats_t *stats) {
+  uint32_t primask = irq_save();
+
+  can_busload_get(bl, timebase_us(), stats);
+  irq_restore(primask);
+}
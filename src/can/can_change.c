@@ -0,0 +1,130 @@
+#include <stddef.h>
+#include <string.h>
+#include "stm32h563.h"
+#include "can/can_change.h"
+#include "can/can_idmap.h"
+
+/* Bitmap of the non-zero bytes of a word, bit n = byte n */
+static inline uint32_t _change_bytes(uint32_t d) {
+  uint32_t lanes;
+
+#if defined(__ARM_FEATURE_SIMD32)
+  // USUB8 0 - d sets GE[n] only for zero bytes, SEL then picks 0x00 there and 0xFF elsewhere
+  __asm ("usub8 %0, %1, %2\n\tsel %0, %1, %3" : "=&r" (lanes) : "r" (0U), "r" (d), "r" (0xFFFFFFFFU) : "cc");
+#else
+  // bit 7 of each byte ends up set iff the byte is non-zero
+  lanes = (((d & 0x7F7F7F7FU) + 0x7F7F7F7FU) | d) >> 7;
+#endif
+
+  // gather bit 0 of each byte into bits 28..31
+  return ((lanes & 0x01010101U) * 0x10204080U) >> 28;
+}
+
+void can_change_init(can_change_t *chg, can_change_handler_t fallback, void *ctx) {
+  memset(chg, 0, sizeof(*chg));
+  chg->fallback = fallback;
+  chg->fallback_ctx = ctx;
+}
+
+int can_change_add(can_change_t *chg, uint32_t key, can_change_handler_t handler, void *ctx) {
+  can_change_entry_t *e;
+
+  if (handler == NULL || chg->count >= CAN_CHANGE_MAX_IDS) return -1;
+  if (can_idmap_add(chg->hash_key, chg->hash_index, CAN_CHANGE_HASH_SIZE, key, chg->count) != 0) return -1;
+
+  e = &chg->entry[chg->count];
+  memset(e, 0, sizeof(*e));
+  memset(e->mask, 0xFF, sizeof(e->mask));
+  e->key = key;
+  e->handler = handler;
+  e->ctx = ctx;
+
+  return (int)chg->count++;
+}
+
+int can_change_index(const can_change_t *chg, uint32_t key) {
+  return can_idmap_find(chg->hash_key, chg->hash_index, CAN_CHANGE_HASH_SIZE, key);
+}
+
+int can_change_ignore(can_change_t *chg, int index, uint32_t start_bit, uint32_t length) {
+  can_change_entry_t *e;
+  uint32_t bit;
+
+  if (index < 0 || (uint32_t)index >= chg->count) return 1;
+  if (start_bit + length > CAN_CHANGE_WORDS * 32U || start_bit + length < start_bit) return 1;
+
+  e = &chg->entry[index];
+  for (bit = start_bit; bit < start_bit + length; bit++) {
+    e->mask[bit >> 5] &= ~(1UL << (bit & 31));
+  }
+
+  return 0;
+}
+
+int can_change_set_mask(can_change_t *chg, int index, const uint8_t *mask, uint32_t len) {
+  can_change_entry_t *e;
+
+  if (index < 0 || (uint32_t)index >= chg->count || len > sizeof(e->mask)) return 1;
+
+  e = &chg->entry[index];
+  memset(e->mask, 0xFF, sizeof(e->mask));
+  memcpy(e->mask, mask, len);   // little-endian: byte n of the payload is byte n of the mask
+
+  return 0;
+}
+
+RAMFUNC uint64_t can_change_diff(uint32_t *last, const uint32_t *mask, const uint8_t *data, uint32_t len) {
+  uint32_t i, w, d, words = len >> 2;
+  uint64_t changed = 0;
+
+  for (i = 0; i < words; i++) {
+    memcpy(&w, &data[i * 4], 4);   // single unaligned LDR on the M33
+    d = (w ^ last[i]) & mask[i];
+    last[i] = w;
+    if (d != 0) changed |= (uint64_t)_change_bytes(d) << (i * 4);
+  }
+
+  if ((len & 3) != 0 && words < CAN_CHANGE_WORDS) {
+    w = 0;
+    memcpy(&w, &data[words * 4], len & 3);
+    d = (w ^ last[words]) & mask[words];
+    last[words] = w;
+    if (d != 0) changed |= (uint64_t)_change_bytes(d) << (words * 4);
+  }
+
+  return changed;
+}
+
+RAMFUNC int can_change_process(can_change_t *chg, uint32_t key, const uint8_t *data, uint8_t len) {
+  int index = can_change_index(chg, key);
+  can_change_entry_t *e;
+  uint64_t changed, all;
+
+  if (len > 64) len = 64;
+  all = (len == 64) ? ~0ULL : ((1ULL << len) - 1);
+  chg->frames++;
+
+  if (index < 0) {
+    if (chg->fallback == NULL) return 0;
+    chg->fallback(chg->fallback_ctx, key, data, len, all);
+    return 1;
+  }
+
+  e = &chg->entry[index];
+  e->frames++;
+  changed = can_change_diff(e->last, e->mask, data, len);
+
+  if (!e->valid || e->len != len) {
+    e->valid = true;
+    e->len = len;
+    changed = all;
+  } else if (changed == 0) {
+    e->skipped++;
+    chg->skipped++;
+    return 0;
+  }
+
+  e->handler(e->ctx, key, data, len, changed);
+
+  return 1;
+}
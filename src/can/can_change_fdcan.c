@@ -0,0 +1,19 @@
+#include <stddef.h>
+#include "can/can_change_fdcan.h"
+#include "can/can_bind_fdcan.h"
+
+static can_bind_t change_binding[2];   // FDCAN1, FDCAN2
+
+RAMFUNC static void _change_rx_callback(FDCAN_Handle_t *fdcan, const FDCAN_RxElement_t *rx) {
+  can_bind_t *b = can_bind_of(change_binding, fdcan);
+  uint32_t key = rx->Identifier;
+
+  if (rx->IdType == FDCAN_EXTENDED_ID) key |= CAN_CHANGE_EXT;
+  (void)can_change_process(b->ctx, key, rx->Data, (uint8_t)fdcan_dlc_to_bytes(rx->DataLength));
+
+  can_bind_chain(b, fdcan, rx);
+}
+
+int can_change_attach(can_change_t *chg, FDCAN_Handle_t *fdcan) {
+  return can_bind_rx(change_binding, fdcan, chg, _change_rx_callback);
+}
@@ -0,0 +1,170 @@
+#include <stddef.h>
+#include <string.h>
+#include "can/can_health.h"
+
+#define HEALTH_BACKOFF_MAX_SCALE  64U
+#define HEALTH_STABLE_US          1000000U
+
+#define HEALTH_PSR_EP             BIT(5)
+#define HEALTH_PSR_EW             BIT(6)
+#define HEALTH_PSR_BO             BIT(7)
+
+#define HEALTH_IT_SMSG            0x000001C0U   // HPM, TC, TCF: the ILS SMSG group
+
+int can_health_init(can_health_t *h, FDCAN_Handle_t *fdcan, const can_health_config_t *cfg) {
+  if (h == NULL || fdcan == NULL || cfg == NULL) return 1;
+
+  memset(h, 0, sizeof(*h));
+  h->fdcan = fdcan;
+  h->cfg = *cfg;
+  if (h->cfg.backoff_max_us == 0) h->cfg.backoff_max_us = h->cfg.backoff_us * HEALTH_BACKOFF_MAX_SCALE;
+  if (h->cfg.backoff_max_us < h->cfg.backoff_us) h->cfg.backoff_max_us = h->cfg.backoff_us;
+  if (h->cfg.stable_us == 0) h->cfg.stable_us = HEALTH_STABLE_US;
+  h->backoff_us = h->cfg.backoff_us;
+
+  return 0;
+}
+
+static void _health_start_recovery(can_health_t *h) {
+  h->pending = false;
+  h->stats.state = CAN_HEALTH_RECOVERING;
+  fdcan_start(h->fdcan);
+}
+
+static void _health_bus_off(can_health_t *h, uint64_t now_us) {
+  // bus-off soon after the last recovery: wait longer this time
+  if (h->stats.recoveries != 0 && now_us - h->recovered_us < h->cfg.stable_us) {
+    h->backoff_us = (h->backoff_us > h->cfg.backoff_max_us / 2) ? h->cfg.backoff_max_us : 2 * h->backoff_us;
+    if (h->backoff_us == 0) h->backoff_us = h->cfg.backoff_us;
+  } else {
+    h->backoff_us = h->cfg.backoff_us;
+  }
+
+  h->stats.bus_off++;
+  h->stats.state = CAN_HEALTH_BUS_OFF;
+  h->stats.backoff_us = h->backoff_us;
+  h->bus_off_us = now_us;
+  h->recover_at_us = now_us + h->backoff_us;
+  can_health_release(h);
+
+  if (h->cfg.manual) return;
+  if (h->backoff_us == 0) {
+    _health_start_recovery(h);
+  } else {
+    h->pending = true;
+  }
+}
+
+static void _health_recovered(can_health_t *h, uint64_t now_us) {
+  uint32_t us = (uint32_t)(now_us - h->bus_off_us);
+
+  h->recovered_us = now_us;
+  h->stats.recoveries++;
+  h->stats.recovery_last_us = us;
+  h->stats.recovery_sum_us += us;
+  if (us > h->stats.recovery_max_us) h->stats.recovery_max_us = us;
+}
+
+/* Take TC to line 1 until the first transmission, saving what line 0 users had set */
+static void _health_watch_tx(can_health_t *h) {
+  FDCAN_t *regs = h->fdcan->Instance;
+
+  if (h->tx_watch) return;
+  h->saved_ils = regs->ILS;
+  h->saved_txbtie = regs->TXBTIE;
+  h->saved_tc = (regs->IE & FDCAN_IT_TX_COMPLETE) != 0;
+  h->tx_watch = true;
+  fdcan_irq_route(h->fdcan, h->saved_ils | FDCAN_IT_GROUP_SMSG);
+  regs->TXBTIE = (1U << FDCAN_TX_BUFFERS) - 1U;
+  fdcan_irq_enable(h->fdcan, FDCAN_IT_TX_COMPLETE);
+}
+
+void can_health_release(can_health_t *h) {
+  FDCAN_t *regs = h->fdcan->Instance;
+
+  if (!h->tx_watch) return;
+  h->tx_watch = false;
+  regs->TXBTIE = h->saved_txbtie;
+  if (!h->saved_tc) {
+    fdcan_irq_disable(h->fdcan, FDCAN_IT_TX_COMPLETE);
+    regs->IR = FDCAN_IT_TX_COMPLETE;  // nobody on line 0 waits for it
+  }
+  fdcan_irq_route(h->fdcan, h->saved_ils);
+}
+
+RAMFUNC void can_health_isr(can_health_t *h, uint64_t now_us) {
+  FDCAN_Handle_t *fdcan = h->fdcan;
+  uint32_t ir, psr, ecr, code, was, smsg;
+  uint8_t tec, rec;
+
+  // SMSG goes back to line 0 before the ack, so its flags stay pending for the line 0 handler
+  if (h->tx_watch) {
+    smsg = fdcan->Instance->IR & fdcan->Instance->IE & HEALTH_IT_SMSG;
+    if (smsg != 0) {
+      can_health_release(h);
+      if ((smsg & FDCAN_IT_TX_COMPLETE) && h->stats.state == CAN_HEALTH_RECOVERING) _health_recovered(h, now_us);
+    }
+  }
+
+  ir = fdcan_irq_ack_line1(fdcan);
+  psr = fdcan->Instance->PSR;   // clears LEC/DLEC
+  ecr = fdcan->Instance->ECR;   // clears CEL
+  h->stats.irqs++;
+
+  if (ir & FDCAN_IT_ARB_PROTOCOL_ERROR) {
+    code = psr & 0x7U;
+    if (code != 0 && code != 7) h->stats.lec[code]++;
+  }
+  if (ir & FDCAN_IT_DATA_PROTOCOL_ERROR) {
+    code = (psr >> 8) & 0x7U;
+    if (code != 0 && code != 7) h->stats.dlec[code]++;
+  }
+
+  tec = (uint8_t)(ecr & 0xFFU);
+  rec = (uint8_t)((ecr >> 8) & 0x7FU);
+  h->stats.tec = tec;
+  h->stats.rec = rec;
+  if (tec > h->stats.tec_peak) h->stats.tec_peak = tec;
+  if (rec > h->stats.rec_peak) h->stats.rec_peak = rec;
+  h->stats.errors_logged += (ecr >> 16) & 0xFFU;
+
+  was = h->psr;
+  h->psr = psr & (HEALTH_PSR_EP | HEALTH_PSR_EW | HEALTH_PSR_BO);
+  if ((psr & HEALTH_PSR_EW) && !(was & HEALTH_PSR_EW)) h->stats.warning++;
+  if ((psr & HEALTH_PSR_EP) && !(was & HEALTH_PSR_EP)) h->stats.passive++;
+
+  if ((psr & HEALTH_PSR_BO) && !(was & HEALTH_PSR_BO)) {
+    _health_bus_off(h, now_us);
+  } else if (!(psr & HEALTH_PSR_BO) && (was & HEALTH_PSR_BO)) {
+    // recovery sequence done, the first frame out ends the recovery
+    _health_watch_tx(h);
+  }
+
+  if (psr & HEALTH_PSR_BO) {
+    if (h->stats.state != CAN_HEALTH_RECOVERING) h->stats.state = CAN_HEALTH_BUS_OFF;
+  } else if (h->stats.state == CAN_HEALTH_RECOVERING && h->tx_watch) {
+    // waiting for the first transmission
+  } else if (psr & HEALTH_PSR_EP) {
+    h->stats.state = CAN_HEALTH_ERROR_PASSIVE;
+  } else if (psr & HEALTH_PSR_EW) {
+    h->stats.state = CAN_HEALTH_ERROR_WARNING;
+  } else {
+    h->stats.state = CAN_HEALTH_ERROR_ACTIVE;
+  }
+}
+
+RAMFUNC void can_health_tick(can_health_t *h, uint64_t now_us) {
+  if (!h->pending) return;
+  if (now_us >= h->recover_at_us) _health_start_recovery(h);
+}
+
+int can_health_recover(can_health_t *h) {
+  if (h->stats.state != CAN_HEALTH_BUS_OFF) return 1;
+
+  _health_start_recovery(h);
+  return 0;
+}
+
+void can_health_get_stats(const can_health_t *h, can_health_stats_t *stats) {
+  *stats = h->stats;
+}
@@ -0,0 +1,83 @@
+#include <stddef.h>
+#include "can/can_health_fdcan.h"
+#include "nvic.h"
+#include "trace.h"
+#include "timebase.h"
+
+#define HEALTH_IRQ_SOURCES      (FDCAN_IT_ERROR_PASSIVE | FDCAN_IT_ERROR_WARNING | FDCAN_IT_BUS_OFF)
+#define HEALTH_PROTOCOL_SOURCES (FDCAN_IT_ARB_PROTOCOL_ERROR | FDCAN_IT_DATA_PROTOCOL_ERROR)
+#define HEALTH_IRQ_GROUPS       (FDCAN_IT_GROUP_BIT_LINE_ERROR | FDCAN_IT_GROUP_PROTOCOL_ERROR)
+
+static can_health_t *health_binding[2];   // FDCAN1, FDCAN2
+
+RAMFUNC static void _health_fdcan1_irq(void) {
+  FDCAN_STATS_ISR_BEGIN();
+
+  TRACE_ISR_ENTER(FDCAN1_IT1_IRQn);
+  can_health_isr(health_binding[0], timebase_us());
+  FDCAN_STATS_ISR_END(health_binding[0]->fdcan);
+  TRACE_ISR_EXIT(FDCAN1_IT1_IRQn);
+}
+
+RAMFUNC static void _health_fdcan2_irq(void) {
+  FDCAN_STATS_ISR_BEGIN();
+
+  TRACE_ISR_ENTER(FDCAN2_IT1_IRQn);
+  can_health_isr(health_binding[1], timebase_us());
+  FDCAN_STATS_ISR_END(health_binding[1]->fdcan);
+  TRACE_ISR_EXIT(FDCAN2_IT1_IRQn);
+}
+
+static void _health_tick(void) {
+  uint32_t ch;
+
+  for (ch = 0; ch < 2; ch++) {
+    if (health_binding[ch] != NULL && health_binding[ch]->pending) {
+      can_health_tick(health_binding[ch], timebase_us());
+    }
+  }
+}
+
+int can_health_start(can_health_t *h, FDCAN_Handle_t *fdcan, const can_health_config_t *cfg, uint8_t priority) {
+  IRQn_t irqn;
+  int ch;
+
+  if (fdcan == NULL) return 1;
+  if (fdcan->Instance == FDCAN1) ch = 0;
+  else if (fdcan->Instance == FDCAN2) ch = 1;
+  else return 1;
+
+  if (can_health_init(h, fdcan, cfg) != 0) return 1;
+
+  irqn = (ch == 1) ? FDCAN2_IT1_IRQn : FDCAN1_IT1_IRQn;
+  nvic_disable_irq(irqn);
+
+  health_binding[ch] = h;
+  irq_register(irqn, (ch == 1) ? _health_fdcan2_irq : _health_fdcan1_irq);
+  nvic_set_priority(irqn, priority);
+  timebase_set_tick_hook(_health_tick);
+
+  fdcan_irq_route(fdcan, HEALTH_IRQ_GROUPS);
+  fdcan_irq_enable(fdcan, HEALTH_IRQ_SOURCES | (cfg->protocol_errors ? HEALTH_PROTOCOL_SOURCES : 0));
+  nvic_enable_irq(irqn);
+
+  return 0;
+}
+
+void can_health_stop(can_health_t *h) {
+  FDCAN_Handle_t *fdcan = h->fdcan;
+  int ch = (fdcan->Instance == FDCAN2) ? 1 : 0;
+
+  fdcan_irq_disable(fdcan, HEALTH_IRQ_SOURCES | HEALTH_PROTOCOL_SOURCES);
+  nvic_disable_irq((ch == 1) ? FDCAN2_IT1_IRQn : FDCAN1_IT1_IRQn);
+  can_health_release(h);
+  h->pending = false;
+  health_binding[ch] = NULL;
+}
+
+void can_health_snapshot(const can_health_t *h, can_health_stats_t *stats) {
+  uint32_t primask = irq_save();
+
+  can_health_get_stats(h, stats);
+  irq_restore(primask);
+}
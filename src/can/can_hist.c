@@ -0,0 +1,62 @@
+#include <stddef.h>
+#include <string.h>
+#include "can/can_hist.h"
+
+void can_hist_reset(can_hist_t *h) {
+  memset(h->count, 0, sizeof(h->count));
+  h->n = 0;
+  h->min = UINT32_MAX;
+  h->max = 0;
+  h->sum = 0;
+}
+
+uint32_t can_hist_bucket_low(uint32_t index) {
+  uint32_t shift;
+
+  if (index < 2U * CAN_HIST_SUB) return index;
+  shift = index / CAN_HIST_SUB - 1U;
+  return (CAN_HIST_SUB + index % CAN_HIST_SUB) << shift;
+}
+
+uint32_t can_hist_bucket_high(uint32_t index) {
+  uint32_t shift;
+
+  if (index < 2U * CAN_HIST_SUB) return index;
+  shift = index / CAN_HIST_SUB - 1U;
+  return can_hist_bucket_low(index) + ((1U << shift) - 1U);
+}
+
+uint32_t can_hist_percentile(const can_hist_t *h, uint32_t permille) {
+  uint64_t rank;
+  uint32_t seen = 0, i, high;
+
+  if (h->n == 0) return 0;
+  if (permille == 0) return h->min;
+  if (permille >= 1000) return h->max;
+
+  // rank of the value, rounded up: p50 of 3 values is the 2nd
+  rank = ((uint64_t)h->n * permille + 999U) / 1000U;
+  for (i = 0; i < CAN_HIST_BUCKETS; i++) {
+    seen += h->count[i];
+    if (seen >= rank) break;
+  }
+
+  high = can_hist_bucket_high(i);
+  return (high > h->max) ? h->max : high;
+}
+
+uint32_t can_hist_mean(const can_hist_t *h) {
+  return (h->n != 0) ? (uint32_t)(h->sum / h->n) : 0;
+}
+
+void can_hist_merge(can_hist_t *dst, const can_hist_t *src) {
+  uint32_t i;
+
+  for (i = 0; i < CAN_HIST_BUCKETS; i++) {
+    dst->count[i] += src->count[i];
+  }
+  dst->n += src->n;
+  dst->sum += src->sum;
+  if (src->min < dst->min) dst->min = src->min;
+  if (src->max > dst->max) dst->max = src->max;
+}
@@ -0,0 +1,53 @@
+#include <stddef.h>
+#include <string.h>
+#include "can/can_latency.h"
+
+int can_latency_init(can_latency_t *lat, uint32_t tick_ns_q8, uint32_t clock_hz) {
+  uint64_t wrap;
+
+  if (lat == NULL || tick_ns_q8 == 0 || clock_hz == 0) return 1;
+
+  // 65536 ticks in clock units, capped below the clock's own half period
+  wrap = (((uint64_t)tick_ns_q8 << 8) * clock_hz) / 1000000000ULL;
+  lat->wrap = (wrap >= 0x80000000ULL) ? 0x80000000U : (uint32_t)wrap;
+  lat->tick_ns_q8 = tick_ns_q8;
+  memset(lat->stamp, 0, sizeof(lat->stamp));
+  can_latency_reset(lat);
+
+  return 0;
+}
+
+void can_latency_tx_sent(can_latency_t *lat, uint8_t marker, uint16_t ts, uint32_t now) {
+  can_latency_stamp_t *s = &lat->stamp[marker & (CAN_LATENCY_STAMPS - 1U)];
+
+  s->sent = now;
+  s->ts = ts;
+  s->marker = marker;
+  s->used = true;
+}
+
+void can_latency_tx_event(can_latency_t *lat, uint8_t marker, uint16_t tx_ts, uint32_t now) {
+  can_latency_stamp_t *s = &lat->stamp[marker & (CAN_LATENCY_STAMPS - 1U)];
+  uint32_t ticks;
+
+  if (!s->used || s->marker != marker) {
+    lat->tx_unmatched++;
+    return;
+  }
+  s->used = false;
+
+  if (now - s->sent >= lat->wrap) {
+    lat->tx_out_of_range++;
+    return;
+  }
+
+  ticks = (uint16_t)(tx_ts - s->ts);
+  can_hist_record(&lat->tx, (uint32_t)(((uint64_t)ticks * lat->tick_ns_q8) >> 8));
+}
+
+void can_latency_reset(can_latency_t *lat) {
+  can_hist_reset(&lat->tx);
+  can_hist_reset(&lat->rx);
+  lat->tx_unmatched = 0;
+  lat->tx_out_of_range = 0;
+}
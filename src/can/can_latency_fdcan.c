@@ -0,0 +1,105 @@
+#include <stddef.h>
+#include "can/can_latency_fdcan.h"
+#include "nvic.h"
+#include "rcc.h"
+#include "timebase.h"
+
+typedef struct {
+  can_latency_t *lat;
+  void (*rx_chained)(FDCAN_Handle_t *fdcan, const FDCAN_RxElement_t *rx);
+  void (*tx_chained)(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx, uint32_t marker);
+} latency_binding_t;
+
+static latency_binding_t latency_binding[2];   // FDCAN1, FDCAN2
+
+RAMFUNC static void _latency_drain(can_latency_t *lat) {
+  FDCAN_TxEvent_t ev;
+
+  while (fdcan_tx_event(lat->fdcan, &ev) == 0) {
+    can_latency_tx_event(lat, (uint8_t)ev.MessageMarker, (uint16_t)ev.TxTimestamp, DWT->CYCCNT);
+  }
+}
+
+RAMFUNC static void _latency_rx_callback(FDCAN_Handle_t *fdcan, const FDCAN_RxElement_t *rx) {
+  latency_binding_t *b = &latency_binding[(fdcan->Instance == FDCAN2) ? 1 : 0];
+
+  can_latency_rx(b->lat, (uint16_t)rx->RxTimestamp, (uint16_t)fdcan_timestamp(fdcan));
+
+  if (b->rx_chained != NULL) {
+    b->rx_chained(fdcan, rx);
+  }
+}
+
+RAMFUNC static void _latency_tx_callback(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx, uint32_t marker) {
+  latency_binding_t *b = &latency_binding[(fdcan->Instance == FDCAN2) ? 1 : 0];
+  uint32_t primask = irq_save();   // fdcan_send() may run outside the RX interrupt
+
+  can_latency_tx_sent(b->lat, (uint8_t)marker, (uint16_t)fdcan_timestamp(fdcan), DWT->CYCCNT);
+  _latency_drain(b->lat);
+  irq_restore(primask);
+
+  if (b->tx_chained != NULL) {
+    b->tx_chained(fdcan, tx, marker);
+  }
+}
+
+int can_latency_attach(can_latency_t *lat, FDCAN_Handle_t *fdcan) {
+  uint32_t clk = rcc_get_fdcan_clk_hz(), tq;
+  uint64_t tick_ns_q8;
+  int ch;
+
+  if (lat == NULL || fdcan == NULL || clk == 0) return 1;
+  if (fdcan->Instance == FDCAN1) ch = 0;
+  else if (fdcan->Instance == FDCAN2) ch = 1;
+  else return 1;
+  if (fdcan->Init.TimestampPrescaler == 0) return 1;
+
+  // one counter tick: TimestampPrescaler nominal bit times
+  tq = fdcan->Init.NominalPrescaler * (1 + fdcan->Init.NominalTimeSeg1 + fdcan->Init.NominalTimeSeg2);
+  tick_ns_q8 = (((uint64_t)tq * fdcan->Init.TimestampPrescaler * 1000000000ULL) << 8) / clk;
+  if (tick_ns_q8 == 0 || tick_ns_q8 > UINT32_MAX) return 1;
+  if (can_latency_init(lat, (uint32_t)tick_ns_q8, timebase_core_hz()) != 0) return 1;
+  lat->fdcan = fdcan;
+
+  latency_binding[ch].lat = lat;
+  if (fdcan->RxCallback != _latency_rx_callback) {
+    latency_binding[ch].rx_chained = fdcan->RxCallback;
+  }
+  fdcan->RxCallback = _latency_rx_callback;
+  if (fdcan->Init.TxEvents) {
+    if (fdcan->TxCallback != _latency_tx_callback) {
+      latency_binding[ch].tx_chained = fdcan->TxCallback;
+    }
+    fdcan->TxCallback = _latency_tx_callback;
+  }
+
+  return 0;
+}
+
+void can_latency_poll(can_latency_t *lat) {
+  uint32_t primask;
+
+  if ((lat->fdcan->Instance->TXEFS & 0b111) == 0) return;
+
+  primask = irq_save();
+  _latency_drain(lat);
+  irq_restore(primask);
+}
+
+void can_latency_snapshot(can_latency_t *lat, can_hist_t *tx, can_hist_t *rx, bool reset) {
+  uint32_t primask;
+
+  primask = irq_save();
+  if (tx != NULL) *tx = lat->tx;
+  if (reset) {
+    can_hist_reset(&lat->tx);
+    lat->tx_unmatched = 0;
+    lat->tx_out_of_range = 0;
+  }
+  irq_restore(primask);
+
+  primask = irq_save();
+  if (rx != NULL) *rx = lat->rx;
+  if (reset) can_hist_reset(&lat->rx);
+  irq_restore(primask);
+}
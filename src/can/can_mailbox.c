@@ -0,0 +1,104 @@
+#include <stddef.h>
+#include <string.h>
+#include "stm32h563.h"
+#include "fdcan.h"
+#include "can/can_mailbox.h"
+#include "can/can_idmap.h"
+
+int can_mailbox_init(can_mailbox_t *mb, const uint32_t *ids, uint32_t count) {
+  uint32_t i;
+
+  if (mb == NULL || (count > 0 && ids == NULL) || count > CAN_MAILBOX_MAX_IDS) return 1;
+
+  memset(mb, 0, sizeof(*mb));
+
+  for (i = 0; i < count; i++) {
+    if (can_idmap_add(mb->hash_key, mb->hash_index, CAN_MAILBOX_HASH_SIZE, ids[i], i) != 0) return 1;
+    mb->slot[i].key = ids[i];
+  }
+  mb->count = count;
+
+  return 0;
+}
+
+int can_mailbox_index(const can_mailbox_t *mb, uint32_t key) {
+  return can_idmap_find(mb->hash_key, mb->hash_index, CAN_MAILBOX_HASH_SIZE, key);
+}
+
+RAMFUNC int can_mailbox_write(can_mailbox_t *mb, uint32_t key, uint8_t flags, uint8_t dlc, const uint8_t *data,
+                              uint64_t timestamp_us) {
+  int index = can_mailbox_index(mb, key);
+  can_mailbox_slot_t *slot;
+  can_mailbox_entry_t *e;
+  uint32_t seq;
+
+  if (index < 0) {
+    mb->unknown++;
+    return 1;
+  }
+
+  slot = &mb->slot[index];
+  seq = slot->seq;
+  e = &slot->entry[((seq >> 1) + 1) & 1];   // the copy readers are not pointed at
+
+  // odd while writing: readers of the published copy are unaffected
+  __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  e->timestamp_us = timestamp_us;
+  e->count = slot->entry[(seq >> 1) & 1].count + 1;
+  e->flags = flags;
+  e->dlc = dlc & 0xF;
+  memcpy(e->data, data, fdcan_dlc_to_bytes(dlc));
+
+  __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+
+  return 0;
+}
+
+int can_mailbox_read_index(const can_mailbox_t *mb, int index, can_mailbox_entry_t *out) {
+  const can_mailbox_slot_t *slot;
+  const can_mailbox_entry_t *e;
+  uint32_t seq, retries;
+
+  if (index < 0 || (uint32_t)index >= mb->count) return 1;
+  slot = &mb->slot[index];
+
+  for (retries = 0; retries < CAN_MAILBOX_RETRIES; retries++) {
+    seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (seq < 2) return 1;
+
+    e = &slot->entry[(seq >> 1) & 1];
+    out->timestamp_us = e->timestamp_us;
+    out->count = e->count;
+    out->flags = e->flags;
+    out->dlc = e->dlc;
+    memcpy(out->data, (const void *)e->data, fdcan_dlc_to_bytes(out->dlc));
+
+    // the copy is only rewritten by the write after the next publish
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) - (seq & ~1U) <= 2) return 0;
+  }
+
+  return 2;
+}
+
+int can_mailbox_read(const can_mailbox_t *mb, uint32_t key, can_mailbox_entry_t *out) {
+  return can_mailbox_read_index(mb, can_mailbox_index(mb, key), out);
+}
+
+int can_mailbox_read_fresh(const can_mailbox_t *mb, uint32_t key, uint64_t now_us, uint64_t max_age_us,
+                           can_mailbox_entry_t *out) {
+  int rc = can_mailbox_read(mb, key, out);
+
+  if (rc != 0) return rc;
+  if (now_us > out->timestamp_us && now_us - out->timestamp_us > max_age_us) return 3;
+
+  return 0;
+}
+
+uint32_t can_mailbox_updates(const can_mailbox_t *mb, int index) {
+  if (index < 0 || (uint32_t)index >= mb->count) return 0;
+
+  return __atomic_load_n(&mb->slot[index].seq, __ATOMIC_ACQUIRE) >> 1;
+}
@@ -0,0 +1,66 @@
+#include <stddef.h>
+#include "can/can_mailbox_fdcan.h"
+#include "can/can_bind_fdcan.h"
+#include "nvic.h"
+#include "trace.h"
+#include "timebase.h"
+
+static can_bind_t mailbox_binding[2];   // FDCAN1, FDCAN2
+
+RAMFUNC static void _mailbox_rx_callback(FDCAN_Handle_t *fdcan, const FDCAN_RxElement_t *rx) {
+  can_bind_t *b = can_bind_of(mailbox_binding, fdcan);
+  uint32_t key = rx->Identifier;
+  uint8_t flags = 0;
+
+  if (rx->IdType == FDCAN_EXTENDED_ID) key |= CAN_MAILBOX_EXT;
+  if (rx->FDFormat == FDCAN_FD_CAN) flags |= CAN_MAILBOX_FLAG_FDF;
+  if (rx->BitRateSwitch == FDCAN_BRS_ON) flags |= CAN_MAILBOX_FLAG_BRS;
+  if (rx->ErrorStateIndicator != 0) flags |= CAN_MAILBOX_FLAG_ESI;
+
+  can_mailbox_write(b->ctx, key, flags, (uint8_t)rx->DataLength, rx->Data, timebase_us());
+
+  can_bind_chain(b, fdcan, rx);
+}
+
+int can_mailbox_attach(can_mailbox_t *mb, FDCAN_Handle_t *fdcan) {
+  return can_bind_rx(mailbox_binding, fdcan, mb, _mailbox_rx_callback);
+}
+
+RAMFUNC static void _mailbox_drain(FDCAN_Handle_t *fdcan) {
+  static uint8_t data[64];
+  FDCAN_RxElement_t rx;
+  FDCAN_STATS_ISR_BEGIN();
+
+  rx.Data = data;
+  fdcan_irq_ack(fdcan);
+  while (fdcan_receive(fdcan, &rx, FDCAN_RX_FIFO0) == 0);
+  while (fdcan_receive(fdcan, &rx, FDCAN_RX_FIFO1) == 0);
+  FDCAN_STATS_ISR_END(fdcan);
+}
+
+static void _mailbox_fdcan1_irq(void) {
+  TRACE_ISR_ENTER(FDCAN1_IT0_IRQn);
+  _mailbox_drain(mailbox_binding[0].fdcan);
+  TRACE_ISR_EXIT(FDCAN1_IT0_IRQn);
+}
+
+static void _mailbox_fdcan2_irq(void) {
+  TRACE_ISR_ENTER(FDCAN2_IT0_IRQn);
+  _mailbox_drain(mailbox_binding[1].fdcan);
+  TRACE_ISR_EXIT(FDCAN2_IT0_IRQn);
+}
+
+int can_mailbox_irq_enable(FDCAN_Handle_t *fdcan, uint8_t priority) {
+  int ch = can_bind_channel(fdcan);
+  IRQn_t irqn = (ch == 1) ? FDCAN2_IT0_IRQn : FDCAN1_IT0_IRQn;
+
+  if (ch < 0) return 1;
+
+  mailbox_binding[ch].fdcan = fdcan;
+  irq_register(irqn, (ch == 1) ? _mailbox_fdcan2_irq : _mailbox_fdcan1_irq);
+  nvic_set_priority(irqn, priority);
+  fdcan_irq_enable(fdcan, FDCAN_IT_RX_FIFO0_NEW_MESSAGE | FDCAN_IT_RX_FIFO1_NEW_MESSAGE);
+  nvic_enable_irq(irqn);
+
+  return 0;
+}
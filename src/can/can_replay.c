@@ -0,0 +1,286 @@
+#include <stddef.h>
+#include <string.h>
+#include "can/can_replay.h"
+#include "nvic.h"
+#include "timebase.h"
+#include "usart.h"
+
+#define CAN_REPLAY_STREAM_HEADER  24U
+#define CAN_REPLAY_FILTER_BURST   16U   // filtered frames skipped per poll
+#define CAN_REPLAY_ERR_MAX_US     2000000U   // timing errors are clamped to +-2 s
+
+// Busy-wait step, overridden by simulation builds to advance the simulated cycle counter
+#ifndef CAN_REPLAY_SPIN
+#define CAN_REPLAY_SPIN()
+#endif
+
+/* ---- RAM source ---- */
+
+static int _ram_next(void *ctx, can_trace_frame_t *frame) {
+  can_replay_ram_t *ram = ctx;
+  uint32_t used;
+  int rc;
+
+  while (1) {
+    if (ram->in_block) {
+      rc = can_trace_decode_next(&ram->dec, frame);
+      if (rc > 0) return 0;
+      ram->in_block = false;
+      used = can_trace_block_used(&ram->data[ram->pos]);
+      ram->pos += used; // a corrupt block loses its remaining records only
+    }
+
+    if (ram->pos + CAN_TRACE_HEADER_SIZE > ram->len) return 2;
+
+    if (can_trace_decode_begin(&ram->dec, &ram->data[ram->pos], ram->len - ram->pos) == 0) {
+      ram->in_block = true;
+    } else {
+      ram->pos++; // resynchronise on the next block header
+    }
+  }
+}
+
+void can_replay_ram_init(can_replay_ram_t *ram, const uint8_t *data, uint32_t len, can_replay_source_t *src) {
+  memset(ram, 0, sizeof(*ram));
+  ram->data = data;
+  ram->len = len;
+
+  // skip the export stream header if present
+  if (len >= CAN_REPLAY_STREAM_HEADER && memcmp(data, "CTRC", 4) == 0) {
+    ram->pos = CAN_REPLAY_STREAM_HEADER;
+  }
+
+  src->next = _ram_next;
+  src->ctx = ram;
+}
+
+/* ---- USART source ---- */
+
+static void _uart_credit(can_replay_uart_t *uart) {
+  char c = CAN_REPLAY_UART_CREDIT;
+
+  usart_write(uart->usart, (const uint8_t *)&c, 1);
+}
+
+static void _uart_receive(can_replay_uart_t *uart) {
+  uint8_t *buf = uart->buf[uart->fill];
+  uint32_t used;
+
+  while (!uart->ended) {
+    if (uart->fill_len < uart->need) {
+      uart->fill_len += usart_read(uart->usart, &buf[uart->fill_len], uart->need - uart->fill_len);
+      if (uart->fill_len < uart->need) return;
+    }
+
+    if (!uart->header_done) {
+      // stream header consumed, ask for the first block
+      uart->header_done = true;
+      uart->fill_len = 0;
+      uart->need = CAN_TRACE_HEADER_SIZE;
+      _uart_credit(uart);
+      continue;
+    }
+
+    if (uart->need == CAN_TRACE_HEADER_SIZE) {
+      used = can_trace_block_used(buf);
+      if (used <= CAN_TRACE_HEADER_SIZE || used > CAN_REPLAY_UART_BLOCK_MAX) {
+        uart->ended = true;   // end marker, or a block we cannot hold
+        return;
+      }
+      uart->need = used;
+      continue;
+    }
+
+    // block complete: hand it over once the other buffer has been replayed
+    if (uart->ready) return;
+    uart->ready = true;
+    uart->fill ^= 1;
+    uart->fill_len = 0;
+    uart->need = CAN_TRACE_HEADER_SIZE;
+    _uart_credit(uart);
+    return;
+  }
+}
+
+static int _uart_next(void *ctx, can_trace_frame_t *frame) {
+  can_replay_uart_t *uart = ctx;
+  uint8_t *block;
+
+  _uart_receive(uart);
+
+  while (1) {
+    if (uart->in_block) {
+      if (can_trace_decode_next(&uart->dec, frame) > 0) return 0;
+      uart->in_block = false;
+      uart->ready = false;
+      _uart_receive(uart);    // a complete block may be waiting for this buffer
+    }
+
+    if (!uart->ready) return uart->ended ? 2 : 1;
+
+    block = uart->buf[uart->fill ^ 1];
+    if (can_trace_decode_begin(&uart->dec, block, CAN_REPLAY_UART_BLOCK_MAX) == 0) {
+      uart->in_block = true;
+    } else {
+      uart->ready = false;
+    }
+  }
+}
+
+void can_replay_uart_init(can_replay_uart_t *uart, USART_t *usart, can_replay_source_t *src) {
+  memset(uart, 0, sizeof(*uart));
+  uart->usart = usart;
+  uart->need = CAN_REPLAY_STREAM_HEADER;
+  usart_enable_fifo(usart); // absorbs the bytes arriving while a due frame is awaited
+
+  src->next = _uart_next;
+  src->ctx = uart;
+}
+
+/* ---- Engine ---- */
+
+static bool _replay_pass(const can_replay_config_t *cfg, const can_trace_frame_t *frame) {
+  uint32_t i;
+  bool match = false;
+
+  if (cfg->filter_count == 0) return true;
+
+  for (i = 0; i < cfg->filter_count && !match; i++) {
+    match = ((frame->id ^ cfg->filter_id[i]) & cfg->filter_mask[i]) == 0;
+  }
+  return match != cfg->filter_block;
+}
+
+static void _replay_account(can_replay_t *replay, int64_t err_cycles) {
+  can_replay_stats_t *s = &replay->stats;
+  uint64_t abs_cycles = (uint64_t)((err_cycles < 0) ? -err_cycles : err_cycles);
+  uint32_t max_cycles = timebase_us_to_cycles(CAN_REPLAY_ERR_MAX_US);
+  int32_t err_ns;
+
+  if (abs_cycles > max_cycles) abs_cycles = max_cycles;
+  err_ns = (int32_t)timebase_cycles_to_ns((uint32_t)abs_cycles);
+
+  if (err_cycles < 0) err_ns = -err_ns;
+
+  if (s->sent == 0 || err_ns < s->err_min_ns) s->err_min_ns = err_ns;
+  if (s->sent == 0 || err_ns > s->err_max_ns) s->err_max_ns = err_ns;
+  s->err_sum_ns += err_ns;
+  s->err_abs_sum_ns += (uint32_t)((err_ns < 0) ? -err_ns : err_ns);
+  if ((uint32_t)((err_ns < 0) ? -err_ns : err_ns) > replay->cfg.tolerance_ns) s->late++;
+  s->sent++;
+}
+
+/* Fetch the next frame that passes the filter and schedule it, returns false if none */
+static bool _replay_fetch(can_replay_t *replay) {
+  uint32_t i;
+  uint64_t offset_us;
+  int rc;
+
+  for (i = 0; i < CAN_REPLAY_FILTER_BURST; i++) {
+    rc = replay->src.next(replay->src.ctx, &replay->frame);
+    if (rc == 2) {
+      replay->state = CAN_REPLAY_DONE;
+      return false;
+    }
+    if (rc != 0) {
+      if (!replay->starved && replay->started) replay->stats.underruns++;
+      replay->starved = true;
+      return false;
+    }
+    replay->starved = false;
+
+    if (_replay_pass(&replay->cfg, &replay->frame)) break;
+    replay->stats.filtered++;
+  }
+  if (i == CAN_REPLAY_FILTER_BURST) return false;
+
+  if (!replay->started) {
+    replay->started = true;
+    replay->t0_us = replay->frame.timestamp_us;
+    replay->start_cycles = timebase_cycles() +
+                           (uint64_t)replay->cfg.start_delay_us * timebase_core_hz() / 1000000U;
+  }
+
+  offset_us = (replay->frame.timestamp_us > replay->t0_us) ? (replay->frame.timestamp_us - replay->t0_us) : 0;
+  offset_us = offset_us * 1000U / replay->cfg.speed_permille;
+  replay->due_cycles = replay->start_cycles + offset_us * timebase_core_hz() / 1000000U;
+
+  replay->tx.Identifier = replay->frame.id;
+  replay->tx.IdType = (replay->frame.flags & CAN_TRACE_FLAG_XTD) ? FDCAN_EXTENDED_ID : FDCAN_STANDARD_ID;
+  replay->tx.DataLength = replay->frame.dlc;
+  replay->tx.ErrorStateIndicator = 0;
+  replay->tx.Deadline = 0;
+  replay->tx.FDFormat = (replay->frame.flags & CAN_TRACE_FLAG_FDF) ? FDCAN_FD_CAN : FDCAN_CLASSIC_CAN;
+  replay->tx.BitRateSwitch = (replay->frame.flags & CAN_TRACE_FLAG_BRS) ? FDCAN_BRS_ON : FDCAN_BRS_OFF;
+  replay->tx.Data = replay->frame.data;
+
+  replay->have_frame = true;
+  replay->staged = false;
+  return true;
+}
+
+int can_replay_start(can_replay_t *replay, FDCAN_Handle_t *fdcan, const can_replay_config_t *cfg,
+                     const can_replay_source_t *src) {
+  if (replay == NULL || fdcan == NULL || cfg == NULL || src == NULL || src->next == NULL) return 1;
+  if (cfg->filter_count > CAN_REPLAY_MAX_FILTERS) return 1;
+
+  memset(replay, 0, sizeof(*replay));
+  replay->fdcan = fdcan;
+  replay->cfg = *cfg;
+  replay->src = *src;
+  if (replay->cfg.speed_permille == 0) replay->cfg.speed_permille = 1000;
+  if (replay->cfg.spin_us == 0) replay->cfg.spin_us = 20;
+  if (replay->cfg.tolerance_ns == 0) replay->cfg.tolerance_ns = 1000;
+  replay->state = CAN_REPLAY_RUNNING;
+
+  return 0;
+}
+
+RAMFUNC int can_replay_poll(can_replay_t *replay) {
+  uint32_t primask, due32;
+  uint64_t committed;
+  int64_t remaining;
+
+  if (replay->state != CAN_REPLAY_RUNNING) return 1;
+
+  if (!replay->have_frame && !_replay_fetch(replay)) {
+    return (replay->state == CAN_REPLAY_RUNNING) ? 0 : 1;
+  }
+
+  // prefetch: the frame sits in its TX slot well before it is due
+  if (!replay->staged) {
+    if (fdcan_tx_prepare(replay->fdcan, &replay->tx, &replay->slot) != 0) return 0;
+    replay->staged = true;
+  }
+
+  remaining = (int64_t)(replay->due_cycles - timebase_cycles());
+  if (remaining > (int64_t)timebase_us_to_cycles(replay->cfg.spin_us)) return 0;
+
+  due32 = (uint32_t)replay->due_cycles;
+  primask = irq_save();
+  if (remaining > 0) {
+    // less than spin_us to go: the 32-bit difference cannot wrap
+    while ((int32_t)(timebase_cycles32() - due32) < 0) CAN_REPLAY_SPIN();
+  }
+  fdcan_tx_commit(replay->fdcan, replay->slot);
+  committed = timebase_cycles();
+  irq_restore(primask);
+
+  _replay_account(replay, (int64_t)(committed - replay->due_cycles));
+  replay->have_frame = false;
+  replay->staged = false;
+
+  return 0;
+}
+
+void can_replay_run(can_replay_t *replay) {
+  while (can_replay_poll(replay) == 0);
+}
+
+void can_replay_stop(can_replay_t *replay) {
+  replay->state = CAN_REPLAY_DONE;
+}
+
+void can_replay_get_stats(const can_replay_t *replay, can_replay_stats_t *stats) {
+  *stats = replay->stats;
+}
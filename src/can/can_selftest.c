@@ -0,0 +1,229 @@
+#include <stddef.h>
+#include <string.h>
+#include "stm32h563.h"
+#include "fdcan.h"
+#include "can/can_selftest.h"
+
+#define SELFTEST_FRAME_FLAGS    (CAN_TRACE_FLAG_XTD | CAN_TRACE_FLAG_FDF | CAN_TRACE_FLAG_BRS)
+#define SELFTEST_DRAIN_US       10000U
+
+static uint8_t selftest_crc8[256];
+static bool selftest_crc8_ready;
+
+static void _selftest_crc8_init(void) {
+  uint32_t i, bit;
+  uint8_t crc;
+
+  for (i = 0; i < 256; i++) {
+    crc = (uint8_t)i;
+    for (bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x2F) : (uint8_t)(crc << 1);
+    }
+    selftest_crc8[i] = crc;
+  }
+  selftest_crc8_ready = true;
+}
+
+static inline uint8_t _selftest_crc(const uint8_t *data, uint32_t len) {
+  uint8_t crc = 0xFF;
+  uint32_t i;
+
+  for (i = 0; i < len; i++) {
+    crc = selftest_crc8[crc ^ data[i]];
+  }
+  return crc ^ 0xFF;
+}
+
+static inline uint32_t _selftest_mix(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x45D9F3BU;
+  x ^= x >> 16;
+  x *= 0x45D9F3BU;
+  x ^= x >> 16;
+  return x;
+}
+
+static inline uint32_t _selftest_rand(uint32_t *s) {
+  uint32_t x = *s;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *s = x;
+  return x;
+}
+
+RAMFUNC void can_selftest_frame(const can_selftest_config_t *cfg, uint32_t seq, can_trace_frame_t *frame) {
+  uint32_t s = _selftest_mix(cfg->seed ^ (seq * 0x9E3779B9U)) | 1U;
+  uint32_t r, len, i;
+  uint8_t flags = cfg->extended ? CAN_TRACE_FLAG_XTD : 0, dlc;
+
+  frame->id = cfg->id_min + _selftest_rand(&s) % (cfg->id_max - cfg->id_min + 1U);
+
+  r = _selftest_rand(&s);
+  if ((r % 1000U) < cfg->fd_permille) {
+    flags |= CAN_TRACE_FLAG_FDF;
+    if (((r >> 10) % 1000U) < cfg->brs_permille) flags |= CAN_TRACE_FLAG_BRS;
+  }
+
+  dlc = (uint8_t)(cfg->dlc_min + _selftest_rand(&s) % (uint32_t)(cfg->dlc_max - cfg->dlc_min + 1));
+  if ((flags & CAN_TRACE_FLAG_FDF) == 0 && dlc > 8) dlc = 8;
+
+  frame->timestamp_us = 0;
+  frame->flags = flags;
+  frame->dlc = dlc;
+
+  len = fdcan_dlc_to_bytes(dlc);
+  for (i = 0; i < len && i < 4; i++) {
+    frame->data[i] = (uint8_t)(seq >> (8 * i));
+  }
+  for (r = 0; i < len; i++) {
+    if ((i & 3) == 0) r = _selftest_rand(&s);
+    frame->data[i] = (uint8_t)r;
+    r >>= 8;
+  }
+  if (len >= 6) frame->data[len - 1] = _selftest_crc(frame->data, len - 1);
+}
+
+/* Place a received frame in the sequence and compare it with the frame rebuilt for its number */
+RAMFUNC static void _selftest_check(can_selftest_t *st, const can_trace_frame_t *rx) {
+  uint32_t len = fdcan_dlc_to_bytes(rx->dlc), bits = 0, mask, gap, i;
+
+  for (i = 0; i < len && i < 4; i++) {
+    bits |= (uint32_t)rx->data[i] << (8 * i);
+  }
+  mask = (len >= 4) ? 0xFFFFFFFFU : ((1UL << (8 * len)) - 1U);
+  gap = (bits - st->expect_seq) & mask;
+
+  // only numbers sent and not yet seen are possible: anything else is a duplicate or garbage
+  if (gap >= st->next_seq - st->expect_seq) {
+    st->stats.corrupt++;
+    return;
+  }
+
+  st->stats.lost += gap;
+  st->expect_seq += gap + 1;
+
+  can_selftest_frame(&st->cfg, st->expect_seq - 1, &st->ref);
+  if (rx->id != st->ref.id || (rx->flags & SELFTEST_FRAME_FLAGS) != st->ref.flags || rx->dlc != st->ref.dlc ||
+      memcmp(rx->data, st->ref.data, len) != 0) {
+    st->stats.corrupt++;
+  }
+}
+
+int can_selftest_init(can_selftest_t *st, const can_selftest_config_t *cfg, const can_selftest_port_t *port,
+                      void *ctx) {
+  uint32_t id_limit;
+
+  if (st == NULL || cfg == NULL || port == NULL || port->send == NULL || port->receive == NULL ||
+      port->cycles == NULL || port->now_us == NULL) {
+    return 1;
+  }
+
+  id_limit = cfg->extended ? 0x1FFFFFFFU : 0x7FFU;
+  if (cfg->id_min > cfg->id_max || cfg->id_max > id_limit || cfg->dlc_min > cfg->dlc_max || cfg->dlc_max > 15 ||
+      cfg->fd_permille > 1000 || cfg->brs_permille > 1000) {
+    return 1;
+  }
+  if (cfg->verify && cfg->dlc_max < CAN_SELFTEST_VERIFY_DLC_MIN) return 1;
+
+  if (!selftest_crc8_ready) _selftest_crc8_init();
+
+  memset(st, 0, sizeof(*st));
+  st->port = port;
+  st->ctx = ctx;
+  st->cfg = *cfg;
+  if (st->cfg.drain_us == 0) st->cfg.drain_us = SELFTEST_DRAIN_US;
+  if (st->cfg.verify && st->cfg.dlc_min < CAN_SELFTEST_VERIFY_DLC_MIN) st->cfg.dlc_min = CAN_SELFTEST_VERIFY_DLC_MIN;
+  st->start_us = port->now_us(ctx);
+  st->last_us = st->start_us;
+  st->state = CAN_SELFTEST_RUNNING;
+
+  return 0;
+}
+
+RAMFUNC int can_selftest_poll(can_selftest_t *st) {
+  const can_selftest_port_t *port = st->port;
+  uint32_t start;
+  bool progress = false;
+
+  if (st->state != CAN_SELFTEST_RUNNING && st->state != CAN_SELFTEST_DRAINING) return 1;
+
+  // receive first, in loopback the RX FIFO is only as deep as the TX side
+  for (;;) {
+    start = port->cycles(st->ctx);
+    if (port->receive(st->ctx, &st->rx) != 0) break;
+    st->stats.rx_cycles += (uint32_t)(port->cycles(st->ctx) - start);
+
+    st->stats.received++;
+    st->stats.rx_bytes += fdcan_dlc_to_bytes(st->rx.dlc);
+    if (st->cfg.verify) _selftest_check(st, &st->rx);
+    progress = true;
+  }
+
+  if (st->state == CAN_SELFTEST_RUNNING) {
+    while (st->cfg.frames == 0 || st->next_seq < st->cfg.frames) {
+      if (!st->have_frame) {
+        can_selftest_frame(&st->cfg, st->next_seq, &st->tx);
+        st->have_frame = true;
+      }
+
+      start = port->cycles(st->ctx);
+      if (port->send(st->ctx, &st->tx) != 0) {
+        st->stats.tx_busy++;
+        break;
+      }
+      st->stats.tx_cycles += (uint32_t)(port->cycles(st->ctx) - start);
+
+      st->have_frame = false;
+      st->next_seq++;
+      st->stats.sent++;
+      st->stats.tx_bytes += fdcan_dlc_to_bytes(st->tx.dlc);
+      progress = true;
+    }
+    if (st->cfg.frames != 0 && st->next_seq == st->cfg.frames) st->state = CAN_SELFTEST_DRAINING;
+  }
+
+  if (progress) st->last_us = port->now_us(st->ctx);
+
+  if (st->state == CAN_SELFTEST_DRAINING) {
+    if (st->cfg.verify && st->expect_seq != st->next_seq &&
+        (port->now_us(st->ctx) - st->last_us) <= st->cfg.drain_us) {
+      return 0;
+    }
+
+    // whatever has not come back by now is lost
+    if (st->cfg.verify) st->stats.lost += st->next_seq - st->expect_seq;
+    st->expect_seq = st->next_seq;
+    st->stats.elapsed_us = st->last_us - st->start_us;
+    st->state = CAN_SELFTEST_DONE;
+    return 1;
+  }
+
+  return 0;
+}
+
+void can_selftest_stop(can_selftest_t *st) {
+  if (st->state == CAN_SELFTEST_RUNNING) {
+    st->state = CAN_SELFTEST_DRAINING;
+    st->last_us = st->port->now_us(st->ctx);
+  }
+}
+
+void can_selftest_get_stats(const can_selftest_t *st, can_selftest_stats_t *stats) {
+  uint64_t elapsed;
+
+  *stats = st->stats;
+  if (st->state == CAN_SELFTEST_RUNNING || st->state == CAN_SELFTEST_DRAINING) {
+    stats->elapsed_us = st->port->now_us(st->ctx) - st->start_us;
+  }
+
+  elapsed = (stats->elapsed_us != 0) ? stats->elapsed_us : 1;
+  stats->frames_per_s = (uint32_t)(((uint64_t)stats->sent * 1000000U) / elapsed);
+  stats->bytes_per_s = (uint32_t)((stats->tx_bytes * 1000000U) / elapsed);
+  stats->tx_cycles_per_frame = (stats->sent != 0) ? (uint32_t)(stats->tx_cycles / stats->sent) : 0;
+  stats->rx_cycles_per_frame = (stats->received != 0) ? (uint32_t)(stats->rx_cycles / stats->received) : 0;
+  stats->loss_ppm = (st->cfg.verify && stats->sent != 0)
+                  ? (uint32_t)(((uint64_t)(stats->lost + stats->corrupt) * 1000000U) / stats->sent)
+                  : 0;
+}
@@ -0,0 +1,66 @@
+#include <stddef.h>
+#include "can/can_selftest_fdcan.h"
+#include "timebase.h"
+
+RAMFUNC static int _selftest_fdcan_send(void *ctx, const can_trace_frame_t *frame) {
+  FDCAN_TxElement_t tx;
+
+  tx.Identifier = frame->id;
+  tx.IdType = (frame->flags & CAN_TRACE_FLAG_XTD) ? FDCAN_EXTENDED_ID : FDCAN_STANDARD_ID;
+  tx.DataLength = frame->dlc;
+  tx.ErrorStateIndicator = 0;
+  tx.BitRateSwitch = (frame->flags & CAN_TRACE_FLAG_BRS) ? FDCAN_BRS_ON : FDCAN_BRS_OFF;
+  tx.FDFormat = (frame->flags & CAN_TRACE_FLAG_FDF) ? FDCAN_FD_CAN : FDCAN_CLASSIC_CAN;
+  tx.Deadline = 0;
+  tx.Data = (uint8_t *)frame->data;
+
+  return fdcan_send((FDCAN_Handle_t *)ctx, &tx);
+}
+
+RAMFUNC static int _selftest_fdcan_receive(void *ctx, can_trace_frame_t *frame) {
+  FDCAN_RxElement_t rx;
+
+  rx.Data = frame->data;
+  if (fdcan_receive((FDCAN_Handle_t *)ctx, &rx, FDCAN_RX_FIFO0) != 0) return 1;
+
+  frame->id = rx.Identifier;
+  frame->dlc = (uint8_t)rx.DataLength;
+  frame->flags = 0;
+  if (rx.IdType == FDCAN_EXTENDED_ID) frame->flags |= CAN_TRACE_FLAG_XTD;
+  if (rx.FDFormat == FDCAN_FD_CAN) frame->flags |= CAN_TRACE_FLAG_FDF;
+  if (rx.BitRateSwitch == FDCAN_BRS_ON) frame->flags |= CAN_TRACE_FLAG_BRS;
+  if (rx.ErrorStateIndicator != 0) frame->flags |= CAN_TRACE_FLAG_ESI;
+  frame->timestamp_us = 0;
+
+  return 0;
+}
+
+RAMFUNC static uint32_t _selftest_fdcan_cycles(void *ctx) {
+  (void)ctx;
+  return timebase_cycles32();
+}
+
+static uint64_t _selftest_fdcan_now_us(void *ctx) {
+  (void)ctx;
+  return timebase_us();
+}
+
+static const can_selftest_port_t selftest_fdcan_port = {
+  .send = _selftest_fdcan_send,
+  .receive = _selftest_fdcan_receive,
+  .cycles = _selftest_fdcan_cycles,
+  .now_us = _selftest_fdcan_now_us,
+};
+
+int can_selftest_fdcan_init(can_selftest_t *st, FDCAN_Handle_t *fdcan, const can_selftest_config_t *cfg) {
+  if (fdcan == NULL) return 1;
+
+  return can_selftest_init(st, cfg, &selftest_fdcan_port, fdcan);
+}
+
+void can_selftest_fdcan_run(can_selftest_t *st, can_selftest_stats_t *stats) {
+  while (can_selftest_poll(st) == 0) {
+  }
+
+  can_selftest_get_stats(st, stats);
+}
@@ -0,0 +1,159 @@
+#include <stddef.h>
+#include <string.h>
+#include "can/can_sniffer.h"
+#include "timebase.h"
+
+static const uint8_t sniffer_dlc_words[16] = { 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 4, 5, 6, 8, 12, 16 };
+
+int can_sniffer_init(can_sniffer_t *sn, FDCAN_Handle_t *fdcan, uint32_t *buf, uint32_t words,
+                     uint32_t cycles_per_us) {
+  if (sn == NULL || fdcan == NULL || buf == NULL || words < 2 * CAN_SNIFFER_RECORD_MAX || cycles_per_us == 0) {
+    return 1;
+  }
+
+  memset(sn, 0, sizeof(*sn));
+  sn->fdcan = fdcan;
+  sn->buf = buf;
+  sn->size = words;
+  sn->cycles_per_us = cycles_per_us;
+
+  return 0;
+}
+
+/* Room for n contiguous words: returns the write position, or size if full */
+RAMFUNC static inline uint32_t _sniffer_reserve(can_sniffer_t *sn, uint32_t head, uint32_t n) {
+  uint32_t tail = __atomic_load_n(&sn->tail, __ATOMIC_ACQUIRE);
+
+  if (head >= tail) {
+    // never fill up to tail: head == tail means empty
+    if (sn->size - head > n || (sn->size - head == n && tail != 0)) return head;
+    if (tail > n) {
+      sn->buf[head] = CAN_SNIFFER_PAD;
+      return 0;
+    }
+  } else if (tail - head > n) {
+    return head;
+  }
+
+  return sn->size;
+}
+
+RAMFUNC static inline void _sniffer_store(can_sniffer_t *sn, uint32_t *head, const uint32_t *element,
+                                          uint32_t stamp) {
+  uint32_t n = sniffer_dlc_words[(element[1] >> 16) & 0xF], pos, i, *dst;
+
+  pos = _sniffer_reserve(sn, *head, 3 + n);
+  if (pos == sn->size) {
+    sn->stats.ring_full++;
+    return;
+  }
+
+  dst = &sn->buf[pos];
+  dst[0] = element[0];
+  dst[1] = element[1];
+  dst[2] = stamp;
+  for (i = 0; i < n; i++) {
+    dst[3 + i] = element[2 + i];
+  }
+
+  pos += 3 + n;
+  *head = (pos == sn->size) ? 0 : pos;
+  sn->stats.frames++;
+}
+
+RAMFUNC uint32_t can_sniffer_isr(can_sniffer_t *sn) {
+  FDCAN_Handle_t *fdcan = sn->fdcan;
+  uint32_t ir, n0, n1, i0 = 0, i1 = 0, head = sn->head, stamp, used;
+  const uint32_t *e0, *e1;
+
+  ir = fdcan_irq_ack(fdcan);
+  if (ir & FDCAN_IT_RX_FIFO0_MESSAGE_LOST) sn->stats.fifo_lost[0]++;
+  if (ir & FDCAN_IT_RX_FIFO1_MESSAGE_LOST) sn->stats.fifo_lost[1]++;
+
+  // frames arriving from here on raise the interrupt again
+  n0 = (uint32_t)fdcan_rxfifo_level(fdcan, FDCAN_RX_FIFO0);
+  n1 = (uint32_t)fdcan_rxfifo_level(fdcan, FDCAN_RX_FIFO1);
+  if (n0 > sn->stats.fifo_peak[0]) sn->stats.fifo_peak[0] = n0;
+  if (n1 > sn->stats.fifo_peak[1]) sn->stats.fifo_peak[1] = n1;
+
+  stamp = timebase_cycles32();
+  e0 = (n0 > 0) ? fdcan_rxfifo_peek(fdcan, FDCAN_RX_FIFO0, 0) : NULL;
+  e1 = (n1 > 0) ? fdcan_rxfifo_peek(fdcan, FDCAN_RX_FIFO1, 0) : NULL;
+  while (e0 != NULL || e1 != NULL) {
+    // oldest RX timestamp first, 16-bit wrap-around
+    if (e0 != NULL && (e1 == NULL || (int16_t)(uint16_t)(e0[1] - e1[1]) <= 0)) {
+      _sniffer_store(sn, &head, e0, stamp);
+      e0 = (++i0 < n0) ? fdcan_rxfifo_peek(fdcan, FDCAN_RX_FIFO0, i0) : NULL;
+    } else {
+      _sniffer_store(sn, &head, e1, stamp);
+      e1 = (++i1 < n1) ? fdcan_rxfifo_peek(fdcan, FDCAN_RX_FIFO1, i1) : NULL;
+    }
+  }
+
+  fdcan_rxfifo_release(fdcan, FDCAN_RX_FIFO0, i0);
+  fdcan_rxfifo_release(fdcan, FDCAN_RX_FIFO1, i1);
+  __atomic_store_n(&sn->head, head, __ATOMIC_RELEASE);
+
+  used = can_sniffer_pending(sn);
+  if (used > sn->stats.ring_peak) sn->stats.ring_peak = used;
+
+  return i0 + i1;
+}
+
+int can_sniffer_read(can_sniffer_t *sn, can_trace_frame_t *frame) {
+  uint32_t head = __atomic_load_n(&sn->head, __ATOMIC_ACQUIRE), tail = sn->tail, w0, w1, len;
+  const uint32_t *rec;
+
+  if (tail == head) return 1;
+  if (sn->buf[tail] == CAN_SNIFFER_PAD) {
+    tail = 0;
+    if (tail == head) {
+      __atomic_store_n(&sn->tail, tail, __ATOMIC_RELEASE);
+      return 1;
+    }
+  }
+
+  rec = &sn->buf[tail];
+  w0 = rec[0];
+  w1 = rec[1];
+
+  if (!sn->have_cycles) {
+    sn->last_cycles = rec[2];
+    sn->have_cycles = true;
+  } else {
+    sn->last_cycles += (uint32_t)(rec[2] - (uint32_t)sn->last_cycles);
+  }
+  frame->timestamp_us = sn->last_cycles / sn->cycles_per_us;
+
+  frame->flags = 0;
+  if (w0 & FDCAN_EXTENDED_ID) {
+    frame->id = w0 & 0x1FFFFFFFU;
+    frame->flags |= CAN_TRACE_FLAG_XTD;
+  } else {
+    frame->id = (w0 >> 18) & 0x7FFU;
+  }
+  if (w0 & 0x80000000U) frame->flags |= CAN_TRACE_FLAG_ESI;
+  if (w1 & FDCAN_FD_CAN) frame->flags |= CAN_TRACE_FLAG_FDF;
+  if (w1 & FDCAN_BRS_ON) frame->flags |= CAN_TRACE_FLAG_BRS;
+  frame->dlc = (uint8_t)((w1 >> 16) & 0xF);
+
+  len = fdcan_dlc_to_bytes(frame->dlc);
+  memcpy(frame->data, &rec[3], len);
+
+  tail += 3 + sniffer_dlc_words[frame->dlc];
+  if (tail == sn->size) tail = 0;
+  __atomic_store_n(&sn->tail, tail, __ATOMIC_RELEASE);
+
+  return 0;
+}
+
+uint32_t can_sniffer_pending(const can_sniffer_t *sn) {
+  uint32_t head = __atomic_load_n(&sn->head, __ATOMIC_ACQUIRE);
+  uint32_t tail = __atomic_load_n(&sn->tail, __ATOMIC_ACQUIRE);
+
+  return (head >= tail) ? head - tail : sn->size - tail + head;
+}
+
+void can_sniffer_get_stats(const can_sniffer_t *sn, can_sniffer_stats_t *stats) {
+  *stats = sn->stats;
+}
@@ -0,0 +1,93 @@
+#include <stddef.h>
+#include "can/can_sniffer_fdcan.h"
+#include "nvic.h"
+#include "trace.h"
+#include "timebase.h"
+
+#define SNIFFER_IRQ_SOURCES (FDCAN_IT_RX_FIFO0_NEW_MESSAGE | FDCAN_IT_RX_FIFO0_MESSAGE_LOST | \
+                             FDCAN_IT_RX_FIFO1_NEW_MESSAGE | FDCAN_IT_RX_FIFO1_MESSAGE_LOST)
+
+static can_sniffer_t *sniffer_binding[2];   // FDCAN1, FDCAN2
+
+RAMFUNC static void _sniffer_fdcan1_irq(void) {
+  FDCAN_STATS_ISR_BEGIN();
+
+  TRACE_ISR_ENTER(FDCAN1_IT0_IRQn);
+  (void)can_sniffer_isr(sniffer_binding[0]);
+  FDCAN_STATS_ISR_END(sniffer_binding[0]->fdcan);
+  TRACE_ISR_EXIT(FDCAN1_IT0_IRQn);
+}
+
+RAMFUNC static void _sniffer_fdcan2_irq(void) {
+  FDCAN_STATS_ISR_BEGIN();
+
+  TRACE_ISR_ENTER(FDCAN2_IT0_IRQn);
+  (void)can_sniffer_isr(sniffer_binding[1]);
+  FDCAN_STATS_ISR_END(sniffer_binding[1]->fdcan);
+  TRACE_ISR_EXIT(FDCAN2_IT0_IRQn);
+}
+
+/* Even IDs to Rx FIFO 0, odd IDs to Rx FIFO 1, for both ID types */
+static void _sniffer_filters(FDCAN_Handle_t *fdcan) {
+  FDCAN_Filter_t filter;
+  uint32_t parity;
+
+  for (parity = 0; parity < 2; parity++) {
+    filter.FilterIndex = parity;
+    filter.FilterType = FDCAN_FILTER_MASK;
+    filter.FilterConfig = (parity == 0) ? FDCAN_FILTER_TO_RXFIFO0 : FDCAN_FILTER_TO_RXFIFO1;
+    filter.FilterID1 = parity;
+    filter.FilterID2 = 1;   // mask: only the ID LSB is compared
+
+    filter.IdType = FDCAN_STANDARD_ID;
+    fdcan_set_filter(fdcan, &filter);
+    filter.IdType = FDCAN_EXTENDED_ID;
+    fdcan_set_filter(fdcan, &filter);
+  }
+}
+
+int can_sniffer_start(can_sniffer_t *sn, FDCAN_Handle_t *fdcan, uint32_t *buf, uint32_t words, uint8_t priority) {
+  IRQn_t irqn;
+  int ch;
+
+  if (fdcan == NULL) return 1;
+  if (fdcan->Instance == FDCAN1) ch = 0;
+  else if (fdcan->Instance == FDCAN2) ch = 1;
+  else return 1;
+
+  if (can_sniffer_init(sn, fdcan, buf, words, timebase_core_hz() / 1000000U) != 0) return 1;
+
+  irqn = (ch == 1) ? FDCAN2_IT0_IRQn : FDCAN1_IT0_IRQn;
+  nvic_disable_irq(irqn);
+
+  fdcan->Init.BusMonitor = true;
+  fdcan->Init.Loopback = false;
+  fdcan->Init.StdFiltersNbr = 2;
+  fdcan->Init.ExtFiltersNbr = 2;
+  if (fdcan->Init.TimestampPrescaler == 0) fdcan->Init.TimestampPrescaler = 1;
+  fdcan_init(fdcan);
+  _sniffer_filters(fdcan);
+
+  sniffer_binding[ch] = sn;
+  irq_register(irqn, (ch == 1) ? _sniffer_fdcan2_irq : _sniffer_fdcan1_irq);
+  nvic_set_priority(irqn, priority);
+  fdcan_irq_enable(fdcan, SNIFFER_IRQ_SOURCES);
+  nvic_enable_irq(irqn);
+
+  return 0;
+}
+
+void can_sniffer_stop(can_sniffer_t *sn) {
+  FDCAN_Handle_t *fdcan = sn->fdcan;
+
+  fdcan_irq_disable(fdcan, SNIFFER_IRQ_SOURCES);
+  nvic_disable_irq((fdcan->Instance == FDCAN2) ? FDCAN2_IT0_IRQn : FDCAN1_IT0_IRQn);
+  fdcan_stop(fdcan);
+}
+
+void can_sniffer_snapshot(const can_sniffer_t *sn, can_sniffer_stats_t *stats) {
+  uint32_t primask = irq_save();
+
+  can_sniffer_get_stats(sn, stats);
+  irq_restore(primask);
+}
@@ -0,0 +1,251 @@
+#include <stddef.h>
+#include <string.h>
+#include "can/can_trace.h"
+#include "nvic.h"
+#include "timebase.h"
+#include "usart.h"
+
+static uint8_t trace_ring[CAN_TRACE_BLOCK_COUNT][CAN_TRACE_BLOCK_SIZE];
+static can_trace_encoder_t trace_enc;
+static can_trace_config_t trace_cfg;
+static can_trace_stats_t trace_stats;
+static volatile can_trace_state_t trace_state;
+static uint32_t trace_head;          // block being written
+static uint32_t trace_filled;        // completed blocks behind trace_head
+static uint32_t trace_seq;
+static uint32_t trace_post_left;
+static uint32_t trace_trigger_tag;
+static bool trace_trigger_pending;   // trigger frame seen, seq/time not yet latched
+
+typedef struct {
+  void (*rx_chained)(FDCAN_Handle_t *fdcan, const FDCAN_RxElement_t *rx);
+  void (*tx_chained)(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx, uint32_t marker);
+} trace_binding_t;
+
+static trace_binding_t trace_binding[2];   // FDCAN1, FDCAN2
+
+static void _trace_begin(uint64_t now_us) {
+  can_trace_block_begin(&trace_enc, trace_ring[trace_head], CAN_TRACE_BLOCK_SIZE, trace_seq, now_us);
+}
+
+static void _trace_latch_trigger(uint64_t now_us) {
+  trace_state = CAN_TRACE_TRIGGERED;
+  trace_stats.trigger_seq = trace_seq;
+  trace_stats.trigger_us = now_us;
+  trace_post_left = trace_cfg.post_blocks;
+}
+
+/* Close the current block, returns false when the capture has ended */
+static bool _trace_next_block(uint64_t now_us) {
+  if (trace_state == CAN_TRACE_TRIGGERED && trace_cfg.post_blocks != 0) {
+    if (--trace_post_left == 0) {
+      trace_state = CAN_TRACE_STOPPED;
+      return false;
+    }
+  }
+
+  trace_head = (trace_head + 1) % CAN_TRACE_BLOCK_COUNT;
+  trace_seq++;
+  if (trace_filled < CAN_TRACE_BLOCK_COUNT - 1) {
+    trace_filled++;
+  } else {
+    trace_stats.overwritten++;
+  }
+
+  _trace_begin(now_us);
+  return true;
+}
+
+int can_trace_init(const can_trace_config_t *cfg) {
+  uint32_t primask;
+
+  if (cfg == NULL || cfg->post_blocks >= CAN_TRACE_BLOCK_COUNT) return 1;
+
+  primask = irq_save();
+  trace_cfg = *cfg;
+  trace_trigger_tag = (cfg->trigger_id & cfg->trigger_mask) | (cfg->trigger_ext ? (1UL << 31) : 0);
+  trace_state = CAN_TRACE_IDLE;
+  trace_head = 0;
+  trace_filled = 0;
+  trace_seq = 0;
+  memset(&trace_stats, 0, sizeof(trace_stats));
+  irq_restore(primask);
+
+  return 0;
+}
+
+void can_trace_arm(void) {
+  uint32_t primask = irq_save();
+
+  trace_head = 0;
+  trace_filled = 0;
+  trace_seq = 0;
+  trace_trigger_pending = false;
+  memset(&trace_stats, 0, sizeof(trace_stats));
+  _trace_begin(timebase_us());
+  trace_state = CAN_TRACE_ARMED;
+
+  irq_restore(primask);
+}
+
+void can_trace_trigger(void) {
+  uint32_t primask = irq_save();
+
+  if (trace_state == CAN_TRACE_ARMED) {
+    _trace_latch_trigger(timebase_us());
+  }
+
+  irq_restore(primask);
+}
+
+void can_trace_stop(void) {
+  uint32_t primask = irq_save();
+
+  if (trace_state != CAN_TRACE_IDLE) {
+    trace_state = CAN_TRACE_STOPPED;
+  }
+
+  irq_restore(primask);
+}
+
+can_trace_state_t can_trace_state(void) {
+  return trace_state;
+}
+
+void can_trace_get_stats(can_trace_stats_t *stats) {
+  uint32_t primask = irq_save();
+
+  *stats = trace_stats;
+  irq_restore(primask);
+}
+
+RAMFUNC void can_trace_record(const can_trace_frame_t *frame) {
+  uint32_t primask, n, tag;
+
+  primask = irq_save();
+
+  if (trace_state == CAN_TRACE_ARMED || trace_state == CAN_TRACE_TRIGGERED) {
+    if (trace_state == CAN_TRACE_ARMED && trace_cfg.trigger_mask != 0) {
+      tag = (frame->id & trace_cfg.trigger_mask) | ((frame->flags & CAN_TRACE_FLAG_XTD) ? (1UL << 31) : 0);
+      trace_trigger_pending = (tag == trace_trigger_tag);
+    }
+
+    n = can_trace_encode(&trace_enc, frame);
+    if (n == 0 && _trace_next_block(frame->timestamp_us)) {
+      n = can_trace_encode(&trace_enc, frame);
+    }
+
+    if (n != 0) {
+      trace_stats.frames++;
+      trace_stats.bytes += n;
+      if (trace_trigger_pending) {
+        trace_trigger_pending = false;
+        _trace_latch_trigger(frame->timestamp_us);
+      }
+    }
+  }
+
+  irq_restore(primask);
+}
+
+static uint8_t _trace_channel(const FDCAN_Handle_t *fdcan) {
+  return (fdcan->Instance == FDCAN2) ? 1U : 0U;
+}
+
+static void _trace_rx_callback(FDCAN_Handle_t *fdcan, const FDCAN_RxElement_t *rx) {
+  trace_binding_t *b = &trace_binding[_trace_channel(fdcan)];
+  can_trace_frame_t frame;
+  uint32_t len = fdcan_dlc_to_bytes(rx->DataLength);
+
+  frame.timestamp_us = timebase_us();
+  frame.id = rx->Identifier;
+  frame.dlc = (uint8_t)(rx->DataLength & 0xF);
+  frame.flags = _trace_channel(fdcan);
+  if (rx->IdType == FDCAN_EXTENDED_ID) frame.flags |= CAN_TRACE_FLAG_XTD;
+  if (rx->FDFormat == FDCAN_FD_CAN) frame.flags |= CAN_TRACE_FLAG_FDF;
+  if (rx->BitRateSwitch == FDCAN_BRS_ON) frame.flags |= CAN_TRACE_FLAG_BRS;
+  if (rx->ErrorStateIndicator != 0) frame.flags |= CAN_TRACE_FLAG_ESI;
+  memcpy(frame.data, rx->Data, len);
+
+  can_trace_record(&frame);
+
+  if (b->rx_chained != NULL) {
+    b->rx_chained(fdcan, rx);
+  }
+}
+
+static void _trace_tx_callback(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx, uint32_t marker) {
+  trace_binding_t *b = &trace_binding[_trace_channel(fdcan)];
+  can_trace_frame_t frame;
+  uint32_t len = fdcan_dlc_to_bytes(tx->DataLength);
+
+  frame.timestamp_us = timebase_us();
+  frame.id = tx->Identifier;
+  frame.dlc = (uint8_t)(tx->DataLength & 0xF);
+  frame.flags = CAN_TRACE_FLAG_TX | _trace_channel(fdcan);
+  if (tx->IdType == FDCAN_EXTENDED_ID) frame.flags |= CAN_TRACE_FLAG_XTD;
+  if (tx->FDFormat == FDCAN_FD_CAN) frame.flags |= CAN_TRACE_FLAG_FDF;
+  if (tx->BitRateSwitch == FDCAN_BRS_ON) frame.flags |= CAN_TRACE_FLAG_BRS;
+  if (tx->ErrorStateIndicator != 0) frame.flags |= CAN_TRACE_FLAG_ESI;
+  memcpy(frame.data, tx->Data, len);
+
+  can_trace_record(&frame);
+
+  if (b->tx_chained != NULL) {
+    b->tx_chained(fdcan, tx, marker);
+  }
+}
+
+int can_trace_attach(FDCAN_Handle_t *fdcan) {
+  trace_binding_t *b;
+
+  if (fdcan == NULL || (fdcan->Instance != FDCAN1 && fdcan->Instance != FDCAN2)) return 1;
+
+  b = &trace_binding[_trace_channel(fdcan)];
+  if (fdcan->RxCallback != _trace_rx_callback) {
+    b->rx_chained = fdcan->RxCallback;
+  }
+  if (fdcan->TxCallback != _trace_tx_callback) {
+    b->tx_chained = fdcan->TxCallback;
+  }
+  fdcan->RxCallback = _trace_rx_callback;
+  fdcan->TxCallback = _trace_tx_callback;
+
+  return 0;
+}
+
+static void _trace_put(USART_t *usart, const uint8_t *buf, uint32_t len) {
+  uint32_t i;
+
+  for (i = 0; i < len; i++) {
+    usart_send_char(usart, (char)buf[i]);
+  }
+}
+
+int can_trace_export(USART_t *usart) {
+  uint8_t hdr[24];
+  uint32_t i, count, first, block, used, magic = CAN_TRACE_STREAM_MAGIC;
+
+  if (trace_state == CAN_TRACE_ARMED || trace_state == CAN_TRACE_TRIGGERED) return 1;
+
+  count = (trace_state == CAN_TRACE_STOPPED) ? trace_filled + 1 : 0;
+  first = (trace_head + CAN_TRACE_BLOCK_COUNT - trace_filled) % CAN_TRACE_BLOCK_COUNT;
+
+  memset(hdr, 0, sizeof(hdr));
+  memcpy(&hdr[0], &magic, 4);
+  hdr[4] = CAN_TRACE_STREAM_VER;
+  hdr[6] = (uint8_t)CAN_TRACE_BLOCK_SIZE;
+  hdr[7] = (uint8_t)(CAN_TRACE_BLOCK_SIZE >> 8);
+  memcpy(&hdr[8], &count, 4);
+  memcpy(&hdr[12], &trace_stats.trigger_seq, 4);
+  memcpy(&hdr[16], &trace_stats.trigger_us, 8);
+  _trace_put(usart, hdr, sizeof(hdr));
+
+  for (i = 0; i < count; i++) {
+    block = (first + i) % CAN_TRACE_BLOCK_COUNT;
+    used = can_trace_block_used(trace_ring[block]);
+    _trace_put(usart, trace_ring[block], used);
+  }
+
+  return 0;
+}
@@ -0,0 +1,228 @@
+#include <stddef.h>
+#include <string.h>
+#include "can/can_trace_codec.h"
+#include "fdcan.h"
+
+static void _put_u16(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void _put_u32(uint8_t *p, uint32_t v) {
+  _put_u16(p, v);
+  _put_u16(p + 2, v >> 16);
+}
+
+static uint32_t _get_u16(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static uint32_t _get_u32(const uint8_t *p) {
+  return _get_u16(p) | (_get_u16(p + 2) << 16);
+}
+
+static uint32_t _tag(uint32_t id, uint8_t flags) {
+  return id | ((flags & CAN_TRACE_FLAG_XTD) ? (1UL << 31) : 0);
+}
+
+static can_trace_cache_t *_slot(can_trace_cache_t *cache, uint32_t tag) {
+  uint32_t h = tag ^ (tag >> 7) ^ (tag >> 14);
+
+  return &cache[h & (CAN_TRACE_CACHE_SIZE - 1)];
+}
+
+static void _cache_clear(can_trace_cache_t *cache) {
+  uint32_t i;
+
+  for (i = 0; i < CAN_TRACE_CACHE_SIZE; i++) {
+    cache[i].tag = 0xFFFFFFFFUL;
+  }
+}
+
+void can_trace_block_begin(can_trace_encoder_t *enc, uint8_t *block, uint32_t size, uint32_t seq, uint64_t base_us) {
+  enc->block = block;
+  enc->size = size;
+  enc->used = CAN_TRACE_HEADER_SIZE;
+  enc->last_us = base_us;
+  _cache_clear(enc->cache);
+
+  _put_u16(block, CAN_TRACE_MAGIC);
+  _put_u16(block + 2, CAN_TRACE_HEADER_SIZE);
+  _put_u32(block + 4, seq);
+  _put_u32(block + 8, (uint32_t)base_us);
+  _put_u32(block + 12, (uint32_t)(base_us >> 32));
+}
+
+uint32_t can_trace_encode(can_trace_encoder_t *enc, const can_trace_frame_t *frame) {
+  uint8_t rec[CAN_TRACE_RECORD_MAX];
+  uint8_t mask[8];
+  uint32_t len = fdcan_dlc_to_bytes(frame->dlc);
+  uint32_t n = 0, i, changed = 0, mask_len = (len + 7) / 8;
+  uint32_t tag = _tag(frame->id, frame->flags);
+  uint64_t dt = (frame->timestamp_us > enc->last_us) ? (frame->timestamp_us - enc->last_us) : 0;
+  can_trace_cache_t *slot = _slot(enc->cache, tag);
+  bool delta;
+
+  if (dt > CAN_TRACE_DT_MAX) return 0;
+
+  // payload delta against the previous frame with this ID, if that is smaller
+  delta = (slot->tag == tag) && (slot->len == len) && (len > 0);
+  if (delta) {
+    memset(mask, 0, sizeof(mask));
+    for (i = 0; i < len; i++) {
+      if (frame->data[i] != slot->data[i]) {
+        mask[i >> 3] |= (uint8_t)(1U << (i & 7));
+        changed++;
+      }
+    }
+    delta = (mask_len + changed) < len;
+  }
+
+  rec[n++] = (frame->flags & ~CAN_TRACE_FLAG_DELTA) | (delta ? CAN_TRACE_FLAG_DELTA : 0);
+  rec[n++] = frame->dlc & 0xF;
+
+  do {
+    rec[n++] = (uint8_t)((dt & 0x7F) | ((dt > 0x7F) ? 0x80 : 0));
+    dt >>= 7;
+  } while (dt != 0);
+
+  if (frame->flags & CAN_TRACE_FLAG_XTD) {
+    _put_u32(&rec[n], frame->id);
+    n += 4;
+  } else {
+    _put_u16(&rec[n], frame->id);
+    n += 2;
+  }
+
+  if (delta) {
+    memcpy(&rec[n], mask, mask_len);
+    n += mask_len;
+    for (i = 0; i < len; i++) {
+      if (mask[i >> 3] & (1U << (i & 7))) {
+        rec[n++] = frame->data[i];
+      }
+    }
+  } else {
+    memcpy(&rec[n], frame->data, len);
+    n += len;
+  }
+
+  if (enc->used + n > enc->size) return 0;
+
+  memcpy(&enc->block[enc->used], rec, n);
+  enc->used += n;
+  enc->last_us = frame->timestamp_us;
+  _put_u16(enc->block + 2, enc->used);
+
+  slot->tag = tag;
+  slot->len = (uint8_t)len;
+  memcpy(slot->data, frame->data, len);
+
+  return n;
+}
+
+int can_trace_decode_begin(can_trace_decoder_t *dec, const uint8_t *block, uint32_t size) {
+  uint32_t used;
+
+  if (size < CAN_TRACE_HEADER_SIZE || _get_u16(block) != CAN_TRACE_MAGIC) return 1;
+  used = _get_u16(block + 2);
+  if (used < CAN_TRACE_HEADER_SIZE || used > size) return 1;
+
+  dec->block = block;
+  dec->pos = CAN_TRACE_HEADER_SIZE;
+  dec->used = used;
+  dec->last_us = (uint64_t)_get_u32(block + 8) | ((uint64_t)_get_u32(block + 12) << 32);
+  _cache_clear(dec->cache);
+
+  return 0;
+}
+
+int can_trace_decode_next(can_trace_decoder_t *dec, can_trace_frame_t *frame) {
+  const uint8_t *block = dec->block;
+  can_trace_cache_t *slot;
+  uint32_t pos = dec->pos, used = dec->used, len, mask_len, i, shift, tag;
+  uint64_t dt;
+  const uint8_t *mask;
+  bool delta;
+
+  if (pos >= used) return 0;
+
+  if (pos + 2 > used) return -1;
+  frame->flags = block[pos] & ~CAN_TRACE_FLAG_DELTA;
+  frame->dlc = block[pos + 1] & 0xF;
+  len = fdcan_dlc_to_bytes(frame->dlc);
+  mask_len = (len + 7) / 8;
+  delta = (block[pos] & CAN_TRACE_FLAG_DELTA) != 0;
+  pos += 2;
+
+  dt = 0;
+  shift = 0;
+  do {
+    if (pos >= used || shift > 28) return -1;
+    dt |= (uint64_t)(block[pos] & 0x7F) << shift;
+    shift += 7;
+  } while (block[pos++] & 0x80);
+  dec->last_us += dt;
+  frame->timestamp_us = dec->last_us;
+
+  if (frame->flags & CAN_TRACE_FLAG_XTD) {
+    if (pos + 4 > used) return -1;
+    frame->id = _get_u32(&block[pos]);
+    pos += 4;
+  } else {
+    if (pos + 2 > used) return -1;
+    frame->id = _get_u16(&block[pos]);
+    pos += 2;
+  }
+
+  tag = _tag(frame->id, frame->flags);
+  slot = _slot(dec->cache, tag);
+
+  if (delta) {
+    if (slot->tag != tag || slot->len != len || pos + mask_len > used) return -1;
+    mask = &block[pos];
+    pos += mask_len;
+    for (i = 0; i < len; i++) {
+      if (mask[i >> 3] & (1U << (i & 7))) {
+        if (pos >= used) return -1;
+        frame->data[i] = block[pos++];
+      } else {
+        frame->data[i] = slot->data[i];
+      }
+    }
+  } else {
+    if (pos + len > used) return -1;
+    memcpy(frame->data, &block[pos], len);
+    pos += len;
+  }
+
+  slot->tag = tag;
+  slot->len = (uint8_t)len;
+  memcpy(slot->data, frame->data, len);
+
+  dec->pos = pos;
+  return 1;
+}
+
+int can_trace_decode_block(can_trace_decoder_t *dec, const uint8_t *block, uint32_t size,
+                           can_trace_frame_cb_t cb, void *arg) {
+  can_trace_frame_t frame;
+  int count = 0, rc;
+
+  if (can_trace_decode_begin(dec, block, size) != 0) return -1;
+
+  while ((rc = can_trace_decode_next(dec, &frame)) > 0) {
+    if (cb != NULL) cb(&frame, arg);
+    count++;
+  }
+
+  return (rc < 0) ? -1 : count;
+}
+
+uint32_t can_trace_block_seq(const uint8_t *block) {
+  return _get_u32(block + 4);
+}
+
+uint32_t can_trace_block_used(const uint8_t *block) {
+  return _get_u16(block + 2);
+}
@@ -0,0 +1,123 @@
+#include <stddef.h>
+#include <string.h>
+#include "stm32h563.h"
+#include "fdcan.h"
+#include "can/can_txq.h"
+
+static inline uint32_t _txq_lock(can_txq_t *q) {
+  return (q->port->lock != NULL) ? q->port->lock(q->ctx) : 0;
+}
+
+static inline void _txq_unlock(can_txq_t *q, uint32_t state) {
+  if (q->port->unlock != NULL) q->port->unlock(q->ctx, state);
+}
+
+static void _txq_copy(can_txq_frame_t *dst, const can_txq_frame_t *src) {
+  dst->key = src->key;
+  dst->flags = src->flags;
+  dst->dlc = src->dlc & 0xF;
+  memcpy(dst->data, src->data, fdcan_dlc_to_bytes(dst->dlc));
+}
+
+RAMFUNC static int _txq_submit(can_txq_t *q, const can_txq_frame_t *frame) {
+  uint32_t slot;
+
+  if (q->port->submit(q->ctx, frame, &slot) != 0) return 1;
+
+  if (slot < CAN_TXQ_HW_SLOTS) {
+    q->hw_key[slot] = frame->key;
+    q->hw_valid |= (1UL << slot);
+  }
+  q->stats.submitted++;
+
+  return 0;
+}
+
+/* Cancel every unsent hardware buffer of the frame's ID and submit the frame instead */
+static int _txq_replace(can_txq_t *q, const can_txq_frame_t *frame) {
+  uint32_t slot, cancelled = 0;
+
+  for (slot = 0; slot < CAN_TXQ_HW_SLOTS; slot++) {
+    if ((q->hw_valid & (1UL << slot)) == 0 || q->hw_key[slot] != frame->key) continue;
+
+    q->hw_valid &= ~(1UL << slot);
+    if (q->port->cancel(q->ctx, slot) == 0) cancelled++;
+  }
+
+  if (cancelled == 0 || _txq_submit(q, frame) != 0) return 1;
+  q->stats.replaced++;
+
+  return 0;
+}
+
+RAMFUNC static uint32_t _txq_pump(can_txq_t *q) {
+  uint32_t n = 0;
+
+  while (q->count > 0 && _txq_submit(q, &q->entry[q->head]) == 0) {
+    q->head = (q->head + 1) % CAN_TXQ_DEPTH;
+    q->count--;
+    n++;
+  }
+
+  return n;
+}
+
+void can_txq_init(can_txq_t *q, const can_txq_port_t *port, void *ctx, uint32_t options) {
+  memset(q, 0, sizeof(*q));
+  q->port = port;
+  q->ctx = ctx;
+  q->options = options;
+}
+
+/* Waiting entry of a key, -1 if none */
+static int _txq_find(const can_txq_t *q, uint32_t key) {
+  uint32_t i, e;
+
+  for (i = 0; i < q->count; i++) {
+    e = (q->head + i) % CAN_TXQ_DEPTH;
+    if (q->entry[e].key == key) return (int)e;
+  }
+  return -1;
+}
+
+RAMFUNC int can_txq_push(can_txq_t *q, const can_txq_frame_t *frame) {
+  uint32_t state = _txq_lock(q);
+  int e = _txq_find(q, frame->key), rc = 0;
+
+  if (e >= 0) {
+    // keeps its place in line, only the payload gets fresher
+    _txq_copy(&q->entry[e], frame);
+    q->stats.coalesced++;
+  } else if ((q->options & CAN_TXQ_REPLACE_PENDING) != 0 && _txq_replace(q, frame) == 0) {
+    // the fresh payload took over the cancelled buffer
+  } else if (q->count >= CAN_TXQ_DEPTH) {
+    q->stats.full++;
+    rc = 1;
+  } else {
+    _txq_copy(&q->entry[(q->head + q->count) % CAN_TXQ_DEPTH], frame);
+    q->count++;
+    if (q->count > q->stats.max_depth) q->stats.max_depth = q->count;
+  }
+
+  if (rc == 0) q->stats.pushed++;
+  (void)_txq_pump(q);
+  _txq_unlock(q, state);
+
+  return rc;
+}
+
+RAMFUNC uint32_t can_txq_pump(can_txq_t *q) {
+  uint32_t state = _txq_lock(q);
+  uint32_t n = _txq_pump(q);
+
+  _txq_unlock(q, state);
+  return n;
+}
+
+uint32_t can_txq_pending(const can_txq_t *q) {
+  return q->count;
+}
+
+void can_txq_get_stats(const can_txq_t *q, can_txq_stats_t *stats) {
+  *stats = q->stats;
+}
@@ -0,0 +1,54 @@
+#include <stddef.h>
+#include "can/can_txq_fdcan.h"
+#include "nvic.h"
+
+RAMFUNC static int _txq_fdcan_submit(void *ctx, const can_txq_frame_t *frame, uint32_t *slot) {
+  FDCAN_Handle_t *fdcan = ctx;
+  FDCAN_TxElement_t tx;
+  uint32_t marker;
+
+  tx.Identifier = frame->key & ~CAN_TXQ_EXT;
+  tx.IdType = (frame->key & CAN_TXQ_EXT) ? FDCAN_EXTENDED_ID : FDCAN_STANDARD_ID;
+  tx.DataLength = frame->dlc;
+  tx.ErrorStateIndicator = 0;
+  tx.Deadline = 0;
+  tx.FDFormat = (frame->flags & CAN_TXQ_FLAG_FDF) ? FDCAN_FD_CAN : FDCAN_CLASSIC_CAN;
+  tx.BitRateSwitch = (frame->flags & CAN_TXQ_FLAG_BRS) ? FDCAN_BRS_ON : FDCAN_BRS_OFF;
+  tx.Data = (uint8_t *)frame->data;
+
+  // prepare/commit instead of fdcan_send() to learn which buffer the frame is in
+  if (fdcan_tx_prepare(fdcan, &tx, slot) != 0) return 1;
+  marker = fdcan_tx_marker(fdcan, *slot);
+  fdcan_tx_commit(fdcan, *slot);
+
+  if (fdcan->TxCallback != NULL) {
+    fdcan->TxCallback(fdcan, &tx, marker);
+  }
+
+  return 0;
+}
+
+static int _txq_fdcan_cancel(void *ctx, uint32_t slot) {
+  return fdcan_tx_cancel((FDCAN_Handle_t *)ctx, slot);
+}
+
+static uint32_t _txq_fdcan_lock(void *ctx) {
+  (void)ctx;
+  return irq_save();
+}
+
+static void _txq_fdcan_unlock(void *ctx, uint32_t state) {
+  (void)ctx;
+  irq_restore(state);
+}
+
+static const can_txq_port_t txq_fdcan_port = {
+  .submit = _txq_fdcan_submit,
+  .cancel = _txq_fdcan_cancel,
+  .lock = _txq_fdcan_lock,
+  .unlock = _txq_fdcan_unlock,
+};
+
+void can_txq_fdcan_init(can_txq_t *q, FDCAN_Handle_t *fdcan, uint32_t options) {
+  can_txq_init(q, &txq_fdcan_port, fdcan, options);
+}
@@ -0,0 +1,258 @@
+#include <stddef.h>
+#include <string.h>
+#include "can/slcan.h"
+#include "fdcan.h"
+
+#define SLCAN_OK      '\r'
+#define SLCAN_ERROR   '\a'
+
+static const uint32_t slcan_nominal_bps[9] = { 10000, 20000, 50000, 100000, 125000, 250000, 500000, 800000, 1000000 };
+static const char slcan_hex[16] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F' };
+
+/* ASCII -> nibble + 1, 0 for anything that is not a hex digit */
+static const uint8_t slcan_nibble[256] = {
+  ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+  ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+  ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+};
+
+static int _slcan_hex(const char *s, uint32_t digits, uint32_t *value) {
+  uint32_t v = 0, i, n;
+
+  for (i = 0; i < digits; i++) {
+    n = slcan_nibble[(uint8_t)s[i]];
+    if (n == 0) return 1;
+    v = (v << 4) | (n - 1);
+  }
+  *value = v;
+  return 0;
+}
+
+uint32_t slcan_format_frame(const slcan_frame_t *frame, int32_t timestamp_ms, char *out) {
+  uint32_t n = 0, i, len = fdcan_dlc_to_bytes(frame->dlc);
+  uint32_t digits = (frame->flags & SLCAN_FRAME_XTD) ? 8 : 3;
+  char cmd;
+
+  if (frame->flags & SLCAN_FRAME_BRS) {
+    cmd = 'b';
+  } else if (frame->flags & SLCAN_FRAME_FDF) {
+    cmd = 'd';
+  } else {
+    cmd = 't';
+  }
+  out[n++] = (frame->flags & SLCAN_FRAME_XTD) ? (char)(cmd - 'a' + 'A') : cmd;
+
+  for (i = digits; i > 0; i--) {
+    out[n + i - 1] = slcan_hex[(frame->id >> (4 * (digits - i))) & 0xF];
+  }
+  n += digits;
+  out[n++] = slcan_hex[frame->dlc & 0xF];
+
+  for (i = 0; i < len; i++) {
+    out[n++] = slcan_hex[frame->data[i] >> 4];
+    out[n++] = slcan_hex[frame->data[i] & 0xF];
+  }
+
+  if (timestamp_ms >= 0) {
+    out[n++] = slcan_hex[(timestamp_ms >> 12) & 0xF];
+    out[n++] = slcan_hex[(timestamp_ms >> 8) & 0xF];
+    out[n++] = slcan_hex[(timestamp_ms >> 4) & 0xF];
+    out[n++] = slcan_hex[timestamp_ms & 0xF];
+  }
+  out[n++] = '\r';
+
+  return n;
+}
+
+int slcan_parse_frame(const char *line, uint32_t len, slcan_frame_t *frame) {
+  uint32_t digits, value, i, bytes, pos;
+  char cmd = line[0];
+
+  frame->flags = 0;
+  if (cmd >= 'A' && cmd <= 'Z') {
+    frame->flags |= SLCAN_FRAME_XTD;
+    cmd = (char)(cmd - 'A' + 'a');
+  }
+  if (cmd == 'b') {
+    frame->flags |= SLCAN_FRAME_FDF | SLCAN_FRAME_BRS;
+  } else if (cmd == 'd') {
+    frame->flags |= SLCAN_FRAME_FDF;
+  } else if (cmd != 't') {
+    return 1;
+  }
+
+  digits = (frame->flags & SLCAN_FRAME_XTD) ? 8 : 3;
+  if (len < 1 + digits + 1) return 1;
+  if (_slcan_hex(&line[1], digits, &value)) return 1;
+  if (value > ((frame->flags & SLCAN_FRAME_XTD) ? 0x1FFFFFFFUL : 0x7FFUL)) return 1;
+  frame->id = value;
+
+  if (_slcan_hex(&line[1 + digits], 1, &value)) return 1;
+  if (value > 8 && !(frame->flags & SLCAN_FRAME_FDF)) return 1;
+  frame->dlc = (uint8_t)value;
+
+  bytes = fdcan_dlc_to_bytes(value);
+  pos = 2 + digits;
+  if (len != pos + 2 * bytes) return 1;
+
+  for (i = 0; i < bytes; i++, pos += 2) {
+    if (_slcan_hex(&line[pos], 2, &value)) return 1;
+    frame->data[i] = (uint8_t)value;
+  }
+
+  return 0;
+}
+
+static uint8_t *_slcan_reserve(slcan_t *slcan, uint32_t len) {
+  uint32_t pending;
+
+  if (SLCAN_OUT_SIZE - slcan->out_head < len) {
+    // compact: move the unsent bytes to the front of the buffer
+    pending = slcan->out_head - slcan->out_tail;
+    memmove(slcan->out, &slcan->out[slcan->out_tail], pending);
+    slcan->out_tail = 0;
+    slcan->out_head = pending;
+    if (SLCAN_OUT_SIZE - pending < len) return NULL;
+  }
+  return &slcan->out[slcan->out_head];
+}
+
+static void _slcan_reply(slcan_t *slcan, const char *text, uint32_t len) {
+  uint8_t *p = _slcan_reserve(slcan, len);
+
+  // replies are never dropped silently on a healthy link, the host waits for them
+  if (p != NULL) {
+    memcpy(p, text, len);
+    slcan->out_head += len;
+  }
+}
+
+static void _slcan_flush(slcan_t *slcan) {
+  uint32_t n;
+
+  if (slcan->out_head == slcan->out_tail) return;
+
+  n = slcan->port->write(slcan->ctx, &slcan->out[slcan->out_tail], slcan->out_head - slcan->out_tail);
+  slcan->out_tail += n;
+  if (slcan->out_tail == slcan->out_head) {
+    slcan->out_tail = 0;
+    slcan->out_head = 0;
+  }
+}
+
+static bool _slcan_command(slcan_t *slcan, const char *line, uint32_t len) {
+  slcan_frame_t frame;
+  uint32_t n;
+
+  switch (line[0]) {
+    case 'S':
+      if (len != 2 || slcan->is_open || line[1] < '0' || line[1] > '8') return false;
+      slcan->nominal_bps = slcan_nominal_bps[line[1] - '0'];
+      return true;
+
+    case 'Y':
+      if (len != 2 || slcan->is_open) return false;
+      n = (uint32_t)(line[1] - '0');
+      if (n != 1 && n != 2 && n != 4 && n != 5 && n != 8) return false;
+      slcan->data_bps = n * 1000000UL;
+      return true;
+
+    case 'O':
+    case 'L':
+      if (len != 1 || slcan->is_open) return false;
+      if (slcan->port->open(slcan->ctx, slcan->nominal_bps, slcan->data_bps, line[0] == 'L') != 0) return false;
+      slcan->is_open = true;
+      return true;
+
+    case 'C':
+      if (len != 1) return false;
+      if (slcan->is_open) slcan->port->close(slcan->ctx);
+      slcan->is_open = false;
+      return true;
+
+    case 'Z':
+      if (len != 2 || (line[1] != '0' && line[1] != '1')) return false;
+      slcan->timestamps = (line[1] == '1');
+      return true;
+
+    case 'V':
+      _slcan_reply(slcan, "V1013", 5);
+      return true;
+
+    case 'N':
+      _slcan_reply(slcan, "NFDC1", 5);
+      return true;
+
+    case 'F':
+      _slcan_reply(slcan, "F00", 3);
+      return true;
+
+    case 't': case 'T': case 'd': case 'D': case 'b': case 'B':
+      if (!slcan->is_open || slcan_parse_frame(line, len, &frame) != 0) return false;
+      if (slcan->port->send(slcan->ctx, &frame) != 0) {
+        slcan->stats.tx_full++;
+        return false;
+      }
+      slcan->stats.tx_frames++;
+      _slcan_reply(slcan, (frame.flags & SLCAN_FRAME_XTD) ? "Z" : "z", 1);
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+void slcan_init(slcan_t *slcan, const slcan_port_t *port, void *ctx) {
+  memset(slcan, 0, sizeof(*slcan));
+  slcan->port = port;
+  slcan->ctx = ctx;
+  slcan->nominal_bps = 500000;
+  slcan->data_bps = 2000000;
+}
+
+void slcan_input(slcan_t *slcan, const uint8_t *buf, uint32_t len) {
+  uint32_t i;
+  char c;
+
+  for (i = 0; i < len; i++) {
+    c = (char)buf[i];
+
+    if (c == '\r' || c == '\n') {
+      if (slcan->line_len == 0) continue; // empty line or LF of CRLF
+      if (slcan->line_len > SLCAN_LINE_MAX || !_slcan_command(slcan, slcan->line, slcan->line_len)) {
+        slcan->stats.errors++;
+        _slcan_reply(slcan, "\a", 1);
+      } else {
+        _slcan_reply(slcan, "\r", 1);
+      }
+      slcan->line_len = 0;
+    } else if (slcan->line_len < SLCAN_LINE_MAX) {
+      slcan->line[slcan->line_len++] = c;
+    } else if (slcan->line_len == SLCAN_LINE_MAX) {
+      slcan->stats.overflows++;
+      slcan->line_len++; // reject the whole line at its CR
+    }
+  }
+}
+
+void slcan_poll(slcan_t *slcan) {
+  uint8_t buf[64];
+  uint32_t n;
+  slcan_frame_t frame;
+  uint8_t *p;
+  int32_t ts;
+
+  while ((n = slcan->port->read(slcan->ctx, buf, sizeof(buf))) > 0) {
+    slcan_input(slcan, buf, n);
+  }
+
+  // received frames stay in the controller while the serial side is behind
+  while (slcan->is_open && (p = _slcan_reserve(slcan, SLCAN_LINE_MAX)) != NULL) {
+    if (slcan->port->receive(slcan->ctx, &frame) != 0) break;
+    ts = slcan->timestamps ? (int32_t)(slcan->port->time_ms(slcan->ctx) % 60000U) : -1;
+    slcan->out_head += slcan_format_frame(&frame, ts, (char *)p);
+    slcan->stats.rx_frames++;
+  }
+
+  _slcan_flush(slcan);
+}
@@ -0,0 +1,125 @@
+#include <stddef.h>
+#include <string.h>
+#include "can/slcan_fdcan.h"
+#include "rcc.h"
+#include "timebase.h"
+#include "usart.h"
+
+#define SLCAN_NOMINAL_SP_PERMILLE   875U
+#define SLCAN_DATA_SP_PERMILLE      750U
+
+typedef struct {
+  FDCAN_Handle_t *fdcan;
+  USART_t *usart;
+} slcan_fdcan_ctx_t;
+
+static slcan_fdcan_ctx_t slcan_fdcan_ctx;
+
+static int _slcan_fdcan_open(void *ctx, uint32_t nominal_bps, uint32_t data_bps, bool listen_only) {
+  slcan_fdcan_ctx_t *c = ctx;
+  FDCAN_BitTiming_t nominal, data;
+  uint32_t clk = rcc_get_fdcan_clk_hz();
+  bool fd = true;
+
+  if (fdcan_calc_bittiming(clk, nominal_bps, SLCAN_NOMINAL_SP_PERMILLE, false, &nominal) != 0) return 1;
+  // a data rate the kernel clock cannot produce leaves the channel classic-only
+  if (fdcan_calc_bittiming(clk, data_bps, SLCAN_DATA_SP_PERMILLE, true, &data) != 0) fd = false;
+
+  c->fdcan->Init.NominalPrescaler = nominal.Prescaler;
+  c->fdcan->Init.NominalSyncJumpWidth = nominal.SyncJumpWidth;
+  c->fdcan->Init.NominalTimeSeg1 = nominal.TimeSeg1;
+  c->fdcan->Init.NominalTimeSeg2 = nominal.TimeSeg2;
+  c->fdcan->Init.FDMode = fd;
+  if (fd) {
+    c->fdcan->Init.DataPrescaler = data.Prescaler;
+    c->fdcan->Init.DataSyncJumpWidth = data.SyncJumpWidth;
+    c->fdcan->Init.DataTimeSeg1 = data.TimeSeg1;
+    c->fdcan->Init.DataTimeSeg2 = data.TimeSeg2;
+  }
+  c->fdcan->Init.BusMonitor = listen_only;
+  c->fdcan->Init.Loopback = false;
+  c->fdcan->Init.StdFiltersNbr = 0;  // non-matching frames are accepted into FIFO0
+  c->fdcan->Init.ExtFiltersNbr = 0;
+  c->fdcan->Init.TxQueue = false;
+
+  return fdcan_init(c->fdcan);
+}
+
+static void _slcan_fdcan_close(void *ctx) {
+  slcan_fdcan_ctx_t *c = ctx;
+
+  fdcan_stop(c->fdcan);
+}
+
+static int _slcan_fdcan_send(void *ctx, const slcan_frame_t *frame) {
+  slcan_fdcan_ctx_t *c = ctx;
+  FDCAN_TxElement_t tx;
+  uint8_t data[64];
+
+  memcpy(data, frame->data, fdcan_dlc_to_bytes(frame->dlc));
+  tx.Identifier = frame->id;
+  tx.IdType = (frame->flags & SLCAN_FRAME_XTD) ? FDCAN_EXTENDED_ID : FDCAN_STANDARD_ID;
+  tx.DataLength = frame->dlc;
+  tx.ErrorStateIndicator = 0;
+  tx.Deadline = 0;
+  tx.FDFormat = (frame->flags & SLCAN_FRAME_FDF) ? FDCAN_FD_CAN : FDCAN_CLASSIC_CAN;
+  tx.BitRateSwitch = (frame->flags & SLCAN_FRAME_BRS) ? FDCAN_BRS_ON : FDCAN_BRS_OFF;
+  tx.Data = data;
+
+  if ((frame->flags & SLCAN_FRAME_FDF) && !c->fdcan->Init.FDMode) return 1;
+
+  return fdcan_send(c->fdcan, &tx);
+}
+
+static int _slcan_fdcan_receive(void *ctx, slcan_frame_t *frame) {
+  slcan_fdcan_ctx_t *c = ctx;
+  FDCAN_RxElement_t rx;
+
+  if (fdcan_rxfifo_level(c->fdcan, FDCAN_RX_FIFO0) == 0) return 1;
+
+  rx.Data = frame->data;
+  if (fdcan_receive(c->fdcan, &rx, FDCAN_RX_FIFO0) != 0) return 1;
+
+  frame->id = rx.Identifier;
+  frame->dlc = (uint8_t)rx.DataLength;
+  frame->flags = 0;
+  if (rx.IdType == FDCAN_EXTENDED_ID) frame->flags |= SLCAN_FRAME_XTD;
+  if (rx.FDFormat == FDCAN_FD_CAN) frame->flags |= SLCAN_FRAME_FDF;
+  if (rx.BitRateSwitch == FDCAN_BRS_ON) frame->flags |= SLCAN_FRAME_BRS;
+
+  return 0;
+}
+
+static uint32_t _slcan_fdcan_read(void *ctx, uint8_t *buf, uint32_t max) {
+  return usart_read(((slcan_fdcan_ctx_t *)ctx)->usart, buf, max);
+}
+
+static uint32_t _slcan_fdcan_write(void *ctx, const uint8_t *buf, uint32_t len) {
+  return usart_write(((slcan_fdcan_ctx_t *)ctx)->usart, buf, len);
+}
+
+static uint32_t _slcan_fdcan_time_ms(void *ctx) {
+  (void)ctx;
+  return timebase_ms();
+}
+
+static const slcan_port_t slcan_fdcan_port = {
+  .open = _slcan_fdcan_open,
+  .close = _slcan_fdcan_close,
+  .send = _slcan_fdcan_send,
+  .receive = _slcan_fdcan_receive,
+  .read = _slcan_fdcan_read,
+  .write = _slcan_fdcan_write,
+  .time_ms = _slcan_fdcan_time_ms,
+};
+
+int slcan_fdcan_init(slcan_t *slcan, FDCAN_Handle_t *fdcan, USART_t *usart) {
+  if (slcan == NULL || fdcan == NULL || usart == NULL) return 1;
+
+  slcan_fdcan_ctx.fdcan = fdcan;
+  slcan_fdcan_ctx.usart = usart;
+  usart_enable_fifo(usart);
+  slcan_init(slcan, &slcan_fdcan_port, &slcan_fdcan_ctx);
+
+  return 0;
+}
@@ -1,8 +1,11 @@
 #include <stdbool.h>
 #include <stddef.h>
+#include <string.h>
 #include "fdcan.h"
 #include "rcc.h"
 #include "gpio.h"
+#include "nvic.h"
+#include "trace.h"
 #include "stm32h563.h"
 
 #define FDCAN_ELEMENT_MASK_STDID ((uint32_t)0x1FFC0000U) /* Standard Identifier         */
@@ -20,36 +23,147 @@
 #define FDCAN_ELEMENT_MASK_ANMF  ((uint32_t)0x80000000U) /* Accepted Non-matching Frame */
 #define FDCAN_ELEMENT_MASK_ET    ((uint32_t)0x00C00000U) /* Event type                  */
 
-#define SRAMCAN_FLS_NBR                  (28U)         /* Max. Filter List Standard Number      */
-#define SRAMCAN_FLE_NBR                  ( 8U)         /* Max. Filter List Extended Number      */
-#define SRAMCAN_RF0_NBR                  ( 3U)         /* RX FIFO 0 Elements Number             */
-#define SRAMCAN_RF1_NBR                  ( 3U)         /* RX FIFO 1 Elements Number             */
-#define SRAMCAN_TEF_NBR                  ( 3U)         /* TX Event FIFO Elements Number         */
-#define SRAMCAN_TFQ_NBR                  ( 3U)         /* TX FIFO/Queue Elements Number         */
-
-#define SRAMCAN_FLS_SIZE            ( 1U * 4U)         /* Filter Standard Element Size in bytes */
-#define SRAMCAN_FLE_SIZE            ( 2U * 4U)         /* Filter Extended Element Size in bytes */
-#define SRAMCAN_RF0_SIZE            (18U * 4U)         /* RX FIFO 0 Elements Size in bytes      */
-#define SRAMCAN_RF1_SIZE            (18U * 4U)         /* RX FIFO 1 Elements Size in bytes      */
-#define SRAMCAN_TEF_SIZE            ( 2U * 4U)         /* TX Event FIFO Elements Size in bytes  */
-#define SRAMCAN_TFQ_SIZE            (18U * 4U)         /* TX FIFO/Queue Elements Size in bytes  */
-
-#define SRAMCAN_FLSSA ((uint32_t)0)                                                      /* Filter List Standard Start
-                                                                                            Address                  */
-#define SRAMCAN_FLESA ((uint32_t)(SRAMCAN_FLSSA + (SRAMCAN_FLS_NBR * SRAMCAN_FLS_SIZE))) /* Filter List Extended Start
-                                                                                            Address                  */
-#define SRAMCAN_RF0SA ((uint32_t)(SRAMCAN_FLESA + (SRAMCAN_FLE_NBR * SRAMCAN_FLE_SIZE))) /* Rx FIFO 0 Start Address  */
-#define SRAMCAN_RF1SA ((uint32_t)(SRAMCAN_RF0SA + (SRAMCAN_RF0_NBR * SRAMCAN_RF0_SIZE))) /* Rx FIFO 1 Start Address  */
-#define SRAMCAN_TEFSA ((uint32_t)(SRAMCAN_RF1SA + (SRAMCAN_RF1_NBR * SRAMCAN_RF1_SIZE))) /* Tx Event FIFO Start
-                                                                                            Address */
-#define SRAMCAN_TFQSA ((uint32_t)(SRAMCAN_TEFSA + (SRAMCAN_TEF_NBR * SRAMCAN_TEF_SIZE))) /* Tx FIFO/Queue Start
-                                                                                            Address                  */
-#define SRAMCAN_SIZE  ((uint32_t)(SRAMCAN_TFQSA + (SRAMCAN_TFQ_NBR * SRAMCAN_TFQ_SIZE))) /* Message RAM size         */
+#define FDCAN_RXFS_FL            ((uint32_t)0x0000000FU) /* Rx FIFO fill level          */
+#define FDCAN_RXFS_RFL           ((uint32_t)0x02000000U) /* Rx FIFO message lost        */
+
+#define FDCAN_TX_MASK            ((uint32_t)((1U << FDCAN_TX_BUFFERS) - 1U)) /* All Tx buffers */
+
+// CCCR reads fdcan_stop() waits for INIT: at least 0.6 s at 250 MHz, the longest frame
+// (64 bytes, no BRS, 10 kbit/s) ends within 70 ms
+#define FDCAN_STOP_POLLS         (50000000U)
+
+// Tx buffer add request, overridden by simulation builds to model TXBRP
+#ifndef FDCAN_TXBAR_WRITE
+#define FDCAN_TXBAR_WRITE(instance, bits)  ((instance)->TXBAR = (bits))
+#endif
+
+// Gap between the TXBRP read and the reservation in fdcan_send_mp(), simulation builds yield in it
+#ifndef FDCAN_MP_RESERVE_GAP
+#define FDCAN_MP_RESERVE_GAP()
+#endif
+
+#ifdef FDCAN_STATS
+#define FDCAN_STATS_ID_PROBES    (8U)
+
+RAMFUNC static FDCAN_IdStats_t *_fdcan_stats_id(FDCAN_Handle_t *fdcan, uint32_t key) {
+  FDCAN_IdStats_t *e;
+  uint32_t i, slot, expected;
+
+  slot = (key * 2654435761U) >> 16; // Fibonacci hashing spreads consecutive IDs
+  for (i = 0; i < FDCAN_STATS_ID_PROBES; i++) {
+    e = &fdcan->IdStats[(slot + i) & fdcan->IdStatsMask];
+    if (e->Key == key) return e;
+    if (e->Key != FDCAN_STATS_ID_FREE) continue;
+
+    // the Rx interrupt and a thread sending may claim the same free slot
+    expected = FDCAN_STATS_ID_FREE;
+    if (__atomic_compare_exchange_n(&e->Key, &expected, key, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED) ||
+        expected == key) {
+      return e;
+    }
+  }
+
+  __atomic_fetch_add(&fdcan->Stats.IdOverflow, 1U, __ATOMIC_RELAXED);   // Rx interrupt and senders alike
+  return NULL;
+}
+
+// Plain inline, not RAMFUNC (noinline): the counters fold into their RAMFUNC callers
+static inline void _fdcan_stats_rx(FDCAN_Handle_t *fdcan, uint32_t key, uint32_t bytes) {
+  FDCAN_IdStats_t *e;
+
+  fdcan->Stats.RxFrames++;
+  fdcan->Stats.RxBytes += bytes;
+  if (fdcan->IdStats != NULL && (e = _fdcan_stats_id(fdcan, key)) != NULL) e->RxFrames++;
+}
+
+static inline uint32_t _fdcan_stats_tx_key(const FDCAN_TxElement_t *tx) {
+  return (tx->IdType == FDCAN_EXTENDED_ID) ? ((tx->Identifier & FDCAN_ELEMENT_MASK_EXTID) | FDCAN_EXTENDED_ID)
+                                           : tx->Identifier;
+}
+
+static inline void _fdcan_stats_tx(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx, uint32_t bytes) {
+  FDCAN_IdStats_t *e;
+
+  fdcan->Stats.TxFrames++;
+  fdcan->Stats.TxBytes += bytes;
+  if (fdcan->IdStats != NULL && (e = _fdcan_stats_id(fdcan, _fdcan_stats_tx_key(tx))) != NULL) e->TxFrames++;
+}
+
+/* fdcan_send_mp(): a producer may preempt another between the load and the store of an increment */
+static inline void _fdcan_stats_tx_mp(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx, uint32_t bytes) {
+  FDCAN_IdStats_t *e;
+
+  __atomic_fetch_add(&fdcan->Stats.TxFrames, 1U, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&fdcan->Stats.TxBytes, bytes, __ATOMIC_RELAXED);
+  if (fdcan->IdStats != NULL && (e = _fdcan_stats_id(fdcan, _fdcan_stats_tx_key(tx))) != NULL) {
+    __atomic_fetch_add(&e->TxFrames, 1U, __ATOMIC_RELAXED);
+  }
+}
+
+/* Fill level and message lost flag of the RXFnS value the caller read anyway */
+static inline void _fdcan_stats_rxfifo(FDCAN_Handle_t *fdcan, FDCAN_RxFIFO_t fifo, uint32_t status) {
+  uint32_t lost_it = (fifo == FDCAN_RX_FIFO0) ? FDCAN_IT_RX_FIFO0_MESSAGE_LOST : FDCAN_IT_RX_FIFO1_MESSAGE_LOST;
+
+  if ((status & FDCAN_RXFS_FL) > fdcan->Stats.RxHighWater[fifo]) {
+    fdcan->Stats.RxHighWater[fifo] = status & FDCAN_RXFS_FL;
+  }
+
+  // with its interrupt enabled RFnL is counted (and cleared) by fdcan_irq_ack()
+  if ((status & FDCAN_RXFS_RFL) != 0 && (fdcan->Instance->IE & lost_it) == 0) {
+    fdcan->Stats.RxLost[fifo]++;
+    fdcan->Instance->IR = lost_it;
+  }
+}
+
+static inline void _fdcan_stats_lost(FDCAN_Handle_t *fdcan, uint32_t ir) {
+  if ((ir & (FDCAN_IT_RX_FIFO0_MESSAGE_LOST | FDCAN_IT_RX_FIFO1_MESSAGE_LOST)) == 0) return;
+
+  if (ir & FDCAN_IT_RX_FIFO0_MESSAGE_LOST) fdcan->Stats.RxLost[0]++;
+  if (ir & FDCAN_IT_RX_FIFO1_MESSAGE_LOST) fdcan->Stats.RxLost[1]++;
+}
+
+/* Frames released unread by fdcan_rxfifo_release(), decoded from their element header */
+RAMFUNC static void _fdcan_stats_release(FDCAN_Handle_t *fdcan, FDCAN_RxFIFO_t fifo, uint32_t status, uint32_t count) {
+  uintptr_t base = (fifo == FDCAN_RX_FIFO0) ? fdcan->msgRam.RxFIFO0SA : fdcan->msgRam.RxFIFO1SA;
+  uint32_t elements = (fifo == FDCAN_RX_FIFO0) ? SRAMCAN_RF0_NBR : SRAMCAN_RF1_NBR;
+  uint32_t size = (fifo == FDCAN_RX_FIFO0) ? SRAMCAN_RF0_SIZE : SRAMCAN_RF1_SIZE;
+  const uint32_t *e;
+  uint32_t i, key;
+
+  _fdcan_stats_rxfifo(fdcan, fifo, status);
+  if (count > (status & FDCAN_RXFS_FL)) count = status & FDCAN_RXFS_FL;
+
+  for (i = 0; i < count; i++) {
+    e = (const uint32_t *)(base + (((((status >> 8) & 0b11) + i) % elements) * size));
+    if (e[0] & FDCAN_ELEMENT_MASK_XTD) {
+      key = e[0] & (FDCAN_ELEMENT_MASK_EXTID | FDCAN_ELEMENT_MASK_XTD);
+    } else {
+      key = (e[0] & FDCAN_ELEMENT_MASK_STDID) >> 18U;
+    }
+    _fdcan_stats_rx(fdcan, key, fdcan_dlc_to_bytes((e[1] & FDCAN_ELEMENT_MASK_DLC) >> 16U));
+  }
+}
+
+#define _fdcan_stats_tx_full(fdcan)     ((fdcan)->Stats.TxFull++)
+#define _fdcan_stats_tx_full_mp(fdcan)  ((void)__atomic_fetch_add(&(fdcan)->Stats.TxFull, 1U, __ATOMIC_RELAXED))
+#else
+#define _fdcan_stats_rx(fdcan, key, bytes)                 ((void)0)
+#define _fdcan_stats_tx(fdcan, tx, bytes)                  ((void)(bytes))
+#define _fdcan_stats_rxfifo(fdcan, fifo, status)           ((void)0)
+#define _fdcan_stats_lost(fdcan, ir)                       ((void)0)
+#define _fdcan_stats_release(fdcan, fifo, status, count)   ((void)0)
+#define _fdcan_stats_tx_mp(fdcan, tx, bytes)               ((void)(bytes))
+#define _fdcan_stats_tx_full(fdcan)                        ((void)0)
+#define _fdcan_stats_tx_full_mp(fdcan)                     ((void)0)
+#endif
+
+// trace unit of a handle, see trace_event_t
+#define FDCAN_TRACE_UNIT(fdcan)  ((fdcan)->Instance == FDCAN2)
 
 static void _fdcan_init_ram(FDCAN_Handle_t *fdcan)
 {
-  uint32_t RAMcounter;
-  uint32_t SramCanInstanceBase = FDCAN_SRAM_BASE;
+  uintptr_t RAMcounter;
+  uintptr_t SramCanInstanceBase = FDCAN_SRAM_BASE;
 
   if (fdcan->Instance == FDCAN2)
   {
@@ -61,13 +175,14 @@ static void _fdcan_init_ram(FDCAN_Handle_t *fdcan)
 
   /* Standard filter elements number */
   // MODIFY_REG(hfdcan->Instance->RXGFC, FDCAN_RXGFC_LSS, (hfdcan->Init.StdFiltersNbr << FDCAN_RXGFC_LSS_Pos));
-  fdcan->Instance->RXGFC |= (fdcan->Init.StdFiltersNbr << 16);
+  fdcan->Instance->RXGFC = (fdcan->Instance->RXGFC & ~(0x1FU << 16)) | (fdcan->Init.StdFiltersNbr << 16);
 
   /* Extended filter list start address */
   fdcan->msgRam.ExtendedFilterSA = SramCanInstanceBase + SRAMCAN_FLESA;
 
   /* Extended filter elements number */
   // MODIFY_REG(hfdcan->Instance->RXGFC, FDCAN_RXGFC_LSE, (hfdcan->Init.ExtFiltersNbr << FDCAN_RXGFC_LSE_Pos));
+  fdcan->Instance->RXGFC = (fdcan->Instance->RXGFC & ~(0xFU << 24)) | (fdcan->Init.ExtFiltersNbr << 24);
 
   /* Rx FIFO 0 start address */
   fdcan->msgRam.RxFIFO0SA = SramCanInstanceBase + SRAMCAN_RF0SA;
@@ -100,20 +215,47 @@ static void _fdcan_bittiming(FDCAN_Handle_t *fdcan) {
                 (prescaler << 16) |
                 (sjw << 25);
 
-  fdcan->Instance->DBTP = (tseg2 << 0) |
-                (tseg1 << 8) |
-                (prescaler << 16) |
-                (sjw << 25);
+  if (fdcan->Init.FDMode) {
+    prescaler = (fdcan->Init.DataPrescaler) - 1;
+    tseg1 = (fdcan->Init.DataTimeSeg1) - 1;
+    tseg2 = (fdcan->Init.DataTimeSeg2) - 1;
+    sjw = (fdcan->Init.DataSyncJumpWidth) - 1;
+
+    fdcan->Instance->DBTP = (sjw << 0) |
+                  (tseg2 << 4) |
+                  (tseg1 << 8) |
+                  (prescaler << 16) |
+                  BIT(23); // TDC
+
+    // secondary sample point at the data sample point, in mtq (TDCO is 7 bits)
+    tseg1 = fdcan->Init.DataPrescaler * (fdcan->Init.DataTimeSeg1 + 1);
+    fdcan->Instance->TDCR = ((tseg1 > 127 ? 127 : tseg1) << 8);
+  }
 }
 
-static void _fdcan_copy2ram(const FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx, uint32_t index) {
-  uint32_t tx_element1 = 0, tx_element2 = 0, *tx_address, byte_count;
+RAMFUNC static uint32_t _fdcan_copy2ram(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx, uint32_t index,
+                                        uint32_t *marker) {
+  uint32_t tx_element1 = 0, tx_element2 = 0, *tx_address, byte_count, length;
 
-  tx_element1 = (tx->Identifier << 18U);
+  if (tx->IdType == FDCAN_STANDARD_ID) {
+    tx_element1 = (tx->Identifier << 18U);
+  } else {
+    tx_element1 = (tx->Identifier & FDCAN_ELEMENT_MASK_EXTID) | FDCAN_ELEMENT_MASK_XTD;
+  }
+  if (tx->ErrorStateIndicator != 0) {
+    tx_element1 |= FDCAN_ELEMENT_MASK_ESI;
+  }
 
   /* Build second word of Tx header element */
-  tx_element2 = (tx->DataLength << 16U);
-                 
+  tx_element2 = (tx->DataLength << 16U) | tx->BitRateSwitch | tx->FDFormat;
+  *marker = 0;
+  if (fdcan->Init.TxEvents) {
+    // atomic: fdcan_send_mp() producers take markers concurrently
+    *marker = __atomic_fetch_add(&fdcan->TxMarker, 1U, __ATOMIC_RELAXED) & 0xFFU;
+    tx_element2 |= FDCAN_ELEMENT_MASK_EFC | (*marker << 24U);
+  }
+  length = fdcan_dlc_to_bytes(tx->DataLength);
+
   /* Calculate Tx element address */
   tx_address = (uint32_t *)(fdcan->msgRam.TxFIFOQSA + (index * SRAMCAN_TFQ_SIZE));
 
@@ -124,7 +266,7 @@ static void _fdcan_copy2ram(const FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t
   tx_address++;
 
   /* Write Tx payload to the message RAM */
-  for (byte_count = 0; byte_count < tx->DataLength; byte_count += 4U)
+  for (byte_count = 0; byte_count < length; byte_count += 4U)
   {
     *tx_address = (((uint32_t)tx->Data[byte_count + 3U] << 24U) |
                   ((uint32_t)tx->Data[byte_count + 2U] << 16U) |
@@ -132,9 +274,13 @@ static void _fdcan_copy2ram(const FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t
                   (uint32_t)tx->Data[byte_count]);
     tx_address++;
   }
+
+  return length;
 }
 
 int fdcan_init(FDCAN_Handle_t *fdcan) {
+  uint32_t i;
+
   if (fdcan == NULL) return 1;
 
   pll1_q_init();
@@ -164,16 +310,50 @@ int fdcan_init(FDCAN_Handle_t *fdcan) {
     fdcan->Instance->CCCR |= BIT(7);
     fdcan->Instance->TEST |= BIT(4);
   }
-  
-  // fdcan->Instance->CCCR |= (BIT(8) | BIT(9)); // disable FDCAN, use standard CAN 2.0
+
+  if (fdcan->Init.BusMonitor) {
+    fdcan->Instance->CCCR |= BIT(5);
+  } else {
+    fdcan->Instance->CCCR &= ~BIT(5);
+  }
+
+  if (fdcan->Init.FDMode) {
+    fdcan->Instance->CCCR |= (BIT(8) | BIT(9)); // FDOE, BRSE
+  } else {
+    fdcan->Instance->CCCR &= ~(BIT(8) | BIT(9)); // standard CAN 2.0
+  }
   
   if(fdcan->Init.TxQueue) {
     fdcan->Instance->TXBC |= BIT(24);
   }
 
+  if (fdcan->Init.TimestampPrescaler != 0) {
+    // TSS = internal counter, in units of nominal bit times
+    fdcan->Instance->TSCC = ((fdcan->Init.TimestampPrescaler - 1) << 16) | BIT(0);
+  } else {
+    fdcan->Instance->TSCC = 0;
+  }
+
   _fdcan_init_ram(fdcan);
 
   fdcan->LatestTxFifoQRequest = 0;
+  fdcan->RxCallback = NULL;
+  fdcan->TxCallback = NULL;
+  for (i = 0; i < FDCAN_TX_BUFFERS; i++) {
+    fdcan->TxDeadline[i] = 0;
+  }
+  fdcan->TxCancelRequest = 0;
+  fdcan->TxStats.Expired = 0;
+  fdcan->TxStats.Cancelled = 0;
+  fdcan->TxStats.Late = 0;
+  fdcan->TxMarker = 0;
+  fdcan->TxOwned = 0;
+  memset(&fdcan->TxMpStats, 0, sizeof(fdcan->TxMpStats));
+#ifdef FDCAN_STATS
+  memset(&fdcan->Stats, 0, sizeof(fdcan->Stats));
+  fdcan->IdStats = NULL;
+  fdcan->IdStatsMask = 0;
+#endif
 
   fdcan->Instance->CCCR &= ~BIT(0); // unset INIT
   while ((fdcan->Instance->CCCR & BIT(0)) == 1) {
@@ -183,9 +363,73 @@ int fdcan_init(FDCAN_Handle_t *fdcan) {
   return 0;
 }
 
+int fdcan_stop(FDCAN_Handle_t *fdcan) {
+  uint32_t polls = 0;
+
+  if (fdcan == NULL) return 1;
+
+  fdcan->Instance->CCCR |= BIT(0); // set INIT, leaves the bus after the current frame
+  while ((fdcan->Instance->CCCR & BIT(0)) == 0) {
+    if (++polls == FDCAN_STOP_POLLS) return 1;   // kernel clock stopped or controller hung
+  }
+
+  return 0;
+}
+
+int fdcan_start(FDCAN_Handle_t *fdcan) {
+  if (fdcan == NULL) return 1;
+
+  fdcan->Instance->CCCR &= ~(BIT(0) | BIT(1)); // unset INIT (and CCE)
+  return 0;
+}
+
+int fdcan_calc_bittiming(uint32_t kernel_hz, uint32_t bitrate, uint32_t sample_point_permille, bool data_phase,
+                         FDCAN_BitTiming_t *bt) {
+  uint32_t prescaler, tq, tseg1, tseg2;
+  uint32_t max_prescaler = data_phase ? 32U : 512U;
+  uint32_t max_tseg1 = data_phase ? 32U : 256U;
+  uint32_t max_tseg2 = data_phase ? 16U : 128U;
+
+  if (bt == NULL || bitrate == 0 || sample_point_permille == 0 || sample_point_permille >= 1000) return 1;
+
+  // smallest prescaler = most time quanta per bit = finest sample point placement
+  for (prescaler = 1; prescaler <= max_prescaler; prescaler++) {
+    if ((kernel_hz % (prescaler * bitrate)) != 0) continue;
+
+    tq = kernel_hz / (prescaler * bitrate);
+    if (tq < 4 || tq > (1 + max_tseg1 + max_tseg2)) continue;
+
+    tseg1 = ((tq * sample_point_permille) + 500U) / 1000U - 1U;
+    if (tseg1 > max_tseg1) tseg1 = max_tseg1;
+    tseg2 = tq - 1U - tseg1;
+    if (tseg2 > max_tseg2) continue;
+    if (tseg2 == 0) {
+      tseg2 = 1;
+      tseg1--;
+    }
+
+    bt->Prescaler = prescaler;
+    bt->TimeSeg1 = tseg1;
+    bt->TimeSeg2 = tseg2;
+    bt->SyncJumpWidth = tseg2;
+    return 0;
+  }
+
+  return 1;
+}
+
 int fdcan_set_filter(FDCAN_Handle_t *fdcan, const FDCAN_Filter_t *filter) {
   uint32_t filter_word, *filter_addr;
 
+  if (filter->IdType == FDCAN_EXTENDED_ID) {
+    filter_addr = (uint32_t *)(fdcan->msgRam.ExtendedFilterSA + (filter->FilterIndex * SRAMCAN_FLE_SIZE));
+
+    filter_addr[0] = (filter->FilterConfig << 29U) | (filter->FilterID1 & FDCAN_ELEMENT_MASK_EXTID);
+    filter_addr[1] = (filter->FilterType << 30U) | (filter->FilterID2 & FDCAN_ELEMENT_MASK_EXTID);
+
+    return 0;
+  }
+
   filter_word = ((filter->FilterType << 30U)  |
                 (filter->FilterConfig << 27U) |
                 (filter->FilterID1 << 16U)    |
@@ -198,22 +442,213 @@ int fdcan_set_filter(FDCAN_Handle_t *fdcan, const FDCAN_Filter_t *filter) {
   return 0;
 }
 
-int fdcan_send(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx) {
-  uint32_t index;
+/* Account for deadline cancellations the controller has finished, before TXBAR resets TXBCF/TXBTO */
+RAMFUNC void fdcan_tx_settle(FDCAN_Handle_t *fdcan) {
+  uint32_t done = fdcan->TxCancelRequest & ~fdcan->Instance->TXBRP;
+  uint32_t sent, i;
+
+  if (done == 0) return;
+
+  // fdcan_send_mp() producers settle concurrently: TXBTO is read before the
+  // claim, and a buffer is only counted by the context whose claim cleared it
+  sent = fdcan->Instance->TXBTO;
+  done &= __atomic_fetch_and(&fdcan->TxCancelRequest, ~done, __ATOMIC_RELAXED);
+  for (i = 0; i < FDCAN_TX_BUFFERS; i++) {
+    if ((done & BIT(i)) == 0) continue;
+    if ((sent & BIT(i)) != 0) {
+      __atomic_fetch_add(&fdcan->TxStats.Late, 1U, __ATOMIC_RELAXED);
+    } else {
+      __atomic_fetch_add(&fdcan->TxStats.Cancelled, 1U, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+RAMFUNC int fdcan_send(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx) {
+  uint32_t index, length, marker;
 
   if ((fdcan->Instance->TXFQS & BIT(21)) != 0) {
+    _fdcan_stats_tx_full(fdcan);
+    TRACE(TRACE_EV_FDCAN_TX_FULL, FDCAN_TRACE_UNIT(fdcan), 0, 0);
     return 1;
   } else {
+    fdcan_tx_settle(fdcan);
     index = ((fdcan->Instance->TXFQS & (0b11 << 16)) >> 16);
-    _fdcan_copy2ram(fdcan, tx, index);
-    fdcan->Instance->TXBAR = ((uint32_t)1 << index);
+    TRACE(TRACE_EV_FDCAN_TX_SLOT, FDCAN_TRACE_UNIT(fdcan), index, tx->Identifier | tx->IdType);
+    length = _fdcan_copy2ram(fdcan, tx, index, &marker);
+    fdcan->TxDeadline[index] = tx->Deadline;
+    FDCAN_TXBAR_WRITE(fdcan->Instance, (uint32_t)1 << index);
+    TRACE(TRACE_EV_FDCAN_TX_REQUEST, FDCAN_TRACE_UNIT(fdcan), index, 0);
     fdcan->LatestTxFifoQRequest = ((uint32_t)1 << index);
+    _fdcan_stats_tx(fdcan, tx, length);
+  }
+
+  // the marker this frame took: TxMarker may have moved on in an interrupt since
+  if (fdcan->TxCallback != NULL) {
+    fdcan->TxCallback(fdcan, tx, marker);
   }
 
   return 0;
 }
 
-int fdcan_rxfifo_level(const FDCAN_Handle_t *fdcan, FDCAN_RxFIFO_t fifo){
+RAMFUNC int fdcan_send_mp(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx) {
+  uint32_t owned, busy, bit, index, length, marker;
+
+  if (!fdcan->Init.TxQueue) return 1;
+
+  // reserve the lowest buffer neither pending nor being filled elsewhere
+  owned = __atomic_load_n(&fdcan->TxOwned, __ATOMIC_RELAXED);
+  for (;;) {
+    busy = (owned | fdcan->Instance->TXBRP) & FDCAN_TX_MASK;
+    if (busy == FDCAN_TX_MASK) {
+      __atomic_fetch_add(&fdcan->TxMpStats.Full, 1U, __ATOMIC_RELAXED);
+      _fdcan_stats_tx_full_mp(fdcan);
+      TRACE(TRACE_EV_FDCAN_TX_FULL, FDCAN_TRACE_UNIT(fdcan), 0, 0);
+      return 1;
+    }
+    bit = ~busy & (busy + 1U);
+    FDCAN_MP_RESERVE_GAP();
+    // LDREX/STREX on Cortex-M33, fails if another context wrote TxOwned meanwhile
+    if (__atomic_compare_exchange_n(&fdcan->TxOwned, &owned, owned | bit, true, __ATOMIC_ACQUIRE,
+                                    __ATOMIC_RELAXED)) {
+      // another context may have reserved, requested and released it since TXBRP was read
+      if ((fdcan->Instance->TXBRP & bit) == 0) break;
+      owned = __atomic_and_fetch(&fdcan->TxOwned, ~bit, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&fdcan->TxMpStats.Contended, 1U, __ATOMIC_RELAXED);
+  }
+
+  index = (uint32_t)__builtin_ctz(bit);
+  TRACE(TRACE_EV_FDCAN_TX_SLOT, FDCAN_TRACE_UNIT(fdcan), index, tx->Identifier | tx->IdType);
+  fdcan_tx_settle(fdcan);
+  length = _fdcan_copy2ram(fdcan, tx, index, &marker);
+  fdcan->TxDeadline[index] = tx->Deadline;
+
+  // element complete before the request, the request in TXBRP before the buffer is released
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  FDCAN_TXBAR_WRITE(fdcan->Instance, bit);
+  (void)fdcan->Instance->TXBRP;
+  __atomic_fetch_and(&fdcan->TxOwned, ~bit, __ATOMIC_RELEASE);
+  TRACE(TRACE_EV_FDCAN_TX_REQUEST, FDCAN_TRACE_UNIT(fdcan), index, 0);
+
+  fdcan->LatestTxFifoQRequest = bit;
+  __atomic_fetch_add(&fdcan->TxMpStats.Sent, 1U, __ATOMIC_RELAXED);
+  _fdcan_stats_tx_mp(fdcan, tx, length);
+
+  return 0;
+}
+
+RAMFUNC int fdcan_tx_prepare(FDCAN_Handle_t *fdcan, const FDCAN_TxElement_t *tx, uint32_t *index) {
+  uint32_t length, marker;
+
+  if ((fdcan->Instance->TXFQS & BIT(21)) != 0) {
+    _fdcan_stats_tx_full(fdcan);
+    TRACE(TRACE_EV_FDCAN_TX_FULL, FDCAN_TRACE_UNIT(fdcan), 0, 0);
+    return 1;
+  }
+
+  // the put index only advances on TXBAR, so the slot stays ours until committed
+  fdcan_tx_settle(fdcan);
+  *index = ((fdcan->Instance->TXFQS & (0b11 << 16)) >> 16);
+  TRACE(TRACE_EV_FDCAN_TX_SLOT, FDCAN_TRACE_UNIT(fdcan), *index, tx->Identifier | tx->IdType);
+  length = _fdcan_copy2ram(fdcan, tx, *index, &marker);
+  fdcan->TxDeadline[*index] = tx->Deadline;
+  _fdcan_stats_tx(fdcan, tx, length); // a prepared frame is always committed
+
+  return 0;
+}
+
+RAMFUNC void fdcan_tx_commit(FDCAN_Handle_t *fdcan, uint32_t index) {
+  FDCAN_TXBAR_WRITE(fdcan->Instance, (uint32_t)1 << index);
+  TRACE(TRACE_EV_FDCAN_TX_REQUEST, FDCAN_TRACE_UNIT(fdcan), index, 0);
+  fdcan->LatestTxFifoQRequest = ((uint32_t)1 << index);
+}
+
+RAMFUNC uint32_t fdcan_tx_marker(FDCAN_Handle_t *fdcan, uint32_t index) {
+  const uint32_t *e = (const uint32_t *)(fdcan->msgRam.TxFIFOQSA + (index * SRAMCAN_TFQ_SIZE));
+
+  return (e[1] & FDCAN_ELEMENT_MASK_EFC) ? (e[1] & FDCAN_ELEMENT_MASK_MM) >> 24U : 0;
+}
+
+RAMFUNC int fdcan_tx_cancel(FDCAN_Handle_t *fdcan, uint32_t index) {
+  uint32_t bit = ((uint32_t)1 << index);
+
+  if ((fdcan->Instance->TXBRP & bit) == 0) return 1;
+
+  fdcan->Instance->TXBCR = bit;
+  while ((fdcan->Instance->TXBRP & bit) != 0) {
+    // at most one frame time if the buffer is being transmitted
+  }
+
+  // TXBTO is set if the transmission completed before the cancellation took effect
+  return ((fdcan->Instance->TXBTO & bit) != 0) ? 1 : 0;
+}
+
+RAMFUNC uint32_t fdcan_tx_expire(FDCAN_Handle_t *fdcan, uint64_t now_us) {
+  uint32_t pending, expired = 0, i;
+
+  fdcan_tx_settle(fdcan);
+
+  pending = fdcan->Instance->TXBRP & ~fdcan->TxCancelRequest;
+  for (i = 0; i < FDCAN_TX_BUFFERS; i++) {
+    if ((pending & BIT(i)) != 0 && fdcan->TxDeadline[i] != 0 && now_us > fdcan->TxDeadline[i]) {
+      expired |= BIT(i);
+    }
+  }
+
+  if (expired != 0) {
+    // a timer and the main loop may both expire a buffer: only the first request counts
+    expired &= ~__atomic_fetch_or(&fdcan->TxCancelRequest, expired, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&fdcan->TxStats.Expired, (uint32_t)__builtin_popcount(expired), __ATOMIC_RELAXED);
+    fdcan->Instance->TXBCR = expired;
+  }
+
+  return expired;
+}
+
+void fdcan_irq_enable(FDCAN_Handle_t *fdcan, uint32_t it) {
+  fdcan->Instance->IE |= it;
+  fdcan->Instance->ILE |= BIT(0); // all groups on interrupt line 0 (ILS reset value)
+}
+
+void fdcan_irq_disable(FDCAN_Handle_t *fdcan, uint32_t it) {
+  fdcan->Instance->IE &= ~it;
+}
+
+RAMFUNC uint32_t fdcan_irq_ack(FDCAN_Handle_t *fdcan) {
+  uint32_t ir = fdcan->Instance->IR & fdcan->Instance->IE & ~fdcan->IrqLine1;
+
+  fdcan->Instance->IR = ir; // write 1 to clear
+  _fdcan_stats_lost(fdcan, ir);
+  TRACE(TRACE_EV_FDCAN_IRQ_ACK, FDCAN_TRACE_UNIT(fdcan), 0, ir);
+  return ir;
+}
+
+void fdcan_irq_route(FDCAN_Handle_t *fdcan, uint32_t groups) {
+  // IR bits of each ILS group, in ILS bit order
+  static const uint32_t group_bits[7] = {
+    0x00000007U, 0x00000038U, 0x000001C0U, 0x00001E00U, 0x0000E000U, 0x00030000U, 0x00FC0000U
+  };
+  uint32_t i, line1 = 0;
+
+  for (i = 0; i < 7; i++) {
+    if (groups & BIT(i)) line1 |= group_bits[i];
+  }
+
+  fdcan->IrqLine1 = line1;
+  fdcan->Instance->ILS = groups;
+  fdcan->Instance->ILE |= BIT(0) | BIT(1);
+}
+
+RAMFUNC uint32_t fdcan_irq_ack_line1(FDCAN_Handle_t *fdcan) {
+  uint32_t ir = fdcan->Instance->IR & fdcan->Instance->IE & fdcan->IrqLine1;
+
+  fdcan->Instance->IR = ir; // write 1 to clear
+  _fdcan_stats_lost(fdcan, ir);
+  TRACE(TRACE_EV_FDCAN_IRQ_ACK, FDCAN_TRACE_UNIT(fdcan), 1, ir);
+  return ir;
+}
+
+RAMFUNC int fdcan_rxfifo_level(const FDCAN_Handle_t *fdcan, FDCAN_RxFIFO_t fifo){
   uint32_t fill_level;
 
   if (fifo == FDCAN_RX_FIFO0) {
@@ -225,23 +660,63 @@ int fdcan_rxfifo_level(const FDCAN_Handle_t *fdcan, FDCAN_RxFIFO_t fifo){
   return fill_level;
 }
 
-int fdcan_receive(FDCAN_Handle_t *fdcan, FDCAN_RxElement_t *rx, FDCAN_RxFIFO_t fifo) {
-  uint32_t *rx_addr, byte_counter, index = 0;
+RAMFUNC const uint32_t *fdcan_rxfifo_peek(const FDCAN_Handle_t *fdcan, FDCAN_RxFIFO_t fifo, uint32_t offset) {
+  uint32_t status, index;
+
+  status = (fifo == FDCAN_RX_FIFO0) ? fdcan->Instance->RXF0S : fdcan->Instance->RXF1S;
+  if (offset >= (status & 0b1111)) return NULL;
+
+  index = ((status & (0b11 << 8)) >> 8) + offset;
+  if (fifo == FDCAN_RX_FIFO0) {
+    return (const uint32_t *)(fdcan->msgRam.RxFIFO0SA + ((index % SRAMCAN_RF0_NBR) * SRAMCAN_RF0_SIZE));
+  }
+  return (const uint32_t *)(fdcan->msgRam.RxFIFO1SA + ((index % SRAMCAN_RF1_NBR) * SRAMCAN_RF1_SIZE));
+}
+
+RAMFUNC void fdcan_rxfifo_release(FDCAN_Handle_t *fdcan, FDCAN_RxFIFO_t fifo, uint32_t count) {
+  uint32_t status, index;
+
+  if (count == 0) return;
+
+  status = (fifo == FDCAN_RX_FIFO0) ? fdcan->Instance->RXF0S : fdcan->Instance->RXF1S;
+  _fdcan_stats_release(fdcan, fifo, status, count);
+  TRACE(TRACE_EV_FDCAN_RXFIFO, FDCAN_TRACE_UNIT(fdcan), fifo, status & 0b1111);
+
+  // acknowledging an index releases every element up to it
+  if (fifo == FDCAN_RX_FIFO0) {
+    index = (((status & (0b11 << 8)) >> 8) + count - 1) % SRAMCAN_RF0_NBR;
+    fdcan->Instance->RXF0A = index;
+  } else {
+    index = (((status & (0b11 << 8)) >> 8) + count - 1) % SRAMCAN_RF1_NBR;
+    fdcan->Instance->RXF1A = index;
+  }
+  TRACE(TRACE_EV_FDCAN_RX_ACK, FDCAN_TRACE_UNIT(fdcan), fifo, index);
+}
+
+RAMFUNC int fdcan_receive(FDCAN_Handle_t *fdcan, FDCAN_RxElement_t *rx, FDCAN_RxFIFO_t fifo) {
+  uint32_t *rx_addr, byte_counter, length, status, index = 0;
   uint8_t *data;
 
   if (fifo == FDCAN_RX_FIFO0) {
-    if ((fdcan->Instance->RXF0S & 0b1111) != 0) {
-      index += ((fdcan->Instance->RXF0S & (0b11 << 8)) >> 8);
-      rx_addr = (uint32_t *)(fdcan->msgRam.RxFIFO0SA + (index * SRAMCAN_RF0_SIZE));
-    }
+    status = fdcan->Instance->RXF0S;
+    if ((status & 0b1111) == 0) return 1;
+    index += ((status & (0b11 << 8)) >> 8);
+    rx_addr = (uint32_t *)(fdcan->msgRam.RxFIFO0SA + (index * SRAMCAN_RF0_SIZE));
   } else {
-    if ((fdcan->Instance->RXF1S & 0b1111) != 0) {
-      index += ((fdcan->Instance->RXF1S & (0b11 << 8)) >> 8);
-      rx_addr = (uint32_t *)(fdcan->msgRam.RxFIFO1SA + (index * SRAMCAN_RF0_SIZE));
-    }
+    status = fdcan->Instance->RXF1S;
+    if ((status & 0b1111) == 0) return 1;
+    index += ((status & (0b11 << 8)) >> 8);
+    rx_addr = (uint32_t *)(fdcan->msgRam.RxFIFO1SA + (index * SRAMCAN_RF1_SIZE));
   }
+  _fdcan_stats_rxfifo(fdcan, fifo, status);
+  TRACE(TRACE_EV_FDCAN_RXFIFO, FDCAN_TRACE_UNIT(fdcan), fifo, status & 0b1111);
 
-  rx->Identifier = ((*rx_addr & FDCAN_ELEMENT_MASK_STDID) >> 18U);
+  rx->IdType = (*rx_addr & FDCAN_ELEMENT_MASK_XTD);
+  if (rx->IdType == FDCAN_STANDARD_ID) {
+    rx->Identifier = ((*rx_addr & FDCAN_ELEMENT_MASK_STDID) >> 18U);
+  } else {
+    rx->Identifier = (*rx_addr & FDCAN_ELEMENT_MASK_EXTID);
+  }
   rx->ErrorStateIndicator = (*rx_addr & FDCAN_ELEMENT_MASK_ESI);
 
   rx_addr++;
@@ -249,11 +724,14 @@ int fdcan_receive(FDCAN_Handle_t *fdcan, FDCAN_RxElement_t *rx, FDCAN_RxFIFO_t f
   rx->RxTimestamp = (*rx_addr & FDCAN_ELEMENT_MASK_TS);
   rx->DataLength = ((*rx_addr & FDCAN_ELEMENT_MASK_DLC) >> 16U);
   rx->FilterIndex = ((*rx_addr & FDCAN_ELEMENT_MASK_FIDX) >> 24U);
+  rx->BitRateSwitch = (*rx_addr & FDCAN_ELEMENT_MASK_BRS);
+  rx->FDFormat = (*rx_addr & FDCAN_ELEMENT_MASK_FDF);
 
   rx_addr++;
 
   data = (uint8_t *)rx_addr;
-  for (byte_counter = 0; byte_counter < rx->DataLength; byte_counter++) {
+  length = fdcan_dlc_to_bytes(rx->DataLength);
+  for (byte_counter = 0; byte_counter < length; byte_counter++) {
     rx->Data[byte_counter] = data[byte_counter];
   }
 
@@ -262,7 +740,99 @@ int fdcan_receive(FDCAN_Handle_t *fdcan, FDCAN_RxElement_t *rx, FDCAN_RxFIFO_t f
   } else {
     fdcan->Instance->RXF1A = index;
   }
+  _fdcan_stats_rx(fdcan, rx->Identifier | rx->IdType, length);
+  TRACE(TRACE_EV_FDCAN_RX, FDCAN_TRACE_UNIT(fdcan), fifo, rx->Identifier | rx->IdType);
+  TRACE(TRACE_EV_FDCAN_RX_ACK, FDCAN_TRACE_UNIT(fdcan), fifo, index);
+
+  if (fdcan->RxCallback != NULL) {
+    fdcan->RxCallback(fdcan, rx);
+  }
 
   return 0;
 }
+RAMFUNC int fdcan_tx_event(FDCAN_Handle_t *fdcan, FDCAN_TxEvent_t *ev) {
+  uint32_t status, index, *e;
+
+  status = fdcan->Instance->TXEFS;
+  if ((status & 0b111) == 0) return 1;
+
+  index = (status & (0b11 << 8)) >> 8;
+  e = (uint32_t *)(fdcan->msgRam.TxEventFIFOSA + (index * SRAMCAN_TEF_SIZE));
+
+  ev->IdType = (e[0] & FDCAN_ELEMENT_MASK_XTD);
+  if (ev->IdType == FDCAN_STANDARD_ID) {
+    ev->Identifier = ((e[0] & FDCAN_ELEMENT_MASK_STDID) >> 18U);
+  } else {
+    ev->Identifier = (e[0] & FDCAN_ELEMENT_MASK_EXTID);
+  }
+  ev->TxTimestamp = (e[1] & FDCAN_ELEMENT_MASK_TS);
+  ev->DataLength = ((e[1] & FDCAN_ELEMENT_MASK_DLC) >> 16U);
+  ev->EventType = ((e[1] & FDCAN_ELEMENT_MASK_ET) >> 22U);
+  ev->MessageMarker = ((e[1] & FDCAN_ELEMENT_MASK_MM) >> 24U);
+
+  fdcan->Instance->TXEFA = index;
+
+  return 0;
+}
+
+RAMFUNC uint32_t fdcan_timestamp(const FDCAN_Handle_t *fdcan) {
+  return (fdcan->Instance->TSCV & FDCAN_ELEMENT_MASK_TS);
+}
+
+#ifdef FDCAN_STATS
+int fdcan_stats_ids(FDCAN_Handle_t *fdcan, FDCAN_IdStats_t *table, uint32_t size) {
+  uint32_t i, primask;
+
+  if (fdcan == NULL || (table == NULL && size != 0) || (size & (size - 1)) != 0) return 1;
+
+  for (i = 0; i < size; i++) {
+    table[i].Key = FDCAN_STATS_ID_FREE;
+    table[i].RxFrames = 0;
+    table[i].TxFrames = 0;
+  }
+
+  primask = irq_save();
+  fdcan->IdStatsMask = (size != 0) ? size - 1 : 0;
+  fdcan->IdStats = (size != 0) ? table : NULL;
+  irq_restore(primask);
+
+  return 0;
+}
+
+void fdcan_stats_snapshot(FDCAN_Handle_t *fdcan, FDCAN_Stats_t *stats, bool reset) {
+  uint32_t primask = irq_save();
+
+  *stats = fdcan->Stats;
+  if (reset) memset(&fdcan->Stats, 0, sizeof(fdcan->Stats));
+  irq_restore(primask);
+}
+
+uint32_t fdcan_stats_ids_snapshot(FDCAN_Handle_t *fdcan, FDCAN_IdStats_t *ids, uint32_t max, bool reset) {
+  FDCAN_IdStats_t *e;
+  uint32_t i, n = 0, primask;
+
+  if (fdcan->IdStats == NULL) return 0;
+
+  primask = irq_save();
+  for (i = 0; i <= fdcan->IdStatsMask; i++) {
+    e = &fdcan->IdStats[i];
+    if (e->Key == FDCAN_STATS_ID_FREE) continue;
+    if (n < max) ids[n++] = *e;
+    if (reset) {
+      e->RxFrames = 0;
+      e->TxFrames = 0;
+    }
+  }
+  irq_restore(primask);
+
+  return n;
+}
+
+RAMFUNC void fdcan_stats_isr(FDCAN_Handle_t *fdcan, uint32_t cycles) {
+  fdcan->Stats.IsrCount++;
+  fdcan->Stats.IsrCycles += cycles;
+  if (cycles > fdcan->Stats.IsrMaxCycles) fdcan->Stats.IsrMaxCycles = cycles;
+}
+#endif
+
 // int fdcan_is_available(FDCAN_Handle_t *fdcan);
@@ -0,0 +1,78 @@
+#include <stddef.h>
+#include "drivers/nvic.h"
+
+extern const irq_handler_t g_pfnVectors[IRQ_VECTOR_COUNT];
+
+/* VTOR needs the table aligned to its size rounded up to a power of two */
+static irq_handler_t ram_vectors[IRQ_VECTOR_COUNT] __attribute__((section(".ram_vectors"), aligned(1024)));
+
+void irq_vector_relocate(void) {
+  uint32_t i;
+
+  if (SCB->VTOR == (uint32_t)ram_vectors) return;
+
+  for (i = 0; i < IRQ_VECTOR_COUNT; i++) {
+    ram_vectors[i] = g_pfnVectors[i];
+  }
+
+  __asm volatile ("dsb" ::: "memory");
+  SCB->VTOR = (uint32_t)ram_vectors;
+  __asm volatile ("dsb\n\tisb" ::: "memory");
+}
+
+void irq_register(IRQn_t irqn, irq_handler_t handler) {
+  uint32_t index = (uint32_t)(16 + irqn);
+
+  irq_vector_relocate();
+
+  if (handler == NULL) {
+    handler = g_pfnVectors[index];
+  }
+  ram_vectors[index] = handler;
+  __asm volatile ("dsb" ::: "memory");
+}
+
+void nvic_enable_irq(IRQn_t irqn) {
+  if (irqn < 0) return;
+  NVIC->ISER[irqn >> 5] = BIT(irqn & 0x1F);
+}
+
+void nvic_disable_irq(IRQn_t irqn) {
+  if (irqn < 0) return;
+  NVIC->ICER[irqn >> 5] = BIT(irqn & 0x1F);
+  __asm volatile ("dsb\n\tisb" ::: "memory");
+}
+
+void nvic_set_priority(IRQn_t irqn, uint8_t priority) {
+  uint8_t value = (uint8_t)(priority << (8U - NVIC_PRIO_BITS));
+
+  if (irqn < MemoryManagement_IRQn) return; // NMI and HardFault have fixed priorities, no SHPR byte
+  if (irqn < 0) {
+    SCB->SHPR[(16 + irqn) - 4] = value;
+  } else {
+    NVIC->IPR[irqn] = value;
+  }
+}
+
+uint8_t nvic_get_priority(IRQn_t irqn) {
+  if (irqn < MemoryManagement_IRQn) return 0;
+  if (irqn < 0) {
+    return (uint8_t)(SCB->SHPR[(16 + irqn) - 4] >> (8U - NVIC_PRIO_BITS));
+  }
+  return (uint8_t)(NVIC->IPR[irqn] >> (8U - NVIC_PRIO_BITS));
+}
+
+void nvic_set_pending(IRQn_t irqn) {
+  if (irqn < 0) return;
+  NVIC->ISPR[irqn >> 5] = BIT(irqn & 0x1F);
+}
+
+void nvic_clear_pending(IRQn_t irqn) {
+  if (irqn < 0) return;
+  NVIC->ICPR[irqn >> 5] = BIT(irqn & 0x1F);
+}
+
+bool nvic_is_pending(IRQn_t irqn) {
+  if (irqn < 0) return false;
+  return (NVIC->ISPR[irqn >> 5] & BIT(irqn & 0x1F)) != 0;
+}
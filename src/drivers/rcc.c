@@ -1,5 +1,25 @@
+#include <stddef.h>
 #include "drivers/rcc.h"
 
+// Ready flag polls, overridden by simulation builds to step the modelled clock tree
+#ifndef RCC_POLL
+#define RCC_POLL()
+#endif
+
+const RCC_ClockConfig_t rcc_clock_250mhz = {
+  .hse_bypass = true,
+  .pll_m      = 2,   // 4 MHz reference
+  .pll_n      = 125, // 500 MHz VCO
+  .pll_p      = 2,   // 250 MHz SYSCLK
+  .pll_q      = 10,  // 50 MHz FDCAN kernel clock
+  .ahb_div    = 1,
+  .apb1_div   = 1,
+  .apb2_div   = 1,
+  .apb3_div   = 1,
+};
+
+static const uint16_t ahb_div_table[8] = { 2, 4, 8, 16, 64, 128, 256, 512 };
+
 void rcc_enable_gpio(uint8_t bank_idx) {
     RCC->AHB2ENR |= BIT(bank_idx);
 }
@@ -18,37 +38,232 @@ void rcc_enable_fdcan() {
   RCC->APB1HENR |= BIT(9);
 }
 
-void pll1_q_init() {
-  RCC->CR |= BIT(18);
+static void _rcc_hse_on(bool bypass) {
+  if (bypass) {
+    RCC->CR |= BIT(18); // HSEBYP
+  }
   RCC->CR |= BIT(16);
-  while(!(RCC->CR & BIT(17))); // wait for HSE to be ready
-  
+  while (!(RCC->CR & BIT(17))) RCC_POLL(); // wait for HSE to be ready
+}
+
+/* PLL1 from HSE, P and Q outputs enabled */
+static void _rcc_pll1_config(uint32_t ref_hz, uint32_t m, uint32_t n, uint32_t p, uint32_t q) {
+  uint32_t pll_in = ref_hz / m, range, vco = pll_in * n;
+
   if (RCC->CR & BIT(24)) {
     RCC->CR &= ~BIT(24); // if PLL1 is enabled, turn it off first
-    while (RCC->CR & BIT(25));
+    while (RCC->CR & BIT(25)) RCC_POLL();
   }
 
-  RCC->PLL1CFGR &= ~(0b11);
-  RCC->PLL1CFGR |= 0b10; // PLL1SCR 10=HSE
-  
-  RCC->PLL1CFGR &= ~(0b111111 << 8);
-  RCC->PLL1DIVR &= ~(0b111111111 | (0b1111111 << 16));
+  // PLL1RGE: input frequency range
+  if (pll_in < 2000000UL) {
+    range = 0b00;
+  } else if (pll_in < 4000000UL) {
+    range = 0b01;
+  } else if (pll_in < 8000000UL) {
+    range = 0b10;
+  } else {
+    range = 0b11;
+  }
 
-  // set M = 2
-  RCC->PLL1CFGR |= (0b10 << 8);
+  RCC->PLL1CFGR &= ~((0b11) | (0b11 << 2) | BIT(5) | (0b111111 << 8));
+  RCC->PLL1CFGR |= 0b11;          // PLL1SRC 11=HSE
+  RCC->PLL1CFGR |= (range << 2);  // PLL1RGE
+  if (vco < 192000000UL) {
+    RCC->PLL1CFGR |= BIT(5);      // PLL1VCOSEL medium range (150-420 MHz)
+  }
+  RCC->PLL1CFGR |= (m << 8);      // PLL1M
 
-  // set N = 40
-  RCC->PLL1DIVR |= (39);
+  // N, P, Q, R=2 (R output stays disabled)
+  RCC->PLL1DIVR = ((n - 1) << 0) |
+                  ((p - 1) << 9) |
+                  ((q - 1) << 16) |
+                  (1UL << 24);
 
-  // set Q = 4
-  RCC->PLL1DIVR |= (0b11 << 16);
+  RCC->PLL1CFGR |= BIT(16) | BIT(17); // enable PLL1P, PLL1Q
 
-  RCC->PLL1CFGR |= BIT(17); // enable PLL1Q
-  
   RCC->CR |= BIT(24);
-  while (!(RCC->CR & BIT(25)));
+  while (!(RCC->CR & BIT(25))) RCC_POLL();
+}
 
+static void _rcc_fdcan_sel_pll1q() {
   RCC->CCIPR5 &= ~(0b11 << 8);
   RCC->CCIPR5 |= (0b01 << 8);
 }
 
+void pll1_q_init() {
+  if ((RCC->CR & BIT(25)) && (RCC->PLL1CFGR & BIT(17))) {
+    // PLL1 already running with Q output (rcc_clock_init), it may be SYSCLK
+    _rcc_fdcan_sel_pll1q();
+    return;
+  }
+
+  _rcc_hse_on(true);
+
+  // M = 2, N = 40, P = 2 (unused), Q = 4 -> 40 MHz from the 8 MHz HSE
+  _rcc_pll1_config(RCC_HSE_HZ, 2, 40, 2, 4);
+  RCC->PLL1CFGR &= ~BIT(16); // only the Q output is used
+
+  _rcc_fdcan_sel_pll1q();
+}
+
+static uint32_t _rcc_hpre(uint32_t div) {
+  uint32_t i;
+
+  if (div <= 1) return 0;
+  for (i = 0; i < 8; i++) {
+    if (ahb_div_table[i] == div) return (0b1000 | i);
+  }
+  return 0xFF;
+}
+
+static uint32_t _rcc_ppre(uint32_t div) {
+  switch (div) {
+    case 1:  return 0b000;
+    case 2:  return 0b100;
+    case 4:  return 0b101;
+    case 8:  return 0b110;
+    case 16: return 0b111;
+    default: return 0xFF;
+  }
+}
+
+static void _rcc_flash_latency(uint32_t hclk_hz) {
+  // VOS0: one wait state per 42 MHz, WRHIGHFREQ per 84 MHz (RM0481 flash table)
+  uint32_t latency = (hclk_hz - 1) / 42000000UL;
+  uint32_t wrhighfreq = (hclk_hz - 1) / 84000000UL;
+
+  FLASH->ACR = (FLASH->ACR & ~((0b1111 << 0) | (0b11 << 4))) |
+               (latency << 0) |
+               (wrhighfreq << 4);
+  while ((FLASH->ACR & 0b1111) != latency) RCC_POLL();
+}
+
+static void _rcc_icache_enable() {
+  if (ICACHE->CR & BIT(0)) return;
+
+  while (ICACHE->SR & BIT(0)) RCC_POLL(); // wait for the reset invalidation to finish
+  ICACHE->CR |= BIT(0);
+}
+
+int rcc_clock_init(const RCC_ClockConfig_t *cfg) {
+  uint32_t sysclk, hclk, hpre, ppre1, ppre2, ppre3;
+
+  if (cfg == NULL) return 1;
+  if (cfg->pll_m == 0 || cfg->pll_m > 63 || cfg->pll_n < 4 || cfg->pll_n > 512) return 1;
+  if (cfg->pll_p < 2 || cfg->pll_p > 128 || (cfg->pll_p & 1)) return 1;
+  if (cfg->pll_q == 0 || cfg->pll_q > 128) return 1;
+
+  sysclk = RCC_HSE_HZ / cfg->pll_m * cfg->pll_n / cfg->pll_p;
+  hpre = _rcc_hpre(cfg->ahb_div);
+  ppre1 = _rcc_ppre(cfg->apb1_div);
+  ppre2 = _rcc_ppre(cfg->apb2_div);
+  ppre3 = _rcc_ppre(cfg->apb3_div);
+  if (sysclk > RCC_SYSCLK_MAX_HZ || hpre == 0xFF || ppre1 == 0xFF || ppre2 == 0xFF || ppre3 == 0xFF) return 1;
+  hclk = sysclk / (cfg->ahb_div ? cfg->ahb_div : 1);
+
+  // VOS0 is required above 200 MHz
+  PWR->VOSCR |= (0b11 << 4);
+  while (!(PWR->VOSSR & BIT(3))) RCC_POLL(); // VOSRDY
+
+  _rcc_hse_on(cfg->hse_bypass);
+
+  // leave PLL1 before reprogramming it
+  if (((RCC->CFGR1 >> 3) & 0b11) == 0b11) {
+    RCC->CFGR1 &= ~0b11; // SW = HSI
+    while (((RCC->CFGR1 >> 3) & 0b11) != 0b00) RCC_POLL();
+  }
+
+  _rcc_pll1_config(RCC_HSE_HZ, cfg->pll_m, cfg->pll_n, cfg->pll_p, cfg->pll_q);
+
+  // wait states must be in place before the frequency goes up
+  if (hclk > rcc_get_hclk_hz()) {
+    _rcc_flash_latency(hclk);
+  }
+
+  RCC->CFGR2 = (RCC->CFGR2 & ~((0b1111 << 0) | (0b111 << 4) | (0b111 << 8) | (0b111 << 12))) |
+               (hpre << 0) |
+               (ppre1 << 4) |
+               (ppre2 << 8) |
+               (ppre3 << 12);
+
+  RCC->CFGR1 |= 0b11; // SW = PLL1P
+  while (((RCC->CFGR1 >> 3) & 0b11) != 0b11) RCC_POLL();
+
+  _rcc_flash_latency(hclk);
+
+  _rcc_fdcan_sel_pll1q();
+  _rcc_icache_enable();
+
+  return 0;
+}
+
+static uint32_t _rcc_pll1_ref_hz() {
+  switch (RCC->PLL1CFGR & 0b11) {
+    case 0b01: return RCC_HSI_HZ >> ((RCC->CR >> 3) & 0b11);
+    case 0b10: return RCC_CSI_HZ;
+    case 0b11: return RCC_HSE_HZ;
+    default:   return 0;
+  }
+}
+
+/* PLL1 VCO / (div + 1) where div is the raw divider field at 'pos' */
+static uint32_t _rcc_pll1_out_hz(uint32_t pos) {
+  uint32_t m = (RCC->PLL1CFGR >> 8) & 0b111111;
+  uint32_t n = (RCC->PLL1DIVR & 0x1FF) + 1;
+  uint32_t div = ((RCC->PLL1DIVR >> pos) & 0x7F) + 1;
+
+  if (m == 0 || !(RCC->CR & BIT(25))) return 0;
+  return _rcc_pll1_ref_hz() / m * n / div;
+}
+
+uint32_t rcc_get_sysclk_hz(void) {
+  switch ((RCC->CFGR1 >> 3) & 0b11) {
+    case 0b00: return RCC_HSI_HZ >> ((RCC->CR >> 3) & 0b11);
+    case 0b01: return RCC_CSI_HZ;
+    case 0b10: return RCC_HSE_HZ;
+    default:   return _rcc_pll1_out_hz(9);
+  }
+}
+
+uint32_t rcc_get_hclk_hz(void) {
+  uint32_t hpre = RCC->CFGR2 & 0b1111;
+
+  if (!(hpre & 0b1000)) return rcc_get_sysclk_hz();
+  return rcc_get_sysclk_hz() / ahb_div_table[hpre & 0b111];
+}
+
+static uint32_t _rcc_pclk_hz(uint32_t pos) {
+  uint32_t ppre = (RCC->CFGR2 >> pos) & 0b111;
+
+  if (!(ppre & 0b100)) return rcc_get_hclk_hz();
+  return rcc_get_hclk_hz() >> ((ppre & 0b11) + 1);
+}
+
+uint32_t rcc_get_pclk1_hz(void) {
+  return _rcc_pclk_hz(4);
+}
+
+uint32_t rcc_get_pclk2_hz(void) {
+  return _rcc_pclk_hz(8);
+}
+
+uint32_t rcc_get_pclk3_hz(void) {
+  return _rcc_pclk_hz(12);
+}
+
+uint32_t rcc_get_fdcan_clk_hz(void) {
+  switch ((RCC->CCIPR5 >> 8) & 0b11) {
+    case 0b00: return RCC_HSE_HZ;
+    case 0b01: return _rcc_pll1_out_hz(16);
+    default:   return 0; // PLL2Q is not configured by this driver
+  }
+}
+
+uint32_t rcc_get_usart_clk_hz(const USART_t *usart) {
+  // kernel clock mux left at reset value (PCLK)
+  if (usart == USART1) {
+    return rcc_get_pclk2_hz();
+  }
+  return rcc_get_pclk1_hz();
+}
@@ -0,0 +1,124 @@
+#include <stddef.h>
+#include "drivers/timebase.h"
+#include "drivers/nvic.h"
+#include "drivers/rcc.h"
+#include "drivers/systick.h"
+#include "drivers/trace.h"
+
+// Orders the slot against 'seq', overridden by simulation builds to preempt the code there
+#ifndef TIMEBASE_DMB
+#define TIMEBASE_DMB()      __asm volatile ("dmb" ::: "memory")
+#endif
+
+/*
+ * The SysTick handler is the only writer. It publishes the 64-bit cycle count
+ * sampled at each tick into the slot not currently advertised by 'seq', then
+ * bumps 'seq'. Readers never wait on the writer: a reader preempting the tick
+ * handler reads the previous, complete slot, and a reader preempted by it sees
+ * 'seq' change and retries.
+ */
+static struct {
+  volatile uint32_t seq;
+  volatile uint64_t base[2];
+} tb_epoch;
+
+static uint32_t tb_hz;           // calibrated core clock
+static uint32_t tb_us_q32;       // us per cycle, Q0.32
+static uint32_t tb_ns_q24;       // ns per cycle, Q8.24
+static uint32_t tb_cyc_q16;      // cycles per us, Q16.16
+static void (*volatile tb_hook)(void);
+
+static uint64_t _timebase_base(void) {
+  uint32_t seq;
+  uint64_t base;
+
+  do {
+    seq = tb_epoch.seq;
+    base = tb_epoch.base[seq & 1];
+    TIMEBASE_DMB();
+  } while (seq != tb_epoch.seq);
+
+  return base;
+}
+
+static void _timebase_tick(void) {
+  uint32_t seq = tb_epoch.seq;
+  uint64_t base = tb_epoch.base[seq & 1];
+
+  TRACE_ISR_ENTER(SysTick_IRQn);
+  base += (uint32_t)(DWT->CYCCNT - (uint32_t)base);
+  tb_epoch.base[(seq + 1) & 1] = base;
+  TIMEBASE_DMB();
+  tb_epoch.seq = seq + 1;
+
+  if (tb_hook != NULL) tb_hook();
+  TRACE_ISR_EXIT(SysTick_IRQn);
+}
+
+int timebase_init(void) {
+  uint32_t hz = rcc_get_hclk_hz();
+
+  if (hz == 0) return 1;
+
+  tb_hz = hz;
+  tb_us_q32 = (uint32_t)((1000000ULL << 32) / hz);
+  tb_ns_q24 = (uint32_t)((1000000000ULL << 24) / hz);
+  tb_cyc_q16 = (uint32_t)(((uint64_t)hz << 16) / 1000000U);
+
+  DCB->DEMCR |= BIT(24);   // TRCENA
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= BIT(0);     // CYCCNTENA
+
+  tb_epoch.base[0] = 0;
+  tb_epoch.base[1] = 0;
+  tb_epoch.seq = 0;
+
+  irq_register(SysTick_IRQn, _timebase_tick);
+  systick_init(hz / TIMEBASE_TICK_HZ);
+
+  return 0;
+}
+
+uint64_t timebase_cycles(void) {
+  uint64_t base = _timebase_base();
+
+  // CYCCNT is read after the base, so the difference is the time since that tick
+  return base + (uint32_t)(DWT->CYCCNT - (uint32_t)base);
+}
+
+uint64_t timebase_us(void) {
+  uint64_t cycles = timebase_cycles();
+
+  return (cycles / tb_hz) * 1000000U + ((cycles % tb_hz) * 1000000U) / tb_hz;
+}
+
+uint32_t timebase_ms(void) {
+  return (uint32_t)(timebase_us() / 1000U);
+}
+
+uint32_t timebase_cycles_to_us(uint32_t cycles) {
+  return (uint32_t)(((uint64_t)cycles * tb_us_q32) >> 32);
+}
+
+uint32_t timebase_cycles_to_ns(uint32_t cycles) {
+  return (uint32_t)(((uint64_t)cycles * tb_ns_q24) >> 24);
+}
+
+uint32_t timebase_us_to_cycles(uint32_t us) {
+  return (uint32_t)(((uint64_t)us * tb_cyc_q16) >> 16);
+}
+
+uint32_t timebase_core_hz(void) {
+  return tb_hz;
+}
+
+void timebase_delay_us(uint32_t us) {
+  uint32_t start = timebase_cycles32();
+  uint32_t cycles = timebase_us_to_cycles(us);
+
+  while ((timebase_cycles32() - start) < cycles);
+}
+
+void timebase_set_tick_hook(void (*hook)(void)) {
+  tb_hook = hook;
+}
@@ -0,0 +1,128 @@
+#include <stddef.h>
+#include <string.h>
+#include "drivers/trace.h"
+
+#ifdef TRACE_ENABLE
+
+#if TRACE_BACKEND == TRACE_BACKEND_UART
+#include "drivers/usart.h"
+#elif TRACE_BACKEND == TRACE_BACKEND_FILE
+#include <stdio.h>
+#endif
+
+#include "drivers/timebase.h"
+
+#define TRACE_BLOCK_MAX  0xFFFFU   // count and lost are 16 bit
+
+trace_ring_t trace_ring;
+
+#if TRACE_BACKEND == TRACE_BACKEND_FILE
+static FILE *trace_file;
+#endif
+
+static void _trace_header(trace_block_t *b, uint32_t count, uint32_t lost) {
+  b->magic = TRACE_STREAM_MAGIC;
+  b->clock_hz = TRACE_CLOCK_HZ;
+  b->count = (uint16_t)count;
+  b->lost = (uint16_t)((lost > TRACE_BLOCK_MAX) ? TRACE_BLOCK_MAX : lost);
+}
+
+/* Event 'idx' still in the ring: writers may have lapped the reader while it was copied */
+static bool _trace_live(uint32_t idx) {
+  return (__atomic_load_n(&trace_ring.head, __ATOMIC_ACQUIRE) - idx) <= TRACE_RING_EVENTS;
+}
+
+void trace_init(void) {
+  trace_ring.head = 0;
+  trace_ring.tail = 0;
+
+#if TRACE_BACKEND == TRACE_BACKEND_FILE
+  if (trace_file != NULL) fclose(trace_file);
+  trace_file = fopen(TRACE_FILE, "wb");
+#endif
+}
+
+#if TRACE_BACKEND == TRACE_BACKEND_UART
+static void _trace_send(const void *data, uint32_t len) {
+  const char *p = data;
+
+  // byte by byte on the register: usart_write() would trace itself
+  while (len--) {
+    usart_send_char(TRACE_USART, *p++);
+  }
+}
+#elif TRACE_BACKEND == TRACE_BACKEND_FILE
+static void _trace_send(const void *data, uint32_t len) {
+  if (trace_file != NULL) fwrite(data, 1, len, trace_file);
+}
+#endif
+
+uint32_t trace_flush(uint32_t max) {
+#if TRACE_BACKEND == TRACE_BACKEND_RAM
+  (void)max;
+  return 0;
+#else
+  trace_block_t block;
+  trace_event_t ev;
+  uint32_t head, tail, lost = 0, count, i;
+
+  head = __atomic_load_n(&trace_ring.head, __ATOMIC_ACQUIRE);
+  tail = trace_ring.tail;
+  if (head - tail > TRACE_RING_EVENTS) {
+    lost = head - tail - TRACE_RING_EVENTS;
+    tail = head - TRACE_RING_EVENTS;
+  }
+
+  count = head - tail;
+  if (max != 0 && count > max) count = max;
+  if (count > TRACE_BLOCK_MAX) count = TRACE_BLOCK_MAX;
+  if (count == 0 && lost == 0) return 0;
+
+  _trace_header(&block, count, lost);
+  _trace_send(&block, sizeof(block));
+  for (i = 0; i < count; i++) {
+    ev = trace_ring.ev[(tail + i) & (TRACE_RING_EVENTS - 1U)];
+    if (!_trace_live(tail + i)) {
+      // overwritten while the block was being sent, keep the stream framing
+      memset(&ev, 0, sizeof(ev));
+    }
+    _trace_send(&ev, sizeof(ev));
+  }
+  trace_ring.tail = tail + count;
+
+#if TRACE_BACKEND == TRACE_BACKEND_FILE
+  if (trace_file != NULL) fflush(trace_file);
+#endif
+
+  return count;
+#endif
+}
+
+uint32_t trace_export(uint8_t *buf, uint32_t len) {
+  trace_block_t block;
+  uint32_t head, from, count, i, n = 0;
+
+  if (len < sizeof(trace_block_t)) return 0;
+
+  head = __atomic_load_n(&trace_ring.head, __ATOMIC_ACQUIRE);
+  count = (len - sizeof(trace_block_t)) / sizeof(trace_event_t);
+  if (count > TRACE_RING_EVENTS) count = TRACE_RING_EVENTS;
+  if (count > head) count = head;
+  if (count > TRACE_BLOCK_MAX) count = TRACE_BLOCK_MAX;
+  from = head - count;
+
+  for (i = 0; i < count; i++) {
+    memcpy(buf + sizeof(trace_block_t) + n * sizeof(trace_event_t),
+           &trace_ring.ev[(from + i) & (TRACE_RING_EVENTS - 1U)], sizeof(trace_event_t));
+    if (_trace_live(from + i)) {
+      n++;
+    }
+  }
+
+  _trace_header(&block, n, count - n);
+  memcpy(buf, &block, sizeof(block));
+
+  return sizeof(trace_block_t) + n * sizeof(trace_event_t);
+}
+
+#endif
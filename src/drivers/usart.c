@@ -1,4 +1,5 @@
 #include "drivers/usart.h"
+#include "drivers/trace.h"
 
 void usart_setup(USART_t *usart, uint32_t baudrate, uint32_t pclk_hz) {
     // 1. Disable USART
@@ -37,3 +38,34 @@ char usart_receive_char(USART_t *usart) {
     while (!usart_data_available(usart));
     return (char)(usart->RDR);
 }
+
+void usart_enable_fifo(USART_t *usart) {
+    // FIFOEN (Bit 29) can only be written while UE=0
+    usart->CR1 &= ~BIT(0);
+    usart->CR1 |= BIT(29);
+    usart->CR1 |= BIT(0);
+}
+
+uint32_t usart_write(USART_t *usart, const uint8_t *buf, uint32_t len) {
+    uint32_t n = 0;
+
+    while (n < len && (usart->ISR & BIT(7))) {
+        usart->TDR = buf[n++];
+    }
+    if (n > 0) TRACE(TRACE_EV_USART_TX, 0, 0, n);
+    return n;
+}
+
+uint32_t usart_read(USART_t *usart, uint8_t *buf, uint32_t max) {
+    uint32_t n = 0;
+
+    // ORE (Bit 3) blocks further reception until cleared
+    if (usart->ISR & BIT(3)) {
+        usart->ICR = BIT(3);
+    }
+    while (n < max && (usart->ISR & BIT(5))) {
+        buf[n++] = (uint8_t)usart->RDR;
+    }
+    if (n > 0) TRACE(TRACE_EV_USART_RX, 0, 0, n);
+    return n;
+}
@@ -5,13 +5,14 @@
 #include "drivers/gpio.h"
 #include "drivers/rcc.h"
 #include "drivers/usart.h"
-#include "drivers/systick.h"
+#include "drivers/timebase.h"
+#include "drivers/trace.h"
+#include "can/slcan_fdcan.h"
+#include "can/can_selftest_fdcan.h"
 
-static volatile uint32_t timems = 0;
-
-void SysTick_Handler() {
-  timems++;
-}
+#ifndef SLCAN_BAUDRATE
+#define SLCAN_BAUDRATE 2000000U
+#endif
 
 static USART_t *DEBUG_UART = USART3;
 
@@ -21,7 +22,7 @@ void _putchar(char c) {
 
 void SystemInit(void)
 {
-    systick_init(4000);
+    rcc_clock_init(&rcc_clock_250mhz);
 
     rcc_enable_usart(USART3);
 
@@ -30,11 +31,80 @@ void SystemInit(void)
     gpio_setup(PIN('D', 8), GPIO_MODE_AF, GPIO_PULLUP, GPIO_OTYPE_PP, GPIO_SPEED_MEDIUM, 7);
     gpio_setup(PIN('D', 9), GPIO_MODE_AF, GPIO_PULLUP, GPIO_OTYPE_PP, GPIO_SPEED_MEDIUM, 7);
 
-    usart_setup(USART3, 115200, 32000000);
+    usart_setup(USART3, 115200, rcc_get_usart_clk_hz(USART3));
+}
+
+#ifdef SLCAN_GATEWAY
+/* FDCAN1 <-> ST-Link VCP, the UART carries the SLCAN protocol only */
+static void slcan_gateway(void)
+{
+  static FDCAN_Handle_t can = { .Instance = FDCAN1 };
+  static slcan_t slcan;
+
+  usart_setup(USART3, SLCAN_BAUDRATE, rcc_get_usart_clk_hz(USART3));
+  slcan_fdcan_init(&slcan, &can, USART3);
+
+  while (1) {
+    slcan_poll(&slcan);
+  }
+}
+#endif
+
+#ifdef CAN_SELFTEST
+/* FDCAN1 internal loopback at 1 Mbit/s + 5 Mbit/s, one JSON line per run */
+static void can_selftest_loopback(void)
+{
+  static FDCAN_Handle_t can = { .Instance = FDCAN1 };
+  static const can_selftest_config_t cfg = {
+    .id_min = 0x000, .id_max = 0x7FF, .dlc_min = CAN_SELFTEST_VERIFY_DLC_MIN, .dlc_max = 15,
+    .fd_permille = 500, .brs_permille = 1000, .frames = 100000, .verify = true, .seed = 1,
+  };
+  static can_selftest_t st;
+  can_selftest_stats_t stats;
+  FDCAN_BitTiming_t nominal, data;
+
+  pll1_q_init();
+  fdcan_calc_bittiming(rcc_get_fdcan_clk_hz(), 1000000U, 800U, false, &nominal);
+  fdcan_calc_bittiming(rcc_get_fdcan_clk_hz(), 5000000U, 750U, true, &data);
+  can.Init.NominalPrescaler = nominal.Prescaler;
+  can.Init.NominalSyncJumpWidth = nominal.SyncJumpWidth;
+  can.Init.NominalTimeSeg1 = nominal.TimeSeg1;
+  can.Init.NominalTimeSeg2 = nominal.TimeSeg2;
+  can.Init.DataPrescaler = data.Prescaler;
+  can.Init.DataSyncJumpWidth = data.SyncJumpWidth;
+  can.Init.DataTimeSeg1 = data.TimeSeg1;
+  can.Init.DataTimeSeg2 = data.TimeSeg2;
+  can.Init.FDMode = true;
+  can.Init.Loopback = true;
+  fdcan_init(&can);
+
+  while (1) {
+    can_selftest_fdcan_init(&st, &can, &cfg);
+    can_selftest_fdcan_run(&st, &stats);
+    printf("{\"selftest\":{\"sent\":%u,\"received\":%u,\"lost\":%u,\"corrupt\":%u,\"frames_per_s\":%u,"
+           "\"bytes_per_s\":%u,\"tx_cycles\":%u,\"rx_cycles\":%u,\"loss_ppm\":%u}}\r\n",
+           (unsigned)stats.sent, (unsigned)stats.received, (unsigned)stats.lost, (unsigned)stats.corrupt,
+           (unsigned)stats.frames_per_s, (unsigned)stats.bytes_per_s, (unsigned)stats.tx_cycles_per_frame,
+           (unsigned)stats.rx_cycles_per_frame, (unsigned)stats.loss_ppm);
+  }
 }
+#endif
 
 int main(void)
 {
+  timebase_init();
+#ifdef TRACE_ENABLE
+  trace_init();
+#endif
+
+#ifdef SLCAN_GATEWAY
+  slcan_gateway();
+#endif
+
+#ifdef CAN_SELFTEST
+  can_selftest_loopback();
+#endif
+
   printf("starting...\r\n");
   uint16_t green_led = PIN('B', 0);
   uint16_t yellow_led = PIN('F', 4);
@@ -56,16 +126,19 @@ int main(void)
   gpio_write(red_led, false);
 
 
-  uint32_t last_time = timems;
+  uint32_t last_time = timebase_ms();
 
   while (1) {
     gpio_write(green_led, gpio_read(button));
 
-    if ((timems - last_time) > 500) {
-      last_time = timems;
+    if ((timebase_ms() - last_time) > 500) {
+      last_time = timebase_ms();
       gpio_toggle(yellow_led);
       gpio_toggle(red_led);
-      printf("timems: %d\r\n", timems);
+      printf("timems: %d\r\n", last_time);
+#ifdef TRACE_ENABLE
+      trace_flush(0);
+#endif
     }
   }
 
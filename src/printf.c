@@ -857,6 +857,161 @@ static int _vsnprintf(out_fct_type out, char* buffer, const size_t maxlen, const
 }
 
 
+// internal vsnprintf executing a pre-parsed format, see printf_compile()
+static int _vsnprintf_fmt(out_fct_type out, char* buffer, const size_t maxlen, const printf_fmt_t* fmt, va_list va)
+{
+  unsigned int flags, width, precision, n;
+  const printf_spec_t* spec;
+  size_t idx = 0U;
+
+  if (!buffer) {
+    // use null output function
+    out = _out_null;
+  }
+
+  for (spec = fmt->specs; ; spec++) {
+    // literal run preceding the conversion
+    const char* lit = fmt->format + spec->lit_pos;
+    for (n = spec->lit_len; n; n--) {
+      out(*(lit++), buffer, idx++, maxlen);
+    }
+    if (spec->conv == PRINTF_CONV_END) {
+      break;
+    }
+
+    flags     = spec->flags & ~(PRINTF_FLAG_WIDTH_ARG | PRINTF_FLAG_PREC_ARG);
+    width     = spec->width;
+    precision = spec->precision;
+
+    if (spec->flags & PRINTF_FLAG_WIDTH_ARG) {
+      const int w = va_arg(va, int);
+      if (w < 0) {
+        flags |= FLAGS_LEFT;    // reverse padding
+        width = (unsigned int)-w;
+      }
+      else {
+        width = (unsigned int)w;
+      }
+    }
+    if (spec->flags & PRINTF_FLAG_PREC_ARG) {
+      const int prec = (int)va_arg(va, int);
+      precision = prec > 0 ? (unsigned int)prec : 0U;
+    }
+
+    switch (spec->conv) {
+      case PRINTF_CONV_SIGNED :
+        if (flags & FLAGS_LONG_LONG) {
+#if defined(PRINTF_SUPPORT_LONG_LONG)
+          const long long value = va_arg(va, long long);
+          idx = _ntoa_long_long(out, buffer, idx, maxlen, (unsigned long long)(value > 0 ? value : 0 - value), value < 0, spec->base, precision, width, flags);
+#endif
+        }
+        else if (flags & FLAGS_LONG) {
+          const long value = va_arg(va, long);
+          idx = _ntoa_long(out, buffer, idx, maxlen, (unsigned long)(value > 0 ? value : 0 - value), value < 0, spec->base, precision, width, flags);
+        }
+        else {
+          const int value = (flags & FLAGS_CHAR) ? (char)va_arg(va, int) : (flags & FLAGS_SHORT) ? (short int)va_arg(va, int) : va_arg(va, int);
+          idx = _ntoa_long(out, buffer, idx, maxlen, (unsigned int)(value > 0 ? value : 0 - value), value < 0, spec->base, precision, width, flags);
+        }
+        break;
+
+      case PRINTF_CONV_UNSIGNED :
+        if (flags & FLAGS_LONG_LONG) {
+#if defined(PRINTF_SUPPORT_LONG_LONG)
+          idx = _ntoa_long_long(out, buffer, idx, maxlen, va_arg(va, unsigned long long), false, spec->base, precision, width, flags);
+#endif
+        }
+        else if (flags & FLAGS_LONG) {
+          idx = _ntoa_long(out, buffer, idx, maxlen, va_arg(va, unsigned long), false, spec->base, precision, width, flags);
+        }
+        else {
+          const unsigned int value = (flags & FLAGS_CHAR) ? (unsigned char)va_arg(va, unsigned int) : (flags & FLAGS_SHORT) ? (unsigned short int)va_arg(va, unsigned int) : va_arg(va, unsigned int);
+          idx = _ntoa_long(out, buffer, idx, maxlen, value, false, spec->base, precision, width, flags);
+        }
+        break;
+
+#if defined(PRINTF_SUPPORT_FLOAT)
+      case PRINTF_CONV_FLOAT :
+        idx = _ftoa(out, buffer, idx, maxlen, va_arg(va, double), precision, width, flags);
+        break;
+#if defined(PRINTF_SUPPORT_EXPONENTIAL)
+      case PRINTF_CONV_EXP :
+        idx = _etoa(out, buffer, idx, maxlen, va_arg(va, double), precision, width, flags);
+        break;
+#endif  // PRINTF_SUPPORT_EXPONENTIAL
+#endif  // PRINTF_SUPPORT_FLOAT
+
+      case PRINTF_CONV_CHAR : {
+        unsigned int l = 1U;
+        // pre padding
+        if (!(flags & FLAGS_LEFT)) {
+          while (l++ < width) {
+            out(' ', buffer, idx++, maxlen);
+          }
+        }
+        // char output
+        out((char)va_arg(va, int), buffer, idx++, maxlen);
+        // post padding
+        if (flags & FLAGS_LEFT) {
+          while (l++ < width) {
+            out(' ', buffer, idx++, maxlen);
+          }
+        }
+        break;
+      }
+
+      case PRINTF_CONV_STRING : {
+        const char* p = va_arg(va, char*);
+        unsigned int l = _strnlen_s(p, precision ? precision : (size_t)-1);
+        // pre padding
+        if (flags & FLAGS_PRECISION) {
+          l = (l < precision ? l : precision);
+        }
+        if (!(flags & FLAGS_LEFT)) {
+          while (l++ < width) {
+            out(' ', buffer, idx++, maxlen);
+          }
+        }
+        // string output
+        while ((*p != 0) && (!(flags & FLAGS_PRECISION) || precision--)) {
+          out(*(p++), buffer, idx++, maxlen);
+        }
+        // post padding
+        if (flags & FLAGS_LEFT) {
+          while (l++ < width) {
+            out(' ', buffer, idx++, maxlen);
+          }
+        }
+        break;
+      }
+
+      case PRINTF_CONV_POINTER :
+#if defined(PRINTF_SUPPORT_LONG_LONG)
+        if (sizeof(uintptr_t) == sizeof(long long)) {
+          idx = _ntoa_long_long(out, buffer, idx, maxlen, (uintptr_t)va_arg(va, void*), false, 16U, precision, width, flags);
+        }
+        else
+#endif
+        {
+          idx = _ntoa_long(out, buffer, idx, maxlen, (unsigned long)((uintptr_t)va_arg(va, void*)), false, 16U, precision, width, flags);
+        }
+        break;
+
+      default :
+        out((char)spec->base, buffer, idx++, maxlen);
+        break;
+    }
+  }
+
+  // termination
+  out((char)0, buffer, idx < maxlen ? idx : maxlen - 1U, maxlen);
+
+  // return written chars without terminating \0
+  return (int)idx;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 
 int printf_(const char* format, ...)
@@ -911,4 +1066,42 @@ int fctprintf(void (*out)(char character, void* arg), void* arg, const char* for
   const int ret = _vsnprintf(_out_fct, (char*)(uintptr_t)&out_fct_wrap, (size_t)-1, format, va);
   va_end(va);
   return ret;
-}
+}
+
+
+int printf_fmt_(const printf_fmt_t* fmt, ...)
+{
+  va_list va;
+  va_start(va, fmt);
+  char buffer[1];
+  const int ret = _vsnprintf_fmt(_out_char, buffer, (size_t)-1, fmt, va);
+  va_end(va);
+  return ret;
+}
+
+
+int snprintf_fmt_(char* buffer, size_t count, const printf_fmt_t* fmt, ...)
+{
+  va_list va;
+  va_start(va, fmt);
+  const int ret = _vsnprintf_fmt(_out_buffer, buffer, count, fmt, va);
+  va_end(va);
+  return ret;
+}
+
+
+int vsnprintf_fmt_(char* buffer, size_t count, const printf_fmt_t* fmt, va_list va)
+{
+  return _vsnprintf_fmt(_out_buffer, buffer, count, fmt, va);
+}
+
+
+int fctprintf_fmt(void (*out)(char character, void* arg), void* arg, const printf_fmt_t* fmt, ...)
+{
+  va_list va;
+  va_start(va, fmt);
+  const out_fct_wrap_type out_fct_wrap = { out, arg };
+  const int ret = _vsnprintf_fmt(_out_fct, (char*)(uintptr_t)&out_fct_wrap, (size_t)-1, fmt, va);
+  va_end(va);
+  return ret;
+}
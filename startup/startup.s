@@ -41,6 +41,13 @@ defined in linker script */
 .word _sbss
 /* end address for the .bss section. defined in linker script */
 .word _ebss
+/* start address for the initialization values of the .ramfunc section.
+defined in linker script */
+.word _siramfunc
+/* start address for the .ramfunc section. defined in linker script */
+.word _sramfunc
+/* end address for the .ramfunc section. defined in linker script */
+.word _eramfunc
 
 /**
  * @brief  This is the code that gets called when the processor first
@@ -77,6 +84,23 @@ LoopCopyDataInit:
   cmp r4, r1
   bcc CopyDataInit
 
+/* Copy the RAM-resident code from flash to SRAM */
+  ldr r0, =_sramfunc
+  ldr r1, =_eramfunc
+  ldr r2, =_siramfunc
+  movs r3, #0
+  b LoopCopyRamfuncInit
+
+CopyRamfuncInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyRamfuncInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyRamfuncInit
+
 /* Zero fill the bss segment. */
   ldr r2, =_sbss
   ldr r4, =_ebss
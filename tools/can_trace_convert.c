@@ -0,0 +1,617 @@
+/*
+ * Convert a binary CAN trace (can_trace_export() stream) to candump, Vector
+ * ASC or Vector BLF.
+ *
+ *   can_trace_convert [-f candump|asc|blf] [-j threads] [-o out] capture.bin
+ *   can_trace_convert --bench [MB]
+ *
+ * The capture is memory-mapped and its blocks are indexed in one pass over
+ * the block headers. Blocks decode independently, so they are handed out to
+ * worker threads in fixed-size chunks; each chunk is formatted into its own
+ * buffer and the buffers are written in capture order.
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "can/can_trace_codec.h"
+
+#define STREAM_HEADER_SIZE  24U
+#define CHUNK_BLOCKS        2048U   // blocks per work item
+#define BLF_CONTAINER_MAX   0x20000U
+
+#define BLF_OBJ_CAN_MESSAGE       1U
+#define BLF_OBJ_LOG_CONTAINER     10U
+#define BLF_OBJ_CAN_FD_MESSAGE_64 101U
+#define BLF_TIME_ONE_NANS         0x00000002U
+#define BLF_CAN_EXT               0x80000000U
+#define BLF_FD_EDL                0x1000U
+#define BLF_FD_BRS                0x2000U
+#define BLF_FD_ESI                0x4000U
+
+typedef enum {
+  FORMAT_CANDUMP = 0,
+  FORMAT_ASC,
+  FORMAT_BLF
+} format_t;
+
+typedef struct {
+  char *data;
+  size_t len;
+  size_t cap;
+} buf_t;
+
+typedef struct {
+  const uint8_t *base;
+  const size_t *offsets;        // block offsets into the mapping
+  size_t first, count;          // block range of this chunk
+  size_t map_size;
+  format_t format;
+  uint64_t start_us;            // capture start, for relative formats
+  buf_t out;                    // formatted text, or BLF objects
+  uint64_t frames;
+  uint64_t objects;             // BLF objects
+  uint64_t errors;
+  can_trace_decoder_t dec;
+} chunk_t;
+
+static const uint8_t dlc_bytes[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+static const char hex_upper[] = "0123456789ABCDEF";
+
+static void _die(const char *msg) {
+  perror(msg);
+  exit(1);
+}
+
+static char *_buf_reserve(buf_t *b, size_t n) {
+  if (b->len + n > b->cap) {
+    b->cap = (b->cap == 0) ? (1U << 20) : b->cap * 2;
+    while (b->len + n > b->cap) b->cap *= 2;
+    b->data = realloc(b->data, b->cap);
+    if (b->data == NULL) _die("realloc");
+  }
+  return b->data + b->len;
+}
+
+static char *_put_hex8(char *p, uint8_t v) {
+  p[0] = hex_upper[v >> 4];
+  p[1] = hex_upper[v & 0xF];
+  return p + 2;
+}
+
+static char *_put_hex(char *p, uint32_t v, int digits) {
+  int i;
+
+  for (i = digits - 1; i >= 0; i--) {
+    p[i] = hex_upper[v & 0xF];
+    v >>= 4;
+  }
+  return p + digits;
+}
+
+/* Unsigned decimal, zero padded to 'width' digits (0: no padding) */
+static char *_put_dec(char *p, uint64_t v, int width) {
+  char tmp[24];
+  int n = 0;
+
+  do {
+    tmp[n++] = (char)('0' + v % 10);
+    v /= 10;
+  } while (v != 0);
+  while (n < width) tmp[n++] = '0';
+  while (n > 0) *p++ = tmp[--n];
+  return p;
+}
+
+/* candump -l: (1436509052.249713) can0 123#11223344, FD: 123##<flags>11223344 */
+static void _emit_candump(chunk_t *c, const can_trace_frame_t *f) {
+  char *p = _buf_reserve(&c->out, 160), *start = p;
+  uint32_t i, len = dlc_bytes[f->dlc];
+
+  *p++ = '(';
+  p = _put_dec(p, f->timestamp_us / 1000000U, 10);
+  *p++ = '.';
+  p = _put_dec(p, f->timestamp_us % 1000000U, 6);
+  memcpy(p, ") can", 5);
+  p += 5;
+  *p++ = (char)('0' + (f->flags & CAN_TRACE_FLAG_CH_MASK));
+  *p++ = ' ';
+  p = (f->flags & CAN_TRACE_FLAG_XTD) ? _put_hex(p, f->id, 8) : _put_hex(p, f->id, 3);
+  *p++ = '#';
+  if (f->flags & CAN_TRACE_FLAG_FDF) {
+    *p++ = '#';
+    *p++ = hex_upper[((f->flags & CAN_TRACE_FLAG_BRS) ? 1 : 0) | ((f->flags & CAN_TRACE_FLAG_ESI) ? 2 : 0)];
+  }
+  for (i = 0; i < len; i++) {
+    p = _put_hex8(p, f->data[i]);
+  }
+  *p++ = '\n';
+  c->out.len += (size_t)(p - start);
+}
+
+/* Vector ASC, "base hex timestamps absolute" (seconds from the capture start) */
+static void _emit_asc(chunk_t *c, const can_trace_frame_t *f) {
+  char *p = _buf_reserve(&c->out, 400), *start = p;
+  uint64_t t = f->timestamp_us - c->start_us;
+  uint32_t i, len = dlc_bytes[f->dlc], ch = (f->flags & CAN_TRACE_FLAG_CH_MASK) + 1;
+  const char *dir = (f->flags & CAN_TRACE_FLAG_TX) ? "Tx" : "Rx";
+  char id[10];
+  int id_len;
+
+  id_len = (int)((f->flags & CAN_TRACE_FLAG_XTD) ? (_put_hex(id, f->id, 8) - id) : (_put_hex(id, f->id, 3) - id));
+  if (f->flags & CAN_TRACE_FLAG_XTD) id[id_len++] = 'x';
+
+  *p++ = ' ';
+  p = _put_dec(p, t / 1000000U, 3);
+  *p++ = '.';
+  p = _put_dec(p, t % 1000000U, 6);
+
+  if (f->flags & CAN_TRACE_FLAG_FDF) {
+    p += sprintf(p, " CANFD %3u %-4s %8.*s %32s %u %u %X %2u", ch, dir, id_len, id, "",
+                 (f->flags & CAN_TRACE_FLAG_BRS) ? 1U : 0U, (f->flags & CAN_TRACE_FLAG_ESI) ? 1U : 0U,
+                 (unsigned)f->dlc, len);
+    for (i = 0; i < len; i++) {
+      *p++ = ' ';
+      p = _put_hex8(p, f->data[i]);
+    }
+    p += sprintf(p, " %8u %4u %8X %8u %8u %8u %8u %8u\n", 0U, 0U,
+                 BLF_FD_EDL | ((f->flags & CAN_TRACE_FLAG_BRS) ? BLF_FD_BRS : 0) |
+                 ((f->flags & CAN_TRACE_FLAG_ESI) ? BLF_FD_ESI : 0), 0U, 0U, 0U, 0U, 0U);
+  } else {
+    p += sprintf(p, " %u  %-15.*s %s   d %X", ch, id_len, id, dir, (unsigned)f->dlc);
+    for (i = 0; i < len; i++) {
+      *p++ = ' ';
+      p = _put_hex8(p, f->data[i]);
+    }
+    *p++ = '\n';
+  }
+  c->out.len += (size_t)(p - start);
+}
+
+static void _put_le16(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void _put_le32(uint8_t *p, uint32_t v) {
+  _put_le16(p, v);
+  _put_le16(p + 2, v >> 16);
+}
+
+static void _put_le64(uint8_t *p, uint64_t v) {
+  _put_le32(p, (uint32_t)v);
+  _put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+/* BLF object header v1: "LOBJ", header size, version, object size, type, flags, client, version, time */
+static uint8_t *_blf_object(chunk_t *c, uint32_t type, uint32_t body_size, uint64_t time_ns) {
+  uint32_t size = 32 + body_size;
+  uint8_t *p = (uint8_t *)_buf_reserve(&c->out, size + 4);
+
+  memset(p, 0, size + 4);
+  memcpy(p, "LOBJ", 4);
+  _put_le16(p + 4, 32);
+  _put_le16(p + 6, 1);
+  _put_le32(p + 8, size);
+  _put_le32(p + 12, type);
+  _put_le32(p + 16, BLF_TIME_ONE_NANS);
+  _put_le64(p + 24, time_ns);
+  c->out.len += size + (size % 4);   // objects are 4-byte aligned
+  c->objects++;
+  return p + 32;
+}
+
+static void _emit_blf(chunk_t *c, const can_trace_frame_t *f) {
+  uint64_t t = (f->timestamp_us - c->start_us) * 1000U;
+  uint32_t len = dlc_bytes[f->dlc], id = f->id;
+  uint32_t ch = (f->flags & CAN_TRACE_FLAG_CH_MASK) + 1, flags;
+  uint8_t *p;
+
+  if (f->flags & CAN_TRACE_FLAG_XTD) id |= BLF_CAN_EXT;
+
+  if (f->flags & CAN_TRACE_FLAG_FDF) {
+    // CAN_FD_MESSAGE_64: channel, dlc, valid bytes, tx count, id, frame length, flags,
+    // arb/data bit timing, BRS/CRC offsets, bit count, dir, ext offset, crc, data[64]
+    p = _blf_object(c, BLF_OBJ_CAN_FD_MESSAGE_64, 40 + 64, t);
+    flags = BLF_FD_EDL | ((f->flags & CAN_TRACE_FLAG_BRS) ? BLF_FD_BRS : 0) | ((f->flags & CAN_TRACE_FLAG_ESI) ? BLF_FD_ESI : 0);
+    p[0] = (uint8_t)ch;
+    p[1] = f->dlc;
+    p[2] = (uint8_t)len;
+    _put_le32(p + 4, id);
+    _put_le32(p + 12, flags);
+    p[34] = (f->flags & CAN_TRACE_FLAG_TX) ? 1 : 0;
+    memcpy(p + 40, f->data, len);
+  } else {
+    // CAN_MESSAGE: channel, flags (bit 0 = TX), dlc, id, data[8]
+    p = _blf_object(c, BLF_OBJ_CAN_MESSAGE, 16, t);
+    _put_le16(p, ch);
+    p[2] = (f->flags & CAN_TRACE_FLAG_TX) ? 1 : 0;
+    p[3] = f->dlc;
+    _put_le32(p + 4, id);
+    memcpy(p + 8, f->data, len);
+  }
+}
+
+static void _frame_cb(const can_trace_frame_t *f, void *arg) {
+  chunk_t *c = arg;
+
+  switch (c->format) {
+    case FORMAT_CANDUMP: _emit_candump(c, f); break;
+    case FORMAT_ASC:     _emit_asc(c, f); break;
+    case FORMAT_BLF:     _emit_blf(c, f); break;
+  }
+  c->frames++;
+}
+
+static void *_chunk_worker(void *arg) {
+  chunk_t *c = arg;
+  size_t i, off;
+  int n;
+
+  c->out.len = 0;
+  c->frames = c->objects = c->errors = 0;
+  for (i = c->first; i < c->first + c->count; i++) {
+    off = c->offsets[i];
+    n = can_trace_decode_block(&c->dec, c->base + off, (uint32_t)(c->map_size - off), _frame_cb, c);
+    if (n < 0) c->errors++;
+  }
+  return NULL;
+}
+
+/* Walk the block headers once; a damaged region is skipped up to the next valid header */
+static size_t _index_blocks(const uint8_t *base, size_t size, size_t **offsets_out) {
+  size_t pos = 0, count = 0, cap = 1024, used;
+  size_t *offsets = malloc(cap * sizeof(*offsets));
+
+  if (offsets == NULL) _die("malloc");
+
+  // optional stream header (anything before it, e.g. console output, is ignored)
+  while (pos + STREAM_HEADER_SIZE <= size && memcmp(base + pos, "CTRC", 4) != 0 &&
+         !(base[pos] == 'C' && base[pos + 1] == 'T')) {
+    pos++;
+  }
+  if (pos + STREAM_HEADER_SIZE <= size && memcmp(base + pos, "CTRC", 4) == 0) pos += STREAM_HEADER_SIZE;
+
+  while (pos + CAN_TRACE_HEADER_SIZE <= size) {
+    used = can_trace_block_used(base + pos);
+    if (base[pos] != 'C' || base[pos + 1] != 'T' || used < CAN_TRACE_HEADER_SIZE || pos + used > size) {
+      pos++;
+      continue;
+    }
+    if (count == cap) {
+      cap *= 2;
+      offsets = realloc(offsets, cap * sizeof(*offsets));
+      if (offsets == NULL) _die("realloc");
+    }
+    offsets[count++] = pos;
+    pos += used;
+  }
+
+  *offsets_out = offsets;
+  return count;
+}
+
+static uint64_t _block_base_us(const uint8_t *block) {
+  uint64_t v = 0;
+  int i;
+
+  for (i = 7; i >= 0; i--) v = (v << 8) | block[8 + i];
+  return v;
+}
+
+static void _write_all(FILE *out, const void *data, size_t len) {
+  if (len != 0 && fwrite(data, 1, len, out) != len) _die("fwrite");
+}
+
+static void _blf_write_containers(FILE *out, const buf_t *objs, uint64_t *file_size) {
+  uint8_t hdr[32];
+  size_t pos = 0, len, obj;
+  uint32_t obj_size;
+
+  // containers end on an object boundary, objects are padded to 4 bytes
+  while (pos < objs->len) {
+    len = 0;
+    while (pos + len < objs->len) {
+      memcpy(&obj_size, objs->data + pos + len + 8, 4);
+      obj = obj_size + (obj_size % 4);
+      if (len != 0 && len + obj > BLF_CONTAINER_MAX) break;
+      len += obj;
+    }
+
+    memset(hdr, 0, sizeof(hdr));
+    memcpy(hdr, "LOBJ", 4);
+    _put_le16(hdr + 4, 16);
+    _put_le16(hdr + 6, 1);
+    _put_le32(hdr + 8, (uint32_t)(16 + 16 + len));
+    _put_le32(hdr + 12, BLF_OBJ_LOG_CONTAINER);
+    _put_le16(hdr + 16, 0);                   // no compression
+    _put_le32(hdr + 24, (uint32_t)len);       // uncompressed size
+    _write_all(out, hdr, 32);
+    _write_all(out, objs->data + pos, len);
+    if ((16 + 16 + len) % 4) _write_all(out, "\0\0\0", (16 + 16 + len) % 4);
+
+    *file_size += 32 + len + ((16 + 16 + len) % 4);
+    pos += len;
+  }
+}
+
+static void _blf_file_header(uint8_t *hdr, uint64_t file_size, uint64_t uncompressed, uint64_t objects) {
+  memset(hdr, 0, 144);
+  memcpy(hdr, "LOGG", 4);
+  _put_le32(hdr + 4, 144);
+  hdr[8] = 5;                                 // application id
+  hdr[12] = 4;                                // binlog version 4.1.1.1
+  hdr[13] = 1;
+  hdr[14] = 1;
+  hdr[15] = 1;
+  _put_le64(hdr + 16, file_size);
+  _put_le64(hdr + 24, uncompressed);
+  _put_le32(hdr + 32, (uint32_t)objects);
+}
+
+typedef struct {
+  uint64_t frames;
+  uint64_t errors;
+  size_t blocks;
+} convert_stats_t;
+
+static int _convert(const uint8_t *base, size_t size, format_t format, unsigned threads, FILE *out,
+                    convert_stats_t *stats) {
+  size_t *offsets, nblocks, next = 0;
+  chunk_t *chunks;
+  pthread_t *tids;
+  unsigned t, active;
+  uint64_t start_us, blf_size = 144, blf_objects = 0, blf_uncompressed = 0;
+  uint8_t blf_hdr[144];
+
+  nblocks = _index_blocks(base, size, &offsets);
+  start_us = (nblocks != 0) ? _block_base_us(base + offsets[0]) : 0;
+
+  chunks = calloc(threads, sizeof(*chunks));
+  tids = calloc(threads, sizeof(*tids));
+  if (chunks == NULL || tids == NULL) _die("calloc");
+
+  if (format == FORMAT_ASC) {
+    fprintf(out, "date Thu Jan 1 00:00:00.000 am 1970\nbase hex  timestamps absolute\n"
+                 "internal events logged\nBegin Triggerblock\n");
+  } else if (format == FORMAT_BLF) {
+    memset(blf_hdr, 0, sizeof(blf_hdr));
+    _write_all(out, blf_hdr, sizeof(blf_hdr));   // rewritten at the end
+  }
+
+  memset(stats, 0, sizeof(*stats));
+  stats->blocks = nblocks;
+
+  while (next < nblocks) {
+    for (active = 0; active < threads && next < nblocks; active++) {
+      chunk_t *c = &chunks[active];
+
+      c->base = base;
+      c->offsets = offsets;
+      c->map_size = size;
+      c->format = format;
+      c->start_us = start_us;
+      c->first = next;
+      c->count = (nblocks - next < CHUNK_BLOCKS) ? nblocks - next : CHUNK_BLOCKS;
+      next += c->count;
+      if (threads > 1) {
+        if (pthread_create(&tids[active], NULL, _chunk_worker, c) != 0) _die("pthread_create");
+      } else {
+        _chunk_worker(c);
+      }
+    }
+
+    for (t = 0; t < active; t++) {
+      if (threads > 1) pthread_join(tids[t], NULL);
+      stats->frames += chunks[t].frames;
+      stats->errors += chunks[t].errors;
+      if (format == FORMAT_BLF) {
+        blf_uncompressed += chunks[t].out.len;
+        blf_objects += chunks[t].objects;
+        _blf_write_containers(out, &chunks[t].out, &blf_size);
+      } else {
+        _write_all(out, chunks[t].out.data, chunks[t].out.len);
+      }
+    }
+  }
+
+  if (format == FORMAT_ASC) {
+    fprintf(out, "End TriggerBlock\n");
+  } else if (format == FORMAT_BLF) {
+    _blf_file_header(blf_hdr, blf_size, blf_uncompressed + 144, blf_objects);
+    if (fseek(out, 0, SEEK_SET) != 0) {
+      fprintf(stderr, "blf output must be seekable\n");
+      return 1;
+    }
+    _write_all(out, blf_hdr, sizeof(blf_hdr));
+  }
+
+  for (t = 0; t < threads; t++) free(chunks[t].out.data);
+  free(chunks);
+  free(tids);
+  free(offsets);
+  return 0;
+}
+
+static const uint8_t *_map(const char *path, size_t *size) {
+  struct stat st;
+  void *p;
+  int fd = open(path, O_RDONLY);
+
+  if (fd < 0) _die(path);
+  if (fstat(fd, &st) != 0) _die("fstat");
+  *size = (size_t)st.st_size;
+  if (*size == 0) {
+    close(fd);
+    return NULL;
+  }
+  p = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (p == MAP_FAILED) _die("mmap");
+  madvise(p, *size, MADV_SEQUENTIAL);
+  close(fd);
+  return p;
+}
+
+static double _now_s(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Synthetic capture: 1 KB blocks of periodic classic frames with an FD and an extended ID mixed in */
+static void _bench_generate(const char *path, size_t mb) {
+  static uint8_t block[1024];
+  can_trace_encoder_t enc;
+  can_trace_frame_t f;
+  uint8_t hdr[STREAM_HEADER_SIZE] = { 'C', 'T', 'R', 'C', 1, 0, 0x00, 0x04 };
+  uint64_t t = 0, written = 0, target = (uint64_t)mb << 20;
+  uint32_t i = 0, seq = 0, seed = 1;
+  FILE *fp = fopen(path, "wb");
+
+  if (fp == NULL) _die(path);
+  _write_all(fp, hdr, sizeof(hdr));
+  memset(&f, 0, sizeof(f));
+  can_trace_block_begin(&enc, block, sizeof(block), seq, 0);
+
+  while (written < target) {
+    seed = seed * 1103515245U + 12345U;
+    t += 100 + ((seed >> 16) & 0xFF);
+    f.timestamp_us = t;
+    f.id = 0x100 + (i % 32) * 8;
+    f.flags = (uint8_t)(i & 1);
+    f.dlc = 8;
+    if ((i % 32) == 30) {
+      f.flags |= CAN_TRACE_FLAG_FDF | CAN_TRACE_FLAG_BRS;
+      f.dlc = 12;
+    } else if ((i % 32) == 31) {
+      f.id = 0x18DAF100;
+      f.flags |= CAN_TRACE_FLAG_XTD;
+    }
+    f.data[0] = (uint8_t)(i >> 5);
+    f.data[1] = (uint8_t)(seed >> 24);
+    f.data[5] = (uint8_t)(i >> 12);
+
+    if (can_trace_encode(&enc, &f) == 0) {
+      _write_all(fp, block, enc.used);
+      written += enc.used;
+      can_trace_block_begin(&enc, block, sizeof(block), ++seq, t);
+      can_trace_encode(&enc, &f);
+    }
+    i++;
+  }
+  if (enc.used > CAN_TRACE_HEADER_SIZE) _write_all(fp, block, enc.used);
+  fclose(fp);
+}
+
+static int _bench(size_t mb) {
+  static const char *names[] = { "candump", "asc", "blf" };
+  char path[] = "/tmp/can_trace_benchXXXXXX";
+  unsigned thread_counts[2] = { 1, (unsigned)sysconf(_SC_NPROCESSORS_ONLN) };
+  convert_stats_t stats;
+  const uint8_t *base;
+  size_t size;
+  double t0, dt;
+  FILE *null;
+  int fd, f, k;
+
+  fd = mkstemp(path);
+  if (fd < 0) _die("mkstemp");
+  close(fd);
+  _bench_generate(path, mb);
+  base = _map(path, &size);
+
+  null = fopen("/dev/null", "wb");
+  if (null == NULL) _die("/dev/null");
+
+  for (f = FORMAT_CANDUMP; f <= FORMAT_BLF; f++) {
+    for (k = 0; k < 2; k++) {
+      if (k == 1 && thread_counts[1] <= 1) break;
+      t0 = _now_s();
+      _convert(base, size, (format_t)f, thread_counts[k], null, &stats);
+      fflush(null);
+      dt = _now_s() - t0;
+      printf("{\"tool\":\"can_trace_convert\",\"format\":\"%s\",\"threads\":%u,\"input_mb\":%.1f,"
+             "\"frames\":%llu,\"seconds\":%.3f,\"mb_per_s\":%.1f,\"frames_per_s\":%.0f,\"errors\":%llu}\n",
+             names[f], thread_counts[k], (double)size / 1048576.0, (unsigned long long)stats.frames, dt,
+             (double)size / 1048576.0 / dt, (double)stats.frames / dt, (unsigned long long)stats.errors);
+      fflush(stdout);
+    }
+  }
+
+  fclose(null);
+  munmap((void *)base, size);
+  unlink(path);
+  return 0;
+}
+
+static void _usage(const char *argv0) {
+  fprintf(stderr, "usage: %s [-f candump|asc|blf] [-j threads] [-o out] capture.bin\n"
+                  "       %s --bench [MB]\n", argv0, argv0);
+}
+
+int main(int argc, char **argv) {
+  format_t format = FORMAT_CANDUMP;
+  unsigned threads = 1;
+  const char *out_path = NULL;
+  const uint8_t *base;
+  convert_stats_t stats;
+  size_t size;
+  FILE *out = stdout;
+  int opt, rc;
+
+  if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+    return _bench((argc >= 3) ? (size_t)strtoul(argv[2], NULL, 0) : 1024);
+  }
+
+  while ((opt = getopt(argc, argv, "f:j:o:")) != -1) {
+    switch (opt) {
+      case 'f':
+        if (strcmp(optarg, "candump") == 0) format = FORMAT_CANDUMP;
+        else if (strcmp(optarg, "asc") == 0) format = FORMAT_ASC;
+        else if (strcmp(optarg, "blf") == 0) format = FORMAT_BLF;
+        else { _usage(argv[0]); return 2; }
+        break;
+      case 'j':
+        threads = (unsigned)strtoul(optarg, NULL, 0);
+        if (threads == 0) threads = (unsigned)sysconf(_SC_NPROCESSORS_ONLN);
+        break;
+      case 'o':
+        out_path = optarg;
+        break;
+      default:
+        _usage(argv[0]);
+        return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    _usage(argv[0]);
+    return 2;
+  }
+
+  base = _map(argv[optind], &size);
+  if (out_path != NULL) {
+    out = fopen(out_path, "wb");
+    if (out == NULL) _die(out_path);
+  }
+  setvbuf(out, NULL, _IOFBF, 1U << 20);
+
+  rc = (base != NULL) ? _convert(base, size, format, threads, out, &stats) : 0;
+  if (base != NULL) {
+    fprintf(stderr, "%zu blocks, %llu frames, %llu bad blocks\n", stats.blocks,
+            (unsigned long long)stats.frames, (unsigned long long)stats.errors);
+    munmap((void *)base, size);
+  }
+  if (out != stdout) fclose(out);
+
+  return rc;
+}
@@ -0,0 +1,713 @@
+/*
+ * Worst-case response time analysis of a CAN message set.
+ *
+ *   can_wcrt [-k kernel_hz] [-N presc,tseg1,tseg2] [-D presc,tseg1,tseg2]
+ *            [-m queue|fifo|ideal] [-n node=mode]... [-b buffers] [-c] messages.csv|bus.dbc
+ *   can_wcrt --bench [messages]
+ *
+ * Bit timing takes the FDCAN_Init_t parameters (NominalPrescaler,
+ * NominalTimeSeg1, NominalTimeSeg2 and the Data* ones) and the FDCAN kernel
+ * clock, 50 MHz (PLL1Q of rcc_clock_250mhz) / 500 kbit/s / 2 Mbit/s by default. Frame times are the
+ * worst-case stuffed lengths from can_busload_frame_bits().
+ *
+ * Message sets:
+ *   CSV  name,id,node,dlc,format,period_ms[,jitter_ms[,deadline_ms]]
+ *        format: classic, ext, fd, fd-brs, ext-fd, ext-fd-brs; dlc is the
+ *        data length code; deadline defaults to the period.
+ *   DBC  BO_ lines, GenMsgCycleTime (or GenMsgDelayTime) for the period,
+ *        VFrameFormat / CANFD_BRS for the format, and the optional
+ *        GenMsgJitter / GenMsgDeadline (ms) attributes.
+ *
+ * Analysis, per transmitting node mode (-m / -n, default queue):
+ *   ideal  the revised fixed-priority analysis of Davis et al. (2007):
+ *          blocking by the longest lower priority frame, busy period over
+ *          all instances, interference from higher priority frames.
+ *   queue  Tx queue mode with -b non-abortable buffers (3 on the H5): a
+ *          frame with at least that many lower priority frames on its node
+ *          can find every buffer held by them and first waits for the one
+ *          that gets out first; its response time bound is added.
+ *   fifo   Tx FIFO mode: up to buffers-1 frames of the node sit ahead of the
+ *          frame, the node's frames can be overtaken by everything with a
+ *          higher priority than the node's lowest one (FIFO-queue analysis,
+ *          one instance, needs R <= T).
+ * The bounds are safe, not tight, for the queue and fifo modes.
+ *
+ * Exit status: 0 if every message meets its deadline, 1 if not, 2 on errors.
+ */
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fdcan.h"
+#include "can/can_busload.h"
+
+#define NAME_MAX_LEN    48
+#define NODE_MAX_LEN    32
+#define MAX_NODES       64
+#define LIMIT_NS        (60LL * 1000000000LL)   // busy periods longer than this: overload
+
+typedef enum {
+  MODE_QUEUE = 0,
+  MODE_FIFO,
+  MODE_IDEAL
+} tx_mode_t;
+
+typedef struct {
+  char name[NAME_MAX_LEN];
+  char node[NODE_MAX_LEN];
+  uint32_t id;
+  uint8_t flags;            // CAN_BUSLOAD_XTD/FDF/BRS
+  uint8_t dlc;
+  int64_t period_ns;
+  int64_t jitter_ns;
+  int64_t deadline_ns;
+  uint64_t key;             // arbitration order, lower wins
+  int node_index;
+  int64_t c_ns;             // worst-case frame time
+  int64_t r_ns;             // worst-case response time, -1 if unbounded
+} msg_t;
+
+typedef struct {
+  char name[NODE_MAX_LEN];
+  tx_mode_t mode;
+  uint32_t count;
+} node_t;
+
+typedef struct {
+  msg_t *msg;
+  size_t count;
+  size_t cap;
+  node_t node[MAX_NODES];
+  uint32_t nodes;
+  tx_mode_t default_mode;
+  uint32_t buffers;
+  int64_t tau_ns;           // nominal bit time
+} bus_t;
+
+static const uint8_t dlc_bytes[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+
+static double _now_s(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static const char *_mode_name(tx_mode_t mode) {
+  return (mode == MODE_FIFO) ? "fifo" : (mode == MODE_IDEAL) ? "ideal" : "queue";
+}
+
+static int _parse_mode(const char *s, tx_mode_t *mode) {
+  if (strcmp(s, "queue") == 0) *mode = MODE_QUEUE;
+  else if (strcmp(s, "fifo") == 0) *mode = MODE_FIFO;
+  else if (strcmp(s, "ideal") == 0) *mode = MODE_IDEAL;
+  else return 1;
+  return 0;
+}
+
+static int _node_index(bus_t *bus, const char *name) {
+  uint32_t i;
+
+  for (i = 0; i < bus->nodes; i++) {
+    if (strcmp(bus->node[i].name, name) == 0) return (int)i;
+  }
+  if (bus->nodes == MAX_NODES) return -1;
+
+  snprintf(bus->node[i].name, sizeof(bus->node[i].name), "%s", name);
+  bus->node[i].mode = bus->default_mode;
+  bus->node[i].count = 0;
+  return (int)bus->nodes++;
+}
+
+static msg_t *_add_msg(bus_t *bus) {
+  if (bus->count == bus->cap) {
+    bus->cap = bus->cap ? bus->cap * 2 : 256;
+    bus->msg = realloc(bus->msg, bus->cap * sizeof(msg_t));
+    if (bus->msg == NULL) {
+      perror("realloc");
+      exit(2);
+    }
+  }
+  memset(&bus->msg[bus->count], 0, sizeof(msg_t));
+  return &bus->msg[bus->count++];
+}
+
+static uint8_t _bytes_to_dlc(uint32_t bytes) {
+  uint8_t dlc;
+
+  for (dlc = 0; dlc < 15 && dlc_bytes[dlc] < bytes; dlc++);
+  return dlc;
+}
+
+static char *_trim(char *s) {
+  char *end;
+
+  while (isspace((unsigned char)*s)) s++;
+  end = s + strlen(s);
+  while (end > s && isspace((unsigned char)end[-1])) *--end = '\0';
+  return s;
+}
+
+/* name,id,node,dlc,format,period_ms[,jitter_ms[,deadline_ms]] */
+static int _load_csv(bus_t *bus, FILE *fp, const char *path) {
+  char line[512], *field[8], *p, *s;
+  uint32_t lineno = 0, n;
+  msg_t *m;
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    lineno++;
+    p = _trim(line);
+    if (*p == '\0' || *p == '#') continue;
+
+    for (n = 0, s = p; n < 8; n++) {
+      field[n] = s;
+      s = strchr(s, ',');
+      if (s == NULL) {
+        n++;
+        break;
+      }
+      *s++ = '\0';
+    }
+    if (n < 6 || strcmp(_trim(field[0]), "name") == 0) {
+      if (lineno == 1) continue;   // header
+      fprintf(stderr, "%s:%u: expected name,id,node,dlc,format,period_ms[,jitter_ms[,deadline_ms]]\n", path, lineno);
+      return 1;
+    }
+
+    m = _add_msg(bus);
+    snprintf(m->name, sizeof(m->name), "%s", _trim(field[0]));
+    m->id = (uint32_t)strtoul(_trim(field[1]), NULL, 0);
+    snprintf(m->node, sizeof(m->node), "%s", _trim(field[2]));
+    m->dlc = (uint8_t)(strtoul(_trim(field[3]), NULL, 0) & 0xF);
+    s = _trim(field[4]);
+    if (strstr(s, "ext") != NULL) m->flags |= CAN_BUSLOAD_XTD;
+    if (strstr(s, "fd") != NULL) m->flags |= CAN_BUSLOAD_FDF;
+    if (strstr(s, "brs") != NULL) m->flags |= CAN_BUSLOAD_FDF | CAN_BUSLOAD_BRS;
+    m->period_ns = (int64_t)(strtod(_trim(field[5]), NULL) * 1e6);
+    m->jitter_ns = (n > 6) ? (int64_t)(strtod(_trim(field[6]), NULL) * 1e6) : 0;
+    m->deadline_ns = (n > 7 && *_trim(field[7]) != '\0') ? (int64_t)(strtod(_trim(field[7]), NULL) * 1e6)
+                                                         : m->period_ns;
+    if (m->period_ns <= 0) {
+      fprintf(stderr, "%s:%u: period must be positive\n", path, lineno);
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+typedef struct {
+  double cycle_ms, delay_ms, jitter_ms, deadline_ms;
+  int format, brs;          // -1: not given
+} dbc_attr_t;
+
+static void _dbc_attr(dbc_attr_t *a, const char *name, const char *value) {
+  double v = strtod(value, NULL);
+
+  if (strcmp(name, "GenMsgCycleTime") == 0) a->cycle_ms = v;
+  else if (strcmp(name, "GenMsgDelayTime") == 0) a->delay_ms = v;
+  else if (strcmp(name, "GenMsgJitter") == 0) a->jitter_ms = v;
+  else if (strcmp(name, "GenMsgDeadline") == 0) a->deadline_ms = v;
+  else if (strcmp(name, "CANFD_BRS") == 0) a->brs = (v != 0) || strstr(value, "1") != NULL;
+  else if (strcmp(name, "VFrameFormat") == 0) {
+    // enum index, or the enum string in a BA_DEF_DEF_
+    a->format = (strstr(value, "FD") != NULL || v == 14 || v == 15) ? 1 : 0;
+  }
+}
+
+static int _load_dbc(bus_t *bus, FILE *fp, const char *path) {
+  char line[1024], name[NAME_MAX_LEN], node[NODE_MAX_LEN], attr[64], value[64];
+  dbc_attr_t def = { 0, 0, 0, 0, -1, -1 }, *attrs = NULL;
+  uint32_t raw, bytes, i, skipped = 0;
+  size_t first = bus->count;
+  msg_t *m;
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    char *p = _trim(line);
+
+    if (sscanf(p, "BO_ %u %47[^: ]%*[ ]: %u %31s", &raw, name, &bytes, node) == 4 ||
+        sscanf(p, "BO_ %u %47[^:]: %u %31s", &raw, name, &bytes, node) == 4) {
+      if (raw == 0xC0000000U || strcmp(name, "VECTOR__INDEPENDENT_SIG_MSG") == 0) continue;
+      m = _add_msg(bus);
+      snprintf(m->name, sizeof(m->name), "%s", name);
+      snprintf(m->node, sizeof(m->node), "%s", node);
+      m->id = raw & 0x1FFFFFFFU;
+      if (raw & 0x80000000U) m->flags |= CAN_BUSLOAD_XTD;
+      m->dlc = _bytes_to_dlc(bytes);
+      m->period_ns = -1;   // resolved below
+    } else if (sscanf(p, "BA_DEF_DEF_ \"%63[^\"]\" %63[^;]", attr, value) == 2) {
+      _dbc_attr(&def, attr, value);
+    }
+  }
+
+  // attributes may precede or follow the messages: second pass
+  attrs = calloc(bus->count - first + 1, sizeof(dbc_attr_t));
+  if (attrs == NULL) return 1;
+  for (i = 0; i < bus->count - first; i++) {
+    attrs[i] = def;
+  }
+  rewind(fp);
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    if (sscanf(_trim(line), "BA_ \"%63[^\"]\" BO_ %u %63[^;]", attr, &raw, value) != 3) continue;
+    for (i = 0; i < bus->count - first; i++) {
+      m = &bus->msg[first + i];
+      if (m->id == (raw & 0x1FFFFFFFU) && ((m->flags & CAN_BUSLOAD_XTD) != 0) == ((raw & 0x80000000U) != 0)) {
+        _dbc_attr(&attrs[i], attr, value);
+        break;
+      }
+    }
+  }
+
+  // drop messages without a period (event frames without a minimum distance)
+  for (i = 0, raw = 0; i < bus->count - first; i++) {
+    m = &bus->msg[first + i];
+    if (attrs[i].format == 1) m->flags |= CAN_BUSLOAD_FDF;
+    if ((m->flags & CAN_BUSLOAD_FDF) && attrs[i].brs == 1) m->flags |= CAN_BUSLOAD_BRS;
+    if (!(m->flags & CAN_BUSLOAD_FDF) && m->dlc > 8) m->dlc = 8;
+    m->period_ns = (int64_t)(((attrs[i].cycle_ms > 0) ? attrs[i].cycle_ms : attrs[i].delay_ms) * 1e6);
+    m->jitter_ns = (int64_t)(attrs[i].jitter_ms * 1e6);
+    m->deadline_ns = (attrs[i].deadline_ms > 0) ? (int64_t)(attrs[i].deadline_ms * 1e6) : m->period_ns;
+    if (m->period_ns <= 0) {
+      skipped++;
+      continue;
+    }
+    bus->msg[first + raw++] = *m;
+  }
+  bus->count = first + raw;
+  free(attrs);
+
+  if (skipped > 0) fprintf(stderr, "%s: %u messages without a cycle time ignored\n", path, skipped);
+  return 0;
+}
+
+static int _cmp_key(const void *a, const void *b) {
+  const msg_t *x = a, *y = b;
+
+  return (x->key < y->key) ? -1 : (x->key > y->key) ? 1 : 0;
+}
+
+static inline int64_t _ceil_div(int64_t a, int64_t b) {
+  return (a <= 0) ? 0 : (a + b - 1) / b;
+}
+
+/* Interference of msg[0 .. hp-1] (except node skip_node if >= 0) over a window w */
+static inline int64_t _interference(const bus_t *bus, size_t hp, int skip_node, int64_t w) {
+  int64_t sum = 0;
+  size_t k;
+
+  for (k = 0; k < hp; k++) {
+    if (bus->msg[k].node_index == skip_node) continue;
+    sum += _ceil_div(w + bus->msg[k].jitter_ns + bus->tau_ns, bus->msg[k].period_ns) * bus->msg[k].c_ns;
+  }
+  return sum;
+}
+
+/* Fixed-priority analysis of msg[m] with blocking b, all instances of its busy period */
+static int64_t _rta(const bus_t *bus, size_t m, int64_t b) {
+  const msg_t *mm = &bus->msg[m];
+  int64_t t = mm->c_ns, next, w, r, worst = 0, q, instances;
+  size_t k;
+
+  // level-m busy period
+  for (;;) {
+    next = b;
+    for (k = 0; k <= m; k++) {
+      next += _ceil_div(t + bus->msg[k].jitter_ns, bus->msg[k].period_ns) * bus->msg[k].c_ns;
+    }
+    if (next == t) break;
+    if (next > LIMIT_NS) return -1;
+    t = next;
+  }
+
+  instances = _ceil_div(t + mm->jitter_ns, mm->period_ns);
+  for (q = 0; q < instances; q++) {
+    w = b + q * mm->c_ns;
+    for (;;) {
+      next = b + q * mm->c_ns + _interference(bus, m, -1, w);
+      if (next == w) break;
+      if (next > LIMIT_NS) return -1;
+      w = next;
+    }
+    r = mm->jitter_ns + w - q * mm->period_ns + mm->c_ns;
+    if (r > worst) worst = r;
+    if (worst > mm->deadline_ns) break;   // already missed, no need to look further
+  }
+
+  return worst;
+}
+
+static void _analyze(bus_t *bus) {
+  int64_t *lp_max, *std_r, b, w, next, ahead, c[MAX_NODES];
+  size_t i, j, n = bus->count, *lowest, pos;
+  uint32_t rank, k;
+  const node_t *node;
+  msg_t *m;
+
+  lp_max = calloc(n + 1, sizeof(int64_t));
+  std_r = calloc(n + 1, sizeof(int64_t));
+  lowest = calloc(MAX_NODES, sizeof(size_t));
+  if (lp_max == NULL || std_r == NULL || lowest == NULL) {
+    perror("calloc");
+    exit(2);
+  }
+
+  qsort(bus->msg, n, sizeof(msg_t), _cmp_key);
+  for (i = n; i-- > 0;) {
+    lp_max[i] = (lp_max[i + 1] > bus->msg[i].c_ns) ? lp_max[i + 1] : bus->msg[i].c_ns;
+  }
+  for (i = 0; i < n; i++) {
+    lowest[bus->msg[i].node_index] = i;
+  }
+
+  for (i = 0; i < n; i++) {
+    std_r[i] = _rta(bus, i, lp_max[i + 1]);
+    bus->msg[i].r_ns = std_r[i];
+  }
+
+  for (i = 0; i < n; i++) {
+    m = &bus->msg[i];
+    node = &bus->node[m->node_index];
+    if (node->mode == MODE_IDEAL || node->count <= 1 || m->r_ns < 0) continue;
+
+    if (node->mode == MODE_QUEUE) {
+      // lower priority frames of the node, in priority order: the last 'buffers' of them may fill the buffers
+      for (j = i + 1, rank = 0; j < n; j++) {
+        if (bus->msg[j].node_index == m->node_index) rank++;
+      }
+      if (rank < bus->buffers) continue;
+      for (j = n, k = 0, pos = n; j-- > i + 1;) {
+        if (bus->msg[j].node_index != m->node_index) continue;
+        if (++k == bus->buffers) {
+          pos = j;   // highest priority of the node's 'buffers' lowest frames: it leaves first
+          break;
+        }
+      }
+      if (std_r[pos] < 0) {
+        m->r_ns = -1;
+      } else {
+        m->r_ns += std_r[pos] - bus->msg[pos].jitter_ns;
+      }
+    } else {
+      // FIFO: the buffers-1 longest other frames of the node may be ahead
+      for (k = 0; k < bus->buffers - 1 && k < MAX_NODES; k++) c[k] = 0;
+      for (j = 0; j < n; j++) {
+        if (j == i || bus->msg[j].node_index != m->node_index) continue;
+        for (k = 0; k + 1 < bus->buffers; k++) {
+          if (bus->msg[j].c_ns > c[k]) {
+            memmove(&c[k + 1], &c[k], (bus->buffers - 2 - k) * sizeof(int64_t));
+            c[k] = bus->msg[j].c_ns;
+            break;
+          }
+        }
+      }
+      for (k = 0, ahead = 0; k + 1 < bus->buffers; k++) ahead += c[k];
+
+      pos = lowest[m->node_index];
+      b = lp_max[pos + 1];
+      w = b + ahead;
+      for (;;) {
+        next = b + ahead + _interference(bus, pos, m->node_index, w);
+        if (next == w) break;
+        if (next > LIMIT_NS) {
+          w = -1;
+          break;
+        }
+        w = next;
+      }
+      m->r_ns = (w < 0) ? -1 : m->jitter_ns + w + m->c_ns;
+      if (m->r_ns > m->period_ns) m->r_ns = -1;   // next instance queued behind this one: not covered
+    }
+  }
+
+  free(lp_max);
+  free(std_r);
+  free(lowest);
+}
+
+static int _prepare(bus_t *bus, const FDCAN_Init_t *init, uint32_t kernel_hz) {
+  can_busload_config_t cfg = { 1000000, 1000000, CAN_BUSLOAD_STUFF_WORST };
+  can_busload_bits_t bits;
+  can_busload_t bl;
+  double nominal_ns, data_ns;
+  size_t i;
+  msg_t *m;
+  int node;
+
+  nominal_ns = 1e9 * init->NominalPrescaler * (1 + init->NominalTimeSeg1 + init->NominalTimeSeg2) / kernel_hz;
+  data_ns = 1e9 * init->DataPrescaler * (1 + init->DataTimeSeg1 + init->DataTimeSeg2) / kernel_hz;
+  bus->tau_ns = (int64_t)(nominal_ns + 0.5);
+  (void)can_busload_init(&bl, &cfg);
+
+  for (i = 0; i < bus->count; i++) {
+    m = &bus->msg[i];
+    if (!(m->flags & CAN_BUSLOAD_FDF) && m->dlc > 8) m->dlc = 8;
+    can_busload_frame_bits(&bl, m->id, m->flags, m->dlc, NULL, &bits);
+    m->c_ns = (int64_t)(bits.nominal * nominal_ns + bits.data * data_ns + 0.999);
+
+    // base ID, then SRR/RTR (standard data frames win), then the extension bits
+    if (m->flags & CAN_BUSLOAD_XTD) {
+      m->key = ((uint64_t)(m->id >> 18) << 19) | (1U << 18) | (m->id & 0x3FFFF);
+    } else {
+      m->key = (uint64_t)(m->id & 0x7FF) << 19;
+    }
+
+    node = _node_index(bus, m->node);
+    if (node < 0) {
+      fprintf(stderr, "more than %u transmitting nodes\n", MAX_NODES);
+      return 1;
+    }
+    m->node_index = node;
+    bus->node[node].count++;
+  }
+
+  return 0;
+}
+
+static double _utilisation(const bus_t *bus) {
+  double u = 0;
+  size_t i;
+
+  for (i = 0; i < bus->count; i++) {
+    u += (double)bus->msg[i].c_ns / (double)bus->msg[i].period_ns;
+  }
+  return u;
+}
+
+static uint32_t _report(const bus_t *bus, bool csv, double seconds) {
+  uint32_t missed = 0;
+  const msg_t *m;
+  size_t i;
+  bool ok;
+
+  if (csv) {
+    printf("name,id,node,mode,dlc,c_us,r_us,d_us,slack_us,ok\n");
+  } else {
+    printf("%-24s %10s %-12s %-5s %3s %9s %10s %10s %10s\n", "message", "id", "node", "mode", "dlc", "C_us", "R_us",
+           "D_us", "slack_us");
+  }
+
+  for (i = 0; i < bus->count; i++) {
+    m = &bus->msg[i];
+    ok = m->r_ns >= 0 && m->r_ns <= m->deadline_ns;
+    if (!ok) missed++;
+
+    if (csv) {
+      printf("%s,0x%X,%s,%s,%u,%.3f,", m->name, (unsigned)m->id, m->node, _mode_name(bus->node[m->node_index].mode),
+             (unsigned)m->dlc, m->c_ns / 1e3);
+      if (m->r_ns >= 0) printf("%.3f,%.3f,%.3f,%d\n", m->r_ns / 1e3, m->deadline_ns / 1e3,
+                               (m->deadline_ns - m->r_ns) / 1e3, ok ? 1 : 0);
+      else printf(",%.3f,,0\n", m->deadline_ns / 1e3);
+    } else {
+      printf("%-24s %#10x %-12s %-5s %3u %9.1f ", m->name, (unsigned)m->id, m->node,
+             _mode_name(bus->node[m->node_index].mode), (unsigned)m->dlc, m->c_ns / 1e3);
+      if (m->r_ns >= 0) printf("%10.1f %10.1f %10.1f%s\n", m->r_ns / 1e3, m->deadline_ns / 1e3,
+                               (m->deadline_ns - m->r_ns) / 1e3, ok ? "" : "  MISSED");
+      else printf("%10s %10.1f %10s  MISSED\n", "unbounded", m->deadline_ns / 1e3, "-");
+    }
+  }
+
+  fprintf(stderr, "%zu messages, %u nodes, utilisation %.1f%%, %u deadline misses, analysed in %.3f ms\n",
+          bus->count, bus->nodes, _utilisation(bus) * 100.0, missed, seconds * 1e3);
+  return missed;
+}
+
+/* Synthetic bus: 'count' messages over 16 nodes, periods 50 ms .. 1 s before scaling */
+static void _bench_generate(bus_t *bus, size_t count) {
+  static const double periods_ms[] = { 5, 10, 20, 50, 100, 200, 500, 1000 };
+  uint32_t seed = 0x5EEDU, used[0x800 / 32] = { 0 }, id;
+  size_t i;
+  msg_t *m;
+
+  bus->count = 0;
+  for (i = 0; i < count; i++) {
+    m = _add_msg(bus);
+    seed = seed * 1103515245U + 12345U;
+    snprintf(m->name, sizeof(m->name), "Msg%zu", i);
+    snprintf(m->node, sizeof(m->node), "ECU%u", (seed >> 8) % 16);
+    if (i < 0x700) {
+      do {
+        seed = seed * 1103515245U + 12345U;
+        id = (seed >> 12) & 0x7FF;
+      } while (used[id / 32] & (1U << (id % 32)));
+      used[id / 32] |= 1U << (id % 32);
+      m->id = id;
+    } else {
+      m->id = 0x18000000U | (uint32_t)i;
+      m->flags = CAN_BUSLOAD_XTD;
+    }
+    m->dlc = 8;
+    if ((seed >> 20) % 10 == 0) {
+      m->flags |= CAN_BUSLOAD_FDF | CAN_BUSLOAD_BRS;
+      m->dlc = 13;
+    }
+    m->period_ns = (int64_t)(periods_ms[3 + (seed >> 24) % 5] * 1e6);
+    m->jitter_ns = (int64_t)((seed >> 4) % 500) * 1000;
+    m->deadline_ns = m->period_ns;
+  }
+}
+
+static int _bench(size_t max_count, const FDCAN_Init_t *init, uint32_t kernel_hz) {
+  static const tx_mode_t modes[] = { MODE_IDEAL, MODE_QUEUE, MODE_FIFO };
+  size_t counts[] = { 100, 500, 1000, 2000 }, c;
+  uint32_t k, missed, i;
+  bus_t bus;
+  double t0, dt, scale;
+
+  for (c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+    if (counts[c] > max_count) break;
+    for (k = 0; k < 3; k++) {
+      memset(&bus, 0, sizeof(bus));
+      bus.default_mode = modes[k];
+      bus.buffers = FDCAN_TX_BUFFERS;
+      _bench_generate(&bus, counts[c]);
+      if (_prepare(&bus, init, kernel_hz) != 0) return 2;
+      scale = _utilisation(&bus) / 0.6;   // same 60% load whatever the count
+      for (i = 0; i < bus.count; i++) {
+        bus.msg[i].period_ns = (int64_t)(bus.msg[i].period_ns * scale);
+        bus.msg[i].deadline_ns = bus.msg[i].period_ns;
+      }
+
+      t0 = _now_s();
+      _analyze(&bus);
+      dt = _now_s() - t0;
+
+      for (i = 0, missed = 0; i < bus.count; i++) {
+        if (bus.msg[i].r_ns < 0 || bus.msg[i].r_ns > bus.msg[i].deadline_ns) missed++;
+      }
+      printf("{\"tool\":\"can_wcrt\",\"mode\":\"%s\",\"messages\":%zu,\"utilisation\":%.3f,\"missed\":%u,"
+             "\"seconds\":%.4f}\n", _mode_name(modes[k]), bus.count, _utilisation(&bus), missed, dt);
+      fflush(stdout);
+      free(bus.msg);
+    }
+  }
+  return 0;
+}
+
+static int _parse_timing(const char *s, uint32_t *presc, uint32_t *tseg1, uint32_t *tseg2) {
+  unsigned a, b, c;
+
+  if (sscanf(s, "%u,%u,%u", &a, &b, &c) != 3 || a == 0 || b == 0 || c == 0) return 1;
+  *presc = a;
+  *tseg1 = b;
+  *tseg2 = c;
+  return 0;
+}
+
+static void _usage(const char *argv0) {
+  fprintf(stderr, "usage: %s [-k kernel_hz] [-N presc,tseg1,tseg2] [-D presc,tseg1,tseg2]\n"
+                  "          [-m queue|fifo|ideal] [-n node=mode]... [-b buffers] [-c] messages.csv|bus.dbc\n"
+                  "       %s --bench [messages]\n", argv0, argv0);
+}
+
+int main(int argc, char **argv) {
+  FDCAN_Init_t init;
+  uint32_t kernel_hz = 50000000U, missed;   // FDCAN kernel clock of the firmware
+  const char *overrides[MAX_NODES], *path, *ext;
+  uint32_t n_overrides = 0, i;
+  tx_mode_t mode;
+  bool csv = false;
+  double t0, dt;
+  char *eq;
+  bus_t bus;
+  FILE *fp;
+  int opt, node, rc;
+
+  memset(&init, 0, sizeof(init));
+  memset(&bus, 0, sizeof(bus));
+  init.NominalPrescaler = 1;      // 50 MHz / 100 tq = 500 kbit/s, 80% sample point
+  init.NominalTimeSeg1 = 79;
+  init.NominalTimeSeg2 = 20;
+  init.DataPrescaler = 1;         // 50 MHz / 25 tq = 2 Mbit/s, 76% sample point
+  init.DataTimeSeg1 = 18;
+  init.DataTimeSeg2 = 6;
+  bus.default_mode = MODE_QUEUE;
+  bus.buffers = FDCAN_TX_BUFFERS;
+
+  if (argc >= 2 && strcmp(argv[1], "--bench") == 0) {
+    return _bench((argc >= 3) ? (size_t)strtoul(argv[2], NULL, 0) : 2000, &init, kernel_hz);
+  }
+
+  while ((opt = getopt(argc, argv, "k:N:D:m:n:b:c")) != -1) {
+    switch (opt) {
+      case 'k':
+        kernel_hz = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'N':
+        if (_parse_timing(optarg, &init.NominalPrescaler, &init.NominalTimeSeg1, &init.NominalTimeSeg2) != 0) {
+          _usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'D':
+        if (_parse_timing(optarg, &init.DataPrescaler, &init.DataTimeSeg1, &init.DataTimeSeg2) != 0) {
+          _usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'm':
+        if (_parse_mode(optarg, &bus.default_mode) != 0) {
+          _usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'n':
+        if (n_overrides < MAX_NODES) overrides[n_overrides++] = optarg;
+        break;
+      case 'b':
+        bus.buffers = (uint32_t)strtoul(optarg, NULL, 0);
+        if (bus.buffers == 0 || bus.buffers > MAX_NODES) bus.buffers = FDCAN_TX_BUFFERS;
+        break;
+      case 'c':
+        csv = true;
+        break;
+      default:
+        _usage(argv[0]);
+        return 2;
+    }
+  }
+  if (optind != argc - 1 || kernel_hz == 0) {
+    _usage(argv[0]);
+    return 2;
+  }
+
+  path = argv[optind];
+  fp = fopen(path, "r");
+  if (fp == NULL) {
+    perror(path);
+    return 2;
+  }
+  ext = strrchr(path, '.');
+  rc = (ext != NULL && strcasecmp(ext, ".dbc") == 0) ? _load_dbc(&bus, fp, path) : _load_csv(&bus, fp, path);
+  fclose(fp);
+  if (rc != 0) return 2;
+
+  if (_prepare(&bus, &init, kernel_hz) != 0) return 2;
+
+  for (i = 0; i < n_overrides; i++) {
+    eq = strchr(overrides[i], '=');
+    if (eq == NULL || _parse_mode(eq + 1, &mode) != 0) {
+      fprintf(stderr, "bad node mode '%s', expected node=queue|fifo|ideal\n", overrides[i]);
+      return 2;
+    }
+    *eq = '\0';
+    for (node = 0; node < (int)bus.nodes; node++) {
+      if (strcmp(bus.node[node].name, overrides[i]) == 0) bus.node[node].mode = mode;
+    }
+  }
+
+  t0 = _now_s();
+  _analyze(&bus);
+  dt = _now_s() - t0;
+
+  missed = _report(&bus, csv, dt);
+  free(bus.msg);
+
+  return (missed > 0) ? 1 : 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * Host build of the SLCAN engine: the serial side is a pseudo terminal,
+ * the CAN side a simulated controller that loops sent frames back and can
+ * generate periodic traffic, so slcand/python-can can be tested without a board.
+ *
+ *   build/tools/slcan_pty [-r frames_per_second]
+ *   slcand -o -s6 -t sw /dev/pts/N can0
+ */
+#define _XOPEN_SOURCE 700
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "can/slcan.h"
+
+#define SIM_QUEUE_SIZE  64U
+
+typedef struct {
+  int fd;
+  bool open;
+  uint32_t rate;              // generated frames per second, 0 = off
+  uint64_t next_gen_ns;
+  uint32_t gen_count;
+  slcan_frame_t queue[SIM_QUEUE_SIZE];
+  uint32_t head, tail;
+} sim_port_t;
+
+static uint64_t _now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int _sim_push(sim_port_t *sim, const slcan_frame_t *frame) {
+  if (sim->head - sim->tail == SIM_QUEUE_SIZE) return 1;
+  sim->queue[sim->head++ % SIM_QUEUE_SIZE] = *frame;
+  return 0;
+}
+
+static int _sim_open(void *ctx, uint32_t nominal_bps, uint32_t data_bps, bool listen_only) {
+  sim_port_t *sim = ctx;
+
+  fprintf(stderr, "open: %u bit/s, data %u bit/s%s\n", (unsigned)nominal_bps, (unsigned)data_bps,
+          listen_only ? ", listen-only" : "");
+  sim->open = true;
+  sim->head = sim->tail = 0;
+  sim->next_gen_ns = _now_ns();
+  return 0;
+}
+
+static void _sim_close(void *ctx) {
+  sim_port_t *sim = ctx;
+
+  fprintf(stderr, "close\n");
+  sim->open = false;
+}
+
+/* Loopback: every accepted frame is received back */
+static int _sim_send(void *ctx, const slcan_frame_t *frame) {
+  return _sim_push(ctx, frame);
+}
+
+static int _sim_receive(void *ctx, slcan_frame_t *frame) {
+  sim_port_t *sim = ctx;
+  slcan_frame_t gen;
+  uint64_t now;
+
+  if (sim->rate != 0) {
+    now = _now_ns();
+    while (sim->next_gen_ns <= now && sim->head - sim->tail < SIM_QUEUE_SIZE) {
+      memset(&gen, 0, sizeof(gen));
+      gen.id = 0x100 + (sim->gen_count % 16);
+      gen.dlc = 8;
+      memcpy(gen.data, &sim->gen_count, sizeof(sim->gen_count));
+      sim->gen_count++;
+      _sim_push(sim, &gen);
+      sim->next_gen_ns += 1000000000ULL / sim->rate;
+    }
+  }
+
+  if (sim->head == sim->tail) return 1;
+  *frame = sim->queue[sim->tail++ % SIM_QUEUE_SIZE];
+  return 0;
+}
+
+static uint32_t _sim_read(void *ctx, uint8_t *buf, uint32_t max) {
+  ssize_t n = read(((sim_port_t *)ctx)->fd, buf, max);
+
+  return (n > 0) ? (uint32_t)n : 0;
+}
+
+static uint32_t _sim_write(void *ctx, const uint8_t *buf, uint32_t len) {
+  ssize_t n = write(((sim_port_t *)ctx)->fd, buf, len);
+
+  return (n > 0) ? (uint32_t)n : 0;
+}
+
+static uint32_t _sim_time_ms(void *ctx) {
+  (void)ctx;
+  return (uint32_t)(_now_ns() / 1000000ULL);
+}
+
+static const slcan_port_t sim_port_ops = {
+  .open = _sim_open,
+  .close = _sim_close,
+  .send = _sim_send,
+  .receive = _sim_receive,
+  .read = _sim_read,
+  .write = _sim_write,
+  .time_ms = _sim_time_ms,
+};
+
+int main(int argc, char **argv) {
+  static slcan_t slcan;
+  static sim_port_t sim;
+  struct termios tio;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "r:")) != -1) {
+    if (opt == 'r') {
+      sim.rate = (uint32_t)strtoul(optarg, NULL, 0);
+    } else {
+      fprintf(stderr, "usage: %s [-r frames_per_second]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  sim.fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (sim.fd < 0 || grantpt(sim.fd) != 0 || unlockpt(sim.fd) != 0) {
+    perror("posix_openpt");
+    return 1;
+  }
+  tcgetattr(sim.fd, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(sim.fd, TCSANOW, &tio);
+  fcntl(sim.fd, F_SETFL, fcntl(sim.fd, F_GETFL) | O_NONBLOCK);
+
+  printf("%s\n", ptsname(sim.fd));
+  fflush(stdout);
+
+  slcan_init(&slcan, &sim_port_ops, &sim);
+
+  while (1) {
+    slcan_poll(&slcan);
+    usleep(100);
+  }
+
+  return 0;
+}
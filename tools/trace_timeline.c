@@ -0,0 +1,275 @@
+/*
+ * Driver trace stream to Chrome/Perfetto timeline.
+ *
+ *   trace_timeline [-o timeline.json] [trace.bin]
+ *
+ * Reads the block stream written by trace_flush() (UART capture or the host
+ * TRACE_BACKEND_FILE) or a trace_export() dump, from stdin without a file
+ * argument. Bytes that are not part of a block, e.g. console text sharing
+ * the UART, are skipped up to the next block magic.
+ *
+ * Output is the Chrome trace event JSON that chrome://tracing and
+ * ui.perfetto.dev load: ISR enter/exit pairs become slices on the "ISR"
+ * track, driver events instants on one track per peripheral, Rx FIFO fill
+ * levels counters. Timestamps are unwrapped from the 32-bit clock, so gaps
+ * longer than half its period (about 8.5 s at 250 MHz) between two events
+ * are lost.
+ *
+ * Exit status: 0 on success, 2 on errors.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fdcan.h"
+#include "trace.h"
+
+#define TID_ISR         1
+#define TID_FDCAN       10      // + unit
+#define TID_USART       20
+#define TID_MARK        30
+
+typedef struct {
+  int64_t t;                // unwrapped clock
+  uint64_t seq;             // stream order, sort tie-break
+  uint32_t hz;
+  trace_event_t ev;
+} event_t;
+
+static event_t *events;
+static size_t events_n, events_cap;
+static uint64_t lost_total;
+static size_t skipped_bytes, blocks;
+
+static uint8_t *_read_all(FILE *f, size_t *len) {
+  size_t cap = 1 << 16, n = 0, r;
+  uint8_t *buf = malloc(cap);
+
+  if (buf == NULL) return NULL;
+  while ((r = fread(buf + n, 1, cap - n, f)) > 0) {
+    n += r;
+    if (n == cap) {
+      uint8_t *grown = realloc(buf, cap * 2);
+      if (grown == NULL) {
+        free(buf);
+        return NULL;
+      }
+      buf = grown;
+      cap *= 2;
+    }
+  }
+  *len = n;
+  return buf;
+}
+
+static int _push(const trace_event_t *ev, int64_t t, uint32_t hz) {
+  if (events_n == events_cap) {
+    size_t cap = events_cap ? events_cap * 2 : 4096;
+    event_t *grown = realloc(events, cap * sizeof(*events));
+    if (grown == NULL) return 1;
+    events = grown;
+    events_cap = cap;
+  }
+  events[events_n].t = t;
+  events[events_n].seq = events_n;
+  events[events_n].hz = hz;
+  events[events_n].ev = *ev;
+  events_n++;
+  return 0;
+}
+
+/* Walk the stream block by block, resynchronising on the magic */
+static int _parse(const uint8_t *buf, size_t len) {
+  trace_block_t block;
+  trace_event_t ev;
+  size_t pos = 0, body, i;
+  uint32_t magic, last = 0;
+  int64_t t = 0;
+  int started = 0;
+
+  while (pos + sizeof(block) <= len) {
+    memcpy(&magic, buf + pos, sizeof(magic));
+    if (magic != TRACE_STREAM_MAGIC) {
+      pos++;
+      skipped_bytes++;
+      continue;
+    }
+
+    memcpy(&block, buf + pos, sizeof(block));
+    body = (size_t)block.count * sizeof(trace_event_t);
+    if (block.clock_hz == 0 || pos + sizeof(block) + body > len) {
+      // not a block after all, or truncated capture
+      pos++;
+      skipped_bytes++;
+      continue;
+    }
+
+    pos += sizeof(block);
+    blocks++;
+    lost_total += block.lost;
+    for (i = 0; i < block.count; i++, pos += sizeof(ev)) {
+      memcpy(&ev, buf + pos, sizeof(ev));
+      if (ev.id == 0 || ev.id >= TRACE_EV_COUNT) continue;   // overwritten during the flush
+
+      // signed step: a writer preempted between reserving and stamping is slightly out of order
+      if (started) t += (int32_t)(ev.cycles - last);
+      started = 1;
+      last = ev.cycles;
+      if (_push(&ev, t, block.clock_hz) != 0) return 1;
+    }
+  }
+  skipped_bytes += len - pos;
+
+  return 0;
+}
+
+static int _cmp(const void *a, const void *b) {
+  const event_t *x = a, *y = b;
+
+  if (x->t != y->t) return (x->t < y->t) ? -1 : 1;
+  return (x->seq < y->seq) ? -1 : (x->seq > y->seq);
+}
+
+static const char *_vector_name(uint32_t exc, char *tmp, size_t size) {
+  switch (exc) {
+    case 15:       return "SysTick";
+    case 16 + 39:  return "FDCAN1_IT0";
+    case 16 + 40:  return "FDCAN1_IT1";
+    case 16 + 60:  return "USART3";
+    case 16 + 109: return "FDCAN2_IT0";
+    case 16 + 110: return "FDCAN2_IT1";
+    default:
+      snprintf(tmp, size, (exc < 16) ? "exception %u" : "IRQ%u", (exc < 16) ? exc : exc - 16);
+      return tmp;
+  }
+}
+
+static void _emit(FILE *out, const event_t *e, int64_t t0) {
+  const trace_event_t *ev = &e->ev;
+  double ts = (double)(e->t - t0) * 1e6 / (double)e->hz;
+  char tmp[32];
+  uint32_t fd = ev->unit + 1U;
+
+  fputs(",\n", out);
+  switch (ev->id) {
+    case TRACE_EV_ISR_ENTER:
+    case TRACE_EV_ISR_EXIT:
+      fprintf(out, "{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":0,\"tid\":%d}",
+              _vector_name(ev->aux, tmp, sizeof(tmp)), (ev->id == TRACE_EV_ISR_ENTER) ? "B" : "E",
+              ts, TID_ISR);
+      break;
+    case TRACE_EV_FDCAN_RXFIFO:
+      fprintf(out, "{\"name\":\"FDCAN%u RXFIFO%u\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":0,"
+              "\"args\":{\"level\":%u}}", fd, ev->aux, ts, ev->arg);
+      break;
+    case TRACE_EV_FDCAN_RX:
+    case TRACE_EV_FDCAN_TX_SLOT:
+      fprintf(out, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":0,\"tid\":%u,"
+              "\"args\":{\"%s\":%u,\"id\":\"0x%X\",\"ext\":%s}}",
+              (ev->id == TRACE_EV_FDCAN_RX) ? "rx" : "tx slot", ts, TID_FDCAN + ev->unit,
+              (ev->id == TRACE_EV_FDCAN_RX) ? "fifo" : "buffer", ev->aux,
+              ev->arg & ~FDCAN_EXTENDED_ID, (ev->arg & FDCAN_EXTENDED_ID) ? "true" : "false");
+      break;
+    case TRACE_EV_FDCAN_RX_ACK:
+      fprintf(out, "{\"name\":\"rx ack\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":0,\"tid\":%u,"
+              "\"args\":{\"fifo\":%u,\"index\":%u}}", ts, TID_FDCAN + ev->unit, ev->aux, ev->arg);
+      break;
+    case TRACE_EV_FDCAN_TX_REQUEST:
+      fprintf(out, "{\"name\":\"tx request\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":0,\"tid\":%u,"
+              "\"args\":{\"buffer\":%u}}", ts, TID_FDCAN + ev->unit, ev->aux);
+      break;
+    case TRACE_EV_FDCAN_TX_FULL:
+      fprintf(out, "{\"name\":\"tx full\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":0,\"tid\":%u}",
+              ts, TID_FDCAN + ev->unit);
+      break;
+    case TRACE_EV_FDCAN_IRQ_ACK:
+      fprintf(out, "{\"name\":\"irq ack\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":0,\"tid\":%u,"
+              "\"args\":{\"line\":%u,\"ir\":\"0x%08X\"}}", ts, TID_FDCAN + ev->unit, ev->aux, ev->arg);
+      break;
+    case TRACE_EV_USART_TX:
+    case TRACE_EV_USART_RX:
+      fprintf(out, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":0,\"tid\":%d,"
+              "\"args\":{\"bytes\":%u}}", (ev->id == TRACE_EV_USART_TX) ? "tx" : "rx", ts, TID_USART, ev->arg);
+      break;
+    default:
+      fprintf(out, "{\"name\":\"mark %u\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":0,\"tid\":%d,"
+              "\"args\":{\"arg\":%u}}", ev->aux, ts, TID_MARK, ev->arg);
+      break;
+  }
+}
+
+static void _thread_name(FILE *out, int tid, const char *name) {
+  fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+          tid, name);
+}
+
+static void _usage(void) {
+  fprintf(stderr, "usage: trace_timeline [-o timeline.json] [trace.bin]\n");
+}
+
+int main(int argc, char **argv) {
+  FILE *in = stdin, *out = stdout;
+  const char *out_path = NULL;
+  uint8_t *buf;
+  size_t len, i;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "o:h")) != -1) {
+    switch (opt) {
+      case 'o': out_path = optarg; break;
+      default: _usage(); return 2;
+    }
+  }
+  if (optind < argc) {
+    in = fopen(argv[optind], "rb");
+    if (in == NULL) {
+      perror(argv[optind]);
+      return 2;
+    }
+  }
+
+  buf = _read_all(in, &len);
+  if (in != stdin) fclose(in);
+  if (buf == NULL || _parse(buf, len) != 0) {
+    fprintf(stderr, "trace_timeline: out of memory\n");
+    return 2;
+  }
+  free(buf);
+
+  if (blocks == 0) {
+    fprintf(stderr, "trace_timeline: no trace block found\n");
+    return 2;
+  }
+
+  qsort(events, events_n, sizeof(*events), _cmp);
+
+  if (out_path != NULL) {
+    out = fopen(out_path, "w");
+    if (out == NULL) {
+      perror(out_path);
+      return 2;
+    }
+  }
+
+  fprintf(out, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"blocks\":%zu,\"events\":%zu,\"lost\":%llu},"
+          "\"traceEvents\":[", blocks, events_n, (unsigned long long)lost_total);
+  fputs("\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"FDCANDriver\"}}", out);
+  _thread_name(out, TID_ISR, "ISR");
+  _thread_name(out, TID_FDCAN, "FDCAN1");
+  _thread_name(out, TID_FDCAN + 1, "FDCAN2");
+  _thread_name(out, TID_USART, "USART");
+  _thread_name(out, TID_MARK, "marks");
+  for (i = 0; i < events_n; i++) {
+    _emit(out, &events[i], events[0].t);
+  }
+  fputs("\n]}\n", out);
+  if (out != stdout) fclose(out);
+
+  fprintf(stderr, "%zu blocks, %zu events, %llu lost, %zu bytes skipped\n",
+          blocks, events_n, (unsigned long long)lost_total, skipped_bytes);
+  free(events);
+
+  return 0;
+}